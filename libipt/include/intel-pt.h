@@ -50,6 +50,7 @@ extern "C" {
  * - Query decoder
  * - Traced image
  * - Instruction flow decoder
+ * - Binary instruction trace
  */
 
 
@@ -581,6 +582,15 @@ struct pt_errata {
 /** An unknown packet. */
 struct pt_packet_unknown;
 
+/** A part of a scattered trace buffer. */
+struct pt_trace_part {
+	/** The begin address of this part. */
+	uint8_t *begin;
+
+	/** The end address of this part. */
+	uint8_t *end;
+};
+
 /** An Intel PT decoder configuration.
  */
 struct pt_config {
@@ -645,6 +655,28 @@ struct pt_config {
 	 * packets.
 	 */
 	uint8_t nom_freq;
+
+	/** An optional list of trace buffer parts following \@begin-\@end.
+	 *
+	 * The trace may be split into several non-overlapping buffers, e.g.
+	 * when a wrapped ring buffer is decoded in place.  The trace starts
+	 * in the buffer given by \@begin and \@end and continues in \@parts
+	 * in array order.  Empty parts are ignored.
+	 *
+	 * The decoders treat the concatenation of all parts as one contiguous
+	 * trace.  Trace offsets are counted from \@begin.  While decoding a
+	 * scattered trace, \@begin and \@end in the configuration returned
+	 * by the decoder describe the memory that is currently being read.
+	 *
+	 * The array and the memory it describes must remain valid for as long
+	 * as the configuration is used.
+	 *
+	 * This is ignored by the encoder.
+	 */
+	const struct pt_trace_part *parts;
+
+	/** The number of trace buffer parts in \@parts. */
+	uint32_t nparts;
 };
 
 
@@ -1156,6 +1188,15 @@ enum pt_event_type {
 	ptev_async_vmcs
 };
 
+/** Return the event mask bit for events of type \@type.
+ *
+ * Event masks are bit-vectors with one bit per pt_event_type.
+ */
+static inline uint32_t pt_event_mask(enum pt_event_type type)
+{
+	return 1u << type;
+}
+
 /** An event. */
 struct pt_event {
 	/** The type of the event. */
@@ -1494,6 +1535,36 @@ extern pt_export int pt_qry_indirect_branch(struct pt_query_decoder *decoder,
 extern pt_export int pt_qry_event(struct pt_query_decoder *decoder,
 				  struct pt_event *event, size_t size);
 
+/** Select the events to report.
+ *
+ * Sets \@decoder's event mask to \@mask.  Only events whose type is set in
+ * \@mask are reported.  Use pt_event_mask() to construct \@mask.
+ *
+ * Other events are still applied to \@decoder's internal state but they are
+ * neither reported via pt_qry_event() nor signaled via pts_event_pending.
+ * They are skipped as soon as there are no more cached TNT bits to consume,
+ * i.e. when they would otherwise have been signaled.
+ *
+ * By default, all events are reported.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ *
+ * Returns -pte_invalid if \@decoder is NULL.
+ */
+extern pt_export int pt_qry_set_event_mask(struct pt_query_decoder *decoder,
+					   uint32_t mask);
+
+/** Get the events to report.
+ *
+ * Provides \@decoder's event mask in \@mask.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ *
+ * Returns -pte_invalid if \@decoder or \@mask is NULL.
+ */
+extern pt_export int
+pt_qry_get_event_mask(const struct pt_query_decoder *decoder, uint32_t *mask);
+
 /** Query the current time.
  *
  * On success, provides the time at \@decoder's current position in \@time.
@@ -1624,11 +1695,62 @@ extern pt_export int pt_image_add_file(struct pt_image *image,
 				       const struct pt_asid *asid,
 				       uint64_t vaddr);
 
+/** A segment of a file to be added to the traced memory image. */
+struct pt_file_segment {
+	/** The offset of the segment in the file. */
+	uint64_t offset;
+
+	/** The size of the segment in bytes. */
+	uint64_t size;
+
+	/** The virtual address at which the segment is loaded. */
+	uint64_t vaddr;
+
+	/** The result of adding the segment.
+	 *
+	 * This is set by pt_image_add_file_segments() to zero if a section
+	 * was added for the segment and to a negative pt_error_code
+	 * otherwise.
+	 */
+	int status;
+};
+
+/** Add file sections for several segments of one file.
+ *
+ * Adds a section for each of the \@nsegments segments in \@segments of
+ * \@filename in the address space \@asid.  This is equivalent to calling
+ * pt_image_add_file() for each segment but accesses \@filename only once.
+ * The sections access \@filename again when they are first read.
+ *
+ * Segments that would overlap with other sections or that start beyond the
+ * end of \@filename will be ignored.  The other segments are silently
+ * truncated to match the size of \@filename.
+ *
+ * Sets the status field of each segment in \@segments to the result of
+ * adding it.  If the function fails, segments that were not added get the
+ * returned error code.
+ *
+ * Returns the number of ignored segments on success, a negative error code
+ * otherwise.
+ *
+ * Returns -pte_invalid if \@image or \@filename is NULL.
+ * Returns -pte_invalid if \@segments is NULL and \@nsegments is not zero.
+ * Returns -pte_invalid if \@filename can not be accessed.
+ */
+extern pt_export int
+pt_image_add_file_segments(struct pt_image *image, const char *filename,
+			   struct pt_file_segment *segments,
+			   uint32_t nsegments, const struct pt_asid *asid);
+
 /** Copy an image.
  *
  * Adds all sections from \@src to \@image.  Sections that would overlap with
  * existing sections will be ignored.
  *
+ * If \@image does not contain any sections, it shares \@src's sections
+ * instead of adding them one by one.  This takes constant time.  Later
+ * changes to either image do not affect the other.
+ *
  * Returns the number of ignored images on success, a negative error code
  * otherwise.
  *
@@ -1637,6 +1759,48 @@ extern pt_export int pt_image_add_file(struct pt_image *image,
 extern pt_export int pt_image_copy(struct pt_image *image,
 				   const struct pt_image *src);
 
+/** Save an image.
+ *
+ * Writes a manifest of the file sections in \@image to \@filename.  It lists
+ * the sections with their address spaces and virtual addresses as well as
+ * the size and modification time of each section's file at the time of
+ * saving.  Use pt_image_load() to load the manifest into another image.
+ *
+ * The read memory callback and sections whose file name contains a new-line
+ * are not saved.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ *
+ * Returns -pte_bad_image if a section's file can not be accessed or if its
+ * name contains a new-line.
+ * Returns -pte_invalid if \@image or \@filename is NULL.
+ * Returns -pte_invalid if \@filename can not be written.
+ * Returns -pte_nomem if memory allocation failed.
+ */
+extern pt_export int pt_image_save(const struct pt_image *image,
+				   const char *filename);
+
+/** Load an image.
+ *
+ * Adds the sections listed in the manifest \@filename written by
+ * pt_image_save() to \@image.  The section files are not accessed until
+ * they are first read.  If a file's size or modification time differs from
+ * the manifest, its sections can not be read.
+ *
+ * Sections that would overlap with existing sections will be ignored.
+ * Successfully added sections are not removed in case of errors.
+ *
+ * Returns the number of ignored sections on success, a negative error code
+ * otherwise.
+ *
+ * Returns -pte_bad_image if \@filename is not a valid manifest.
+ * Returns -pte_invalid if \@image or \@filename is NULL.
+ * Returns -pte_invalid if \@filename can not be read.
+ * Returns -pte_nomem if memory allocation failed.
+ */
+extern pt_export int pt_image_load(struct pt_image *image,
+				   const char *filename);
+
 /** Remove all sections loaded from a file.
  *
  * Removes all sections loaded from \@filename from the address space \@asid.
@@ -1691,6 +1855,56 @@ extern pt_export int pt_image_set_callback(struct pt_image *image,
 					   read_memory_callback_t *callback,
 					   void *context);
 
+/** Set a block memory callback for the traced memory image.
+ *
+ * Like pt_image_set_callback() but \@callback is asked to read an entire
+ * 4KB page at a page-aligned address.  It may read less than the page if
+ * the memory ends within that page.
+ *
+ * The pages are cached inside \@image so repeated reads from the same page
+ * do not call \@callback again.  Setting a callback, again, flushes that
+ * cache.
+ *
+ * Returns -pte_invalid if \@image is NULL.
+ */
+extern pt_export int
+pt_image_set_block_callback(struct pt_image *image,
+			    read_memory_callback_t *callback, void *context);
+
+/** Advice for mapping file sections.
+ *
+ * The values are bits that can be combined.
+ */
+enum pt_map_advice {
+	/** Prefault sections that are mapped entirely. */
+	ptma_prefault	= 1 << 0,
+
+	/** Expect random access to big sections that are mapped in windows.
+	 *
+	 * This avoids reading ahead.
+	 */
+	ptma_random	= 1 << 1
+};
+
+/** Set the advice for mapping file sections.
+ *
+ * Sets \@advice, a bit-vector of enum pt_map_advice values, for mapping the
+ * file sections of \@image.  The advice is passed on to the operating system
+ * when a section is mapped for reading memory from \@image.  It is a hint
+ * that is ignored where it is not supported.
+ *
+ * Sections can be shared between images.  They are mapped with the combined
+ * advice of all images that read from them.  Sections that are already
+ * mapped are not affected until they are mapped again.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ *
+ * Returns -pte_invalid if \@image is NULL.
+ * Returns -pte_invalid if \@advice contains unknown bits.
+ */
+extern pt_export int pt_image_set_advice(struct pt_image *image,
+					 uint32_t advice);
+
 
 
 /* Instruction flow decoder. */
@@ -1950,6 +2164,44 @@ extern pt_export int pt_insn_time(struct pt_insn_decoder *decoder,
 extern pt_export int pt_insn_core_bus_ratio(struct pt_insn_decoder *decoder,
 					    uint32_t *cbr);
 
+/** A frame on the instruction flow decoder's shadow call stack. */
+struct pt_call_frame {
+	/** The address of the call instruction. */
+	uint64_t call;
+
+	/** The address of the called function. */
+	uint64_t target;
+
+	/** The return address. */
+	uint64_t ret;
+};
+
+/** Return the depth of the shadow call stack.
+ *
+ * The instruction flow decoder maintains a shadow call stack of near calls
+ * that have not yet returned.  It is cleared on synchronization.  Calls to
+ * the next instruction, as used by position-independent code, are ignored.
+ *
+ * Returns the number of frames on success, a negative error code otherwise.
+ *
+ * Returns -pte_invalid if \@decoder is NULL.
+ */
+extern pt_export int pt_insn_call_depth(const struct pt_insn_decoder *decoder);
+
+/** Get a shadow call stack frame.
+ *
+ * On success, provides the frame at \@level in \@frame.  Level zero is the
+ * innermost frame, i.e. the most recent call that has not yet returned.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ *
+ * Returns -pte_invalid if \@decoder or \@frame is NULL.
+ * Returns -pte_invalid if \@level is not smaller than the call depth.
+ */
+extern pt_export int pt_insn_call_frame(const struct pt_insn_decoder *decoder,
+					struct pt_call_frame *frame,
+					uint32_t level);
+
 /** Determine the next instruction.
  *
  * On success, provides the next instruction in execution order in \@insn.
@@ -1975,6 +2227,183 @@ extern pt_export int pt_insn_core_bus_ratio(struct pt_insn_decoder *decoder,
 extern pt_export int pt_insn_next(struct pt_insn_decoder *decoder,
 				  struct pt_insn *insn, size_t size);
 
+
+
+/* Binary instruction trace. */
+
+
+
+/** The binary instruction trace format.
+ *
+ * This is a compact encoding of a sequence of instructions as produced by the
+ * instruction flow decoder.  It is a sequence of records.  Each record starts
+ * with a tag byte whose lower four bits give the record type:
+ *
+ *   0x0 - 0x8  an instruction of the respective pt_insn_class.
+ *   0xe        an error.
+ *   0xf        a sync record.
+ *
+ * A sync record gives the IP and execution mode of the next instruction.  It
+ * is followed by the execution mode in one byte and the IP in eight bytes
+ * in little endian byte order.  There is a sync record before the first
+ * instruction, on every execution mode change, after each error, and after
+ * pt_bin_sync_period instructions.
+ *
+ * An instruction record is followed by the instruction size.  The upper bits
+ * of the tag byte indicate which optional fields follow:
+ *
+ *   0x10  the instruction flags.
+ *   0x20  the difference between the instruction's IP and the IP following
+ *         the previous instruction.
+ *   0x40  the raw instruction bytes.
+ *
+ * An error record is followed by the negated error code, the trace offset,
+ * and the IP at which the error occurred.
+ *
+ * Numbers are encoded as unsigned LEB128.  Signed numbers are zigzag encoded
+ * before.
+ */
+enum {
+	/** The maximal number of instructions between two sync records. */
+	pt_bin_sync_period	= 1024,
+
+	/** The maximal size of a record in bytes including a preceding sync
+	 * record.
+	 */
+	pt_bin_max_record_size	= 48
+};
+
+/** The state of a binary instruction trace writer or reader.
+ *
+ * Initialize it with pt_bin_init() and use it for the entire stream.
+ */
+struct pt_bin_state {
+	/** The IP of the next instruction if it follows sequentially. */
+	uint64_t ip;
+
+	/** The number of instructions since the last sync record. */
+	uint32_t count;
+
+	/** The execution mode. */
+	uint8_t mode;
+
+	/** A flag saying whether \@ip and \@mode are valid. */
+	uint8_t sync;
+};
+
+/** A binary instruction trace record type. */
+enum pt_bin_record_type {
+	/** An instruction. */
+	pbr_insn,
+
+	/** An error. */
+	pbr_error,
+
+	/** A sync record. */
+	pbr_sync
+};
+
+/** A binary instruction trace error record. */
+struct pt_bin_error {
+	/** The negative pt_error_code enumeration constant. */
+	int errcode;
+
+	/** The trace offset at which the error occurred. */
+	uint64_t offset;
+
+	/** The IP at which the error occurred. */
+	uint64_t ip;
+};
+
+/** A binary instruction trace sync record. */
+struct pt_bin_sync {
+	/** The IP of the next instruction. */
+	uint64_t ip;
+
+	/** The execution mode of the next instruction. */
+	enum pt_exec_mode mode;
+};
+
+/** A binary instruction trace record. */
+struct pt_bin_record {
+	/** The type of the record.
+	 *
+	 * This also determines the \@variant field.
+	 */
+	enum pt_bin_record_type type;
+
+	/** Record specific data. */
+	union {
+		/** Record: pbr_insn.
+		 *
+		 * The raw bytes are zero unless they were written.
+		 */
+		struct pt_insn insn;
+
+		/** Record: pbr_error. */
+		struct pt_bin_error error;
+
+		/** Record: pbr_sync. */
+		struct pt_bin_sync sync;
+	} variant;
+};
+
+/** Initialize a binary instruction trace writer or reader state. */
+extern pt_export void pt_bin_init(struct pt_bin_state *state);
+
+/** Write an instruction record.
+ *
+ * Writes \@insn into the buffer starting at \@pos and ending at \@end.
+ * Writes a sync record before the instruction record if needed.  If \@raw is
+ * non-zero, includes the raw instruction bytes.
+ *
+ * Returns the number of bytes written on success, a negative error code
+ * otherwise.
+ *
+ * Returns -pte_eos if there are less than pt_bin_max_record_size bytes
+ * between \@pos and \@end.  Nothing is written in this case.
+ * Returns -pte_invalid if \@state, \@pos, or \@insn is NULL.
+ * Returns -pte_invalid if \@insn's size, class, or mode is invalid.
+ */
+extern pt_export int pt_bin_write_insn(struct pt_bin_state *state,
+				       uint8_t *pos, const uint8_t *end,
+				       const struct pt_insn *insn, int raw);
+
+/** Write an error record.
+ *
+ * Writes an error record for \@errcode at trace offset \@offset and IP \@ip
+ * into the buffer starting at \@pos and ending at \@end.
+ *
+ * Returns the number of bytes written on success, a negative error code
+ * otherwise.
+ *
+ * Returns -pte_eos if there are less than pt_bin_max_record_size bytes
+ * between \@pos and \@end.  Nothing is written in this case.
+ * Returns -pte_invalid if \@state or \@pos is NULL.
+ */
+extern pt_export int pt_bin_write_error(struct pt_bin_state *state,
+					uint8_t *pos, const uint8_t *end,
+					int errcode, uint64_t offset,
+					uint64_t ip);
+
+/** Read the next record.
+ *
+ * Reads the record starting at \@pos into \@record.  The buffer ends at
+ * \@end.
+ *
+ * Returns the number of bytes read on success, a negative error code
+ * otherwise.
+ *
+ * Returns -pte_bad_opc if the record type is not known.
+ * Returns -pte_bad_packet if the record is corrupt.
+ * Returns -pte_eos if the record is not complete.
+ * Returns -pte_invalid if \@state, \@record, or \@pos is NULL.
+ * Returns -pte_nosync if there was no sync record before an instruction.
+ */
+extern pt_export int pt_bin_read(struct pt_bin_state *state,
+				 struct pt_bin_record *record,
+				 const uint8_t *pos, const uint8_t *end);
+
 #ifdef __cplusplus
 }
 #endif
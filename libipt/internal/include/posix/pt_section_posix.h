@@ -32,6 +32,10 @@
 #include <stdint.h>
 #include <sys/stat.h>
 
+#if defined(FEATURE_THREADS)
+#  include <threads.h>
+#endif /* defined(FEATURE_THREADS) */
+
 struct pt_section;
 
 
@@ -53,6 +57,64 @@ struct pt_sec_posix_mapping {
 	const uint8_t *begin, *end;
 };
 
+/* Sections bigger than @pt_sec_posix_window_threshold bytes are not mapped
+ * entirely.  They are mapped in windows of @pt_sec_posix_window_size bytes
+ * on demand, instead.  At most @pt_sec_posix_nwindows windows are mapped at
+ * any time.
+ *
+ * Each window extends @pt_sec_posix_window_overlap bytes into the next so
+ * any read starting inside a window can be served from that window.
+ *
+ * The window size must be a power of two.
+ */
+enum {
+	pt_sec_posix_window_size	= 0x200000,
+	pt_sec_posix_window_overlap	= 0x10000,
+	pt_sec_posix_window_threshold	= 0x1000000,
+	pt_sec_posix_nwindows		= 4
+};
+
+/* A window into a big section. */
+struct pt_sec_posix_window {
+	/* The mmap base address - NULL if the window is not mapped. */
+	uint8_t *base;
+
+	/* The mapped memory size. */
+	uint64_t size;
+
+	/* The begin and end of the window's memory. */
+	const uint8_t *begin, *end;
+
+	/* The offset of @begin in the section. */
+	uint64_t offset;
+
+	/* The time of the last access for finding the least recently used
+	 * window.
+	 */
+	uint64_t used;
+};
+
+/* Windowed MMAP-based section mapping information. */
+struct pt_sec_posix_windows {
+	/* The file descriptor. */
+	int fd;
+
+	/* The windows. */
+	struct pt_sec_posix_window window[pt_sec_posix_nwindows];
+
+	/* The current time - the number of window accesses. */
+	uint64_t clock;
+
+#if defined(FEATURE_THREADS)
+	/* A lock protecting @window and @clock.
+	 *
+	 * A read may need to replace a window that another read is still
+	 * copying from.
+	 */
+	mtx_t lock;
+#endif /* defined(FEATURE_THREADS) */
+};
+
 
 /* Map a section.
  *
@@ -64,6 +126,20 @@ struct pt_sec_posix_mapping {
  */
 extern int pt_sec_posix_map(struct pt_section *section, int fd);
 
+/* Map a big section in windows.
+ *
+ * Maps the first window to check that @fd can be mapped.  Further windows
+ * are mapped on demand by pt_sec_posix_read_windows().
+ *
+ * On success, sets @section's mapping, unmap, and read pointers and takes
+ * ownership of @fd.  It will be closed when @section is unmapped.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @section is NULL.
+ * Returns -pte_nomem if @section can't be mapped.
+ */
+extern int pt_sec_posix_map_windows(struct pt_section *section, int fd);
+
 /* Unmap a section.
  *
  * On success, clears @section's mapping, unmap, and read pointers.
@@ -74,6 +150,16 @@ extern int pt_sec_posix_map(struct pt_section *section, int fd);
  */
 extern int pt_sec_posix_unmap(struct pt_section *section);
 
+/* Unmap a section that has been mapped in windows.
+ *
+ * On success, clears @section's mapping, unmap, and read pointers.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @section is NULL.
+ * Returns -pte_internal if @section has not been mapped.
+ */
+extern int pt_sec_posix_unmap_windows(struct pt_section *section);
+
 /* Read memory from an mmaped section.
  *
  * Reads at most @size bytes from @section at @offset into @buffer.
@@ -85,4 +171,19 @@ extern int pt_sec_posix_unmap(struct pt_section *section);
 extern int pt_sec_posix_read(const struct pt_section *section, uint8_t *buffer,
 			     uint16_t size, uint64_t offset);
 
+/* Read memory from a section that has been mapped in windows.
+ *
+ * Reads at most @size bytes from @section at @offset into @buffer.  Maps the
+ * window containing @offset if it is not already mapped, replacing the least
+ * recently used window.
+ *
+ * Returns the number of bytes read on success, a negative error code otherwise.
+ * Returns -pte_invalid if @section or @buffer are NULL.
+ * Returns -pte_nomem if the window can't be mapped.
+ * Returns -pte_bad_lock on any locking error.
+ */
+extern int pt_sec_posix_read_windows(const struct pt_section *section,
+				     uint8_t *buffer, uint16_t size,
+				     uint64_t offset);
+
 #endif /* PT_SECTION_POSIX_H */
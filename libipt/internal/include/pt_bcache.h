@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PT_BCACHE_H
+#define PT_BCACHE_H
+
+#include "pt_ild.h"
+
+#include <stdint.h>
+
+
+/* The size of the branch target cache in number of entries.
+ *
+ * This must be a power of two.
+ */
+enum {
+	pt_bcache_size	= 256
+};
+
+/* A branch target cache entry. */
+struct pt_bcache_entry {
+	/* The IP of the direct branch instruction. */
+	uint64_t ip;
+
+	/* The decoded instruction at the branch target.
+	 *
+	 * Its runtime address is the branch target IP.  Its itext pointer is
+	 * not valid; the instruction bytes are stored in @raw.
+	 */
+	struct pt_ild ild;
+
+	/* The memory at the branch target. */
+	uint8_t raw[pt_max_insn_size];
+
+	/* The number of valid bytes in @raw. */
+	uint8_t size;
+
+	/* A flag saying whether this entry is used. */
+	uint8_t valid;
+};
+
+/* A direct-mapped cache of direct branch targets.
+ *
+ * It maps the IP of a direct branch to the decoded instruction at its
+ * target.  It is used for branches and targets within a single section.
+ */
+struct pt_bcache {
+	/* The cache entries indexed by a hash of the branch IP. */
+	struct pt_bcache_entry entry[pt_bcache_size];
+};
+
+
+/* Allocate an empty branch target cache.
+ *
+ * Returns the new cache on success, NULL otherwise.
+ */
+extern struct pt_bcache *pt_bcache_alloc(void);
+
+/* Free a branch target cache. */
+extern void pt_bcache_free(struct pt_bcache *bcache);
+
+/* Look up the target of the direct branch at @ip.
+ *
+ * On success, provides a pointer to the cache entry in @entry.  The pointer
+ * remains valid until the next pt_bcache_add() or pt_bcache_free().
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @bcache or @entry is NULL.
+ * Returns -pte_nomap if @bcache does not contain @ip.
+ */
+extern int pt_bcache_lookup(const struct pt_bcache *bcache,
+			    const struct pt_bcache_entry **entry, uint64_t ip);
+
+/* Add a branch target.
+ *
+ * Adds @entry to @bcache replacing any entry that maps to the same slot.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @bcache or @entry is NULL.
+ * Returns -pte_internal if @entry->size is too big.
+ */
+extern int pt_bcache_add(struct pt_bcache *bcache,
+			 const struct pt_bcache_entry *entry);
+
+#endif /* PT_BCACHE_H */
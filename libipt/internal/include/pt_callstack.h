@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PT_CALLSTACK_H
+#define PT_CALLSTACK_H
+
+#include "intel-pt.h"
+
+#include <stdint.h>
+
+
+/* The shadow call stack capacity in number of frames.
+ *
+ * The stack starts with @pt_callstack_min frames and doubles its capacity
+ * when it is full until it reaches @pt_callstack_max frames.  From then on,
+ * the oldest frame is dropped on each push.
+ *
+ * Both must be powers of two.
+ */
+enum {
+	pt_callstack_min	= 64,
+	pt_callstack_max	= 1 << 20
+};
+
+/* A growable stack of call frames.
+ *
+ * The frames are kept in a ring buffer so the oldest frame can be dropped
+ * in constant time once the maximal capacity has been reached.
+ */
+struct pt_callstack {
+	/* The frames - NULL if nothing has been pushed, yet. */
+	struct pt_call_frame *frame;
+
+	/* The capacity of @frame in number of frames. */
+	uint32_t capacity;
+
+	/* The index one past the top of the stack. */
+	uint32_t top;
+
+	/* The number of frames on the stack. */
+	uint32_t depth;
+};
+
+/* Initialize an empty call stack. */
+extern void pt_callstack_init(struct pt_callstack *callstack);
+
+/* Finalize a call stack.
+ *
+ * This frees the frames.
+ */
+extern void pt_callstack_fini(struct pt_callstack *callstack);
+
+/* Remove all frames from a call stack.
+ *
+ * This keeps the memory for re-use.
+ */
+extern void pt_callstack_clear(struct pt_callstack *callstack);
+
+/* Push a frame onto a call stack.
+ *
+ * Grows @callstack if it is full.  If @callstack already has its maximal
+ * capacity, drops the oldest frame.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @callstack or @frame is NULL.
+ * Returns -pte_nomem if @callstack could not be grown.
+ */
+extern int pt_callstack_push(struct pt_callstack *callstack,
+			     const struct pt_call_frame *frame);
+
+/* Pop the top frame from a call stack.
+ *
+ * If @frame is not NULL, provides the popped frame in @frame.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @callstack is NULL.
+ * Returns -pte_noip if @callstack is empty.
+ */
+extern int pt_callstack_pop(struct pt_callstack *callstack,
+			    struct pt_call_frame *frame);
+
+/* Return the number of frames on a call stack.
+ *
+ * Returns the depth on success, a negative error code otherwise.
+ * Returns -pte_internal if @callstack is NULL.
+ */
+extern int pt_callstack_depth(const struct pt_callstack *callstack);
+
+/* Get a frame from a call stack.
+ *
+ * Provides the frame at @level in @frame.  Level zero is the top frame.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @callstack or @frame is NULL.
+ * Returns -pte_invalid if @level is not smaller than the depth.
+ */
+extern int pt_callstack_frame(const struct pt_callstack *callstack,
+			      struct pt_call_frame *frame, uint32_t level);
+
+#endif /* PT_CALLSTACK_H */
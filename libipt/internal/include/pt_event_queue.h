@@ -44,21 +44,56 @@ enum pt_event_binding {
 };
 
 enum {
-	/* The maximal number of pending events - should be a power of two. */
-	evq_max = 8
+	/* The maximal number of pending events per binding.
+	 *
+	 * This is the largest number of events that may bind to the same
+	 * packet:
+	 *
+	 *   evb_psbend:	MODE.EXEC, MODE.TSX, PIP, VMCS
+	 *   evb_tip:	MODE.EXEC, FUP, PIP, VMCS
+	 *   evb_fup:	OVF, MODE.TSX
+	 */
+	evq_max = 4,
+
+	/* The number of event slots.
+	 *
+	 * All bindings may be full while the last two events that have been
+	 * handed out are still in use.
+	 */
+	evq_size = (evb_max * evq_max) + 2
 };
 
-/* A queue of events. */
+/* A queue of events.
+ *
+ * Events are constructed in place in a pool of event slots shared by all
+ * bindings.  The per-binding queues only hold slot indices.
+ *
+ * An event that has been handed out, either as standalone event or by
+ * dequeuing it, remains valid until two more events have been handed out.
+ * This allows the query decoder to decode one event ahead of its user while
+ * its user still holds a reference to the previous event.
+ */
 struct pt_event_queue {
-	/* A collection of event queues, one per binding. */
-	struct pt_event queue[evb_max][evq_max];
-
-	/* The begin and end indices for the above event queues. */
-	uint8_t begin[evb_max];
-	uint8_t end[evb_max];
-
-	/* A standalone event to be published immediately. */
-	struct pt_event standalone;
+	/* The event slots. */
+	struct pt_event event[evq_size];
+
+	/* A collection of event queues, one per binding, in FIFO order.
+	 *
+	 * Each entry is an index into @event.
+	 */
+	uint8_t queue[evb_max][evq_max];
+
+	/* The number of pending events per binding. */
+	uint8_t size[evb_max];
+
+	/* The indices of the last and the next-to-last event handed out or
+	 * evq_size if none.
+	 */
+	uint8_t current;
+	uint8_t previous;
+
+	/* A bit-vector of slots in use - bit i corresponds to @event[i]. */
+	uint16_t used;
 };
 
 
@@ -66,6 +101,8 @@ struct pt_event_queue {
 extern void pt_evq_init(struct pt_event_queue *);
 
 /* Get a standalone event.
+ *
+ * The event is handed out immediately.
  *
  * Returns a pointer to the standalone event on success.
  * Returns NULL if @evq is NULL.
@@ -88,6 +125,9 @@ extern struct pt_event *pt_evq_enqueue(struct pt_event_queue *evq,
  *
  * Removes the first event for binding @evb from @evq.
  *
+ * The event is handed out and remains valid until two more events have been
+ * handed out.
+ *
  * Returns a pointer to the dequeued event on success.
  * Returns NULL if @evq is NULL or @evb is invalid.
  * Returns NULL if @evq is empty.
@@ -144,6 +144,18 @@ struct pt_ild {
 	/* imm_pos can be derived from disp_pos + disp_bytes. */
 };
 
+/* The result of an instruction run decode. */
+struct pt_ild_run {
+	/* The number of instructions decoded.
+	 *
+	 * This includes the terminating instruction, if any.
+	 */
+	uint64_t ninsn;
+
+	/* The total length of those instructions in bytes. */
+	uint64_t size;
+};
+
 static inline pti_map_enum_t pti_get_map(const struct pt_ild *ild)
 {
 	return (pti_map_enum_t) ild->map;
@@ -180,4 +192,30 @@ extern int pt_instruction_length_decode(struct pt_ild *ild);
  */
 extern int pt_instruction_decode(struct pt_ild *ild);
 
+/* Decode a run of instructions.
+ *
+ * Decodes instructions in the @size bytes at @itext forward until the first
+ * interesting instruction or until the end of the buffer.
+ *
+ * The execution mode is taken from @ild->mode and the address of the first
+ * instruction from @ild->runtime_address.  The remaining inputs of @ild are
+ * ignored.
+ *
+ * On return, @run gives the number and total size of the instructions that
+ * have been decoded and @ild holds the last of those instructions, including
+ * its runtime address.  This is the terminating instruction if one was found.
+ * If no instruction was decoded, @ild is not modified.
+ *
+ * If an instruction crosses the end of the buffer, the run ends before that
+ * instruction.  The caller may retry with more bytes.
+ *
+ * Returns a positive number if the run ended at an interesting instruction.
+ * Returns zero if the run ended at the end of the buffer.
+ * Returns a negative error code otherwise.  In this case, @run gives the
+ * instructions up to the one that could not be decoded.
+ * Returns -pte_internal if @ild, @run, or @itext is NULL.
+ */
+extern int pt_ild_run(struct pt_ild *ild, struct pt_ild_run *run,
+		      const uint8_t *itext, uint64_t size);
+
 #endif /* PT_ILD_H */
@@ -30,11 +30,14 @@
 #define PT_IMAGE_H
 
 #include "pt_mapped_section.h"
+#include "pt_image_index.h"
 
 #include "intel-pt.h"
 
 #include <stdint.h>
 
+struct pt_bcache;
+struct pt_bcache_entry;
 
 /* A list of sections. */
 struct pt_section_list {
@@ -44,17 +47,115 @@ struct pt_section_list {
 	/* The mapped section. */
 	struct pt_mapped_section section;
 
+	/* The branch target cache for @section - NULL if not yet needed.
+	 *
+	 * It is allocated on the first pt_image_bcache_add() and freed
+	 * together with this list element.
+	 */
+	struct pt_bcache *bcache;
+
 	/* A flag saying whether @section is already mapped. */
 	uint32_t mapped:1;
 };
 
-/* A traced image consisting of a collection of sections. */
+/* The sections of one address space that have been used for reading memory.
+ *
+ * They hold the state of reading memory from the sections of an image's
+ * index that is kept per image.
+ */
+struct pt_image_space {
+	/* The next address space in the same hash bucket. */
+	struct pt_image_space *next;
+
+	/* The cr3 value identifying this address space.
+	 *
+	 * The vmcs is checked for each section.
+	 */
+	uint64_t cr3;
+
+	/* The list of sections. */
+	struct pt_section_list *sections;
+};
+
+/* The size of a block read via the block memory callback and the number of
+ * cached blocks.
+ *
+ * Both must be powers of two.
+ */
+enum {
+	pt_image_block_size	= 4096,
+	pt_image_nblocks	= 64
+};
+
+/* A block of memory read via the read memory callback. */
+struct pt_image_block {
+	/* The address space of the block. */
+	uint64_t cr3;
+	uint64_t vmcs;
+
+	/* The page-aligned virtual address of the block. */
+	uint64_t addr;
+
+	/* The number of valid bytes in @data - zero if the entry is unused. */
+	uint16_t size;
+
+	/* The memory. */
+	uint8_t data[pt_image_block_size];
+};
+
+/* The number of address space hash buckets.
+ *
+ * This must be a power of two.
+ */
+enum {
+	pt_image_nbuckets	= 64
+};
+
+/* A traced image consisting of a collection of sections.
+ *
+ * The sections are kept in an index that is shared with copies of the
+ * image.  The sections that were used for reading memory are grouped into
+ * address spaces by their cr3 so reading memory only needs to search the
+ * current address space and the sections that are shared by all address
+ * spaces.
+ */
 struct pt_image {
 	/* The optional image name. */
 	char *name;
 
-	/* The list of sections. */
-	struct pt_section_list *sections;
+	/* The sections of this image - NULL if there are none.
+	 *
+	 * The index may be shared with copies of this image.
+	 */
+	struct pt_image_index *index;
+
+	/* The used sections that were added without cr3.
+	 *
+	 * They are shared by all address spaces.  Its cr3 is pt_asid_no_cr3.
+	 */
+	struct pt_image_space shared;
+
+	/* The other address spaces with used sections hashed by their cr3.
+	 *
+	 * Address spaces are not removed until the image is finalized.
+	 */
+	struct pt_image_space *space[pt_image_nbuckets];
+
+	/* The address space of the most recent memory access. */
+	struct {
+		/* The cr3 value - pt_asid_no_cr3 if there is none. */
+		uint64_t cr3;
+
+		/* The address space for @cr3 - NULL if there is none. */
+		struct pt_image_space *space;
+	} current;
+
+	/* The used section of the most recent block cache access - NULL if
+	 * there is none.
+	 *
+	 * A block cache lookup miss is followed by an add for the same ip.
+	 */
+	struct pt_section_list *branch;
 
 	/* An optional read memory callback. */
 	struct {
@@ -63,8 +164,24 @@ struct pt_image {
 
 		/* The callback context. */
 		void *context;
+
+		/* The cache of blocks read via @callback - NULL if not yet
+		 * needed.
+		 *
+		 * It is allocated on the first block read and freed when the
+		 * callback is changed.
+		 */
+		struct pt_image_block *blocks;
+
+		/* A flag saying whether @callback reads blocks. */
+		uint32_t block:1;
 	} readmem;
 
+	/* The advice for mapping sections - a bit-vector of enum
+	 * pt_map_advice values.
+	 */
+	uint32_t advice;
+
 	/* The cache size as number of to-keep-mapped sections. */
 	uint16_t cache;
 
@@ -88,6 +205,7 @@ extern void pt_image_fini(struct pt_image *image);
  * Returns zero on success.
  * Returns -pte_internal if @image, @section, or @asid is NULL.
  * Returns -pte_bad_image if @section overlaps with a section in @image.
+ * Returns -pte_nomem if @image's index could not be allocated.
  */
 extern int pt_image_add(struct pt_image *image, struct pt_section *section,
 			const struct pt_asid *asid, uint64_t vaddr);
@@ -113,4 +231,33 @@ extern int pt_image_read(struct pt_image *image, uint8_t *buffer,
 			 uint16_t size, const struct pt_asid *asid,
 			 uint64_t addr);
 
+/* Look up a direct branch target.
+ *
+ * Looks up the cached target of the direct branch at @ip in @asid.
+ *
+ * On success, provides a pointer to the cache entry in @entry.  The pointer
+ * remains valid until @image is modified or the next pt_image_bcache_add().
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @image, @entry, or @asid is NULL.
+ * Returns -pte_nomap if the branch target is not cached.
+ */
+extern int pt_image_bcache_lookup(struct pt_image *image,
+				  const struct pt_bcache_entry **entry,
+				  const struct pt_asid *asid, uint64_t ip);
+
+/* Cache a direct branch target.
+ *
+ * Adds @entry to the branch target cache of the section that contains both
+ * the branch at @entry->ip and its target in @asid.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @image, @entry, or @asid is NULL.
+ * Returns -pte_nomap if no section contains both the branch and its target.
+ * Returns -pte_nomem if the cache can't be allocated.
+ */
+extern int pt_image_bcache_add(struct pt_image *image,
+			       const struct pt_bcache_entry *entry,
+			       const struct pt_asid *asid);
+
 #endif /* PT_IMAGE_H */
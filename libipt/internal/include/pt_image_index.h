@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PT_IMAGE_INDEX_H
+#define PT_IMAGE_INDEX_H
+
+#include "pt_mapped_section.h"
+
+#include <stdint.h>
+
+#if defined(FEATURE_THREADS)
+#  include <threads.h>
+#endif /* defined(FEATURE_THREADS) */
+
+struct pt_section;
+
+
+/* The number of buckets in a section index and the maximal number of
+ * indices a section index may be put on top of.
+ *
+ * Sections are hashed by their cr3 into pt_image_index_nbuckets buckets.
+ * Added sections are also hashed by their address into
+ * pt_image_index_nslots buckets of pt_image_index_slot_size bytes each,
+ * and by their file into pt_image_index_nfiles buckets.
+ *
+ * The numbers of buckets must be powers of two.
+ */
+enum {
+	pt_image_index_nbuckets		= 64,
+	pt_image_index_nslots		= 1024,
+	pt_image_index_slot_shift	= 21,
+	pt_image_index_slot_size	= 1 << pt_image_index_slot_shift,
+	pt_image_index_nfiles		= 1024,
+	pt_image_index_max_depth	= 8
+};
+
+/* A section in a section index. */
+struct pt_image_entry {
+	/* The next entry in the same bucket. */
+	struct pt_image_entry *next;
+
+	/* The next added entry in the same address or file bucket. */
+	struct pt_image_entry *next_addr;
+	struct pt_image_entry *next_file;
+
+	/* The mapped section.
+	 *
+	 * An added entry holds a reference to the section.  A removed entry
+	 * does not; the section is kept alive by the parent index.
+	 */
+	struct pt_mapped_section msec;
+};
+
+/* A copy-on-write index of the sections of an image.
+ *
+ * The index is shared between an image and its copies.  A shared index is
+ * read-only.  To modify a shared index, an image puts a new index on top of
+ * it that records the image's own additions and removals.
+ */
+struct pt_image_index {
+	/* The shared index this index is put on top of - NULL if none. */
+	struct pt_image_index *parent;
+
+	/* The sections added in this index hashed by their cr3. */
+	struct pt_image_entry *added[pt_image_index_nbuckets];
+
+	/* The sections added in this index hashed by the slot in which they
+	 * begin.
+	 *
+	 * This holds sections that are not bigger than a slot.  They end in
+	 * the slot in which they begin or in the next.
+	 */
+	struct pt_image_entry *small[pt_image_index_nslots];
+
+	/* The sections added in this index that are bigger than a slot. */
+	struct pt_image_entry *large;
+
+	/* The sections added in this index hashed by their file name, offset,
+	 * and size.
+	 */
+	struct pt_image_entry *files[pt_image_index_nfiles];
+
+	/* The sections of @parent that were removed in this index hashed by
+	 * their cr3.
+	 */
+	struct pt_image_entry *removed[pt_image_index_nbuckets];
+
+	/* The number of indices below this index. */
+	uint32_t depth;
+
+	/* The number of users - images and indices put on top of this one. */
+	uint32_t ucount;
+
+#if defined(FEATURE_THREADS)
+	/* A lock protecting @ucount. */
+	mtx_t lock;
+#endif /* defined(FEATURE_THREADS) */
+};
+
+/* An iterator over the sections in a section index. */
+struct pt_image_index_iter {
+	/* The index over which we iterate. */
+	const struct pt_image_index *index;
+
+	/* The address space to which the iteration is restricted - NULL if
+	 * all sections are provided.
+	 */
+	const struct pt_asid *asid;
+
+	/* The current position given as an index in the chain of parents
+	 * of @index, a bucket in that index, and the most recently provided
+	 * entry in that bucket - NULL at the beginning of the bucket.
+	 */
+	const struct pt_image_index *layer;
+	const struct pt_image_entry *entry;
+	uint32_t bucket;
+};
+
+
+/* Allocate a section index.
+ *
+ * Allocates an empty section index on top of @parent.  The new index gets
+ * its own reference to @parent.  The new index has a single user.
+ *
+ * Returns the new index on success, NULL otherwise.
+ */
+extern struct pt_image_index *
+pt_image_index_alloc(struct pt_image_index *parent);
+
+/* Add another user for a section index.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @index is NULL.
+ * Returns -pte_internal if the user count would overflow.
+ * Returns -pte_bad_lock on any locking error.
+ */
+extern int pt_image_index_get(struct pt_image_index *index);
+
+/* Remove a user of a section index.
+ *
+ * Frees @index and removes its user from its parent if this was the last
+ * user.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @index is NULL.
+ * Returns -pte_bad_lock on any locking error.
+ */
+extern int pt_image_index_put(struct pt_image_index *index);
+
+/* Add a section to a section index.
+ *
+ * Adds @section at @vaddr in @asid to the index pointed to by @pindex if it
+ * does not overlap with another section in @asid.
+ *
+ * Allocates a new index if *@pindex is NULL.  If *@pindex is shared, puts a
+ * new index on top of it and replaces *@pindex with the new index.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @pindex, @section, or @asid is NULL.
+ * Returns -pte_bad_image if @section overlaps with a section in @asid.
+ * Returns -pte_nomem if the index could not be allocated.
+ */
+extern int pt_image_index_add(struct pt_image_index **pindex,
+			      struct pt_section *section,
+			      const struct pt_asid *asid, uint64_t vaddr);
+
+/* Remove a section from a section index.
+ *
+ * Removes @section at @vaddr in @asid from the index pointed to by @pindex.
+ * If *@pindex is shared, the removal is recorded in a new index as in
+ * pt_image_index_add().
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @pindex, @section, or @asid is NULL.
+ * Returns -pte_bad_image if the index does not contain @section at @vaddr.
+ * Returns -pte_nomem if the index could not be allocated.
+ */
+extern int pt_image_index_remove(struct pt_image_index **pindex,
+				 struct pt_section *section,
+				 const struct pt_asid *asid, uint64_t vaddr);
+
+/* Remove sections by file name.
+ *
+ * Removes all sections loaded from @filename in @asid from the index
+ * pointed to by @pindex as in pt_image_index_remove().
+ *
+ * Returns the number of removed sections on success, a negative error code
+ * otherwise.
+ * Returns -pte_internal if @pindex, @filename, or @asid is NULL.
+ * Returns -pte_nomem if the index could not be allocated.
+ */
+extern int pt_image_index_remove_by_filename(struct pt_image_index **pindex,
+					     const char *filename,
+					     const struct pt_asid *asid);
+
+/* Remove sections by address space.
+ *
+ * Removes all sections in @asid from the index pointed to by @pindex as in
+ * pt_image_index_remove().
+ *
+ * Returns the number of removed sections on success, a negative error code
+ * otherwise.
+ * Returns -pte_internal if @pindex or @asid is NULL.
+ * Returns -pte_nomem if the index could not be allocated.
+ */
+extern int pt_image_index_remove_by_asid(struct pt_image_index **pindex,
+					 const struct pt_asid *asid);
+
+/* Check if a section index contains a mapped section.
+ *
+ * Returns a positive number if @index contains @msec.
+ * Returns zero if @index does not contain @msec.
+ * Returns a negative error code otherwise.
+ *
+ * Returns -pte_internal if @msec is NULL.
+ */
+extern int pt_image_index_contains(const struct pt_image_index *index,
+				   const struct pt_mapped_section *msec);
+
+/* Find a section for @size bytes at @offset in @filename.
+ *
+ * This includes sections that have been removed but are still used.
+ *
+ * Returns a pointer to the section on success, NULL otherwise.
+ */
+extern struct pt_section *
+pt_image_index_find(const struct pt_image_index *index, const char *filename,
+		    uint64_t offset, uint64_t size);
+
+/* Start iterating over the sections in @index.
+ *
+ * If @asid is not NULL, only sections that match @asid are provided.  The
+ * index must not be modified until the iteration ends.
+ */
+extern void pt_image_index_begin(struct pt_image_index_iter *iter,
+				 const struct pt_image_index *index,
+				 const struct pt_asid *asid);
+
+/* Provide the next section.
+ *
+ * Returns a pointer to the next mapped section, NULL if there is none.
+ */
+extern const struct pt_mapped_section *
+pt_image_index_next(struct pt_image_index_iter *iter);
+
+#endif /* PT_IMAGE_INDEX_H */
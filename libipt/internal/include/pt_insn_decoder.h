@@ -32,6 +32,7 @@
 #include "pt_query_decoder.h"
 #include "pt_image.h"
 #include "pt_retstack.h"
+#include "pt_callstack.h"
 #include "pt_ild.h"
 
 #include <inttypes.h>
@@ -50,12 +51,19 @@ struct pt_insn_decoder {
 	/* The current address space. */
 	struct pt_asid asid;
 
-	/* The current Intel(R) Processor Trace event. */
-	struct pt_event event;
+	/* The current Intel(R) Processor Trace event.
+	 *
+	 * This points into the query decoder's event queue and remains valid
+	 * until the next event query.
+	 */
+	struct pt_event *event;
 
 	/* The call/return stack for ret compression. */
 	struct pt_retstack retstack;
 
+	/* The shadow call stack of near calls that have not returned. */
+	struct pt_callstack callstack;
+
 	/* The Intel(R) Processor Trace instruction (length) decoder. */
 	struct pt_ild ild;
 
@@ -69,6 +77,11 @@ struct pt_insn_decoder {
 	 */
 	uint64_t last_disable_ip;
 
+	/* The IP of the last taken direct branch, valid if @branch_taken is
+	 * set.  This is used for looking up the branch target cache.
+	 */
+	uint64_t branch_ip;
+
 	/* The current execution mode. */
 	enum pt_exec_mode mode;
 
@@ -99,6 +112,9 @@ struct pt_insn_decoder {
 
 	/* - a vmcs event has been bound to the current instruction. */
 	uint32_t vmcs_event_bound:1;
+
+	/* - the previous instruction was a taken direct branch. */
+	uint32_t branch_taken:1;
 };
 
 
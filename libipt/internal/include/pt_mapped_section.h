@@ -77,6 +77,20 @@ extern const struct pt_asid *pt_msec_asid(const struct pt_mapped_section *msec);
 extern int pt_msec_matches_asid(const struct pt_mapped_section *msec,
 				const struct pt_asid *asid);
 
+/* Check if two mapped sections are the same.
+ *
+ * They are the same if they map the same section at the same address in the
+ * same address space.
+ *
+ * Returns a positive number if @lhs and @rhs are the same.
+ * Returns zero if @lhs and @rhs are not the same.
+ * Returns a negative error code otherwise.
+ *
+ * Returns -pte_internal if @lhs or @rhs are NULL.
+ */
+extern int pt_msec_is_same(const struct pt_mapped_section *lhs,
+			   const struct pt_mapped_section *rhs);
+
 /* Read memory from a mapped section.
  *
  * Reads at most @size bytes from @msec at @addr in @asid into @buffer.
@@ -29,6 +29,8 @@
 #ifndef PT_PACKET_DECODER_H
 #define PT_PACKET_DECODER_H
 
+#include "pt_scatter.h"
+
 #include "intel-pt.h"
 
 
@@ -42,6 +44,9 @@ struct pt_packet_decoder {
 
 	/* The position of the last PSB packet. */
 	const uint8_t *sync;
+
+	/* The trace buffer parts. */
+	struct pt_scatter scatter;
 };
 
 
@@ -33,6 +33,7 @@
 #include "pt_tnt_cache.h"
 #include "pt_time.h"
 #include "pt_event_queue.h"
+#include "pt_scatter.h"
 
 #include "intel-pt.h"
 
@@ -50,6 +51,9 @@ struct pt_query_decoder {
 	/* The position of the last PSB packet. */
 	const uint8_t *sync;
 
+	/* The trace buffer parts. */
+	struct pt_scatter scatter;
+
 	/* The decoding function for the next packet. */
 	const struct pt_decoder_function *next;
 
@@ -71,6 +75,9 @@ struct pt_query_decoder {
 	/* The current event. */
 	struct pt_event *event;
 
+	/* The events to report - one bit per pt_event_type. */
+	uint32_t event_mask;
+
 	/* A collection of flags relevant for decoding:
 	 *
 	 * - tracing is enabled.
@@ -79,6 +86,9 @@ struct pt_query_decoder {
 
 	/* - consume the current packet. */
 	uint32_t consume_packet:1;
+
+	/* - the current event has been decoded ahead of our user. */
+	uint32_t event_pending:1;
 };
 
 /* Initialize the query decoder.
@@ -91,6 +101,19 @@ extern int pt_qry_decoder_init(struct pt_query_decoder *,
 /* Finalize the query decoder. */
 extern void pt_qry_decoder_fini(struct pt_query_decoder *);
 
+/* Query an event by reference.
+ *
+ * This is like pt_qry_event() but provides a pointer to the decoder's event
+ * in @event instead of copying it.
+ *
+ * The event remains valid until the next event query.
+ *
+ * Returns a non-negative pt_status_flag bit-vector on success, a negative
+ * error code otherwise.
+ */
+extern int pt_qry_event_ref(struct pt_query_decoder *decoder,
+			    struct pt_event **event);
+
 /* Decoder functions (tracing context). */
 extern int pt_qry_decode_unknown(struct pt_query_decoder *);
 extern int pt_qry_decode_pad(struct pt_query_decoder *);
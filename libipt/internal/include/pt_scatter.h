@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2014-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PT_SCATTER_H
+#define PT_SCATTER_H
+
+#include "intel-pt.h"
+
+#include <stdint.h>
+
+
+/* The number of bytes a packet may extend beyond a trace buffer part.
+ *
+ * This is the size of the biggest packet minus one.
+ */
+enum {
+	pt_scatter_overlap	= ptps_psb - 1
+};
+
+/* The size of a stitch buffer in bytes.
+ *
+ * A stitch buffer holds pt_scatter_overlap bytes on either side of a part
+ * boundary.  We leave a gap between adjacent stitch buffers so that the end
+ * of one stitch buffer never coincides with the begin of the next.
+ */
+enum {
+	pt_scatter_stitch_size	= 2 * pt_scatter_overlap + 2
+};
+
+/* A window into a scattered trace buffer.
+ *
+ * The windows of a scattered trace buffer alternate between the user's trace
+ * buffer parts and small stitch buffers containing a copy of the bytes around
+ * the boundary between two adjacent parts.
+ *
+ * Every trace offset is represented in exactly one window.  This is the
+ * window containing the offset in its canonical range.  There are at least
+ * pt_scatter_overlap bytes after any canonical position unless we are
+ * approaching the end of the trace.  This allows decoding any packet starting
+ * at a canonical position without having to switch windows.
+ */
+struct pt_scatter_window {
+	/* The begin and end of the window's memory. */
+	uint8_t *begin, *end;
+
+	/* The end of the window's canonical range.
+	 *
+	 * Positions at or beyond @limit are represented in a later window
+	 * unless this is the last window.
+	 */
+	const uint8_t *limit;
+
+	/* The trace offset of @begin. */
+	uint64_t offset;
+
+	/* The trace offset at which the window's canonical range begins. */
+	uint64_t canonical;
+};
+
+/* A scattered trace buffer. */
+struct pt_scatter {
+	/* The windows in trace order - NULL for a contiguous trace buffer. */
+	struct pt_scatter_window *window;
+
+	/* The memory for the stitch buffers. */
+	uint8_t *stitch;
+
+	/* The size of the trace in bytes. */
+	uint64_t size;
+
+	/* The number of windows. */
+	uint32_t nwindows;
+
+	/* The index of the window the decoder is currently reading from. */
+	uint32_t current;
+};
+
+
+/* Initialize a scattered trace buffer.
+ *
+ * Sets up @scatter for the trace buffer parts given in @config.  If @config
+ * contains more than one non-empty part, sets @config's begin and end fields
+ * to the first window.  Otherwise, @config is not modified and @scatter
+ * represents a contiguous trace buffer.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @scatter or @config is NULL.
+ * Returns -pte_nomem if the stitch buffers can't be allocated.
+ */
+extern int pt_scatter_init(struct pt_scatter *scatter,
+			   struct pt_config *config);
+
+/* Finalize a scattered trace buffer. */
+extern void pt_scatter_fini(struct pt_scatter *scatter);
+
+/* Provide the user's trace configuration.
+ *
+ * Restores the begin and end fields in @config that had been modified by
+ * pt_scatter_init() so @config may be used to initialize another decoder.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @config or @scatter is NULL.
+ */
+extern int pt_scatter_user_config(struct pt_config *config,
+				  const struct pt_scatter *scatter);
+
+/* Return the size of the trace in bytes. */
+extern uint64_t pt_scatter_size(const struct pt_scatter *scatter,
+				const struct pt_config *config);
+
+/* Determine the trace offset of the current position.
+ *
+ * The position @pos must lie inside or at the end of the current window.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @offset, @scatter, or @config is NULL.
+ * Returns -pte_internal if @pos lies outside of the current window.
+ */
+extern int pt_scatter_offset(uint64_t *offset, const struct pt_scatter *scatter,
+			     const uint8_t *pos, const struct pt_config *config);
+
+/* Determine the trace offset of a synchronization point.
+ *
+ * The canonical position @sync may lie in any window.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @offset, @scatter, or @config is NULL.
+ * Returns -pte_internal if @sync lies outside of the trace buffer.
+ */
+extern int pt_scatter_sync_offset(uint64_t *offset,
+				  const struct pt_scatter *scatter,
+				  const uint8_t *sync,
+				  const struct pt_config *config);
+
+/* Move to a trace offset.
+ *
+ * Provides the canonical position for @offset in @pos and moves @scatter
+ * and @config to the window containing it.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @pos, @config, or @scatter is NULL.
+ * Returns -pte_eos if @offset lies beyond the end of the trace.
+ */
+extern int pt_scatter_seek(const uint8_t **pos, struct pt_config *config,
+			   struct pt_scatter *scatter, uint64_t offset);
+
+/* Normalize the current position.
+ *
+ * If @pos lies beyond the canonical range of the current window, moves
+ * @scatter and @config to the window that contains it in its canonical range
+ * and adjusts @pos accordingly.
+ *
+ * This must be called before decoding the packet at @pos.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @pos, @config, or @scatter is NULL.
+ */
+extern int pt_scatter_normalize(const uint8_t **pos, struct pt_config *config,
+				struct pt_scatter *scatter);
+
+/* Manually synchronize onto a scattered trace buffer.
+ *
+ * Validate that there is a synchronization point at trace offset @offset.
+ *
+ * On success, provides its canonical position in @sync and moves @scatter and
+ * @config to the window containing it.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @sync, @config, or @scatter is NULL.
+ * Returns -pte_eos if @offset lies beyond the end of the trace.
+ * Returns -pte_nosync if there is no PSB at @offset.
+ */
+extern int pt_scatter_sync_set(const uint8_t **sync, struct pt_config *config,
+			       struct pt_scatter *scatter, uint64_t offset);
+
+/* Synchronize onto a scattered trace buffer.
+ *
+ * Search for the next synchronization point in forward or backward direction
+ * starting at trace offset @offset.
+ *
+ * On success, provides the canonical position of the synchronization point in
+ * @sync and moves @scatter and @config to the window containing it.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @sync, @config, or @scatter is NULL.
+ * Returns -pte_eos if no further synchronization point is found.
+ */
+extern int pt_scatter_sync_forward(const uint8_t **sync,
+				   struct pt_config *config,
+				   struct pt_scatter *scatter,
+				   uint64_t offset);
+extern int pt_scatter_sync_backward(const uint8_t **sync,
+				    struct pt_config *config,
+				    struct pt_scatter *scatter,
+				    uint64_t offset);
+
+#endif /* PT_SCATTER_H */
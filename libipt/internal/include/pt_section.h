@@ -36,6 +36,15 @@
 #endif /* defined(FEATURE_THREADS) */
 
 
+/* The identity of a file used for detecting changes. */
+struct pt_file_id {
+	/* The size of the file in bytes. */
+	uint64_t size;
+
+	/* The time of the last modification. */
+	int64_t mtime;
+};
+
 /* A section of contiguous memory loaded from a file. */
 struct pt_section {
 	/* The name of the file. */
@@ -51,12 +60,28 @@ struct pt_section {
 
 	/* A pointer to OS-specific file status for detecting changes.
 	 *
-	 * The status is initialized on first pt_section_map() and will be
+	 * The status is initialized when the section is created or, for
+	 * lazily created sections, on first pt_section_map().  It will be
 	 * left in the section until the section is destroyed.  This field
 	 * is owned by the OS-specific mmap-based section implementation.
 	 */
 	void *status;
 
+	/* The identity of the file when the section was created.
+	 *
+	 * A lazily created section checks it against the file when the file
+	 * status is taken on the first pt_section_map().
+	 */
+	struct pt_file_id id;
+
+	/* The advice for mapping the section - a bit-vector of enum
+	 * pt_map_advice values.
+	 *
+	 * It is only used by the OS-specific mmap-based section
+	 * implementation.
+	 */
+	uint32_t advice;
+
 	/* A pointer to implementation-specific mapping information - NULL if
 	 * the section is currently not mapped.
 	 *
@@ -115,6 +140,18 @@ struct pt_section {
 extern struct pt_section *pt_mk_section(const char *file, uint64_t offset,
 					uint64_t size);
 
+/* Create a section without accessing its file.
+ *
+ * Like pt_mk_section() but for a @file with identity @id.  The file status
+ * is taken on the first pt_section_map().  Mapping fails if @file changed,
+ * i.e. if its size or modification time differ from @id.
+ *
+ * Returns a new section on success, NULL otherwise.
+ */
+extern struct pt_section *pt_mk_section_lazy(const char *file, uint64_t offset,
+					     uint64_t size,
+					     const struct pt_file_id *id);
+
 /* Lock a section.
  *
  * Locks @section.  The section must not be locked.
@@ -156,27 +193,54 @@ extern int pt_section_get(struct pt_section *section);
  */
 extern int pt_section_put(struct pt_section *section);
 
+/* Add mapping advice.
+ *
+ * Adds @advice, a bit-vector of enum pt_map_advice values, to the advice for
+ * mapping @section.  It will be used the next time @section is mapped.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @section is NULL.
+ * Returns -pte_bad_lock on any locking error.
+ */
+extern int pt_section_advise(struct pt_section *section, uint32_t advice);
+
 /* Return the filename of @section. */
 extern const char *pt_section_filename(const struct pt_section *section);
 
 /* Return the size of the section in bytes. */
 extern uint64_t pt_section_size(const struct pt_section *section);
 
+/* Return the offset of the section in its file. */
+extern uint64_t pt_section_offset(const struct pt_section *section);
+
+/* Return the identity of the section's file when the section was created. */
+extern const struct pt_file_id *pt_section_id(const struct pt_section *section);
+
+/* Determine the identity of @filename.
+ *
+ * This function is implemented in the OS-specific section implementation.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @id or @filename is NULL.
+ * Returns -pte_bad_image if @filename can't be accessed.
+ */
+extern int pt_section_file_id(struct pt_file_id *id, const char *filename);
+
 /* Create the OS-specific file status.
  *
  * On success, allocates a status object, provides a pointer to it in @pstatus
- * and provides the file size in @psize.
+ * and provides the identity of the file in @id.
  *
  * The status object will be free()'ed when its section is.
  *
  * This function is implemented in the OS-specific section implementation.
  *
  * Returns zero on success, a negative error code otherwise.
- * Returns -pte_internal if @pstatus, @psize, or @filename is NULL.
+ * Returns -pte_internal if @pstatus, @id, or @filename is NULL.
  * Returns -pte_bad_image if @filename can't be opened.
  * Returns -pte_nomem if the status object can't be allocated.
  */
-extern int pt_section_mk_status(void **pstatus, uint64_t *psize,
+extern int pt_section_mk_status(void **pstatus, struct pt_file_id *id,
 				const char *filename);
 
 /* Map a section.
@@ -34,6 +34,9 @@
 struct pt_config;
 
 
+/* The two 64bit words' worth of psb payload pattern. */
+extern const uint64_t psb_pattern[];
+
 /* Synchronize onto the trace stream.
  *
  * Search for the next synchronization point in forward or backward direction
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2013-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(PTI_PROPS_DEFS_H)
+#define PTI_PROPS_DEFS_H
+
+
+/* Opcode properties combine the modrm, disp, and imm codes as well as the
+ * instruction class of an opcode in a single 16-bit value:
+ *
+ *   bits  1:0	PTI_MODRM_*
+ *   bits  4:2	PTI_DISP_* and PTI_PRESERVE_DEFAULT
+ *   bits  8:5	PTI_IMM_* and the other imm codes
+ *   bits 14:9	PTI_INST_* or PTI_INST_BYREG
+ */
+#define PTI_PROPS(modrm, disp, imm, iclass)	\
+	((uint16_t) ((modrm) | ((disp) << 2) | ((imm) << 5) | ((iclass) << 9)))
+
+#define PTI_PROPS_MODRM(props)	((uint8_t) ((props) & 0x3))
+#define PTI_PROPS_DISP(props)	((uint8_t) (((props) >> 2) & 0x7))
+#define PTI_PROPS_IMM(props)	((uint8_t) (((props) >> 5) & 0xf))
+#define PTI_PROPS_ICLASS(props)	((uint8_t) (((props) >> 9) & 0x3f))
+
+/* The instruction class depends on the modrm byte. */
+#define PTI_INST_BYREG	PTI_INST_LAST
+
+#endif
@@ -27,6 +27,7 @@
  */
 
 #define _POSIX_C_SOURCE 1
+#define _DEFAULT_SOURCE 1
 #define _DARWIN_C_SOURCE 1
 
 #include "pt_section.h"
@@ -45,13 +46,14 @@
 #include <unistd.h>
 
 
-int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
+int pt_section_mk_status(void **pstatus, struct pt_file_id *id,
+			 const char *filename)
 {
 	struct pt_sec_posix_status *status;
 	struct stat buffer;
 	int errcode;
 
-	if (!pstatus || !psize)
+	if (!pstatus || !id)
 		return -pte_internal;
 
 	errcode = stat(filename, &buffer);
@@ -68,7 +70,29 @@ int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
 	status->stat = buffer;
 
 	*pstatus = status;
-	*psize = buffer.st_size;
+	id->size = (uint64_t) buffer.st_size;
+	id->mtime = (int64_t) buffer.st_mtime;
+
+	return 0;
+}
+
+int pt_section_file_id(struct pt_file_id *id, const char *filename)
+{
+	struct stat buffer;
+	int errcode;
+
+	if (!id || !filename)
+		return -pte_internal;
+
+	errcode = stat(filename, &buffer);
+	if (errcode < 0)
+		return -pte_bad_image;
+
+	if (buffer.st_size < 0)
+		return -pte_bad_image;
+
+	id->size = (uint64_t) buffer.st_size;
+	id->mtime = (int64_t) buffer.st_mtime;
 
 	return 0;
 }
@@ -87,8 +111,29 @@ static int check_file_status(struct pt_section *section, int fd)
 		return -pte_bad_image;
 
 	status = section->status;
-	if (!status)
-		return -pte_internal;
+	if (!status) {
+		/* A lazily created section takes the file status on first
+		 * map.  The file must not have changed since the section was
+		 * created.
+		 */
+		if (stat.st_size < 0)
+			return -pte_bad_image;
+
+		if ((uint64_t) stat.st_size != section->id.size)
+			return -pte_bad_image;
+
+		if ((int64_t) stat.st_mtime != section->id.mtime)
+			return -pte_bad_image;
+
+		status = malloc(sizeof(*status));
+		if (!status)
+			return -pte_nomem;
+
+		status->stat = stat;
+		section->status = status;
+
+		return 0;
+	}
 
 	if (stat.st_size != status->stat.st_size)
 		return -pte_bad_image;
@@ -99,11 +144,34 @@ static int check_file_status(struct pt_section *section, int fd)
 	return 0;
 }
 
+/* Apply the advice in @advice to the memory at @base of @size bytes.
+ *
+ * The advice is only a hint.  We ignore errors.
+ */
+static void pt_sec_posix_advise(uint8_t *base, uint64_t size, uint32_t advice)
+{
+#if defined(MADV_WILLNEED) && !defined(MAP_POPULATE)
+	if (advice & ptma_prefault)
+		(void) madvise(base, size, MADV_WILLNEED);
+#endif /* defined(MADV_WILLNEED) && !defined(MAP_POPULATE) */
+
+#if defined(MADV_RANDOM)
+	if (advice & ptma_random)
+		(void) madvise(base, size, MADV_RANDOM);
+#endif /* defined(MADV_RANDOM) */
+
+	(void) base;
+	(void) size;
+	(void) advice;
+}
+
 int pt_sec_posix_map(struct pt_section *section, int fd)
 {
 	struct pt_sec_posix_mapping *mapping;
 	uint64_t offset, size, adjustment;
+	uint32_t advice;
 	uint8_t *base;
+	int flags;
 
 	if (!section)
 		return -pte_internal;
@@ -122,10 +190,21 @@ int pt_sec_posix_map(struct pt_section *section, int fd)
 	if (size < section->size)
 		return -pte_internal;
 
-	base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, offset);
+	/* Random access only applies to sections mapped in windows. */
+	advice = section->advice & ~(uint32_t) ptma_random;
+	flags = MAP_SHARED;
+
+#if defined(MAP_POPULATE)
+	if (advice & ptma_prefault)
+		flags |= MAP_POPULATE;
+#endif /* defined(MAP_POPULATE) */
+
+	base = mmap(NULL, size, PROT_READ, flags, fd, offset);
 	if (base == MAP_FAILED)
 		return -pte_nomem;
 
+	pt_sec_posix_advise(base, size, advice);
+
 	mapping = malloc(sizeof(*mapping));
 	if (!mapping)
 		goto out_map;
@@ -186,12 +265,25 @@ int pt_section_map(struct pt_section *section)
 	if (errcode < 0)
 		goto out_fd;
 
-	/* We close the file on success.  This does not unmap the section. */
-	errcode = pt_sec_posix_map(section, fd);
-	if (!errcode) {
-		section->mcount = 1;
-		close(fd);
-		return pt_section_unlock(section);
+	if (pt_sec_posix_window_threshold < section->size) {
+		/* We need to keep the file open on success for mapping further
+		 * windows.  It will be closed when the section is unmapped.
+		 */
+		errcode = pt_sec_posix_map_windows(section, fd);
+		if (!errcode) {
+			section->mcount = 1;
+			return pt_section_unlock(section);
+		}
+	} else {
+		/* We close the file on success.  This does not unmap the
+		 * section.
+		 */
+		errcode = pt_sec_posix_map(section, fd);
+		if (!errcode) {
+			section->mcount = 1;
+			close(fd);
+			return pt_section_unlock(section);
+		}
 	}
 
 	/* Fall back to file based sections - report the original error
@@ -266,3 +358,253 @@ int pt_sec_posix_read(const struct pt_section *section, uint8_t *buffer,
 	memcpy(buffer, begin, size);
 	return (int) size;
 }
+
+static int wmap_lock(struct pt_sec_posix_windows *windows)
+{
+	if (!windows)
+		return -pte_internal;
+
+#if defined(FEATURE_THREADS)
+	{
+		int errcode;
+
+		errcode = mtx_lock(&windows->lock);
+		if (errcode != thrd_success)
+			return -pte_bad_lock;
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	return 0;
+}
+
+static int wmap_unlock(struct pt_sec_posix_windows *windows)
+{
+	if (!windows)
+		return -pte_internal;
+
+#if defined(FEATURE_THREADS)
+	{
+		int errcode;
+
+		errcode = mtx_unlock(&windows->lock);
+		if (errcode != thrd_success)
+			return -pte_bad_lock;
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	return 0;
+}
+
+static void wmap_unmap_window(struct pt_sec_posix_window *window)
+{
+	if (!window->base)
+		return;
+
+	munmap(window->base, window->size);
+	memset(window, 0, sizeof(*window));
+}
+
+/* Map the window starting at @offset in @section.
+ *
+ * The window must not be mapped.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int wmap_map_window(struct pt_sec_posix_window *window,
+			   const struct pt_section *section, int fd,
+			   uint64_t offset)
+{
+	uint64_t begin, size, adjustment;
+	uint8_t *base;
+
+	if (!window || !section)
+		return -pte_internal;
+
+	if (window->base || (section->size <= offset))
+		return -pte_internal;
+
+	size = section->size - offset;
+	if ((pt_sec_posix_window_size + pt_sec_posix_window_overlap) < size)
+		size = pt_sec_posix_window_size + pt_sec_posix_window_overlap;
+
+	begin = section->offset + offset;
+	adjustment = begin % PAGE_SIZE;
+
+	begin -= adjustment;
+	size += adjustment;
+
+	base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, begin);
+	if (base == MAP_FAILED)
+		return -pte_nomem;
+
+	/* Windows are mapped on demand.  Prefaulting does not apply. */
+	pt_sec_posix_advise(base, size, section->advice & ptma_random);
+
+	window->base = base;
+	window->size = size;
+	window->begin = base + adjustment;
+	window->end = base + size;
+	window->offset = offset;
+
+	return 0;
+}
+
+int pt_sec_posix_map_windows(struct pt_section *section, int fd)
+{
+	struct pt_sec_posix_windows *windows;
+	int errcode;
+
+	if (!section)
+		return -pte_internal;
+
+	windows = malloc(sizeof(*windows));
+	if (!windows)
+		return -pte_nomem;
+
+	memset(windows, 0, sizeof(*windows));
+	windows->fd = fd;
+
+	errcode = wmap_map_window(&windows->window[0], section, fd, 0ull);
+	if (errcode < 0)
+		goto out_mem;
+
+#if defined(FEATURE_THREADS)
+
+	errcode = mtx_init(&windows->lock, mtx_plain);
+	if (errcode != thrd_success) {
+		errcode = -pte_bad_lock;
+		goto out_map;
+	}
+
+#endif /* defined(FEATURE_THREADS) */
+
+	section->mapping = windows;
+	section->unmap = pt_sec_posix_unmap_windows;
+	section->read = pt_sec_posix_read_windows;
+
+	return 0;
+
+#if defined(FEATURE_THREADS)
+out_map:
+	wmap_unmap_window(&windows->window[0]);
+#endif /* defined(FEATURE_THREADS) */
+
+out_mem:
+	free(windows);
+	return errcode;
+}
+
+int pt_sec_posix_unmap_windows(struct pt_section *section)
+{
+	struct pt_sec_posix_windows *windows;
+	int idx;
+
+	if (!section)
+		return -pte_internal;
+
+	windows = section->mapping;
+	if (!windows || !section->unmap || !section->read)
+		return -pte_internal;
+
+	section->mapping = NULL;
+	section->unmap = NULL;
+	section->read = NULL;
+
+	for (idx = 0; idx < pt_sec_posix_nwindows; ++idx)
+		wmap_unmap_window(&windows->window[idx]);
+
+	close(windows->fd);
+
+#if defined(FEATURE_THREADS)
+
+	mtx_destroy(&windows->lock);
+
+#endif /* defined(FEATURE_THREADS) */
+
+	free(windows);
+
+	return 0;
+}
+
+/* Find the window containing @offset in @section.
+ *
+ * Maps the window, replacing the least recently used window, if it is not
+ * already mapped.
+ *
+ * Returns a pointer to the window on success, NULL otherwise.
+ */
+static struct pt_sec_posix_window *
+wmap_find_window(struct pt_sec_posix_windows *windows,
+		 const struct pt_section *section, uint64_t offset)
+{
+	struct pt_sec_posix_window *window, *lru;
+	int idx, errcode;
+
+	offset &= ~((uint64_t) pt_sec_posix_window_size - 1ull);
+	windows->clock += 1;
+
+	lru = &windows->window[0];
+	for (idx = 0; idx < pt_sec_posix_nwindows; ++idx) {
+		window = &windows->window[idx];
+
+		if (window->base && window->offset == offset) {
+			window->used = windows->clock;
+			return window;
+		}
+
+		/* Prefer unused windows. */
+		if (!lru->base)
+			continue;
+
+		if (!window->base || (window->used < lru->used))
+			lru = window;
+	}
+
+	wmap_unmap_window(lru);
+
+	errcode = wmap_map_window(lru, section, windows->fd, offset);
+	if (errcode < 0)
+		return NULL;
+
+	lru->used = windows->clock;
+	return lru;
+}
+
+int pt_sec_posix_read_windows(const struct pt_section *section,
+			      uint8_t *buffer, uint16_t size, uint64_t offset)
+{
+	struct pt_sec_posix_windows *windows;
+	const struct pt_sec_posix_window *window;
+	int errcode;
+
+	if (!buffer || !section)
+		return -pte_invalid;
+
+	windows = section->mapping;
+	if (!windows)
+		return -pte_internal;
+
+	errcode = wmap_lock(windows);
+	if (errcode < 0)
+		return errcode;
+
+	window = wmap_find_window(windows, section, offset);
+	if (!window) {
+		(void) wmap_unlock(windows);
+		return -pte_nomem;
+	}
+
+	/* We already checked in pt_section_read() that the requested memory
+	 * lies within the section's boundaries.
+	 *
+	 * The window extends far enough into the next window to cover any
+	 * read that starts inside of it.
+	 */
+	memcpy(buffer, window->begin + (offset - window->offset), size);
+
+	errcode = wmap_unlock(windows);
+	if (errcode < 0)
+		return errcode;
+
+	return (int) size;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pt_bcache.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Hash @ip into a cache index.
+ *
+ * Branches are spread quite evenly over the code but their addresses share
+ * most of their bits.  We use multiplicative hashing to mix them.
+ */
+static inline uint32_t pt_bcache_index(uint64_t ip)
+{
+	ip *= 0x9e3779b97f4a7c15ull;
+
+	return (uint32_t) (ip >> 32) & (pt_bcache_size - 1);
+}
+
+struct pt_bcache *pt_bcache_alloc(void)
+{
+	return calloc(1, sizeof(struct pt_bcache));
+}
+
+void pt_bcache_free(struct pt_bcache *bcache)
+{
+	free(bcache);
+}
+
+int pt_bcache_lookup(const struct pt_bcache *bcache,
+		     const struct pt_bcache_entry **entry, uint64_t ip)
+{
+	const struct pt_bcache_entry *bce;
+
+	if (!bcache || !entry)
+		return -pte_internal;
+
+	bce = &bcache->entry[pt_bcache_index(ip)];
+	if (!bce->valid || bce->ip != ip)
+		return -pte_nomap;
+
+	*entry = bce;
+	return 0;
+}
+
+int pt_bcache_add(struct pt_bcache *bcache,
+		  const struct pt_bcache_entry *entry)
+{
+	struct pt_bcache_entry *bce;
+
+	if (!bcache || !entry)
+		return -pte_internal;
+
+	if (sizeof(entry->raw) < entry->size)
+		return -pte_internal;
+
+	bce = &bcache->entry[pt_bcache_index(entry->ip)];
+
+	memcpy(bce, entry, sizeof(*bce));
+	bce->ild.itext = NULL;
+	bce->valid = 1;
+
+	return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "intel-pt.h"
+
+
+/* Record tags. */
+enum {
+	pt_bin_tag_type		= 0x0f,
+	pt_bin_tag_error	= 0x0e,
+	pt_bin_tag_sync		= 0x0f,
+
+	pt_bin_tag_flags	= 0x10,
+	pt_bin_tag_delta	= 0x20,
+	pt_bin_tag_raw		= 0x40,
+	pt_bin_tag_reserved	= 0x80
+};
+
+/* Instruction flags. */
+enum {
+	pt_bin_flag_speculative	= 1 << 0,
+	pt_bin_flag_aborted	= 1 << 1,
+	pt_bin_flag_committed	= 1 << 2,
+	pt_bin_flag_disabled	= 1 << 3,
+	pt_bin_flag_enabled	= 1 << 4,
+	pt_bin_flag_resumed	= 1 << 5,
+	pt_bin_flag_interrupted	= 1 << 6,
+	pt_bin_flag_resynced	= 1 << 7,
+	pt_bin_flag_stopped	= 1 << 8
+};
+
+
+void pt_bin_init(struct pt_bin_state *state)
+{
+	if (!state)
+		return;
+
+	memset(state, 0, sizeof(*state));
+}
+
+static uint8_t *pt_bin_put_uleb(uint8_t *pos, uint64_t value)
+{
+	while (0x7full < value) {
+		*pos++ = (uint8_t) (value | 0x80ull);
+		value >>= 7;
+	}
+
+	*pos++ = (uint8_t) value;
+
+	return pos;
+}
+
+static uint8_t *pt_bin_put_sync(uint8_t *pos, uint64_t ip, uint8_t mode)
+{
+	int byte;
+
+	*pos++ = pt_bin_tag_sync;
+	*pos++ = mode;
+
+	for (byte = 0; byte < 8; ++byte) {
+		*pos++ = (uint8_t) ip;
+		ip >>= 8;
+	}
+
+	return pos;
+}
+
+static uint32_t pt_bin_insn_flags(const struct pt_insn *insn)
+{
+	uint32_t flags;
+
+	flags = 0u;
+	if (insn->speculative)
+		flags |= pt_bin_flag_speculative;
+	if (insn->aborted)
+		flags |= pt_bin_flag_aborted;
+	if (insn->committed)
+		flags |= pt_bin_flag_committed;
+	if (insn->disabled)
+		flags |= pt_bin_flag_disabled;
+	if (insn->enabled)
+		flags |= pt_bin_flag_enabled;
+	if (insn->resumed)
+		flags |= pt_bin_flag_resumed;
+	if (insn->interrupted)
+		flags |= pt_bin_flag_interrupted;
+	if (insn->resynced)
+		flags |= pt_bin_flag_resynced;
+	if (insn->stopped)
+		flags |= pt_bin_flag_stopped;
+
+	return flags;
+}
+
+int pt_bin_write_insn(struct pt_bin_state *state, uint8_t *pos,
+		      const uint8_t *end, const struct pt_insn *insn, int raw)
+{
+	uint8_t *begin, *tag;
+	uint64_t delta;
+	uint32_t flags;
+	uint8_t mode;
+
+	if (!state || !pos || !insn)
+		return -pte_invalid;
+
+	if (!insn->size || (pt_max_insn_size < insn->size))
+		return -pte_invalid;
+
+	if (ptic_far_jump < (unsigned int) insn->iclass)
+		return -pte_invalid;
+
+	if (ptem_64bit < (unsigned int) insn->mode)
+		return -pte_invalid;
+
+	if (end < pos || (end - pos) < pt_bin_max_record_size)
+		return -pte_eos;
+
+	begin = pos;
+	mode = (uint8_t) insn->mode;
+
+	if (!state->sync || (state->mode != mode) ||
+	    (pt_bin_sync_period <= state->count)) {
+		pos = pt_bin_put_sync(pos, insn->ip, mode);
+
+		state->ip = insn->ip;
+		state->mode = mode;
+		state->count = 0;
+		state->sync = 1;
+	}
+
+	tag = pos++;
+	*tag = (uint8_t) insn->iclass;
+
+	pos = pt_bin_put_uleb(pos, insn->size);
+
+	flags = pt_bin_insn_flags(insn);
+	if (flags) {
+		*tag |= pt_bin_tag_flags;
+		pos = pt_bin_put_uleb(pos, flags);
+	}
+
+	delta = insn->ip - state->ip;
+	if (delta) {
+		/* Zigzag-encode the signed difference. */
+		delta = (delta << 1) ^ (uint64_t) ((int64_t) delta >> 63);
+
+		*tag |= pt_bin_tag_delta;
+		pos = pt_bin_put_uleb(pos, delta);
+	}
+
+	if (raw) {
+		*tag |= pt_bin_tag_raw;
+
+		memcpy(pos, insn->raw, insn->size);
+		pos += insn->size;
+	}
+
+	state->ip = insn->ip + insn->size;
+	state->count += 1;
+
+	return (int) (pos - begin);
+}
+
+int pt_bin_write_error(struct pt_bin_state *state, uint8_t *pos,
+		       const uint8_t *end, int errcode, uint64_t offset,
+		       uint64_t ip)
+{
+	uint8_t *begin;
+
+	if (!state || !pos)
+		return -pte_invalid;
+
+	if (end < pos || (end - pos) < pt_bin_max_record_size)
+		return -pte_eos;
+
+	begin = pos;
+
+	*pos++ = pt_bin_tag_error;
+	pos = pt_bin_put_uleb(pos, (uint64_t) (uint32_t) -errcode);
+	pos = pt_bin_put_uleb(pos, offset);
+	pos = pt_bin_put_uleb(pos, ip);
+
+	/* We don't know where decode continues. */
+	state->sync = 0;
+
+	return (int) (pos - begin);
+}
+
+/* Read an unsigned LEB128 number.
+ *
+ * Returns a pointer one past the number on success, NULL otherwise.  Sets
+ * @errcode to -pte_eos if the number is incomplete and to -pte_bad_packet if
+ * it is too big.
+ */
+static const uint8_t *pt_bin_get_uleb(uint64_t *value, const uint8_t *pos,
+				      const uint8_t *end, int *errcode)
+{
+	uint64_t result;
+	int shift;
+
+	result = 0ull;
+	for (shift = 0; pos < end; shift += 7) {
+		uint8_t byte;
+
+		if (64 <= shift) {
+			*errcode = -pte_bad_packet;
+			return NULL;
+		}
+
+		byte = *pos++;
+		result |= (uint64_t) (byte & 0x7f) << shift;
+
+		if (!(byte & 0x80)) {
+			*value = result;
+			return pos;
+		}
+	}
+
+	*errcode = -pte_eos;
+	return NULL;
+}
+
+static int pt_bin_read_sync(struct pt_bin_state *state,
+			    struct pt_bin_record *record,
+			    const uint8_t *pos, const uint8_t *end)
+{
+	uint64_t ip;
+	uint8_t mode;
+	int byte;
+
+	if (*pos != pt_bin_tag_sync)
+		return -pte_bad_packet;
+
+	if ((end - pos) < 10)
+		return -pte_eos;
+
+	mode = pos[1];
+	if (ptem_64bit < mode)
+		return -pte_bad_packet;
+
+	ip = 0ull;
+	for (byte = 7; byte >= 0; --byte)
+		ip = (ip << 8) | pos[2 + byte];
+
+	state->ip = ip;
+	state->mode = mode;
+	state->count = 0;
+	state->sync = 1;
+
+	record->type = pbr_sync;
+	record->variant.sync.ip = ip;
+	record->variant.sync.mode = (enum pt_exec_mode) mode;
+
+	return 10;
+}
+
+static int pt_bin_read_error(struct pt_bin_state *state,
+			     struct pt_bin_record *record,
+			     const uint8_t *pos, const uint8_t *end)
+{
+	const uint8_t *begin;
+	uint64_t errcode, offset, ip;
+	int status;
+
+	if (*pos != pt_bin_tag_error)
+		return -pte_bad_packet;
+
+	begin = pos++;
+
+	pos = pt_bin_get_uleb(&errcode, pos, end, &status);
+	if (!pos)
+		return status;
+
+	pos = pt_bin_get_uleb(&offset, pos, end, &status);
+	if (!pos)
+		return status;
+
+	pos = pt_bin_get_uleb(&ip, pos, end, &status);
+	if (!pos)
+		return status;
+
+	if (0x7fffffffull < errcode)
+		return -pte_bad_packet;
+
+	state->sync = 0;
+
+	record->type = pbr_error;
+	record->variant.error.errcode = -(int) errcode;
+	record->variant.error.offset = offset;
+	record->variant.error.ip = ip;
+
+	return (int) (pos - begin);
+}
+
+static int pt_bin_read_insn(struct pt_bin_state *state,
+			    struct pt_bin_record *record,
+			    const uint8_t *pos, const uint8_t *end)
+{
+	struct pt_insn *insn;
+	const uint8_t *begin;
+	uint64_t size, flags, delta, ip;
+	uint8_t tag;
+	int status;
+
+	if (!state->sync)
+		return -pte_nosync;
+
+	begin = pos;
+	tag = *pos++;
+
+	if (tag & pt_bin_tag_reserved)
+		return -pte_bad_packet;
+
+	pos = pt_bin_get_uleb(&size, pos, end, &status);
+	if (!pos)
+		return status;
+
+	if (!size || (pt_max_insn_size < size))
+		return -pte_bad_packet;
+
+	flags = 0ull;
+	if (tag & pt_bin_tag_flags) {
+		pos = pt_bin_get_uleb(&flags, pos, end, &status);
+		if (!pos)
+			return status;
+	}
+
+	delta = 0ull;
+	if (tag & pt_bin_tag_delta) {
+		pos = pt_bin_get_uleb(&delta, pos, end, &status);
+		if (!pos)
+			return status;
+
+		/* Undo the zigzag encoding. */
+		delta = (delta >> 1) ^ (uint64_t) -(int64_t) (delta & 1ull);
+	}
+
+	insn = &record->variant.insn;
+	memset(insn, 0, sizeof(*insn));
+
+	if (tag & pt_bin_tag_raw) {
+		if ((uint64_t) (end - pos) < size)
+			return -pte_eos;
+
+		memcpy(insn->raw, pos, (size_t) size);
+		pos += size;
+	}
+
+	ip = state->ip + delta;
+
+	insn->ip = ip;
+	insn->iclass = (enum pt_insn_class) (tag & pt_bin_tag_type);
+	insn->mode = (enum pt_exec_mode) state->mode;
+	insn->size = (uint8_t) size;
+	insn->speculative = (flags & pt_bin_flag_speculative) ? 1 : 0;
+	insn->aborted = (flags & pt_bin_flag_aborted) ? 1 : 0;
+	insn->committed = (flags & pt_bin_flag_committed) ? 1 : 0;
+	insn->disabled = (flags & pt_bin_flag_disabled) ? 1 : 0;
+	insn->enabled = (flags & pt_bin_flag_enabled) ? 1 : 0;
+	insn->resumed = (flags & pt_bin_flag_resumed) ? 1 : 0;
+	insn->interrupted = (flags & pt_bin_flag_interrupted) ? 1 : 0;
+	insn->resynced = (flags & pt_bin_flag_resynced) ? 1 : 0;
+	insn->stopped = (flags & pt_bin_flag_stopped) ? 1 : 0;
+
+	record->type = pbr_insn;
+
+	state->ip = ip + size;
+	state->count += 1;
+
+	return (int) (pos - begin);
+}
+
+int pt_bin_read(struct pt_bin_state *state, struct pt_bin_record *record,
+		const uint8_t *pos, const uint8_t *end)
+{
+	uint8_t type;
+
+	if (!state || !record || !pos)
+		return -pte_invalid;
+
+	if (end <= pos)
+		return -pte_eos;
+
+	type = *pos & pt_bin_tag_type;
+	switch (type) {
+	case pt_bin_tag_sync:
+		return pt_bin_read_sync(state, record, pos, end);
+
+	case pt_bin_tag_error:
+		return pt_bin_read_error(state, record, pos, end);
+
+	default:
+		if (ptic_far_jump < type)
+			return -pte_bad_opc;
+
+		return pt_bin_read_insn(state, record, pos, end);
+	}
+}
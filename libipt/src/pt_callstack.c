@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pt_callstack.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+void pt_callstack_init(struct pt_callstack *callstack)
+{
+	if (!callstack)
+		return;
+
+	memset(callstack, 0, sizeof(*callstack));
+}
+
+void pt_callstack_fini(struct pt_callstack *callstack)
+{
+	if (!callstack)
+		return;
+
+	free(callstack->frame);
+
+	memset(callstack, 0, sizeof(*callstack));
+}
+
+void pt_callstack_clear(struct pt_callstack *callstack)
+{
+	if (!callstack)
+		return;
+
+	callstack->top = 0;
+	callstack->depth = 0;
+}
+
+/* Grow @callstack to @capacity frames.
+ *
+ * The frames are moved to the beginning of the new buffer, oldest first.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_callstack_grow(struct pt_callstack *callstack,
+			     uint32_t capacity)
+{
+	struct pt_call_frame *frame;
+	uint32_t depth, bottom, mask, idx;
+
+	if (!callstack)
+		return -pte_internal;
+
+	depth = callstack->depth;
+	if (capacity < depth)
+		return -pte_internal;
+
+	frame = malloc(capacity * sizeof(*frame));
+	if (!frame)
+		return -pte_nomem;
+
+	mask = callstack->capacity - 1;
+	bottom = callstack->top - depth;
+	for (idx = 0; idx < depth; ++idx)
+		frame[idx] = callstack->frame[(bottom + idx) & mask];
+
+	free(callstack->frame);
+
+	callstack->frame = frame;
+	callstack->capacity = capacity;
+	callstack->top = depth;
+
+	return 0;
+}
+
+int pt_callstack_push(struct pt_callstack *callstack,
+		      const struct pt_call_frame *frame)
+{
+	uint32_t capacity, depth;
+
+	if (!callstack || !frame)
+		return -pte_internal;
+
+	capacity = callstack->capacity;
+	depth = callstack->depth;
+
+	if (depth < capacity)
+		callstack->depth = depth + 1;
+	else if (capacity < pt_callstack_max) {
+		int errcode;
+
+		errcode = pt_callstack_grow(callstack, capacity ?
+					    capacity * 2 : pt_callstack_min);
+		if (errcode < 0)
+			return errcode;
+
+		callstack->depth = depth + 1;
+	}
+
+	/* If we're at the maximal capacity, we overwrite the oldest frame
+	 * and the depth remains unchanged.
+	 */
+	capacity = callstack->capacity;
+	callstack->frame[callstack->top & (capacity - 1)] = *frame;
+	callstack->top = (callstack->top + 1) & (capacity - 1);
+
+	return 0;
+}
+
+int pt_callstack_pop(struct pt_callstack *callstack,
+		     struct pt_call_frame *frame)
+{
+	uint32_t top;
+
+	if (!callstack)
+		return -pte_internal;
+
+	if (!callstack->depth)
+		return -pte_noip;
+
+	top = (callstack->top - 1) & (callstack->capacity - 1);
+	if (frame)
+		*frame = callstack->frame[top];
+
+	callstack->top = top;
+	callstack->depth -= 1;
+
+	return 0;
+}
+
+int pt_callstack_depth(const struct pt_callstack *callstack)
+{
+	if (!callstack)
+		return -pte_internal;
+
+	return (int) callstack->depth;
+}
+
+int pt_callstack_frame(const struct pt_callstack *callstack,
+		       struct pt_call_frame *frame, uint32_t level)
+{
+	uint32_t idx;
+
+	if (!callstack || !frame)
+		return -pte_internal;
+
+	if (callstack->depth <= level)
+		return -pte_invalid;
+
+	idx = (callstack->top - 1 - level) & (callstack->capacity - 1);
+	*frame = callstack->frame[idx];
+
+	return 0;
+}
@@ -104,5 +104,21 @@ int pt_config_from_user(struct pt_config *config,
 	/* We copied user's size - fix it. */
 	config->size = size;
 
+	/* Check the additional trace buffer parts, if there are any. */
+	if (config->nparts) {
+		const struct pt_trace_part *part;
+		uint32_t idx;
+
+		part = config->parts;
+		if (!part)
+			return -pte_bad_config;
+
+		for (idx = 0; idx < config->nparts; ++idx) {
+			if (!part[idx].begin || !part[idx].end ||
+			    part[idx].end < part[idx].begin)
+				return -pte_bad_config;
+		}
+	}
+
 	return 0;
 }
@@ -31,20 +31,60 @@
 #include <string.h>
 
 
-static inline uint8_t pt_evq_inc(uint8_t idx)
+static struct pt_event *pt_event_init(struct pt_event *event)
+{
+	if (event)
+		memset(event, 0, sizeof(*event));
+
+	return event;
+}
+
+/* Allocate an event slot.
+ *
+ * Returns the index of a free slot on success, evq_size otherwise.
+ */
+static uint8_t pt_evq_alloc(struct pt_event_queue *evq)
 {
-	idx += 1;
-	idx %= evq_max;
+	uint16_t used;
+	uint8_t idx;
+
+	used = evq->used;
+	for (idx = 0; idx < evq_size; ++idx) {
+		uint16_t mask;
+
+		mask = (uint16_t) (1u << idx);
+		if (!(used & mask)) {
+			evq->used = used | mask;
+			break;
+		}
+	}
 
 	return idx;
 }
 
-static struct pt_event *pt_event_init(struct pt_event *event)
+/* Release the event slot at @idx. */
+static void pt_evq_release(struct pt_event_queue *evq, uint8_t idx)
 {
-	if (event)
-		memset(event, 0, sizeof(*event));
+	if (evq_size <= idx)
+		return;
 
-	return event;
+	evq->used &= (uint16_t) ~(1u << idx);
+}
+
+/* Hand out the event at @idx.
+ *
+ * The next-to-last handed out event, if any, is released.
+ *
+ * Returns a pointer to the event.
+ */
+static struct pt_event *pt_evq_hand_out(struct pt_event_queue *evq,
+					uint8_t idx)
+{
+	pt_evq_release(evq, evq->previous);
+	evq->previous = evq->current;
+	evq->current = idx;
+
+	return &evq->event[idx];
 }
 
 void pt_evq_init(struct pt_event_queue *evq)
@@ -52,21 +92,35 @@ void pt_evq_init(struct pt_event_queue *evq)
 	if (!evq)
 		return;
 
-	memset(evq, 0, sizeof(*evq));
+	/* The events are initialized when they are allocated. */
+	memset(evq->size, 0, sizeof(evq->size));
+	evq->current = evq_size;
+	evq->previous = evq_size;
+	evq->used = 0;
 }
 
 struct pt_event *pt_evq_standalone(struct pt_event_queue *evq)
 {
+	uint8_t idx;
+
 	if (!evq)
 		return NULL;
 
-	return pt_event_init(&evq->standalone);
+	/* Release the next-to-last event first so we're guaranteed a slot. */
+	pt_evq_release(evq, evq->previous);
+	evq->previous = evq_size;
+
+	idx = pt_evq_alloc(evq);
+	if (evq_size <= idx)
+		return NULL;
+
+	return pt_event_init(pt_evq_hand_out(evq, idx));
 }
 
 struct pt_event *pt_evq_enqueue(struct pt_event_queue *evq,
 				enum pt_event_binding evb)
 {
-	uint8_t begin, end, gap, idx;
+	uint8_t size, idx;
 
 	if (!evq)
 		return NULL;
@@ -74,31 +128,24 @@ struct pt_event *pt_evq_enqueue(struct pt_event_queue *evq,
 	if (evb_max <= evb)
 		return NULL;
 
-	begin = evq->begin[evb];
-	idx = evq->end[evb];
-
-	if (evq_max <= begin)
-		return NULL;
-
-	if (evq_max <= idx)
+	size = evq->size[evb];
+	if (evq_max <= size)
 		return NULL;
 
-	end = pt_evq_inc(idx);
-	gap = pt_evq_inc(end);
-
-	/* Leave a gap so we don't overwrite the last dequeued event. */
-	if (begin == gap)
+	idx = pt_evq_alloc(evq);
+	if (evq_size <= idx)
 		return NULL;
 
-	evq->end[evb] = end;
+	evq->queue[evb][size] = idx;
+	evq->size[evb] = size + 1;
 
-	return pt_event_init(&evq->queue[evb][idx]);
+	return pt_event_init(&evq->event[idx]);
 }
 
 struct pt_event *pt_evq_dequeue(struct pt_event_queue *evq,
 				enum pt_event_binding evb)
 {
-	uint8_t begin, end;
+	uint8_t *queue, size, idx, pos;
 
 	if (!evq)
 		return NULL;
@@ -106,40 +153,50 @@ struct pt_event *pt_evq_dequeue(struct pt_event_queue *evq,
 	if (evb_max <= evb)
 		return NULL;
 
-	begin = evq->begin[evb];
-	end = evq->end[evb];
-
-	if (evq_max <= begin)
+	size = evq->size[evb];
+	if (!size || (evq_max < size))
 		return NULL;
 
-	if (evq_max <= end)
-		return NULL;
+	queue = evq->queue[evb];
+	idx = queue[0];
 
-	if (begin == end)
-		return NULL;
+	size -= 1;
+	for (pos = 0; pos < size; ++pos)
+		queue[pos] = queue[pos + 1];
+
+	evq->size[evb] = size;
 
-	evq->begin[evb] = pt_evq_inc(begin);
+	if (evq_size <= idx)
+		return NULL;
 
-	return &evq->queue[evb][begin];
+	return pt_evq_hand_out(evq, idx);
 }
 
 int pt_evq_clear(struct pt_event_queue *evq, enum pt_event_binding evb)
 {
+	uint8_t size, pos;
+
 	if (!evq)
 		return -pte_internal;
 
 	if (evb_max <= evb)
 		return -pte_internal;
 
-	evq->begin[evb] = 0;
-	evq->end[evb] = 0;
+	size = evq->size[evb];
+	if (evq_max < size)
+		return -pte_internal;
+
+	for (pos = 0; pos < size; ++pos)
+		pt_evq_release(evq, evq->queue[evb][pos]);
+
+	evq->size[evb] = 0;
 
 	return 0;
 }
 
 int pt_evq_empty(const struct pt_event_queue *evq, enum pt_event_binding evb)
 {
-	uint8_t begin, end;
+	uint8_t size;
 
 	if (!evq)
 		return -pte_internal;
@@ -147,16 +204,11 @@ int pt_evq_empty(const struct pt_event_queue *evq, enum pt_event_binding evb)
 	if (evb_max <= evb)
 		return -pte_internal;
 
-	begin = evq->begin[evb];
-	end = evq->end[evb];
-
-	if (evq_max <= begin)
+	size = evq->size[evb];
+	if (evq_max < size)
 		return -pte_internal;
 
-	if (evq_max <= end)
-		return -pte_internal;
-
-	return begin == end;
+	return !size;
 }
 
 int pt_evq_pending(const struct pt_event_queue *evq, enum pt_event_binding evb)
@@ -174,7 +226,7 @@ struct pt_event *pt_evq_find(struct pt_event_queue *evq,
 			     enum pt_event_binding evb,
 			     enum pt_event_type evt)
 {
-	uint8_t begin, end;
+	uint8_t size, pos;
 
 	if (!evq)
 		return NULL;
@@ -182,19 +234,19 @@ struct pt_event *pt_evq_find(struct pt_event_queue *evq,
 	if (evb_max <= evb)
 		return NULL;
 
-	begin = evq->begin[evb];
-	end = evq->end[evb];
-
-	if (evq_max <= begin)
+	size = evq->size[evb];
+	if (evq_max < size)
 		return NULL;
 
-	if (evq_max <= end)
-		return NULL;
-
-	for (; begin != end; begin = pt_evq_inc(begin)) {
+	for (pos = 0; pos < size; ++pos) {
 		struct pt_event *ev;
+		uint8_t idx;
+
+		idx = evq->queue[evb][pos];
+		if (evq_size <= idx)
+			return NULL;
 
-		ev = &evq->queue[evb][begin];
+		ev = &evq->event[idx];
 		if (ev->type == evt)
 			return ev;
 	}
@@ -28,71 +28,137 @@
 
 #include "pt_ild.h"
 #include "pti-imm-defs.h"
-#include "pti-imm.h"
 #include "pti-modrm-defs.h"
-#include "pti-modrm.h"
 #include "pti-disp-defs.h"
-#include "pti-disp.h"
+#include "pti-props-defs.h"
+#include "pti-props.h"
 
-#include <string.h>
 
-/* SET UP 3 TABLES */
-
-static uint8_t has_disp_regular[4][4][8];
-
-static void init_has_disp_regular_table(void)
-{
-	uint8_t mod, rm;
-
-	memset(has_disp_regular, 0, sizeof(has_disp_regular));
-
-	/*fill eamode16 */
-	has_disp_regular[ptem_16bit][0][6] = 2;
-	for (rm = 0; rm < 8; rm++)
-		for (mod = 1; mod <= 2; mod++)
-			has_disp_regular[ptem_16bit][mod][rm] = mod;
-
-	/*fill eamode32/64 */
-	has_disp_regular[ptem_32bit][0][5] = 4;
-	has_disp_regular[ptem_64bit][0][5] = 4;
-	for (rm = 0; rm < 8; rm++) {
-		has_disp_regular[ptem_32bit][1][rm] = 1;
-		has_disp_regular[ptem_32bit][2][rm] = 4;
-
-		has_disp_regular[ptem_64bit][1][rm] = 1;
-		has_disp_regular[ptem_64bit][2][rm] = 4;
-	}
-}
-
-static uint8_t eamode_table[2][4];
-
-static void init_eamode_table(void)
-{
-	eamode_table[0][ptem_unknown] = ptem_unknown;
-	eamode_table[0][ptem_16bit] = ptem_16bit;
-	eamode_table[0][ptem_32bit] = ptem_32bit;
-	eamode_table[0][ptem_64bit] = ptem_64bit;
-
-	eamode_table[1][ptem_unknown] = ptem_unknown;
-	eamode_table[1][ptem_16bit] = ptem_32bit;
-	eamode_table[1][ptem_32bit] = ptem_16bit;
-	eamode_table[1][ptem_64bit] = ptem_32bit;
-}
-
-static uint8_t has_sib_table[4][4][8];
-
-static void init_has_sib_table(void)
-{
-	uint8_t mod;
-
-	memset(has_sib_table, 0, sizeof(has_sib_table));
-
-	/*for eamode32/64 there is sib byte for mod!=3 and rm==4 */
-	for (mod = 0; mod <= 2; mod++) {
-		has_sib_table[ptem_32bit][mod][4] = 1;
-		has_sib_table[ptem_64bit][mod][4] = 1;
+/* The number of displacement bytes by effective address mode, mod, and rm
+ * for instructions with a modrm byte.
+ */
+static const uint8_t has_disp_regular[4][4][8] = {
+	/* ptem_unknown */ {
+		{ 0, 0, 0, 0, 0, 0, 0, 0 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 }
+	},
+	/* ptem_16bit */ {
+		{ 0, 0, 0, 0, 0, 0, 2, 0 },
+		{ 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 }
+	},
+	/* ptem_32bit */ {
+		{ 0, 0, 0, 0, 0, 4, 0, 0 },
+		{ 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 4, 4, 4, 4, 4, 4, 4, 4 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 }
+	},
+	/* ptem_64bit */ {
+		{ 0, 0, 0, 0, 0, 4, 0, 0 },
+		{ 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 4, 4, 4, 4, 4, 4, 4, 4 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0 }
 	}
-}
+};
+
+/* The effective address mode by address-size override and execution mode. */
+static const uint8_t eamode_table[2][4] = {
+	/* no asz */ { ptem_unknown, ptem_16bit, ptem_32bit, ptem_64bit },
+	/* asz */ { ptem_unknown, ptem_32bit, ptem_16bit, ptem_32bit }
+};
+
+/* Legacy, REX, VEX, and EVEX prefix classes. */
+enum pti_prefix {
+	PTI_PFX_NONE,
+	PTI_PFX_OSZ,
+	PTI_PFX_ASZ,
+	PTI_PFX_SEG,
+	PTI_PFX_LOCK,
+	PTI_PFX_F2,
+	PTI_PFX_F3,
+	PTI_PFX_REX,
+	PTI_PFX_VEX_C4,
+	PTI_PFX_VEX_C5,
+	PTI_PFX_EVEX
+};
+
+/* The prefix class by byte. */
+static const uint8_t prefix_table[256] = {
+	/* 0x00 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x10 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x20 */ 0, 0, 0, 0, 0, 0, PTI_PFX_SEG, 0,
+		   0, 0, 0, 0, 0, 0, PTI_PFX_SEG, 0,
+	/* 0x30 */ 0, 0, 0, 0, 0, 0, PTI_PFX_SEG, 0,
+		   0, 0, 0, 0, 0, 0, PTI_PFX_SEG, 0,
+	/* 0x40 */ PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX,
+		   PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX,
+		   PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX,
+		   PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX, PTI_PFX_REX,
+	/* 0x50 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x60 */ 0, 0, PTI_PFX_EVEX, 0, PTI_PFX_SEG, PTI_PFX_SEG,
+		   PTI_PFX_OSZ, PTI_PFX_ASZ, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x70 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x80 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0x90 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xa0 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xb0 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xc0 */ 0, 0, 0, 0, PTI_PFX_VEX_C4, PTI_PFX_VEX_C5, 0, 0,
+		   0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xd0 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xe0 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0xf0 */ PTI_PFX_LOCK, 0, PTI_PFX_F2, PTI_PFX_F3,
+		   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/* Instruction class flags. */
+enum pti_iclass_flag {
+	PTI_ICF_BRANCH	= 1 << 0,
+	PTI_ICF_DIRECT	= 1 << 1,
+	PTI_ICF_FAR	= 1 << 2,
+	PTI_ICF_RET	= 1 << 3,
+	PTI_ICF_CALL	= 1 << 4,
+	PTI_ICF_COND	= 1 << 5
+};
+
+/* The instruction class flags by instruction class. */
+static const uint8_t iclass_flags[PTI_INST_LAST] = {
+	/* PTI_INST_INVALID */	0,
+	/* PTI_INST_CALL_9A */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_CALL_FFr3 */ PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_CALL_FFr2 */ PTI_ICF_BRANCH | PTI_ICF_CALL,
+	/* PTI_INST_CALL_E8 */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_CALL,
+	/* PTI_INST_INT */	0,
+	/* PTI_INST_INT3 */	0,
+	/* PTI_INST_INT1 */	0,
+	/* PTI_INST_INTO */	0,
+	/* PTI_INST_IRET */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_JMP_E9 */	PTI_ICF_BRANCH | PTI_ICF_DIRECT,
+	/* PTI_INST_JMP_EB */	PTI_ICF_BRANCH | PTI_ICF_DIRECT,
+	/* PTI_INST_JMP_EA */	PTI_ICF_BRANCH | PTI_ICF_FAR,
+	/* PTI_INST_JMP_FFr5 */	PTI_ICF_BRANCH | PTI_ICF_FAR,
+	/* PTI_INST_JMP_FFr4 */	PTI_ICF_BRANCH,
+	/* PTI_INST_JCC */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_COND,
+	/* PTI_INST_JrCXZ */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_COND,
+	/* PTI_INST_LOOP */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_COND,
+	/* PTI_INST_LOOPE */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_COND,
+	/* PTI_INST_LOOPNE */	PTI_ICF_BRANCH | PTI_ICF_DIRECT | PTI_ICF_COND,
+	/* PTI_INST_MOV_CR3 */	0,
+	/* PTI_INST_RET_C3 */	PTI_ICF_BRANCH | PTI_ICF_RET,
+	/* PTI_INST_RET_C2 */	PTI_ICF_BRANCH | PTI_ICF_RET,
+	/* PTI_INST_RET_CB */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_RET_CA */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_SYSCALL */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_SYSENTER */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_SYSEXIT */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_SYSRET */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_VMLAUNCH */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_VMRESUME */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_CALL,
+	/* PTI_INST_VMCALL */	PTI_ICF_BRANCH | PTI_ICF_FAR | PTI_ICF_RET,
+	/* PTI_INST_VMPTRLD */	0
+};
 
 /* SOME ACCESSORS */
 
@@ -220,24 +286,11 @@ static inline int resolve_v(uint8_t *pbytes, enum pt_exec_mode eosz)
 
 /*  DECODERS */
 
-static int set_imm_bytes(struct pt_ild *ild)
+static int set_imm_bytes(struct pt_ild *ild, uint8_t imm_code)
 {
-	/*: set ild->imm1_bytes and  ild->imm2_bytes for maps 0/1 */
-	static uint8_t const *const map_map[] = {
-		/* map 0 */ imm_bytes_map_0x0,
-		/* map 1 */ imm_bytes_map_0x0F
-	};
-	uint8_t map, imm_code;
-
 	if (!ild)
 		return -pte_internal;
 
-	map = ild->map;
-
-	if ((sizeof(map_map) / sizeof(*map_map)) <= map)
-		return 0;
-
-	imm_code = map_map[map][ild->nominal_opcode];
 	switch (imm_code) {
 	case PTI_IMM_NONE:
 	case PTI_0_IMM_WIDTH_CONST_l2:
@@ -311,56 +364,11 @@ static int set_imm_bytes(struct pt_ild *ild)
 	}
 }
 
-static int imm_dec(struct pt_ild *ild, uint8_t length)
+static int set_disp_bytes(struct pt_ild *ild, uint8_t disp_kind)
 {
-	int errcode;
-
 	if (!ild)
 		return -pte_internal;
 
-	if (ild->map == PTI_MAP_AMD3DNOW) {
-		if (ild->max_bytes <= length)
-			return -pte_bad_insn;
-
-		ild->nominal_opcode = get_byte(ild, length);
-		ild->length = length + 1;
-		return 0;
-	}
-
-	errcode = set_imm_bytes(ild);
-	if (errcode < 0)
-		return errcode;
-
-	length += ild->imm1_bytes;
-	length += ild->imm2_bytes;
-	if (ild->max_bytes < length)
-		return -pte_bad_insn;
-
-	ild->length = length;
-	return 0;
-}
-
-static int compute_disp_dec(struct pt_ild *ild)
-{
-	/* set ild->disp_bytes for maps 0 and 1. */
-	static uint8_t const *const map_map[] = {
-		/* map 0 */ disp_bytes_map_0x0,
-		/* map 1 */ disp_bytes_map_0x0F
-	};
-	uint8_t map, disp_kind;
-
-	if (!ild)
-		return -pte_internal;
-
-	if (0 < ild->disp_bytes)
-		return 0;
-
-	map = ild->map;
-
-	if ((sizeof(map_map) / sizeof(*map_map)) <= map)
-		return 0;
-
-	disp_kind = map_map[map][ild->nominal_opcode];
 	switch (disp_kind) {
 	case PTI_DISP_NONE:
 		ild->disp_bytes = 0;
@@ -405,527 +413,559 @@ static int compute_disp_dec(struct pt_ild *ild)
 	}
 }
 
-static int disp_dec(struct pt_ild *ild, uint8_t length)
+/* Determine the instruction class of an opcode whose class depends on its
+ * modrm byte.
+ */
+static pti_inst_enum_t classify_byreg(const struct pt_ild *ild)
 {
-	uint8_t disp_bytes;
-	int errcode;
+	uint8_t reg;
 
-	if (!ild)
-		return -pte_internal;
+	reg = pti_get_modrm_reg(ild);
 
-	errcode = compute_disp_dec(ild);
-	if (errcode < 0)
-		return errcode;
+	switch (ild->map) {
+	case PTI_MAP_0:
+		switch (ild->nominal_opcode) {
+		case 0xff:
+			switch (reg) {
+			case 2:
+				return PTI_INST_CALL_FFr2;
 
-	disp_bytes = ild->disp_bytes;
-	if (disp_bytes == 0)
-		return imm_dec(ild, length);
+			case 3:
+				return PTI_INST_CALL_FFr3;
 
-	if (length + disp_bytes > ild->max_bytes)
-		return -pte_bad_insn;
+			case 4:
+				return PTI_INST_JMP_FFr4;
 
-	/*Record only position; must be able to re-read itext bytes for actual
-	   value. (SMC/CMC issue). */
-	ild->disp_pos = length;
+			case 5:
+				return PTI_INST_JMP_FFr5;
+			}
+			break;
+		}
+		break;
 
-	return imm_dec(ild, length + disp_bytes);
-}
+	case PTI_MAP_1:
+		switch (ild->nominal_opcode) {
+		case 0x22:
+			if (reg == 3 && !ild->u.s.rex_r)
+				return PTI_INST_MOV_CR3;
+			break;
 
-static int sib_dec(struct pt_ild *ild, uint8_t length)
-{
-	uint8_t sib;
+		case 0x01:
+			switch (ild->modrm_byte) {
+			case 0xc1:
+				return PTI_INST_VMCALL;
 
-	if (!ild)
-		return -pte_internal;
+			case 0xc2:
+				return PTI_INST_VMLAUNCH;
 
-	if (ild->max_bytes <= length)
-		return -pte_bad_insn;
+			case 0xc3:
+				return PTI_INST_VMRESUME;
+			}
+			break;
 
-	sib = get_byte(ild, length);
-	if ((sib & 0x07) == 0x05 && pti_get_modrm_mod(ild) == 0)
-		ild->disp_bytes = 4;
+		case 0xc7:
+			if (pti_get_modrm_mod(ild) != 3 && reg == 6)
+				return PTI_INST_VMPTRLD;
+			break;
+		}
+		break;
+	}
 
-	return disp_dec(ild, length + 1);
+	return PTI_INST_INVALID;
 }
 
-static int modrm_dec(struct pt_ild *ild, uint8_t length)
+static inline int64_t sign_extend_bq(int8_t x)
 {
-	static uint8_t const *const has_modrm_2d[2] = {
-		has_modrm_map_0x0,
-		has_modrm_map_0x0F
-	};
-	int has_modrm = PTI_MODRM_FALSE;
-	pti_map_enum_t map;
-
-	if (!ild)
-		return -pte_internal;
-
-	map = pti_get_map(ild);
-	if (map >= PTI_MAP_2)
-		has_modrm = PTI_MODRM_TRUE;
-	else
-		has_modrm = has_modrm_2d[map][ild->nominal_opcode];
-
-	if (has_modrm == PTI_MODRM_FALSE || has_modrm == PTI_MODRM_UNDEF)
-		return disp_dec(ild, length);
-
-	/* really >= here because we have not eaten the byte yet */
-	if (length >= ild->max_bytes)
-		return -pte_bad_insn;
-
-	ild->modrm_byte = get_byte(ild, length);
-
-	if (has_modrm != PTI_MODRM_IGNORE_MOD) {
-		/* set disp_bytes and sib using simple tables */
-
-		uint8_t eamode = eamode_table[ild->u.s.asz][ild->mode];
-		uint8_t mod = (uint8_t) pti_get_modrm_mod(ild);
-		uint8_t rm = (uint8_t) pti_get_modrm_rm(ild);
-		uint8_t has_sib;
-
-		ild->disp_bytes = has_disp_regular[eamode][mod][rm];
-
-		has_sib = has_sib_table[eamode][mod][rm];
-		if (has_sib)
-			return sib_dec(ild, length + 1);
-	}
-
-	return disp_dec(ild, length + 1);
+	return x;
 }
 
-static inline int get_next_as_opcode(struct pt_ild *ild, uint8_t length)
+static inline int64_t sign_extend_wq(int16_t x)
 {
-	if (!ild)
-		return -pte_internal;
-
-	if (ild->max_bytes <= length)
-		return -pte_bad_insn;
-
-	ild->nominal_opcode = get_byte(ild, length);
-
-	return modrm_dec(ild, length + 1);
+	return x;
 }
 
-static int opcode_dec(struct pt_ild *ild, uint8_t length)
+static inline int64_t sign_extend_dq(int32_t x)
 {
-	uint8_t b, m;
-
-	if (!ild)
-		return -pte_internal;
-
-	/*no need to check max_bytes - it was checked in previous scanners */
-	b = get_byte(ild, length);
-	if (b != 0x0F) {	/* 1B opcodes, map 0 */
-		ild->map = PTI_MAP_0;
-		ild->nominal_opcode = b;
-
-		return modrm_dec(ild, length + 1);
-	}
-
-	length++;		/* eat the 0x0F */
-
-	if (ild->max_bytes <= length)
-		return -pte_bad_insn;
-
-	/* 0x0F opcodes MAPS 1,2,3 */
-	m = get_byte(ild, length);
-	if (m == 0x38) {
-		ild->map = PTI_MAP_2;
-
-		return get_next_as_opcode(ild, length + 1);
-	} else if (m == 0x3A) {
-		ild->map = PTI_MAP_3;
-		ild->imm1_bytes = 1;
-
-		return get_next_as_opcode(ild, length + 1);
-	} else if (bits_match(m, 0xf8, 0x38)) {
-		ild->map = PTI_MAP_INVALID;
-
-		return get_next_as_opcode(ild, length + 1);
-	} else if (m == 0x0F) {	/* 3dNow */
-		ild->map = PTI_MAP_AMD3DNOW;
-		ild->imm1_bytes = 1;
-		/* real opcode is in immediate later on, but we need an
-		 * opcode now. */
-		ild->nominal_opcode = 0x0F;
-
-		return modrm_dec(ild, length + 1);
-	} else {	/* map 1 (simple two byte opcodes) */
-		ild->nominal_opcode = m;
-		ild->map = PTI_MAP_1;
-
-		return modrm_dec(ild, length + 1);
-	}
+	return x;
 }
 
-typedef int (*prefix_decoder)(struct pt_ild *ild, uint8_t length, uint8_t rex);
-static prefix_decoder prefix_table[256];
-
-static inline int prefix_decode(struct pt_ild *ild, uint8_t length, uint8_t rex)
+static int set_branch_target(struct pt_ild *ild)
 {
-	uint8_t byte;
+	int64_t npc;
+	uint64_t sign_extended_disp = 0;
 
 	if (!ild)
 		return -pte_internal;
 
-	if (ild->max_bytes <= length)
-		return -pte_bad_insn;
+	if (ild->disp_bytes == 1)
+		sign_extended_disp =
+		    sign_extend_bq(get_byte(ild, ild->disp_pos));
+	else if (ild->disp_bytes == 2) {
+		int16_t *w = (int16_t *) (get_byte_ptr(ild, ild->disp_pos));
 
-	byte = get_byte(ild, length);
+		sign_extended_disp = sign_extend_wq(*w);
+	} else if (ild->disp_bytes == 4) {
+		int32_t *d = (int32_t *) (get_byte_ptr(ild, ild->disp_pos));
 
-	return prefix_table[byte](ild, length, rex);
-}
+		sign_extended_disp = sign_extend_dq(*d);
+	} else
+		return -pte_bad_insn;
 
-static inline int prefix_next(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	return prefix_decode(ild, length + 1, rex);
+	npc = (int64_t) (ild->runtime_address + ild->length);
+	ild->direct_target = (uint64_t) (npc + sign_extended_disp);
+
+	return 0;
 }
 
-static int prefix_osz(struct pt_ild *ild, uint8_t length, uint8_t rex)
+/* Classify an instruction.
+ *
+ * Sets @ild->iclass and the branch flags based on the instruction class in
+ * the opcode properties @props and, for direct branches, computes the branch
+ * target.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int classify(struct pt_ild *ild, uint16_t props)
 {
-	(void) rex;
+	pti_inst_enum_t iclass;
+	uint8_t flags;
 
 	if (!ild)
 		return -pte_internal;
 
-	ild->u.s.osz = 1;
+	/* We're only interested in legacy map 0 and map 1 instructions. */
+	if (ild->u.s.vex)
+		return 0;
 
-	return prefix_next(ild, length, 0);
-}
+	iclass = (pti_inst_enum_t) PTI_PROPS_ICLASS(props);
+	if (iclass == PTI_INST_INVALID)
+		return 0;
 
-static int prefix_asz(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	(void) rex;
+	if (iclass == PTI_INST_BYREG) {
+		iclass = classify_byreg(ild);
+		if (iclass == PTI_INST_INVALID)
+			return 0;
+	}
 
-	if (!ild)
+	if (PTI_INST_LAST <= iclass)
 		return -pte_internal;
 
-	ild->u.s.asz = 1;
+	ild->iclass = iclass;
+
+	flags = iclass_flags[iclass];
+	if (flags & PTI_ICF_BRANCH)
+		ild->u.s.branch = 1;
+	if (flags & PTI_ICF_FAR)
+		ild->u.s.branch_far = 1;
+	if (flags & PTI_ICF_RET)
+		ild->u.s.ret = 1;
+	if (flags & PTI_ICF_CALL)
+		ild->u.s.call = 1;
+	if (flags & PTI_ICF_COND)
+		ild->u.s.cond = 1;
+	if (flags & PTI_ICF_DIRECT) {
+		ild->u.s.branch_direct = 1;
+
+		return set_branch_target(ild);
+	}
 
-	return prefix_next(ild, length, 0);
+	return 0;
 }
 
-static int prefix_lock(struct pt_ild *ild, uint8_t length, uint8_t rex)
+/* Decode the VEX or EVEX prefix at @length.
+ *
+ * The prefix class @pfx gives the prefix type.
+ *
+ * Returns the length of the prefix including the opcode byte on success.
+ * Returns zero if this is not a VEX or EVEX prefix.
+ * Returns a negative error code otherwise.
+ */
+static int vex_dec(struct pt_ild *ild, uint8_t length, uint8_t pfx)
 {
-	(void) rex;
+	uint8_t max_bytes, p1, p2, map, size;
 
 	if (!ild)
 		return -pte_internal;
 
-	ild->u.s.lock = 1;
+	max_bytes = ild->max_bytes;
 
-	return prefix_next(ild, length, 0);
-}
+	/* Read the next byte to validate that this is indeed VEX. */
+	if (max_bytes <= (length + 1))
+		return -pte_bad_insn;
 
-static int prefix_f2(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	(void) rex;
+	p1 = get_byte(ild, length + 1);
 
-	if (!ild)
-		return -pte_internal;
+	/* If p1[7:6] is not 11b in non-64-bit mode, this is LDS, LES, or
+	 * BOUND, not VEX or EVEX.
+	 */
+	if (!mode_64b(ild) && !bits_match(p1, 0xc0, 0xc0))
+		return 0;
 
-	ild->u.s.f2 = 1;
-	ild->u.s.last_f2f3 = 2;
+	switch (pfx) {
+	case PTI_PFX_VEX_C5:
+		size = 2;
+		map = PTI_MAP_1;
+		break;
 
-	return prefix_next(ild, length, 0);
-}
+	case PTI_PFX_VEX_C4:
+		size = 3;
+		map = p1 & 0x1f;
+		break;
 
-static int prefix_f3(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	(void) rex;
+	case PTI_PFX_EVEX:
+		size = 4;
+		map = p1 & 0x03;
+		break;
 
-	if (!ild)
+	default:
 		return -pte_internal;
+	}
 
-	ild->u.s.f3 = 1;
-	ild->u.s.last_f2f3 = 3;
+	/* We need the prefix and payload bytes plus one for the opcode. */
+	if (max_bytes < (length + size + 1))
+		return -pte_bad_insn;
 
-	return prefix_next(ild, length, 0);
-}
+	ild->u.s.vex = 1;
+	if (p1 & 0x80)
+		ild->u.s.rex_r = 1;
 
-static int prefix_ignore(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	(void) rex;
+	if (size > 2) {
+		p2 = get_byte(ild, length + 2);
+		if (p2 & 0x80)
+			ild->u.s.rex_w = 1;
+	}
 
-	return prefix_next(ild, length, 0);
-}
+	if (PTI_MAP_INVALID <= map)
+		return -pte_bad_insn;
 
-static int prefix_done(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	if (!ild)
-		return -pte_internal;
+	ild->map = map;
+	if (map == PTI_MAP_3)
+		ild->imm1_bytes = 1;
 
-	if (rex & 0x04)
-		ild->u.s.rex_r = 1;
-	if (rex & 0x08)
-		ild->u.s.rex_w = 1;
+	ild->nominal_opcode = get_byte(ild, length + size);
 
-	return opcode_dec(ild, length);
+	return size + 1;
 }
 
-static int prefix_rex(struct pt_ild *ild, uint8_t length, uint8_t rex)
+/* Decode the opcode at @length.
+ *
+ * Returns the length of the opcode on success, a negative error code
+ * otherwise.
+ */
+static int opcode_dec(struct pt_ild *ild, uint8_t length)
 {
-	(void) rex;
+	uint8_t max_bytes, b, m;
 
 	if (!ild)
 		return -pte_internal;
 
-	if (mode_64b(ild))
-		return prefix_next(ild, length, get_byte(ild, length));
-	else
-		return opcode_dec(ild, length);
-}
-
-static inline int prefix_vex_done(struct pt_ild *ild, uint8_t length)
-{
-	if (!ild)
-		return -pte_internal;
+	max_bytes = ild->max_bytes;
 
-	ild->nominal_opcode = get_byte(ild, length);
+	/* The caller checked that there is at least one byte. */
+	b = get_byte(ild, length);
+	if (b != 0x0F) {	/* 1B opcodes, map 0 */
+		ild->map = PTI_MAP_0;
+		ild->nominal_opcode = b;
 
-	return modrm_dec(ild, length + 1);
-}
+		return 1;
+	}
 
-static int prefix_vex_c5(struct pt_ild *ild, uint8_t length, uint8_t rex)
-{
-	uint8_t max_bytes;
-	uint8_t p1;
+	if (max_bytes <= (length + 1))
+		return -pte_bad_insn;
 
-	(void) rex;
+	/* 0x0F opcodes MAPS 1,2,3 */
+	m = get_byte(ild, length + 1);
+	switch (m) {
+	case 0x38:
+		ild->map = PTI_MAP_2;
+		break;
 
-	if (!ild)
-		return -pte_internal;
+	case 0x3A:
+		ild->map = PTI_MAP_3;
+		ild->imm1_bytes = 1;
+		break;
 
-	max_bytes = ild->max_bytes;
+	case 0x0F:	/* 3dNow */
+		ild->map = PTI_MAP_AMD3DNOW;
+		ild->imm1_bytes = 1;
 
-	/* Read the next byte to validate that this is indeed VEX. */
-	if (max_bytes <= (length + 1))
-		return -pte_bad_insn;
+		/* real opcode is in immediate later on, but we need an
+		 * opcode now.
+		 */
+		ild->nominal_opcode = 0x0F;
+		return 2;
 
-	p1 = get_byte(ild, length + 1);
+	default:
+		if (bits_match(m, 0xf8, 0x38)) {
+			ild->map = PTI_MAP_INVALID;
+			break;
+		}
 
-	/* If p1[7:6] is not 11b in non-64-bit mode, this is LDS, not VEX. */
-	if (!mode_64b(ild) && !bits_match(p1, 0xc0, 0xc0))
-		return opcode_dec(ild, length);
+		/* map 1 (simple two byte opcodes) */
+		ild->map = PTI_MAP_1;
+		ild->nominal_opcode = m;
+		return 2;
+	}
 
-	/* We need at least 3 bytes
-	 * - 2 for the VEX prefix and payload and
-	 * - 1 for the opcode.
-	 */
-	if (max_bytes < (length + 3))
+	if (max_bytes <= (length + 2))
 		return -pte_bad_insn;
 
-	ild->u.s.vex = 1;
-	if (p1 & 0x80)
-		ild->u.s.rex_r = 1;
-
-	ild->map = PTI_MAP_1;
+	ild->nominal_opcode = get_byte(ild, length + 2);
 
-	/* Eat the VEX. */
-	length += 2;
-	return prefix_vex_done(ild, length);
+	return 3;
 }
 
-static int prefix_vex_c4(struct pt_ild *ild, uint8_t length, uint8_t rex)
+/* Decode prefixes and the opcode.
+ *
+ * Returns the length of the prefixes and the opcode on success, a negative
+ * error code otherwise.
+ */
+static int prefix_dec(struct pt_ild *ild)
 {
-	uint8_t max_bytes;
-	uint8_t p1, p2, map;
-
-	(void) rex;
+	uint8_t length, max_bytes, rex;
+	int size;
 
 	if (!ild)
 		return -pte_internal;
 
 	max_bytes = ild->max_bytes;
+	rex = 0;
+
+	/* A REX prefix is ignored unless it immediately precedes the opcode. */
+	for (length = 0; length < max_bytes; ++length) {
+		uint8_t byte, pfx;
+
+		byte = get_byte(ild, length);
+		pfx = prefix_table[byte];
+
+		switch (pfx) {
+		case PTI_PFX_NONE:
+			break;
+
+		case PTI_PFX_OSZ:
+			ild->u.s.osz = 1;
+			rex = 0;
+			continue;
+
+		case PTI_PFX_ASZ:
+			ild->u.s.asz = 1;
+			rex = 0;
+			continue;
+
+		case PTI_PFX_SEG:
+			rex = 0;
+			continue;
+
+		case PTI_PFX_LOCK:
+			ild->u.s.lock = 1;
+			rex = 0;
+			continue;
+
+		case PTI_PFX_F2:
+			ild->u.s.f2 = 1;
+			ild->u.s.last_f2f3 = 2;
+			rex = 0;
+			continue;
+
+		case PTI_PFX_F3:
+			ild->u.s.f3 = 1;
+			ild->u.s.last_f2f3 = 3;
+			rex = 0;
+			continue;
+
+		case PTI_PFX_REX:
+			if (!mode_64b(ild))
+				break;
+
+			rex = byte;
+			continue;
+
+		case PTI_PFX_VEX_C4:
+		case PTI_PFX_VEX_C5:
+		case PTI_PFX_EVEX:
+			size = vex_dec(ild, length, pfx);
+			if (size < 0)
+				return size;
+
+			if (size)
+				return length + size;
+
+			break;
+
+		default:
+			return -pte_internal;
+		}
 
-	/* Read the next byte to validate that this is indeed VEX. */
-	if (max_bytes <= (length + 1))
-		return -pte_bad_insn;
-
-	p1 = get_byte(ild, length + 1);
-
-	/* If p1[7:6] is not 11b in non-64-bit mode, this is LES, not VEX. */
-	if (!mode_64b(ild) && !bits_match(p1, 0xc0, 0xc0))
-		return opcode_dec(ild, length);
-
-	/* We need at least 4 bytes
-	 * - 3 for the VEX prefix and payload and
-	 * - 1 for the opcode.
-	 */
-	if (max_bytes < (length + 4))
-		return -pte_bad_insn;
-
-	p2 = get_byte(ild, length + 2);
-
-	ild->u.s.vex = 1;
-	if (p1 & 0x80)
-		ild->u.s.rex_r = 1;
-	if (p2 & 0x80)
-		ild->u.s.rex_w = 1;
+		if (rex & 0x04)
+			ild->u.s.rex_r = 1;
+		if (rex & 0x08)
+			ild->u.s.rex_w = 1;
 
-	map = p1 & 0x1f;
-	if (PTI_MAP_INVALID <= map)
-		return -pte_bad_insn;
+		size = opcode_dec(ild, length);
+		if (size < 0)
+			return size;
 
-	ild->map = map;
-	if (map == PTI_MAP_3)
-		ild->imm1_bytes = 1;
+		return length + size;
+	}
 
-	/* Eat the VEX. */
-	length += 3;
-	return prefix_vex_done(ild, length);
+	return -pte_bad_insn;
 }
 
-static int prefix_evex(struct pt_ild *ild, uint8_t length, uint8_t rex)
+/* Decode modrm, sib, displacement, and immediate at @length.
+ *
+ * The opcode properties @props give the modrm, displacement, and immediate
+ * kinds for maps 0 and 1.
+ *
+ * Returns the instruction length on success, a negative error code
+ * otherwise.
+ */
+static int operand_dec(struct pt_ild *ild, uint8_t length, uint16_t props)
 {
-	uint8_t max_bytes;
-	uint8_t p1, p2, map;
-
-	(void) rex;
+	uint8_t max_bytes, has_modrm, map;
+	int errcode;
 
 	if (!ild)
 		return -pte_internal;
 
 	max_bytes = ild->max_bytes;
+	map = ild->map;
 
-	/* Read the next byte to validate that this is indeed EVEX. */
-	if (max_bytes <= (length + 1))
-		return -pte_bad_insn;
+	has_modrm = PTI_PROPS_MODRM(props);
+	if (has_modrm != PTI_MODRM_FALSE && has_modrm != PTI_MODRM_UNDEF) {
+		if (max_bytes <= length)
+			return -pte_bad_insn;
 
-	p1 = get_byte(ild, length + 1);
+		ild->modrm_byte = get_byte(ild, length++);
 
-	/* If p1[7:6] is not 11b in non-64-bit mode, this is BOUND, not EVEX. */
-	if (!mode_64b(ild) && !bits_match(p1, 0xc0, 0xc0))
-		return opcode_dec(ild, length);
+		if (has_modrm != PTI_MODRM_IGNORE_MOD) {
+			uint8_t eamode, mod, rm;
 
-	/* We need at least 5 bytes
-	 * - 4 for the EVEX prefix and payload and
-	 * - 1 for the opcode.
-	 */
-	if (max_bytes < (length + 5))
-		return -pte_bad_insn;
+			eamode = eamode_table[ild->u.s.asz][ild->mode];
+			mod = pti_get_modrm_mod(ild);
+			rm = pti_get_modrm_rm(ild);
 
-	p2 = get_byte(ild, length + 2);
+			ild->disp_bytes = has_disp_regular[eamode][mod][rm];
 
-	ild->u.s.vex = 1;
-	if (p1 & 0x80)
-		ild->u.s.rex_r = 1;
-	if (p2 & 0x80)
-		ild->u.s.rex_w = 1;
-
-	map = p1 & 0x03;
-	ild->map = map;
-
-	if (map == PTI_MAP_3)
-		ild->imm1_bytes = 1;
+			/* There is a sib byte in 32-bit and 64-bit effective
+			 * addressing mode for mod != 3 and rm == 4.
+			 */
+			if ((eamode == ptem_32bit || eamode == ptem_64bit) &&
+			    mod != 3 && rm == 4) {
+				uint8_t sib;
 
-	/* Eat the EVEX. */
-	length += 4;
-	return prefix_vex_done(ild, length);
-}
+				if (max_bytes <= length)
+					return -pte_bad_insn;
 
-static void init_prefix_table(void)
-{
-	unsigned int byte;
+				sib = get_byte(ild, length++);
+				if ((sib & 0x07) == 0x05 && mod == 0)
+					ild->disp_bytes = 4;
+			}
+		}
+	}
 
-	for (byte = 0; byte <= 0xff; ++byte)
-		prefix_table[byte] = prefix_done;
+	if (!ild->disp_bytes) {
+		errcode = set_disp_bytes(ild, PTI_PROPS_DISP(props));
+		if (errcode < 0)
+			return errcode;
+	}
 
-	prefix_table[0x66] = prefix_osz;
-	prefix_table[0x67] = prefix_asz;
+	if (ild->disp_bytes) {
+		if (max_bytes < (length + ild->disp_bytes))
+			return -pte_bad_insn;
 
-	/* Segment prefixes. */
-	prefix_table[0x2e] = prefix_ignore;
-	prefix_table[0x3e] = prefix_ignore;
-	prefix_table[0x26] = prefix_ignore;
-	prefix_table[0x36] = prefix_ignore;
-	prefix_table[0x64] = prefix_ignore;
-	prefix_table[0x65] = prefix_ignore;
+		/* Record only position; must be able to re-read itext bytes
+		 * for actual value. (SMC/CMC issue).
+		 */
+		ild->disp_pos = length;
+		length += ild->disp_bytes;
+	}
 
-	prefix_table[0xf0] = prefix_lock;
-	prefix_table[0xf2] = prefix_f2;
-	prefix_table[0xf3] = prefix_f3;
+	if (map == PTI_MAP_AMD3DNOW) {
+		if (max_bytes <= length)
+			return -pte_bad_insn;
 
-	for (byte = 0x40; byte <= 0x4f; ++byte)
-		prefix_table[byte] = prefix_rex;
+		ild->nominal_opcode = get_byte(ild, length);
+		return length + 1;
+	}
 
-	prefix_table[0xc4] = prefix_vex_c4;
-	prefix_table[0xc5] = prefix_vex_c5;
-	prefix_table[0x62] = prefix_evex;
-}
+	errcode = set_imm_bytes(ild, PTI_PROPS_IMM(props));
+	if (errcode < 0)
+		return errcode;
 
-static int decode(struct pt_ild *ild)
-{
-	return prefix_decode(ild, 0, 0);
-}
+	length += ild->imm1_bytes;
+	length += ild->imm2_bytes;
+	if (max_bytes < length)
+		return -pte_bad_insn;
 
-static inline int64_t sign_extend_bq(int8_t x)
-{
-	return x;
+	return length;
 }
 
-static inline int64_t sign_extend_wq(int16_t x)
-{
-	return x;
-}
+/* The opcode properties for maps 2, 3, and others without property tables.
+ *
+ * They always have a modrm byte and use the default displacement.  Their
+ * immediate, if any, has been set when decoding the opcode.
+ */
+static const uint16_t props_map_other =
+	PTI_PROPS(PTI_MODRM_TRUE, PTI_PRESERVE_DEFAULT, PTI_IMM_NONE,
+		  PTI_INST_INVALID);
 
-static inline int64_t sign_extend_dq(int32_t x)
+static int decode(struct pt_ild *ild)
 {
-	return x;
-}
+	uint16_t props;
+	int length;
 
-static int set_branch_target(struct pt_ild *ild)
-{
-	int64_t npc;
-	uint64_t sign_extended_disp = 0;
+	length = prefix_dec(ild);
+	if (length < 0)
+		return length;
 
-	if (!ild)
-		return -pte_internal;
+	switch (ild->map) {
+	case PTI_MAP_0:
+		props = props_map_0x0[ild->nominal_opcode];
+		break;
 
-	if (ild->disp_bytes == 1)
-		sign_extended_disp =
-		    sign_extend_bq(get_byte(ild, ild->disp_pos));
-	else if (ild->disp_bytes == 2) {
-		int16_t *w = (int16_t *) (get_byte_ptr(ild, ild->disp_pos));
+	case PTI_MAP_1:
+		props = props_map_0x0F[ild->nominal_opcode];
+		break;
 
-		sign_extended_disp = sign_extend_wq(*w);
-	} else if (ild->disp_bytes == 4) {
-		int32_t *d = (int32_t *) (get_byte_ptr(ild, ild->disp_pos));
+	default:
+		props = props_map_other;
+		break;
+	}
 
-		sign_extended_disp = sign_extend_dq(*d);
-	} else
-		return -pte_bad_insn;
+	length = operand_dec(ild, (uint8_t) length, props);
+	if (length < 0)
+		return length;
 
-	npc = (int64_t) (ild->runtime_address + ild->length);
-	ild->direct_target = (uint64_t) (npc + sign_extended_disp);
+	ild->length = (uint8_t) length;
 
-	/* We return 1 to indicate an interesting instruction so our caller can
-	 * just forward the return value.
-	 */
-	return 1;
+	return classify(ild, props);
 }
 
 /*  MAIN ENTRY POINTS */
 
 void pt_ild_init(void)
-{	/* initialization */
-	init_has_disp_regular_table();
-	init_has_sib_table();
-	init_eamode_table();
-	init_prefix_table();
+{
+	/* All tables are static.  There is nothing to initialize. */
 }
 
-int pt_instruction_length_decode(struct pt_ild *ild)
+/* Reset the outputs of @ild. */
+static inline void ild_reset(struct pt_ild *ild)
 {
-	if (!ild)
-		return -pte_internal;
-
 	ild->u.i = 0;
+	ild->iclass = PTI_INST_INVALID;
 	ild->imm1_bytes = 0;
 	ild->imm2_bytes = 0;
 	ild->disp_bytes = 0;
 	ild->modrm_byte = 0;
 	ild->map = PTI_MAP_INVALID;
+}
+
+int pt_instruction_length_decode(struct pt_ild *ild)
+{
+	if (!ild)
+		return -pte_internal;
+
+	ild_reset(ild);
 
 	if (!ild->mode)
 		return -pte_bad_insn;
@@ -935,328 +975,74 @@ int pt_instruction_length_decode(struct pt_ild *ild)
 
 int pt_instruction_decode(struct pt_ild *ild)
 {
-	uint8_t opcode, map;
-
 	if (!ild)
 		return -pte_internal;
 
-	ild->iclass = PTI_INST_INVALID;
-
-	opcode = ild->nominal_opcode;
-	map = ild->map;
-
-	if (map > PTI_MAP_1)
-		return 0;	/* uninteresting */
-	if (ild->u.s.vex)
-		return 0;	/* uninteresting */
-
-	/* PTI_INST_JCC,   70...7F, 0F (0x80...0x8F) */
-	if (opcode >= 0x70 && opcode <= 0x7F) {
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_JCC;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
-	}
-	if (opcode >= 0x80 && opcode <= 0x8F) {
-		if (map == PTI_MAP_1) {
-			ild->iclass = PTI_INST_JCC;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
-	}
-
-	switch (ild->nominal_opcode) {
-	case 0x9A:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_CALL_9A;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.call = 1;
-			return 1;
-		}
-		return 0;
-
-	case 0xFF:
-		if (map == PTI_MAP_0) {
-			uint8_t reg = pti_get_modrm_reg(ild);
-
-			if (reg == 2) {
-				ild->iclass = PTI_INST_CALL_FFr2;
-				ild->u.s.branch = 1;
-				ild->u.s.call = 1;
-				return 1;
-			} else if (reg == 3) {
-				ild->iclass = PTI_INST_CALL_FFr3;
-				ild->u.s.branch = 1;
-				ild->u.s.branch_far = 1;
-				ild->u.s.call = 1;
-				return 1;
-			} else if (reg == 4) {
-				ild->iclass = PTI_INST_JMP_FFr4;
-				ild->u.s.branch = 1;
-				return 1;
-			} else if (reg == 5) {
-				ild->iclass = PTI_INST_JMP_FFr5;
-				ild->u.s.branch = 1;
-				ild->u.s.branch_far = 1;
-				return 1;
-			}
-		}
-		return 0;
-
-	case 0xE8:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_CALL_E8;
-			ild->u.s.branch = 1;
-			ild->u.s.call = 1;
-			ild->u.s.branch_direct = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
-
-	case 0xCD:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_INT;
-			return 1;
-		}
-		return 0;
-
-	case 0xCC:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_INT3;
-			return 1;
-		}
-		return 0;
-
-	case 0xCE:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_INTO;
-			return 1;
-		}
-		return 0;
-
-	case 0xF1:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_INT1;
-			return 1;
-		}
-		return 0;
-
-	case 0xCF:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_IRET;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
-
-	case 0xE9:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_JMP_E9;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
-
-	case 0xEA:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_JMP_EA;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			/* FIXME: We do not set the branch target. */
-			return 1;
-		}
-		return 0;
-
-	case 0xEB:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_JMP_EB;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			return set_branch_target(ild);
-	}
-		return 0;
-
-	case 0xE3:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_JrCXZ;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
+	/* The instruction has been classified during length decode. */
+	return ild->iclass != PTI_INST_INVALID;
+}
 
-	case 0xE0:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_LOOPNE;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
+int pt_ild_run(struct pt_ild *ild, struct pt_ild_run *run,
+	       const uint8_t *itext, uint64_t size)
+{
+	struct pt_ild next;
+	uint64_t ninsn, offset;
 
-	case 0xE1:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_LOOPE;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
+	if (!ild || !run || !itext)
+		return -pte_internal;
 
-	case 0xE2:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_LOOP;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_direct = 1;
-			ild->u.s.cond = 1;
-			return set_branch_target(ild);
-		}
-		return 0;
+	run->ninsn = 0ull;
+	run->size = 0ull;
 
-	case 0x22:
-		if (map == PTI_MAP_1)
-			if (pti_get_modrm_reg(ild) == 3)
-				if (!ild->u.s.rex_r) {
-					ild->iclass = PTI_INST_MOV_CR3;
-					return 1;
-				}
-		return 0;
+	if (!ild->mode)
+		return -pte_bad_insn;
 
-	case 0xC3:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_RET_C3;
-			ild->u.s.branch = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
+	next.mode = ild->mode;
+	next.runtime_address = ild->runtime_address;
 
-	case 0xC2:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_RET_C2;
-			ild->u.s.branch = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
+	for (ninsn = 0ull, offset = 0ull; offset < size; ++ninsn) {
+		uint64_t left;
+		int errcode;
 
-	case 0xCB:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_RET_CB;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
+		left = size - offset;
 
-	case 0xCA:
-		if (map == PTI_MAP_0) {
-			ild->iclass = PTI_INST_RET_CA;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
+		next.itext = itext + offset;
+		next.max_bytes = (uint8_t) (left < pt_max_insn_size ?
+					    left : pt_max_insn_size);
 
-	case 0x05:
-		if (map == PTI_MAP_1) {
-			ild->iclass = PTI_INST_SYSCALL;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.call = 1;
-			return 1;
-		}
-		return 0;
+		ild_reset(&next);
 
-	case 0x34:
-		if (map == PTI_MAP_1) {
-			ild->iclass = PTI_INST_SYSENTER;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.call = 1;
-			return 1;
-		}
-		return 0;
+		errcode = decode(&next);
+		if (errcode < 0) {
+			run->ninsn = ninsn;
+			run->size = offset;
 
-	case 0x35:
-		if (map == PTI_MAP_1) {
-			ild->iclass = PTI_INST_SYSEXIT;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.ret = 1;
-			return 1;
-		}
-		return 0;
+			/* We can't tell an invalid instruction from one that
+			 * is cut off by the end of the buffer.  We assume the
+			 * latter if there were not enough bytes left for the
+			 * longest possible instruction.
+			 */
+			if (left < pt_max_insn_size)
+				return 0;
 
-	case 0x07:
-		if (map == PTI_MAP_1) {
-			ild->iclass = PTI_INST_SYSRET;
-			ild->u.s.branch = 1;
-			ild->u.s.branch_far = 1;
-			ild->u.s.ret = 1;
-			return 1;
+			return errcode;
 		}
-		return 0;
 
-	case 0x01:
-		if (map == PTI_MAP_1) {
-			switch (ild->modrm_byte) {
-			case 0xc1:
-				ild->iclass = PTI_INST_VMCALL;
-				ild->u.s.branch = 1;
-				ild->u.s.branch_far = 1;
-				ild->u.s.ret = 1;
-				return 1;
-
-			case 0xc2:
-				ild->iclass = PTI_INST_VMLAUNCH;
-				ild->u.s.branch = 1;
-				ild->u.s.branch_far = 1;
-				ild->u.s.call = 1;
-				return 1;
+		*ild = next;
+		offset += next.length;
 
-			case 0xc3:
-				ild->iclass = PTI_INST_VMRESUME;
-				ild->u.s.branch = 1;
-				ild->u.s.branch_far = 1;
-				ild->u.s.call = 1;
-				return 1;
+		if (next.iclass != PTI_INST_INVALID) {
+			run->ninsn = ninsn + 1;
+			run->size = offset;
 
-			default:
-				return 0;
-			}
-		}
-		return 0;
-
-	case 0xc7:
-		if (map == PTI_MAP_1 &&
-		    pti_get_modrm_mod(ild) != 3 &&
-		    pti_get_modrm_reg(ild) == 6) {
-			ild->iclass = PTI_INST_VMPTRLD;
 			return 1;
 		}
-		return 0;
 
-	default:
-		break;
+		next.runtime_address += next.length;
 	}
 
-	return 0;
+	run->ninsn = ninsn;
+	run->size = offset;
 
+	return 0;
 }
@@ -27,8 +27,10 @@
  */
 
 #include "pt_image.h"
+#include "pt_image_index.h"
 #include "pt_section.h"
 #include "pt_asid.h"
+#include "pt_bcache.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -85,9 +87,157 @@ static void pt_section_list_free(struct pt_section_list *list)
 		pt_section_unmap(list->section.section);
 	pt_section_put(list->section.section);
 	pt_msec_fini(&list->section);
+	pt_bcache_free(list->bcache);
 	free(list);
 }
 
+static void pt_image_space_fini(struct pt_image_space *space)
+{
+	struct pt_section_list *list;
+
+	if (!space)
+		return;
+
+	for (list = space->sections; list; ) {
+		struct pt_section_list *trash;
+
+		trash = list;
+		list = list->next;
+
+		pt_section_list_free(trash);
+	}
+
+	space->sections = NULL;
+}
+
+static uint32_t pt_image_bucket(uint64_t cr3)
+{
+	/* The low twelve bits are typically zero. */
+	return (uint32_t) ((cr3 >> 12) ^ (cr3 >> 24)) & (pt_image_nbuckets - 1);
+}
+
+/* Find the address space for @cr3 in @image.
+ *
+ * Returns a pointer to the address space on success, NULL otherwise.
+ */
+static struct pt_image_space *pt_image_lookup(struct pt_image *image,
+					      uint64_t cr3)
+{
+	struct pt_image_space *space;
+
+	if (cr3 == pt_asid_no_cr3)
+		return &image->shared;
+
+	space = image->space[pt_image_bucket(cr3)];
+	for (; space; space = space->next) {
+		if (space->cr3 == cr3)
+			return space;
+	}
+
+	return NULL;
+}
+
+/* Find or create the address space for @cr3 in @image.
+ *
+ * Returns a pointer to the address space on success, NULL otherwise.
+ */
+static struct pt_image_space *pt_image_get_space(struct pt_image *image,
+						 uint64_t cr3)
+{
+	struct pt_image_space *space;
+	uint32_t bucket;
+
+	space = pt_image_lookup(image, cr3);
+	if (space)
+		return space;
+
+	space = malloc(sizeof(*space));
+	if (!space)
+		return NULL;
+
+	memset(space, 0, sizeof(*space));
+	space->cr3 = cr3;
+
+	bucket = pt_image_bucket(cr3);
+	space->next = image->space[bucket];
+	image->space[bucket] = space;
+
+	if (image->current.cr3 == cr3)
+		image->current.space = space;
+
+	return space;
+}
+
+/* Switch to the address space for @cr3 in @image.
+ *
+ * This is a no-op unless @cr3 changed since the last switch.
+ *
+ * Returns a pointer to the address space on success, NULL if @image does
+ * not contain any sections for @cr3.
+ */
+static struct pt_image_space *pt_image_switch(struct pt_image *image,
+					      uint64_t cr3)
+{
+	if (image->current.cr3 != cr3) {
+		image->current.cr3 = cr3;
+		image->current.space = pt_image_lookup(image, cr3);
+	}
+
+	return image->current.space;
+}
+
+/* Provide the next address space in @image that may contain @asid.
+ *
+ * Start with @space NULL.  If @asid is NULL or if it does not specify a cr3,
+ * all address spaces are provided.
+ *
+ * Returns a pointer to the next address space, NULL if there is none.
+ */
+static struct pt_image_space *pt_image_next(struct pt_image *image,
+					    const struct pt_image_space *space,
+					    const struct pt_asid *asid)
+{
+	uint32_t bucket;
+
+	if (!image)
+		return NULL;
+
+	/* For a known cr3, we only need to search its own address space and
+	 * the shared sections.
+	 */
+	if (asid && asid->cr3 != pt_asid_no_cr3) {
+		struct pt_image_space *current;
+
+		if (space == &image->shared)
+			return NULL;
+
+		current = pt_image_switch(image, asid->cr3);
+		if (!space && current)
+			return current;
+
+		return &image->shared;
+	}
+
+	if (!space)
+		return &image->shared;
+
+	if (space == &image->shared)
+		bucket = 0;
+	else {
+		if (space->next)
+			return space->next;
+
+		bucket = pt_image_bucket(space->cr3) + 1;
+	}
+
+	for (; bucket < pt_image_nbuckets; ++bucket) {
+		if (image->space[bucket])
+			return image->space[bucket];
+	}
+
+	return NULL;
+}
+
 void pt_image_init(struct pt_image *image, const char *name)
 {
 	if (!image)
@@ -96,25 +246,38 @@ void pt_image_init(struct pt_image *image, const char *name)
 	memset(image, 0, sizeof(*image));
 
 	image->name = dupstr(name);
+	image->shared.cr3 = pt_asid_no_cr3;
+	image->current.cr3 = pt_asid_no_cr3;
 	image->cache = 10;
 }
 
 void pt_image_fini(struct pt_image *image)
 {
-	struct pt_section_list *list;
+	uint32_t bucket;
 
 	if (!image)
 		return;
 
-	for (list = image->sections; list; ) {
-		struct pt_section_list *trash;
+	pt_image_space_fini(&image->shared);
 
-		trash = list;
-		list = list->next;
+	for (bucket = 0; bucket < pt_image_nbuckets; ++bucket) {
+		struct pt_image_space *space;
 
-		pt_section_list_free(trash);
+		for (space = image->space[bucket]; space; ) {
+			struct pt_image_space *trash;
+
+			trash = space;
+			space = space->next;
+
+			pt_image_space_fini(trash);
+			free(trash);
+		}
 	}
 
+	if (image->index)
+		(void) pt_image_index_put(image->index);
+
+	free(image->readmem.blocks);
 	free(image->name);
 
 	memset(image, 0, sizeof(*image));
@@ -148,81 +311,72 @@ const char *pt_image_name(const struct pt_image *image)
 int pt_image_add(struct pt_image *image, struct pt_section *section,
 		 const struct pt_asid *asid, uint64_t vaddr)
 {
-	struct pt_section_list **list, *next;
-	uint64_t begin, end;
-	int errcode;
+	if (!image || !section || !asid)
+		return -pte_internal;
+
+	/* The section is added to an address space when it is first used. */
+	return pt_image_index_add(&image->index, section, asid, vaddr);
+}
+
+/* Remove sections that are no longer in @image's index.
+ *
+ * Removes the used sections in all address spaces @asid may refer to that
+ * have been removed from @image's index.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_image_purge(struct pt_image *image, const struct pt_asid *asid)
+{
+	struct pt_image_space *space;
 
-	if (!image || !section)
+	if (!image)
 		return -pte_internal;
 
-	begin = vaddr;
-	end = begin + pt_section_size(section);
+	for (space = pt_image_next(image, NULL, asid); space;
+	     space = pt_image_next(image, space, asid)) {
+		struct pt_section_list **list;
 
-	/* Check for overlaps while we move to the end of the list. */
-	for (list = &(image->sections); *list; list = &((*list)->next)) {
-		const struct pt_mapped_section *msec;
-		uint64_t lbegin, lend;
+		for (list = &space->sections; *list;) {
+			struct pt_section_list *trash;
+			int errcode;
 
-		msec = &(*list)->section;
+			trash = *list;
 
-		errcode = pt_msec_matches_asid(msec, asid);
-		if (errcode < 0)
-			return errcode;
+			errcode = pt_image_index_contains(image->index,
+							  &trash->section);
+			if (errcode < 0)
+				return errcode;
 
-		if (!errcode)
-			continue;
+			if (errcode) {
+				list = &trash->next;
+				continue;
+			}
 
-		lbegin = pt_msec_begin(msec);
-		lend = pt_msec_end(msec);
+			*list = trash->next;
 
-		if (end <= lbegin)
-			continue;
-		if (lend <= begin)
-			continue;
+			if (image->branch == trash)
+				image->branch = NULL;
 
-		return -pte_bad_image;
+			pt_section_list_free(trash);
+		}
 	}
 
-	next = pt_mk_section_list(section, asid, vaddr);
-	if (!next)
-		return -pte_nomap;
-
-	*list = next;
 	return 0;
 }
 
 int pt_image_remove(struct pt_image *image, struct pt_section *section,
 		    const struct pt_asid *asid, uint64_t vaddr)
 {
-	struct pt_section_list **list;
+	int errcode;
 
-	if (!image || !section)
+	if (!image || !section || !asid)
 		return -pte_internal;
 
-	for (list = &image->sections; *list; list = &((*list)->next)) {
-		struct pt_mapped_section *msec;
-		struct pt_section_list *trash;
-		int errcode;
-
-		trash = *list;
-		msec = &trash->section;
-
-		errcode = pt_msec_matches_asid(msec, asid);
-		if (errcode < 0)
-			return errcode;
-
-		if (!errcode)
-			continue;
-
-		if (msec->section == section && msec->vaddr == vaddr) {
-			*list = trash->next;
-			pt_section_list_free(trash);
-
-			return 0;
-		}
-	}
+	errcode = pt_image_index_remove(&image->index, section, asid, vaddr);
+	if (errcode < 0)
+		return errcode;
 
-	return -pte_bad_image;
+	return pt_image_purge(image, asid);
 }
 
 int pt_image_add_file(struct pt_image *image, const char *filename,
@@ -240,9 +394,20 @@ int pt_image_add_file(struct pt_image *image, const char *filename,
 	if (errcode < 0)
 		return errcode;
 
-	section = pt_mk_section(filename, offset, size);
-	if (!section)
-		return -pte_invalid;
+	/* The same file is typically mapped into many address spaces.  We
+	 * share the section so it is checked, mapped, and cached only once.
+	 */
+	section = pt_image_index_find(image->index, filename, offset,
+				      size);
+	if (section) {
+		errcode = pt_section_get(section);
+		if (errcode < 0)
+			return errcode;
+	} else {
+		section = pt_mk_section(filename, offset, size);
+		if (!section)
+			return -pte_invalid;
+	}
 
 	errcode = pt_image_add(image, section, &asid, vaddr);
 	if (errcode < 0) {
@@ -258,21 +423,148 @@ int pt_image_add_file(struct pt_image *image, const char *filename,
 	return 0;
 }
 
+/* Fail segments.
+ *
+ * Sets the status of the @nsegments segments in @segments to @errcode.
+ *
+ * Returns @errcode.
+ */
+static int pt_fail_segments(struct pt_file_segment *segments,
+			    uint32_t nsegments, int errcode)
+{
+	uint32_t idx;
+
+	for (idx = 0; idx < nsegments; ++idx)
+		segments[idx].status = errcode;
+
+	return errcode;
+}
+
+int pt_image_add_file_segments(struct pt_image *image, const char *filename,
+			       struct pt_file_segment *segments,
+			       uint32_t nsegments, const struct pt_asid *uasid)
+{
+	struct pt_file_id id;
+	struct pt_asid asid;
+	uint64_t fsize;
+	uint32_t idx;
+	int errcode, ignored;
+
+	if (nsegments && !segments)
+		return -pte_invalid;
+
+	if (!image || !filename)
+		return pt_fail_segments(segments, nsegments, -pte_invalid);
+
+	errcode = pt_asid_from_user(&asid, uasid);
+	if (errcode < 0)
+		return pt_fail_segments(segments, nsegments, errcode);
+
+	errcode = pt_section_file_id(&id, filename);
+	if (errcode < 0)
+		return pt_fail_segments(segments, nsegments, -pte_invalid);
+
+	fsize = id.size;
+
+	ignored = 0;
+	for (idx = 0; idx < nsegments; ++idx) {
+		struct pt_file_segment *segment;
+		struct pt_section *section;
+		uint64_t size;
+		int status;
+
+		segment = &segments[idx];
+
+		if (fsize <= segment->offset) {
+			segment->status = -pte_invalid;
+			ignored += 1;
+			continue;
+		}
+
+		size = fsize - segment->offset;
+		if (segment->size < size)
+			size = segment->size;
+
+		section = pt_image_index_find(image->index, filename,
+					      segment->offset, size);
+		if (section) {
+			errcode = pt_section_get(section);
+			if (errcode < 0)
+				return pt_fail_segments(segment,
+							nsegments - idx,
+							errcode);
+		} else {
+			section = pt_mk_section_lazy(filename, segment->offset,
+						     size, &id);
+			if (!section)
+				return pt_fail_segments(segment,
+							nsegments - idx,
+							-pte_nomem);
+		}
+
+		status = pt_image_add(image, section, &asid, segment->vaddr);
+		if (status < 0)
+			ignored += 1;
+
+		segment->status = status;
+
+		/* The image list got its own reference; let's drop ours. */
+		errcode = pt_section_put(section);
+		if (errcode < 0)
+			return pt_fail_segments(segment + 1,
+						nsegments - (idx + 1),
+						errcode);
+	}
+
+	return ignored;
+}
+
 int pt_image_copy(struct pt_image *image, const struct pt_image *src)
 {
-	struct pt_section_list *list;
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
 	int ignored;
 
 	if (!image || !src)
 		return -pte_invalid;
 
+	/* An empty image shares @src's index.  Both images put their own
+	 * index on top of it when they are modified.
+	 */
+	pt_image_index_begin(&iter, image->index, NULL);
+	if (!pt_image_index_next(&iter)) {
+		struct pt_image_index *index;
+		int errcode;
+
+		index = src->index;
+		if (index) {
+			errcode = pt_image_index_get(index);
+			if (errcode < 0)
+				return errcode;
+		}
+
+		if (image->index) {
+			errcode = pt_image_index_put(image->index);
+			if (errcode < 0) {
+				if (index)
+					(void) pt_image_index_put(index);
+
+				return errcode;
+			}
+		}
+
+		image->index = index;
+		return 0;
+	}
+
 	ignored = 0;
-	for (list = src->sections; list; list = list->next) {
+	pt_image_index_begin(&iter, src->index, NULL);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
 		int errcode;
 
-		errcode = pt_image_add(image, list->section.section,
-				       &list->section.asid,
-				       list->section.vaddr);
+		errcode = pt_image_add(image, msec->section, &msec->asid,
+				       msec->vaddr);
 		if (errcode < 0)
 			ignored += 1;
 	}
@@ -283,7 +575,6 @@ int pt_image_copy(struct pt_image *image, const struct pt_image *src)
 int pt_image_remove_by_filename(struct pt_image *image, const char *filename,
 				const struct pt_asid *uasid)
 {
-	struct pt_section_list **list;
 	struct pt_asid asid;
 	int errcode, removed;
 
@@ -294,34 +585,14 @@ int pt_image_remove_by_filename(struct pt_image *image, const char *filename,
 	if (errcode < 0)
 		return errcode;
 
-	removed = 0;
-	for (list = &image->sections; *list;) {
-		struct pt_mapped_section *msec;
-		struct pt_section_list *trash;
-		const char *tname;
+	removed = pt_image_index_remove_by_filename(&image->index, filename,
+						    &asid);
+	if (removed <= 0)
+		return removed;
 
-		trash = *list;
-		msec = &trash->section;
-
-		errcode = pt_msec_matches_asid(msec, &asid);
-		if (errcode < 0)
-			return errcode;
-
-		if (!errcode) {
-			list = &trash->next;
-			continue;
-		}
-
-		tname = pt_section_filename(msec->section);
-
-		if (tname && (strcmp(tname, filename) == 0)) {
-			*list = trash->next;
-			pt_section_list_free(trash);
-
-			removed += 1;
-		} else
-			list = &trash->next;
-	}
+	errcode = pt_image_purge(image, &asid);
+	if (errcode < 0)
+		return errcode;
 
 	return removed;
 }
@@ -329,7 +600,6 @@ int pt_image_remove_by_filename(struct pt_image *image, const char *filename,
 int pt_image_remove_by_asid(struct pt_image *image,
 			    const struct pt_asid *uasid)
 {
-	struct pt_section_list **list;
 	struct pt_asid asid;
 	int errcode, removed;
 
@@ -340,28 +610,13 @@ int pt_image_remove_by_asid(struct pt_image *image,
 	if (errcode < 0)
 		return errcode;
 
-	removed = 0;
-	for (list = &image->sections; *list;) {
-		struct pt_mapped_section *msec;
-		struct pt_section_list *trash;
+	removed = pt_image_index_remove_by_asid(&image->index, &asid);
+	if (removed <= 0)
+		return removed;
 
-		trash = *list;
-		msec = &trash->section;
-
-		errcode = pt_msec_matches_asid(msec, &asid);
-		if (errcode < 0)
-			return errcode;
-
-		if (!errcode) {
-			list = &trash->next;
-			continue;
-		}
-
-		*list = trash->next;
-		pt_section_list_free(trash);
-
-		removed += 1;
-	}
+	errcode = pt_image_purge(image, &asid);
+	if (errcode < 0)
+		return errcode;
 
 	return removed;
 }
@@ -374,28 +629,57 @@ int pt_image_set_callback(struct pt_image *image,
 
 	image->readmem.callback = callback;
 	image->readmem.context = context;
+	image->readmem.block = 0;
+
+	free(image->readmem.blocks);
+	image->readmem.blocks = NULL;
 
 	return 0;
 }
 
-static int pt_image_prune_cache(struct pt_image *image)
+int pt_image_set_block_callback(struct pt_image *image,
+				read_memory_callback_t *callback,
+				void *context)
+{
+	int errcode;
+
+	errcode = pt_image_set_callback(image, callback, context);
+	if (errcode < 0)
+		return errcode;
+
+	image->readmem.block = 1;
+
+	return 0;
+}
+
+int pt_image_set_advice(struct pt_image *image, uint32_t advice)
+{
+	if (!image)
+		return -pte_invalid;
+
+	if (advice & ~(uint32_t) (ptma_prefault | ptma_random))
+		return -pte_invalid;
+
+	image->advice = advice;
+
+	return 0;
+}
+
+static int pt_image_prune_space(struct pt_image_space *space, uint16_t cache,
+				uint16_t *pmapped)
 {
 	struct pt_section_list *list;
-	uint16_t cache, mapped;
+	uint16_t mapped;
 	int status;
 
-	if (!image)
+	if (!space || !pmapped)
 		return -pte_internal;
 
-	cache = image->cache;
 	status = 0;
-	mapped = 0;
-	for (list = image->sections; list; list = list->next) {
+	mapped = *pmapped;
+	for (list = space->sections; list; list = list->next) {
 		int errcode;
 
-		/* Let's traverse the entire list.  It isn't very long and
-		 * this allows us to fix up any previous unmap errors.
-		 */
 		if (!list->mapped)
 			continue;
 
@@ -413,15 +697,128 @@ static int pt_image_prune_cache(struct pt_image *image)
 		mapped -= 1;
 	}
 
+	*pmapped = mapped;
+	return status;
+}
+
+static int pt_image_prune_cache(struct pt_image *image)
+{
+	struct pt_image_space *space, *current;
+	uint16_t cache, mapped;
+	int status, errcode;
+
+	if (!image)
+		return -pte_internal;
+
+	cache = image->cache;
+	status = 0;
+	mapped = 0;
+
+	/* Let's traverse all address spaces starting with the current one.
+	 * They aren't very long and this allows us to fix up any previous
+	 * unmap errors.
+	 */
+	current = image->current.space;
+	if (current) {
+		errcode = pt_image_prune_space(current, cache, &mapped);
+		if (errcode < 0)
+			status = errcode;
+	}
+
+	for (space = pt_image_next(image, NULL, NULL); space;
+	     space = pt_image_next(image, space, NULL)) {
+		if (space == current)
+			continue;
+
+		errcode = pt_image_prune_space(space, cache, &mapped);
+		if (errcode < 0)
+			status = errcode;
+	}
+
 	image->mapped = mapped;
 	return status;
 }
 
+static uint32_t pt_image_block_index(const struct pt_asid *asid, uint64_t addr)
+{
+	return (uint32_t) ((addr / pt_image_block_size) ^ (asid->cr3 >> 12)) &
+		(pt_image_nblocks - 1);
+}
+
+/* Read memory from a single block.
+ *
+ * Reads at most @size bytes at @addr in @asid into @buffer from the block
+ * containing @addr.  Reads the block via the read memory callback unless it
+ * is already cached.
+ *
+ * Returns the number of bytes read on success, a negative error code otherwise.
+ * Returns -pte_nomap if the block does not contain @addr.
+ */
+static int pt_image_read_block(struct pt_image *image, uint8_t *buffer,
+			       uint16_t size, const struct pt_asid *asid,
+			       uint64_t addr)
+{
+	struct pt_image_block *blocks, *block;
+	uint64_t base;
+	uint16_t offset, available;
+
+	if (!image || !asid)
+		return -pte_internal;
+
+	blocks = image->readmem.blocks;
+	if (!blocks) {
+		blocks = malloc(pt_image_nblocks * sizeof(*blocks));
+		if (!blocks)
+			return -pte_nomem;
+
+		memset(blocks, 0, pt_image_nblocks * sizeof(*blocks));
+
+		image->readmem.blocks = blocks;
+	}
+
+	base = addr & ~((uint64_t) pt_image_block_size - 1ull);
+	block = &blocks[pt_image_block_index(asid, base)];
+
+	if (!block->size || block->addr != base || block->cr3 != asid->cr3 ||
+	    block->vmcs != asid->vmcs) {
+		int status;
+
+		block->size = 0;
+
+		status = image->readmem.callback(block->data,
+						 sizeof(block->data), asid,
+						 base, image->readmem.context);
+		if (status < 0)
+			return status;
+
+		if (sizeof(block->data) < (size_t) status)
+			return -pte_internal;
+
+		block->cr3 = asid->cr3;
+		block->vmcs = asid->vmcs;
+		block->addr = base;
+		block->size = (uint16_t) status;
+	}
+
+	offset = (uint16_t) (addr - base);
+	if (block->size <= offset)
+		return -pte_nomap;
+
+	available = block->size - offset;
+	if (size < available)
+		available = size;
+
+	memcpy(buffer, &block->data[offset], available);
+
+	return (int) available;
+}
+
 static int pt_image_read_callback(struct pt_image *image, uint8_t *buffer,
 				  uint16_t size, const struct pt_asid *asid,
 				  uint64_t addr)
 {
 	read_memory_callback_t *callback;
+	uint16_t read;
 
 	if (!image)
 		return -pte_internal;
@@ -430,45 +827,52 @@ static int pt_image_read_callback(struct pt_image *image, uint8_t *buffer,
 	if (!callback)
 		return -pte_nomap;
 
-	return callback(buffer, size, asid, addr, image->readmem.context);
+	if (!image->readmem.block)
+		return callback(buffer, size, asid, addr,
+				image->readmem.context);
+
+	/* The memory may continue in the next block. */
+	for (read = 0; read < size;) {
+		int status;
+
+		status = pt_image_read_block(image, buffer + read, size - read,
+					     asid, addr + read);
+		if (status < 0)
+			return read ? (int) read : status;
+
+		read += (uint16_t) status;
+
+		/* The block ended early. */
+		if ((addr + read) & (pt_image_block_size - 1))
+			break;
+	}
+
+	return (int) read;
 }
 
-static int pt_image_read_cold(struct pt_image *image,
-			      struct pt_section_list **list,
-			      uint8_t *buffer, uint16_t size,
-			      const struct pt_asid *asid, uint64_t addr)
+static int pt_image_read_hot(struct pt_image_space *space, uint8_t *buffer,
+			     uint16_t size, const struct pt_asid *asid,
+			     uint64_t addr)
 {
-	struct pt_section_list **start;
+	struct pt_section_list **list, **start;
 
-	if (!image || !list)
+	if (!space)
 		return -pte_internal;
 
-	start = &image->sections;
-	while (*list) {
+	start = &space->sections;
+	for (list = start; *list;) {
 		struct pt_mapped_section *msec;
 		struct pt_section_list *elem;
-		struct pt_section *sec;
-		int mapped, errcode, status;
+		int status;
 
 		elem = *list;
 		msec = &elem->section;
-		sec = msec->section;
 
-		mapped = elem->mapped;
-		if (!mapped) {
-			errcode = pt_section_map(sec);
-			if (errcode < 0)
-				return errcode;
-		}
+		if (!elem->mapped)
+			break;
 
 		status = pt_msec_read_mapped(msec, buffer, size, asid, addr);
 		if (status < 0) {
-			if (!mapped) {
-				errcode = pt_section_unmap(sec);
-				if (errcode < 0)
-					return errcode;
-			}
-
 			list = &elem->next;
 			continue;
 		}
@@ -480,73 +884,397 @@ static int pt_image_read_cold(struct pt_image *image,
 			*start = elem;
 		}
 
-		/* Keep the section mapped if it isn't already - provided we
-		 * do cache recently used sections.
-		 */
+		return status;
+	}
+
+	return -pte_nomap;
+}
+
+/* Read memory from a used section.
+ *
+ * Reads at most @size bytes at @addr in @asid into @buffer from the section
+ * at *@list in @space.  Maps the section unless it is already mapped and
+ * moves it to the front of @space's list.
+ *
+ * Returns the number of bytes read on success, a negative error code otherwise.
+ * Returns -pte_nomap if the section does not contain @addr.
+ */
+static int pt_image_read_section(struct pt_image *image,
+				 struct pt_image_space *space,
+				 struct pt_section_list **list,
+				 uint8_t *buffer, uint16_t size,
+				 const struct pt_asid *asid, uint64_t addr)
+{
+	struct pt_mapped_section *msec;
+	struct pt_section_list *elem, **start;
+	struct pt_section *sec;
+	int mapped, errcode, status;
+
+	if (!image || !space || !list || !*list)
+		return -pte_internal;
+
+	elem = *list;
+	msec = &elem->section;
+	sec = msec->section;
+
+	mapped = elem->mapped;
+	if (!mapped) {
+		if (image->advice) {
+			errcode = pt_section_advise(sec, image->advice);
+			if (errcode < 0)
+				return errcode;
+		}
+
+		errcode = pt_section_map(sec);
+		if (errcode < 0)
+			return errcode;
+	}
+
+	status = pt_msec_read_mapped(msec, buffer, size, asid, addr);
+	if (status < 0) {
 		if (!mapped) {
-			uint16_t cache, already;
-
-			already = image->mapped;
-			cache = image->cache;
-			if (cache) {
-				elem->mapped = 1;
-
-				already += 1;
-				image->mapped = already;
-
-				if (cache < already) {
-					errcode = pt_image_prune_cache(image);
-					if (errcode < 0)
-						return errcode;
-				}
-			} else {
-				errcode = pt_section_unmap(sec);
+			errcode = pt_section_unmap(sec);
+			if (errcode < 0)
+				return errcode;
+		}
+
+		return -pte_nomap;
+	}
+
+	/* Move the section to the front if it isn't already. */
+	start = &space->sections;
+	if (list != start) {
+		*list = elem->next;
+		elem->next = *start;
+		*start = elem;
+	}
+
+	/* Keep the section mapped if it isn't already - provided we do cache
+	 * recently used sections.
+	 */
+	if (!mapped) {
+		uint16_t cache, already;
+
+		already = image->mapped;
+		cache = image->cache;
+		if (cache) {
+			elem->mapped = 1;
+
+			already += 1;
+			image->mapped = already;
+
+			if (cache < already) {
+				errcode = pt_image_prune_cache(image);
 				if (errcode < 0)
 					return errcode;
 			}
+		} else {
+			errcode = pt_section_unmap(sec);
+			if (errcode < 0)
+				return errcode;
 		}
-
-		return status;
 	}
 
-	return pt_image_read_callback(image, buffer, size, asid, addr);
+	return status;
 }
 
-int pt_image_read(struct pt_image *image, uint8_t *buffer, uint16_t size,
-		  const struct pt_asid *asid, uint64_t addr)
+static int pt_image_read_cold(struct pt_image *image,
+			      struct pt_image_space *space,
+			      uint8_t *buffer, uint16_t size,
+			      const struct pt_asid *asid, uint64_t addr)
 {
-	struct pt_section_list **list, **start;
+	struct pt_section_list **list;
 
-	if (!image || !asid)
+	if (!image || !space)
 		return -pte_internal;
 
-	start = &image->sections;
-	for (list = start; *list;) {
+	/* Skip the mapped sections at the front.  They have already been
+	 * searched by pt_image_read_hot().
+	 */
+	list = &space->sections;
+	while (*list && (*list)->mapped)
+		list = &((*list)->next);
+
+	while (*list) {
 		struct pt_mapped_section *msec;
 		struct pt_section_list *elem;
-		int status;
+		int errcode, status;
 
 		elem = *list;
 		msec = &elem->section;
 
-		if (!elem->mapped)
-			break;
+		/* Don't map sections that can't contain @addr. */
+		errcode = pt_msec_matches_asid(msec, asid);
+		if (errcode < 0)
+			return errcode;
 
-		status = pt_msec_read_mapped(msec, buffer, size, asid, addr);
-		if (status < 0) {
+		if (!errcode || addr < pt_msec_begin(msec) ||
+		    pt_msec_end(msec) <= addr) {
 			list = &elem->next;
 			continue;
 		}
 
-		/* Move the section to the front if it isn't already. */
-		if (list != start) {
-			*list = elem->next;
-			elem->next = *start;
-			*start = elem;
-		}
+		status = pt_image_read_section(image, space, list, buffer,
+					       size, asid, addr);
+		if (status != -pte_nomap)
+			return status;
+
+		list = &elem->next;
+	}
+
+	return -pte_nomap;
+}
+
+/* Find @msec in the used sections of @space.
+ *
+ * Returns a pointer to the link to @msec's list element or to the link at
+ * the end of @space's list if @space does not contain @msec.
+ */
+static struct pt_section_list **
+pt_image_space_find(struct pt_image_space *space,
+		    const struct pt_mapped_section *msec)
+{
+	struct pt_section_list **list;
+
+	for (list = &space->sections; *list; list = &((*list)->next)) {
+		if (pt_msec_is_same(&(*list)->section, msec) > 0)
+			break;
+	}
+
+	return list;
+}
+
+/* Read memory from a section in @image's index that has not been used.
+ *
+ * Adds the section to the list of used sections in its address space.
+ *
+ * Returns the number of bytes read on success, a negative error code otherwise.
+ * Returns -pte_nomap if no unused section contains @addr.
+ */
+static int pt_image_read_index(struct pt_image *image, uint8_t *buffer,
+			       uint16_t size, const struct pt_asid *asid,
+			       uint64_t addr)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+
+	if (!image)
+		return -pte_internal;
 
+	pt_image_index_begin(&iter, image->index, asid);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		struct pt_section_list **list;
+		struct pt_image_space *space;
+		int status;
+
+		if (addr < pt_msec_begin(msec) || pt_msec_end(msec) <= addr)
+			continue;
+
+		space = pt_image_get_space(image, msec->asid.cr3);
+		if (!space)
+			return -pte_nomem;
+
+		/* Used sections have already been searched by
+		 * pt_image_read_cold().
+		 */
+		list = pt_image_space_find(space, msec);
+		if (*list)
+			continue;
+
+		*list = pt_mk_section_list(msec->section, &msec->asid,
+					   msec->vaddr);
+		if (!*list)
+			return -pte_nomem;
+
+		status = pt_image_read_section(image, space, list, buffer,
+					       size, asid, addr);
+		if (status != -pte_nomap)
+			return status;
+	}
+
+	return -pte_nomap;
+}
+
+int pt_image_read(struct pt_image *image, uint8_t *buffer, uint16_t size,
+		  const struct pt_asid *asid, uint64_t addr)
+{
+	struct pt_image_space *space;
+	int status;
+
+	if (!image || !asid)
+		return -pte_internal;
+
+	/* Try the already mapped sections first. */
+	for (space = pt_image_next(image, NULL, asid); space;
+	     space = pt_image_next(image, space, asid)) {
+		status = pt_image_read_hot(space, buffer, size, asid, addr);
+		if (status != -pte_nomap)
+			return status;
+	}
+
+	for (space = pt_image_next(image, NULL, asid); space;
+	     space = pt_image_next(image, space, asid)) {
+		status = pt_image_read_cold(image, space, buffer, size, asid,
+					    addr);
+		if (status != -pte_nomap)
+			return status;
+	}
+
+	status = pt_image_read_index(image, buffer, size, asid, addr);
+	if (status != -pte_nomap)
 		return status;
+
+	return pt_image_read_callback(image, buffer, size, asid, addr);
+}
+
+/* Check whether the used section @list contains @addr in @asid.
+ *
+ * Returns a positive integer if it does, zero if it does not.
+ */
+static int pt_section_list_contains(const struct pt_section_list *list,
+				    const struct pt_asid *asid, uint64_t addr)
+{
+	const struct pt_mapped_section *msec;
+	int errcode;
+
+	msec = &list->section;
+
+	errcode = pt_msec_matches_asid(msec, asid);
+	if (errcode <= 0)
+		return 0;
+
+	if (addr < pt_msec_begin(msec) || pt_msec_end(msec) <= addr)
+		return 0;
+
+	return 1;
+}
+
+/* Find the section list element containing @addr in @asid.
+ *
+ * Tries the section of the most recent block cache access first and
+ * remembers the found section for the next access.
+ *
+ * Returns a pointer to the list element on success, NULL otherwise.
+ */
+static struct pt_section_list *pt_image_find(struct pt_image *image,
+					     const struct pt_asid *asid,
+					     uint64_t addr)
+{
+	struct pt_image_space *space;
+	struct pt_section_list *list;
+
+	if (!image || !asid)
+		return NULL;
+
+	list = image->branch;
+	if (list && pt_section_list_contains(list, asid, addr))
+		return list;
+
+	for (space = pt_image_next(image, NULL, asid); space;
+	     space = pt_image_next(image, space, asid)) {
+		for (list = space->sections; list; list = list->next) {
+			if (!pt_section_list_contains(list, asid, addr))
+				continue;
+
+			image->branch = list;
+			return list;
+		}
+	}
+
+	return NULL;
+}
+
+/* Find or add the used section containing @addr in @asid.
+ *
+ * Adds the section from @image's index to the list of used sections in its
+ * address space unless it already is.
+ *
+ * Returns a pointer to the list element on success, NULL otherwise.
+ */
+static struct pt_section_list *pt_image_use(struct pt_image *image,
+					    const struct pt_asid *asid,
+					    uint64_t addr)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+
+	if (!image || !asid)
+		return NULL;
+
+	pt_image_index_begin(&iter, image->index, asid);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		struct pt_section_list **list;
+		struct pt_image_space *space;
+
+		if (addr < pt_msec_begin(msec) || pt_msec_end(msec) <= addr)
+			continue;
+
+		space = pt_image_get_space(image, msec->asid.cr3);
+		if (!space)
+			return NULL;
+
+		list = pt_image_space_find(space, msec);
+		if (!*list)
+			*list = pt_mk_section_list(msec->section, &msec->asid,
+						   msec->vaddr);
+
+		return *list;
+	}
+
+	return NULL;
+}
+
+int pt_image_bcache_lookup(struct pt_image *image,
+			   const struct pt_bcache_entry **entry,
+			   const struct pt_asid *asid, uint64_t ip)
+{
+	struct pt_section_list *list;
+
+	if (!image || !entry || !asid)
+		return -pte_internal;
+
+	list = pt_image_find(image, asid, ip);
+	if (!list || !list->bcache)
+		return -pte_nomap;
+
+	return pt_bcache_lookup(list->bcache, entry, ip);
+}
+
+int pt_image_bcache_add(struct pt_image *image,
+			const struct pt_bcache_entry *entry,
+			const struct pt_asid *asid)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_section_list *list;
+	uint64_t target;
+
+	if (!image || !entry || !asid)
+		return -pte_internal;
+
+	list = pt_image_find(image, asid, entry->ip);
+	if (!list) {
+		list = pt_image_use(image, asid, entry->ip);
+		if (!list)
+			return -pte_nomap;
+
+		image->branch = list;
+	}
+
+	/* We only cache branches within a section.  This way, cache entries
+	 * are invalidated together with their section.
+	 */
+	msec = &list->section;
+	target = entry->ild.runtime_address;
+	if (target < pt_msec_begin(msec) || pt_msec_end(msec) <= target)
+		return -pte_nomap;
+
+	if (!list->bcache) {
+		list->bcache = pt_bcache_alloc();
+		if (!list->bcache)
+			return -pte_nomem;
 	}
 
-	return pt_image_read_cold(image, list, buffer, size, asid, addr);
+	return pt_bcache_add(list->bcache, entry);
 }
@@ -0,0 +1,973 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pt_image_index.h"
+#include "pt_section.h"
+#include "pt_asid.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* A filter for removing sections. */
+struct pt_image_index_filter {
+	/* The address space the sections must match. */
+	const struct pt_asid *asid;
+
+	/* The section and the virtual address at which it is mapped - NULL
+	 * for any section.
+	 */
+	const struct pt_section *section;
+	uint64_t vaddr;
+
+	/* The name of the file the sections are loaded from - NULL for any
+	 * file.
+	 */
+	const char *filename;
+};
+
+static uint32_t pt_image_index_bucket(uint64_t cr3)
+{
+	/* The low twelve bits are typically zero. */
+	return (uint32_t) ((cr3 >> 12) ^ (cr3 >> 24)) &
+		(pt_image_index_nbuckets - 1);
+}
+
+/* Hash a file name, offset, and size.
+ *
+ * This is the FNV-1a hash over the file name, folded with offset and size.
+ */
+static uint32_t pt_image_index_file(const char *filename, uint64_t offset,
+				    uint64_t size)
+{
+	uint32_t hash;
+
+	hash = 2166136261u;
+	if (filename) {
+		for (; *filename; ++filename) {
+			hash ^= (uint8_t) *filename;
+			hash *= 16777619u;
+		}
+	}
+
+	hash ^= (uint32_t) (offset >> 12);
+	hash *= 16777619u;
+
+	hash ^= (uint32_t) (size >> 12);
+	hash *= 16777619u;
+
+	return (hash ^ (hash >> 16)) & (pt_image_index_nfiles - 1);
+}
+
+static struct pt_image_entry *pt_image_entry_alloc(struct pt_section *section,
+						   const struct pt_asid *asid,
+						   uint64_t vaddr)
+{
+	struct pt_image_entry *entry;
+
+	entry = malloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+
+	memset(entry, 0, sizeof(*entry));
+	pt_msec_init(&entry->msec, section, asid, vaddr);
+
+	return entry;
+}
+
+/* Free a list of entries.
+ *
+ * If @added is non-zero, the entries hold a reference to their section.
+ */
+static void pt_image_entry_free(struct pt_image_entry *entry, int added)
+{
+	while (entry) {
+		struct pt_image_entry *trash;
+
+		trash = entry;
+		entry = entry->next;
+
+		if (added)
+			(void) pt_section_put(trash->msec.section);
+
+		pt_msec_fini(&trash->msec);
+		free(trash);
+	}
+}
+
+static int pt_image_index_lock(struct pt_image_index *index)
+{
+	if (!index)
+		return -pte_internal;
+
+#if defined(FEATURE_THREADS)
+	{
+		int errcode;
+
+		errcode = mtx_lock(&index->lock);
+		if (errcode != thrd_success)
+			return -pte_bad_lock;
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	return 0;
+}
+
+static int pt_image_index_unlock(struct pt_image_index *index)
+{
+	if (!index)
+		return -pte_internal;
+
+#if defined(FEATURE_THREADS)
+	{
+		int errcode;
+
+		errcode = mtx_unlock(&index->lock);
+		if (errcode != thrd_success)
+			return -pte_bad_lock;
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	return 0;
+}
+
+struct pt_image_index *pt_image_index_alloc(struct pt_image_index *parent)
+{
+	struct pt_image_index *index;
+
+	index = malloc(sizeof(*index));
+	if (!index)
+		return NULL;
+
+	memset(index, 0, sizeof(*index));
+
+	index->ucount = 1;
+
+#if defined(FEATURE_THREADS)
+	{
+		int errcode;
+
+		errcode = mtx_init(&index->lock, mtx_plain);
+		if (errcode != thrd_success) {
+			free(index);
+			return NULL;
+		}
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	if (parent) {
+		int errcode;
+
+		errcode = pt_image_index_get(parent);
+		if (errcode < 0) {
+			(void) pt_image_index_put(index);
+			return NULL;
+		}
+
+		index->parent = parent;
+		index->depth = parent->depth + 1;
+	}
+
+	return index;
+}
+
+static void pt_image_index_free(struct pt_image_index *index)
+{
+	uint32_t bucket;
+
+	if (!index)
+		return;
+
+	for (bucket = 0; bucket < pt_image_index_nbuckets; ++bucket) {
+		pt_image_entry_free(index->added[bucket], 1);
+		pt_image_entry_free(index->removed[bucket], 0);
+	}
+
+#if defined(FEATURE_THREADS)
+
+	mtx_destroy(&index->lock);
+
+#endif /* defined(FEATURE_THREADS) */
+
+	free(index);
+}
+
+int pt_image_index_get(struct pt_image_index *index)
+{
+	uint32_t ucount;
+	int errcode;
+
+	if (!index)
+		return -pte_internal;
+
+	errcode = pt_image_index_lock(index);
+	if (errcode < 0)
+		return errcode;
+
+	ucount = index->ucount + 1;
+	if (!ucount) {
+		(void) pt_image_index_unlock(index);
+		return -pte_internal;
+	}
+
+	index->ucount = ucount;
+
+	return pt_image_index_unlock(index);
+}
+
+int pt_image_index_put(struct pt_image_index *index)
+{
+	if (!index)
+		return -pte_internal;
+
+	/* Freeing an index removes a user from its parent.  We do this in a
+	 * loop to avoid recursion.
+	 */
+	do {
+		struct pt_image_index *parent;
+		uint32_t ucount;
+		int errcode;
+
+		errcode = pt_image_index_lock(index);
+		if (errcode < 0)
+			return errcode;
+
+		ucount = index->ucount;
+		if (ucount > 1) {
+			index->ucount = ucount - 1;
+			return pt_image_index_unlock(index);
+		}
+
+		errcode = pt_image_index_unlock(index);
+		if (errcode < 0)
+			return errcode;
+
+		if (!ucount)
+			return -pte_internal;
+
+		parent = index->parent;
+		pt_image_index_free(index);
+
+		index = parent;
+	} while (index);
+
+	return 0;
+}
+
+/* Check whether an index has more than one user.
+ *
+ * Returns a positive number if @index is shared, zero if it is not, a
+ * negative error code otherwise.
+ */
+static int pt_image_index_is_shared(struct pt_image_index *index)
+{
+	uint32_t ucount;
+	int errcode;
+
+	errcode = pt_image_index_lock(index);
+	if (errcode < 0)
+		return errcode;
+
+	ucount = index->ucount;
+
+	errcode = pt_image_index_unlock(index);
+	if (errcode < 0)
+		return errcode;
+
+	return ucount > 1;
+}
+
+/* Return the address bucket list an added entry for @msec belongs to. */
+static struct pt_image_entry **
+pt_image_index_addr_list(struct pt_image_index *index,
+			 const struct pt_mapped_section *msec)
+{
+	uint64_t begin, end;
+
+	begin = pt_msec_begin(msec);
+	end = pt_msec_end(msec);
+
+	if (end < begin || pt_image_index_slot_size < end - begin)
+		return &index->large;
+
+	begin >>= pt_image_index_slot_shift;
+
+	return &index->small[begin & (pt_image_index_nslots - 1)];
+}
+
+/* Return the file bucket list an added entry for @section belongs to. */
+static struct pt_image_entry **
+pt_image_index_file_list(struct pt_image_index *index,
+			 const struct pt_section *section)
+{
+	uint32_t bucket;
+
+	bucket = pt_image_index_file(pt_section_filename(section),
+				     pt_section_offset(section),
+				     pt_section_size(section));
+
+	return &index->files[bucket];
+}
+
+/* Remove an added entry from its address and file buckets. */
+static void pt_image_index_unlink(struct pt_image_index *index,
+				  const struct pt_image_entry *entry)
+{
+	struct pt_image_entry **list;
+
+	for (list = pt_image_index_addr_list(index, &entry->msec); *list;
+	     list = &(*list)->next_addr) {
+		if (*list == entry) {
+			*list = entry->next_addr;
+			break;
+		}
+	}
+
+	for (list = pt_image_index_file_list(index, entry->msec.section);
+	     *list; list = &(*list)->next_file) {
+		if (*list == entry) {
+			*list = entry->next_file;
+			break;
+		}
+	}
+}
+
+/* Add @section at @vaddr in @asid to @index.
+ *
+ * This does not check for overlaps.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_image_index_insert(struct pt_image_index *index,
+				 struct pt_section *section,
+				 const struct pt_asid *asid, uint64_t vaddr)
+{
+	struct pt_image_entry *entry, **list;
+	uint32_t bucket;
+	int errcode;
+
+	if (!index || !asid)
+		return -pte_internal;
+
+	entry = pt_image_entry_alloc(section, asid, vaddr);
+	if (!entry)
+		return -pte_nomem;
+
+	errcode = pt_section_get(section);
+	if (errcode < 0) {
+		pt_image_entry_free(entry, 0);
+		return errcode;
+	}
+
+	bucket = pt_image_index_bucket(asid->cr3);
+	entry->next = index->added[bucket];
+	index->added[bucket] = entry;
+
+	list = pt_image_index_addr_list(index, &entry->msec);
+	entry->next_addr = *list;
+	*list = entry;
+
+	list = pt_image_index_file_list(index, section);
+	entry->next_file = *list;
+	*list = entry;
+
+	return 0;
+}
+
+/* Copy the sections of @index into a new index without a parent.
+ *
+ * Returns the new index on success, NULL otherwise.
+ */
+static struct pt_image_index *
+pt_image_index_flatten(const struct pt_image_index *index)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+	struct pt_image_index *flat;
+
+	flat = pt_image_index_alloc(NULL);
+	if (!flat)
+		return NULL;
+
+	pt_image_index_begin(&iter, index, NULL);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		int errcode;
+
+		errcode = pt_image_index_insert(flat, msec->section,
+						&msec->asid, msec->vaddr);
+		if (errcode < 0) {
+			(void) pt_image_index_put(flat);
+			return NULL;
+		}
+	}
+
+	return flat;
+}
+
+/* Make the index pointed to by @pindex private so it can be modified.
+ *
+ * Allocates a new index if *@pindex is NULL.  If *@pindex is shared, puts
+ * a new index on top of it.  If that index would be too deep, copies the
+ * sections into a new index, instead.  Either way, the new index replaces
+ * *@pindex.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_image_index_unshare(struct pt_image_index **pindex)
+{
+	struct pt_image_index *index, *top;
+	int errcode;
+
+	if (!pindex)
+		return -pte_internal;
+
+	index = *pindex;
+	if (!index) {
+		top = pt_image_index_alloc(NULL);
+		if (!top)
+			return -pte_nomem;
+
+		*pindex = top;
+		return 0;
+	}
+
+	errcode = pt_image_index_is_shared(index);
+	if (errcode <= 0)
+		return errcode;
+
+	if (index->depth < pt_image_index_max_depth)
+		top = pt_image_index_alloc(index);
+	else
+		top = pt_image_index_flatten(index);
+
+	if (!top)
+		return -pte_nomem;
+
+	*pindex = top;
+
+	return pt_image_index_put(index);
+}
+
+/* Check whether @msec in @layer is removed in an index above @layer.
+ *
+ * Returns a positive number if it is removed, zero if it is not, a negative
+ * error code otherwise.
+ */
+static int pt_image_index_is_removed(const struct pt_image_index *index,
+				     const struct pt_image_index *layer,
+				     const struct pt_mapped_section *msec)
+{
+	uint32_t bucket;
+
+	bucket = pt_image_index_bucket(msec->asid.cr3);
+	for (; index && index != layer; index = index->parent) {
+		const struct pt_image_entry *entry;
+
+		for (entry = index->removed[bucket]; entry;
+		     entry = entry->next) {
+			int status;
+
+			status = pt_msec_is_same(&entry->msec, msec);
+			if (status != 0)
+				return status;
+		}
+	}
+
+	return 0;
+}
+
+/* Check whether an entry in the address bucket list @entry in @layer
+ * overlaps with [@begin; @end) in @asid.
+ *
+ * Returns a positive number if it does, zero if it does not, a negative error
+ * code otherwise.
+ */
+static int pt_image_index_overlaps_list(const struct pt_image_index *index,
+					const struct pt_image_index *layer,
+					const struct pt_image_entry *entry,
+					const struct pt_asid *asid,
+					uint64_t begin, uint64_t end)
+{
+	for (; entry; entry = entry->next_addr) {
+		const struct pt_mapped_section *msec;
+		int status;
+
+		msec = &entry->msec;
+
+		if (end <= pt_msec_begin(msec))
+			continue;
+
+		if (pt_msec_end(msec) <= begin)
+			continue;
+
+		status = pt_msec_matches_asid(msec, asid);
+		if (status <= 0) {
+			if (status < 0)
+				return status;
+
+			continue;
+		}
+
+		status = pt_image_index_is_removed(index, layer, msec);
+		if (status != 0) {
+			if (status < 0)
+				return status;
+
+			continue;
+		}
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Check whether a section in @index overlaps with [@begin; @end) in @asid.
+ *
+ * Returns a positive number if it does, zero if it does not, a negative error
+ * code otherwise.
+ */
+static int pt_image_index_overlaps(const struct pt_image_index *index,
+				   const struct pt_asid *asid, uint64_t begin,
+				   uint64_t end)
+{
+	const struct pt_image_index *layer;
+	uint64_t first, last;
+
+	/* A section that is not bigger than a slot begins at most one slot
+	 * before the first slot it overlaps with.
+	 */
+	first = begin >> pt_image_index_slot_shift;
+	if (first)
+		first -= 1;
+
+	last = (end - 1) >> pt_image_index_slot_shift;
+
+	/* Search all slots if the range is too big. */
+	if (last < first || pt_image_index_nslots <= last - first) {
+		first = 0;
+		last = pt_image_index_nslots - 1;
+	}
+
+	for (layer = index; layer; layer = layer->parent) {
+		uint64_t slot;
+		int status;
+
+		status = pt_image_index_overlaps_list(index, layer,
+						      layer->large, asid,
+						      begin, end);
+		if (status != 0)
+			return status;
+
+		for (slot = first; slot <= last; ++slot) {
+			const struct pt_image_entry *entry;
+
+			entry = layer->small[slot & (pt_image_index_nslots - 1)];
+
+			status = pt_image_index_overlaps_list(index, layer,
+							      entry, asid,
+							      begin, end);
+			if (status != 0)
+				return status;
+		}
+	}
+
+	return 0;
+}
+
+int pt_image_index_add(struct pt_image_index **pindex,
+		       struct pt_section *section, const struct pt_asid *asid,
+		       uint64_t vaddr)
+{
+	uint64_t begin, end;
+	int errcode;
+
+	if (!pindex || !section || !asid)
+		return -pte_internal;
+
+	begin = vaddr;
+	end = begin + pt_section_size(section);
+
+	errcode = pt_image_index_overlaps(*pindex, asid, begin, end);
+	if (errcode != 0)
+		return errcode < 0 ? errcode : -pte_bad_image;
+
+	errcode = pt_image_index_unshare(pindex);
+	if (errcode < 0)
+		return errcode;
+
+	return pt_image_index_insert(*pindex, section, asid, vaddr);
+}
+
+static int pt_image_index_matches(const struct pt_image_index_filter *filter,
+				  const struct pt_mapped_section *msec)
+{
+	int errcode;
+
+	if (!filter || !msec)
+		return -pte_internal;
+
+	errcode = pt_msec_matches_asid(msec, filter->asid);
+	if (errcode <= 0)
+		return errcode;
+
+	if (filter->section) {
+		if (msec->section != filter->section)
+			return 0;
+
+		if (msec->vaddr != filter->vaddr)
+			return 0;
+	}
+
+	if (filter->filename) {
+		const char *filename;
+
+		filename = pt_section_filename(msec->section);
+		if (!filename || strcmp(filename, filter->filename) != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Remove the sections matching @filter.
+ *
+ * Removes at most @max sections - all sections if @max is zero.
+ *
+ * Returns the number of removed sections on success, a negative error code
+ * otherwise.
+ */
+static int pt_image_index_remove_matching(struct pt_image_index **pindex,
+				const struct pt_image_index_filter *filter,
+				int max)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+	struct pt_image_index *index;
+	uint32_t bucket;
+	int errcode, removed;
+
+	if (!pindex)
+		return -pte_internal;
+
+	/* Let's not modify the index if there is nothing to remove. */
+	pt_image_index_begin(&iter, *pindex, filter->asid);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		errcode = pt_image_index_matches(filter, msec);
+		if (errcode < 0)
+			return errcode;
+
+		if (errcode)
+			break;
+	}
+
+	if (!msec)
+		return 0;
+
+	errcode = pt_image_index_unshare(pindex);
+	if (errcode < 0)
+		return errcode;
+
+	index = *pindex;
+	removed = 0;
+
+	/* Sections added in this index can be removed right away. */
+	for (bucket = 0; bucket < pt_image_index_nbuckets; ++bucket) {
+		struct pt_image_entry **list;
+
+		for (list = &index->added[bucket]; *list;) {
+			struct pt_image_entry *trash;
+
+			trash = *list;
+
+			errcode = pt_image_index_matches(filter, &trash->msec);
+			if (errcode < 0)
+				return errcode;
+
+			if (!errcode) {
+				list = &trash->next;
+				continue;
+			}
+
+			*list = trash->next;
+			trash->next = NULL;
+
+			pt_image_index_unlink(index, trash);
+			pt_image_entry_free(trash, 1);
+
+			removed += 1;
+			if (removed == max)
+				return removed;
+		}
+	}
+
+	/* Sections of the parent index are hidden by a removed entry in this
+	 * index.  Adding removed entries does not disturb the iteration over
+	 * the parent index.
+	 */
+	pt_image_index_begin(&iter, index, filter->asid);
+	iter.layer = index->parent;
+
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		struct pt_image_entry *entry;
+
+		errcode = pt_image_index_matches(filter, msec);
+		if (errcode < 0)
+			return errcode;
+
+		if (!errcode)
+			continue;
+
+		entry = pt_image_entry_alloc(msec->section, &msec->asid,
+					     msec->vaddr);
+		if (!entry)
+			return -pte_nomem;
+
+		bucket = pt_image_index_bucket(msec->asid.cr3);
+		entry->next = index->removed[bucket];
+		index->removed[bucket] = entry;
+
+		removed += 1;
+		if (removed == max)
+			break;
+	}
+
+	return removed;
+}
+
+int pt_image_index_remove(struct pt_image_index **pindex,
+			  struct pt_section *section,
+			  const struct pt_asid *asid, uint64_t vaddr)
+{
+	struct pt_image_index_filter filter;
+	int removed;
+
+	if (!pindex || !section || !asid)
+		return -pte_internal;
+
+	memset(&filter, 0, sizeof(filter));
+	filter.asid = asid;
+	filter.section = section;
+	filter.vaddr = vaddr;
+
+	removed = pt_image_index_remove_matching(pindex, &filter, 1);
+	if (removed < 0)
+		return removed;
+
+	if (!removed)
+		return -pte_bad_image;
+
+	return 0;
+}
+
+int pt_image_index_remove_by_filename(struct pt_image_index **pindex,
+				      const char *filename,
+				      const struct pt_asid *asid)
+{
+	struct pt_image_index_filter filter;
+
+	if (!pindex || !filename || !asid)
+		return -pte_internal;
+
+	memset(&filter, 0, sizeof(filter));
+	filter.asid = asid;
+	filter.filename = filename;
+
+	return pt_image_index_remove_matching(pindex, &filter, 0);
+}
+
+int pt_image_index_remove_by_asid(struct pt_image_index **pindex,
+				  const struct pt_asid *asid)
+{
+	struct pt_image_index_filter filter;
+
+	if (!pindex || !asid)
+		return -pte_internal;
+
+	memset(&filter, 0, sizeof(filter));
+	filter.asid = asid;
+
+	return pt_image_index_remove_matching(pindex, &filter, 0);
+}
+
+int pt_image_index_contains(const struct pt_image_index *index,
+			    const struct pt_mapped_section *msec)
+{
+	uint32_t bucket;
+
+	if (!msec)
+		return -pte_internal;
+
+	/* A section may be removed and added again in the same index. */
+	bucket = pt_image_index_bucket(msec->asid.cr3);
+	for (; index; index = index->parent) {
+		const struct pt_image_entry *entry;
+		int status;
+
+		for (entry = index->added[bucket]; entry; entry = entry->next) {
+			status = pt_msec_is_same(&entry->msec, msec);
+			if (status != 0)
+				return status;
+		}
+
+		for (entry = index->removed[bucket]; entry;
+		     entry = entry->next) {
+			status = pt_msec_is_same(&entry->msec, msec);
+			if (status != 0)
+				return status < 0 ? status : 0;
+		}
+	}
+
+	return 0;
+}
+
+struct pt_section *pt_image_index_find(const struct pt_image_index *index,
+				       const char *filename, uint64_t offset,
+				       uint64_t size)
+{
+	uint32_t bucket;
+
+	if (!filename)
+		return NULL;
+
+	bucket = pt_image_index_file(filename, offset, size);
+	for (; index; index = index->parent) {
+		const struct pt_image_entry *entry;
+
+		for (entry = index->files[bucket]; entry;
+		     entry = entry->next_file) {
+			struct pt_section *section;
+			const char *sfilename;
+
+			section = entry->msec.section;
+
+			if (pt_section_offset(section) != offset)
+				continue;
+
+			if (pt_section_size(section) != size)
+				continue;
+
+			sfilename = pt_section_filename(section);
+			if (!sfilename || strcmp(sfilename, filename) != 0)
+				continue;
+
+			return section;
+		}
+	}
+
+	return NULL;
+}
+
+void pt_image_index_begin(struct pt_image_index_iter *iter,
+			  const struct pt_image_index *index,
+			  const struct pt_asid *asid)
+{
+	if (!iter)
+		return;
+
+	memset(iter, 0, sizeof(*iter));
+
+	iter->index = index;
+	iter->asid = asid;
+	iter->layer = index;
+}
+
+/* Check whether @bucket may hold sections that match @asid. */
+static int pt_image_index_searches(const struct pt_asid *asid,
+				   uint32_t bucket)
+{
+	if (!asid || asid->cr3 == pt_asid_no_cr3)
+		return 1;
+
+	if (bucket == pt_image_index_bucket(asid->cr3))
+		return 1;
+
+	return bucket == pt_image_index_bucket(pt_asid_no_cr3);
+}
+
+const struct pt_mapped_section *
+pt_image_index_next(struct pt_image_index_iter *iter)
+{
+	const struct pt_image_index *layer;
+	const struct pt_image_entry *entry;
+	uint32_t bucket;
+
+	if (!iter)
+		return NULL;
+
+	layer = iter->layer;
+	entry = iter->entry;
+	bucket = iter->bucket;
+
+	while (layer) {
+		int status;
+
+		if (entry)
+			entry = entry->next;
+		else if (pt_image_index_searches(iter->asid, bucket))
+			entry = layer->added[bucket];
+
+		if (!entry) {
+			bucket += 1;
+			if (pt_image_index_nbuckets <= bucket) {
+				bucket = 0;
+				layer = layer->parent;
+			}
+
+			continue;
+		}
+
+		if (iter->asid) {
+			status = pt_msec_matches_asid(&entry->msec, iter->asid);
+			if (status <= 0)
+				continue;
+		}
+
+		status = pt_image_index_is_removed(iter->index, layer,
+						   &entry->msec);
+		if (status != 0)
+			continue;
+
+		iter->layer = layer;
+		iter->entry = entry;
+		iter->bucket = bucket;
+
+		return &entry->msec;
+	}
+
+	iter->layer = NULL;
+	iter->entry = NULL;
+	iter->bucket = 0;
+
+	return NULL;
+}
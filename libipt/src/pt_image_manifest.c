@@ -0,0 +1,671 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pt_image.h"
+#include "pt_image_index.h"
+#include "pt_section.h"
+#include "pt_asid.h"
+
+#include "intel-pt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+
+/* The first line of an image manifest.
+ *
+ * The manifest is a text file.  The header is followed by one line per
+ * record:
+ *
+ *   file <size> <mtime> <name>
+ *   section <file> <offset> <size>
+ *   map <section> <cr3> <vmcs> <vaddr>
+ *
+ * Files and sections are numbered in the order of their records starting
+ * at zero.  They must be defined before they are used.  All numbers except
+ * for indices and the modification time are hexadecimal.  The file name
+ * extends to the end of the line.
+ */
+static const char pt_manifest_header[] = "pt-image 1\n";
+
+/* The maximal length of a manifest line including the new-line. */
+enum {
+	pt_manifest_line_size	= FILENAME_MAX + 128
+};
+
+/* The distinct sections and files of an image to be saved. */
+struct pt_manifest {
+	/* The distinct sections in order of their first use. */
+	const struct pt_section **section;
+
+	/* The index into @file of each section in @section. */
+	uint32_t *sfile;
+
+	/* The number of distinct sections. */
+	uint32_t nsections;
+
+	/* The distinct files in order of their first use.
+	 *
+	 * A file is identified by its name together with its identity when
+	 * the sections were created.  A file that changed between adding two
+	 * of its sections is listed once for each identity.
+	 */
+	const char **file;
+
+	/* The identity of each file in @file. */
+	const struct pt_file_id **fid;
+
+	/* The number of distinct files. */
+	uint32_t nfiles;
+
+	/* Hash tables for finding sections and files.
+	 *
+	 * Each slot holds an index into @section or @file, respectively, plus
+	 * one.  Empty slots are zero.
+	 */
+	uint32_t *section_slot;
+	uint32_t *file_slot;
+
+	/* The number of slots in each hash table - a power of two. */
+	uint32_t nslots;
+};
+
+static uint32_t pt_manifest_nelements(const struct pt_image *image)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+	uint32_t nelements;
+
+	nelements = 0;
+
+	pt_image_index_begin(&iter, image->index, NULL);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter))
+		nelements += 1;
+
+	return nelements;
+}
+
+static int pt_manifest_init(struct pt_manifest *manifest,
+			    const struct pt_image *image)
+{
+	uint32_t nelements, nslots;
+
+	if (!manifest || !image)
+		return -pte_internal;
+
+	memset(manifest, 0, sizeof(*manifest));
+
+	nelements = pt_manifest_nelements(image);
+
+	/* Keep the hash tables at most half full. */
+	for (nslots = 1; nslots <= nelements; nslots <<= 1) {
+		if (nslots & (1u << 30))
+			return -pte_nomem;
+	}
+	nslots <<= 1;
+
+	manifest->nslots = nslots;
+	manifest->section = malloc(nelements * sizeof(*manifest->section));
+	manifest->sfile = malloc(nelements * sizeof(*manifest->sfile));
+	manifest->file = malloc(nelements * sizeof(*manifest->file));
+	manifest->fid = malloc(nelements * sizeof(*manifest->fid));
+	manifest->section_slot = calloc(nslots, sizeof(uint32_t));
+	manifest->file_slot = calloc(nslots, sizeof(uint32_t));
+
+	if ((nelements && (!manifest->section || !manifest->sfile ||
+			   !manifest->file || !manifest->fid)) ||
+	    !manifest->section_slot || !manifest->file_slot)
+		return -pte_nomem;
+
+	return 0;
+}
+
+static void pt_manifest_fini(struct pt_manifest *manifest)
+{
+	if (!manifest)
+		return;
+
+	free(manifest->section);
+	free(manifest->sfile);
+	free(manifest->file);
+	free(manifest->fid);
+	free(manifest->section_slot);
+	free(manifest->file_slot);
+}
+
+static uint32_t pt_manifest_hash_section(const struct pt_section *section)
+{
+	uint64_t hash;
+
+	hash = (uint64_t) (uintptr_t) section;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+
+	return (uint32_t) hash;
+}
+
+static uint32_t pt_manifest_hash_file(const char *filename,
+				      const struct pt_file_id *id)
+{
+	uint32_t hash;
+
+	/* This is FNV-1a. */
+	hash = 2166136261u;
+	for (; *filename; ++filename) {
+		hash ^= (uint8_t) *filename;
+		hash *= 16777619u;
+	}
+
+	hash ^= (uint32_t) id->size;
+	hash *= 16777619u;
+	hash ^= (uint32_t) id->mtime;
+	hash *= 16777619u;
+
+	return hash;
+}
+
+/* Find @filename with identity @id in @manifest.
+ *
+ * Adds @filename if it has not been seen before with @id.
+ *
+ * Provides the index of @filename in @manifest's file array in @index.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_manifest_add_file(struct pt_manifest *manifest, uint32_t *index,
+				const char *filename,
+				const struct pt_file_id *id)
+{
+	uint32_t mask, slot;
+
+	if (!manifest || !index || !filename || !id)
+		return -pte_internal;
+
+	/* We can't represent file names that span more than one line. */
+	if (strchr(filename, '\n'))
+		return -pte_bad_image;
+
+	mask = manifest->nslots - 1;
+	for (slot = pt_manifest_hash_file(filename, id) & mask;
+	     manifest->file_slot[slot]; slot = (slot + 1) & mask) {
+		const struct pt_file_id *fid;
+		uint32_t idx;
+
+		idx = manifest->file_slot[slot] - 1;
+		fid = manifest->fid[idx];
+		if (fid->size == id->size && fid->mtime == id->mtime &&
+		    strcmp(manifest->file[idx], filename) == 0) {
+			*index = idx;
+			return 0;
+		}
+	}
+
+	*index = manifest->nfiles++;
+	manifest->file[*index] = filename;
+	manifest->fid[*index] = id;
+	manifest->file_slot[slot] = *index + 1;
+
+	return 0;
+}
+
+/* Find @section in @manifest.
+ *
+ * Adds @section and its file if @add is non-zero and @section has not been
+ * seen before.
+ *
+ * Provides the index of @section in @manifest's section array in @index.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_internal if @add is zero and @section has not been added.
+ */
+static int pt_manifest_find_section(struct pt_manifest *manifest,
+				    uint32_t *index,
+				    const struct pt_section *section, int add)
+{
+	const struct pt_file_id *id;
+	const char *filename;
+	uint32_t mask, slot, file;
+	int errcode;
+
+	if (!manifest || !index || !section)
+		return -pte_internal;
+
+	mask = manifest->nslots - 1;
+	for (slot = pt_manifest_hash_section(section) & mask;
+	     manifest->section_slot[slot]; slot = (slot + 1) & mask) {
+		uint32_t idx;
+
+		idx = manifest->section_slot[slot] - 1;
+		if (manifest->section[idx] == section) {
+			*index = idx;
+			return 0;
+		}
+	}
+
+	if (!add)
+		return -pte_internal;
+
+	filename = pt_section_filename(section);
+	id = pt_section_id(section);
+	if (!filename || !id)
+		return -pte_internal;
+
+	errcode = pt_manifest_add_file(manifest, &file, filename, id);
+	if (errcode < 0)
+		return errcode;
+
+	*index = manifest->nsections++;
+	manifest->section[*index] = section;
+	manifest->sfile[*index] = file;
+	manifest->section_slot[slot] = *index + 1;
+
+	return 0;
+}
+
+static int pt_manifest_add_sections(struct pt_manifest *manifest,
+				    const struct pt_image *image)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+
+	pt_image_index_begin(&iter, image->index, NULL);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		uint32_t index;
+		int errcode;
+
+		errcode = pt_manifest_find_section(manifest, &index,
+						   msec->section, 1);
+		if (errcode < 0)
+			return errcode;
+	}
+
+	return 0;
+}
+
+static int pt_manifest_write_maps(FILE *file, struct pt_manifest *manifest,
+				  const struct pt_image *image)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+
+	pt_image_index_begin(&iter, image->index, NULL);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter)) {
+		const struct pt_asid *asid;
+		uint32_t index;
+		int errcode;
+
+		asid = pt_msec_asid(msec);
+		if (!asid)
+			return -pte_internal;
+
+		errcode = pt_manifest_find_section(manifest, &index,
+						   msec->section, 0);
+		if (errcode < 0)
+			return errcode;
+
+		fprintf(file, "map %" PRIu32 " %" PRIx64 " %" PRIx64 " %"
+			PRIx64 "\n", index, asid->cr3, asid->vmcs,
+			pt_msec_begin(msec));
+	}
+
+	return 0;
+}
+
+static int pt_manifest_write(FILE *file, struct pt_manifest *manifest,
+			     const struct pt_image *image)
+{
+	uint32_t index;
+
+	fputs(pt_manifest_header, file);
+
+	/* We write the identity of each file when its sections were created,
+	 * not when the image is saved.  If the file changed in between,
+	 * pt_image_load() will notice.
+	 */
+	for (index = 0; index < manifest->nfiles; ++index) {
+		const struct pt_file_id *id;
+
+		id = manifest->fid[index];
+
+		fprintf(file, "file %" PRIx64 " %" PRId64 " %s\n", id->size,
+			id->mtime, manifest->file[index]);
+	}
+
+	for (index = 0; index < manifest->nsections; ++index) {
+		const struct pt_section *section;
+
+		section = manifest->section[index];
+
+		fprintf(file, "section %" PRIu32 " %" PRIx64 " %" PRIx64 "\n",
+			manifest->sfile[index], pt_section_offset(section),
+			pt_section_size(section));
+	}
+
+	return pt_manifest_write_maps(file, manifest, image);
+}
+
+int pt_image_save(const struct pt_image *image, const char *filename)
+{
+	struct pt_manifest manifest;
+	FILE *file;
+	int errcode;
+
+	if (!image || !filename)
+		return -pte_invalid;
+
+	errcode = pt_manifest_init(&manifest, image);
+	if (errcode < 0)
+		goto out_manifest;
+
+	errcode = pt_manifest_add_sections(&manifest, image);
+	if (errcode < 0)
+		goto out_manifest;
+
+	file = fopen(filename, "w");
+	if (!file) {
+		errcode = -pte_invalid;
+		goto out_manifest;
+	}
+
+	errcode = pt_manifest_write(file, &manifest, image);
+
+	if (ferror(file) && !(errcode < 0))
+		errcode = -pte_invalid;
+
+	if (fclose(file) && !(errcode < 0))
+		errcode = -pte_invalid;
+
+out_manifest:
+	pt_manifest_fini(&manifest);
+	return errcode;
+}
+
+/* A file described in a manifest that is being loaded. */
+struct pt_manifest_file {
+	/* The file name. */
+	char *name;
+
+	/* The identity of the file when the manifest was written. */
+	struct pt_file_id id;
+};
+
+/* The files and sections of a manifest that is being loaded. */
+struct pt_manifest_loader {
+	/* The files in manifest order. */
+	struct pt_manifest_file *file;
+
+	/* The number of files and the number of allocated entries. */
+	uint32_t nfiles, file_capacity;
+
+	/* The sections in manifest order. */
+	struct pt_section **section;
+
+	/* The number of sections and the number of allocated entries. */
+	uint32_t nsections, section_capacity;
+};
+
+static void pt_manifest_loader_fini(struct pt_manifest_loader *loader)
+{
+	uint32_t index;
+
+	if (!loader)
+		return;
+
+	for (index = 0; index < loader->nfiles; ++index)
+		free(loader->file[index].name);
+
+	/* The image holds its own references to sections it uses. */
+	for (index = 0; index < loader->nsections; ++index)
+		(void) pt_section_put(loader->section[index]);
+
+	free(loader->file);
+	free(loader->section);
+}
+
+/* Make room for one more element in an array of @*capacity elements of size
+ * @size each, @count of which are used.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_manifest_grow(void **array, uint32_t *capacity, uint32_t count,
+			    size_t size)
+{
+	uint32_t ncapacity;
+	void *narray;
+
+	if (!array || !capacity)
+		return -pte_internal;
+
+	if (count < *capacity)
+		return 0;
+
+	ncapacity = *capacity ? *capacity << 1 : 16;
+	if (ncapacity <= *capacity)
+		return -pte_nomem;
+
+	narray = realloc(*array, ncapacity * size);
+	if (!narray)
+		return -pte_nomem;
+
+	*array = narray;
+	*capacity = ncapacity;
+
+	return 0;
+}
+
+static int pt_manifest_load_file(struct pt_manifest_loader *loader,
+				 const char *line)
+{
+	struct pt_manifest_file *file;
+	struct pt_file_id id;
+	const char *name;
+	int errcode, pos;
+	void *array;
+
+	pos = 0;
+	if (sscanf(line, "file %" SCNx64 " %" SCNd64 "%n", &id.size,
+		   &id.mtime, &pos) != 2 || !pos || line[pos] != ' ')
+		return -pte_bad_image;
+
+	name = &line[pos + 1];
+	if (!*name)
+		return -pte_bad_image;
+
+	array = loader->file;
+	errcode = pt_manifest_grow(&array, &loader->file_capacity,
+				   loader->nfiles, sizeof(*loader->file));
+	loader->file = array;
+	if (errcode < 0)
+		return errcode;
+
+	file = &loader->file[loader->nfiles];
+	file->name = malloc(strlen(name) + 1);
+	if (!file->name)
+		return -pte_nomem;
+
+	strcpy(file->name, name);
+	file->id = id;
+
+	loader->nfiles += 1;
+
+	return 0;
+}
+
+static int pt_manifest_load_section(struct pt_manifest_loader *loader,
+				    const char *line)
+{
+	const struct pt_manifest_file *file;
+	struct pt_section *section;
+	uint64_t offset, size;
+	uint32_t index;
+	int errcode, pos;
+	void *array;
+
+	pos = 0;
+	if (sscanf(line, "section %" SCNu32 " %" SCNx64 " %" SCNx64 "%n",
+		   &index, &offset, &size, &pos) != 3 || !pos || line[pos])
+		return -pte_bad_image;
+
+	if (loader->nfiles <= index)
+		return -pte_bad_image;
+
+	array = loader->section;
+	errcode = pt_manifest_grow(&array, &loader->section_capacity,
+				   loader->nsections,
+				   sizeof(*loader->section));
+	loader->section = array;
+	if (errcode < 0)
+		return errcode;
+
+	file = &loader->file[index];
+
+	section = pt_mk_section_lazy(file->name, offset, size, &file->id);
+	if (!section)
+		return -pte_bad_image;
+
+	loader->section[loader->nsections++] = section;
+
+	return 0;
+}
+
+/* Map a section from a manifest into @image.
+ *
+ * Returns zero if the section was added, one if it was ignored, a negative
+ * error code otherwise.
+ */
+static int pt_manifest_load_map(struct pt_image *image,
+				const struct pt_manifest_loader *loader,
+				const char *line)
+{
+	struct pt_asid asid;
+	uint64_t vaddr;
+	uint32_t index;
+	int errcode, pos;
+
+	pt_asid_init(&asid);
+
+	pos = 0;
+	if (sscanf(line, "map %" SCNu32 " %" SCNx64 " %" SCNx64 " %" SCNx64
+		   "%n", &index, &asid.cr3, &asid.vmcs, &vaddr, &pos) != 4 ||
+	    !pos || line[pos])
+		return -pte_bad_image;
+
+	if (loader->nsections <= index)
+		return -pte_bad_image;
+
+	errcode = pt_image_add(image, loader->section[index], &asid, vaddr);
+	if (errcode < 0) {
+		if (errcode != -pte_bad_image)
+			return errcode;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int pt_manifest_load(struct pt_image *image,
+			    struct pt_manifest_loader *loader, FILE *file)
+{
+	char line[pt_manifest_line_size];
+	int ignored;
+
+	if (!fgets(line, sizeof(line), file) ||
+	    strcmp(line, pt_manifest_header) != 0)
+		return -pte_bad_image;
+
+	ignored = 0;
+	while (fgets(line, sizeof(line), file)) {
+		char *end;
+		int errcode;
+
+		/* Reject lines that have been truncated. */
+		end = strchr(line, '\n');
+		if (!end)
+			return -pte_bad_image;
+
+		*end = 0;
+
+		switch (line[0]) {
+		case 'f':
+			errcode = pt_manifest_load_file(loader, line);
+			break;
+
+		case 's':
+			errcode = pt_manifest_load_section(loader, line);
+			break;
+
+		case 'm':
+			errcode = pt_manifest_load_map(image, loader, line);
+			break;
+
+		default:
+			errcode = -pte_bad_image;
+			break;
+		}
+
+		if (errcode < 0)
+			return errcode;
+
+		ignored += errcode;
+	}
+
+	if (ferror(file))
+		return -pte_invalid;
+
+	return ignored;
+}
+
+int pt_image_load(struct pt_image *image, const char *filename)
+{
+	struct pt_manifest_loader loader;
+	FILE *file;
+	int errcode;
+
+	if (!image || !filename)
+		return -pte_invalid;
+
+	file = fopen(filename, "r");
+	if (!file)
+		return -pte_invalid;
+
+	memset(&loader, 0, sizeof(loader));
+
+	errcode = pt_manifest_load(image, &loader, file);
+
+	pt_manifest_loader_fini(&loader);
+	fclose(file);
+
+	return errcode;
+}
@@ -27,6 +27,7 @@
  */
 
 #include "pt_insn_decoder.h"
+#include "pt_bcache.h"
 
 #include "intel-pt.h"
 
@@ -45,9 +46,12 @@ static void pt_insn_reset(struct pt_insn_decoder *decoder)
 	decoder->enabled = 0;
 	decoder->process_event = 0;
 	decoder->speculative = 0;
+	decoder->branch_taken = 0;
 	decoder->event_may_change_ip = 1;
+	decoder->event = NULL;
 
 	pt_retstack_init(&decoder->retstack);
+	pt_callstack_clear(&decoder->callstack);
 	pt_asid_init(&decoder->asid);
 }
 
@@ -66,6 +70,8 @@ int pt_insn_decoder_init(struct pt_insn_decoder *decoder,
 	pt_image_init(&decoder->default_image, NULL);
 	decoder->image = &decoder->default_image;
 
+	pt_callstack_init(&decoder->callstack);
+
 	pt_insn_reset(decoder);
 
 	return 0;
@@ -76,6 +82,7 @@ void pt_insn_decoder_fini(struct pt_insn_decoder *decoder)
 	if (!decoder)
 		return;
 
+	pt_callstack_fini(&decoder->callstack);
 	pt_image_fini(&decoder->default_image);
 	pt_qry_decoder_fini(&decoder->query);
 }
@@ -228,6 +235,23 @@ int pt_insn_core_bus_ratio(struct pt_insn_decoder *decoder, uint32_t *cbr)
 	return pt_qry_core_bus_ratio(&decoder->query, cbr);
 }
 
+int pt_insn_call_depth(const struct pt_insn_decoder *decoder)
+{
+	if (!decoder)
+		return -pte_invalid;
+
+	return pt_callstack_depth(&decoder->callstack);
+}
+
+int pt_insn_call_frame(const struct pt_insn_decoder *decoder,
+		       struct pt_call_frame *frame, uint32_t level)
+{
+	if (!decoder || !frame)
+		return -pte_invalid;
+
+	return pt_callstack_frame(&decoder->callstack, frame, level);
+}
+
 static enum pt_insn_class pt_insn_classify(const struct pt_ild *ild)
 {
 	if (!ild)
@@ -388,6 +412,33 @@ static int decode_insn(struct pt_insn *insn, struct pt_insn_decoder *decoder)
 	insn->ip = decoder->ip;
 	insn->mode = decoder->mode;
 
+	ild = &decoder->ild;
+
+	/* Check the branch target cache if we got here by a direct branch.
+	 *
+	 * Events may have changed the IP, the mode, or the address space
+	 * since we took the branch, so we need to check the target.
+	 */
+	if (decoder->branch_taken) {
+		const struct pt_bcache_entry *bce;
+
+		errcode = pt_image_bcache_lookup(decoder->image, &bce,
+						 &decoder->asid,
+						 decoder->branch_ip);
+		if (!errcode && bce->ild.runtime_address == decoder->ip &&
+		    bce->ild.mode == decoder->mode) {
+			memcpy(insn->raw, bce->raw, sizeof(insn->raw));
+
+			*ild = bce->ild;
+			ild->itext = insn->raw;
+
+			insn->size = ild->length;
+
+			relevant = pt_instruction_decode(ild);
+			goto classify;
+		}
+	}
+
 	/* Read the memory at the current IP in the current address space. */
 	size = pt_image_read(decoder->image, insn->raw, sizeof(insn->raw),
 			     &decoder->asid, decoder->ip);
@@ -395,7 +446,6 @@ static int decode_insn(struct pt_insn *insn, struct pt_insn_decoder *decoder)
 		return size;
 
 	/* Decode the instruction. */
-	ild = &decoder->ild;
 	ild->itext = insn->raw;
 	ild->max_bytes = (uint8_t) size;
 	ild->mode = decoder->mode;
@@ -408,6 +458,25 @@ static int decode_insn(struct pt_insn *insn, struct pt_insn_decoder *decoder)
 	insn->size = ild->length;
 
 	relevant = pt_instruction_decode(ild);
+
+	/* Cache the instruction at the target of a direct branch.
+	 *
+	 * This fails for branches to other sections; we just don't cache
+	 * those.
+	 */
+	if (decoder->branch_taken && relevant >= 0) {
+		struct pt_bcache_entry bce;
+
+		bce.ip = decoder->branch_ip;
+		bce.ild = *ild;
+		bce.size = (uint8_t) size;
+		memcpy(bce.raw, insn->raw, sizeof(bce.raw));
+
+		(void) pt_image_bcache_add(decoder->image, &bce,
+					   &decoder->asid);
+	}
+
+classify:
 	if (!relevant)
 		insn->iclass = ptic_other;
 	else {
@@ -489,8 +558,7 @@ static inline int event_pending(struct pt_insn_decoder *decoder)
 	if (!(status & pts_event_pending))
 		return 0;
 
-	status = pt_qry_event(&decoder->query, &decoder->event,
-			      sizeof(decoder->event));
+	status = pt_qry_event_ref(&decoder->query, &decoder->event);
 	if (status < 0)
 		return status;
 
@@ -507,7 +575,9 @@ static int process_enabled_event(struct pt_insn_decoder *decoder,
 	if (!decoder || !insn)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	/* This event can't be a status update. */
 	if (ev->status_update)
@@ -555,7 +625,9 @@ static int process_disabled_event(struct pt_insn_decoder *decoder,
 	if (!decoder || !insn)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	/* This event can't be a status update. */
 	if (ev->status_update)
@@ -617,7 +689,9 @@ static int process_async_branch_event(struct pt_insn_decoder *decoder)
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	/* This event can't be a status update. */
 	if (ev->status_update)
@@ -643,7 +717,9 @@ static int process_paging_event(struct pt_insn_decoder *decoder)
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	decoder->asid.cr3 = ev->variant.paging.cr3;
 
@@ -658,7 +734,9 @@ static int process_overflow_event(struct pt_insn_decoder *decoder,
 	if (!decoder || !insn)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	/* This event can't be a status update. */
 	if (ev->status_update)
@@ -710,7 +788,10 @@ static int process_exec_mode_event(struct pt_insn_decoder *decoder)
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
+
 	mode = ev->variant.exec_mode.mode;
 
 	/* Use status update events to diagnose inconsistencies. */
@@ -733,7 +814,9 @@ static int process_tsx_event(struct pt_insn_decoder *decoder,
 		return -pte_internal;
 
 	old_speculative = decoder->speculative;
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	decoder->speculative = ev->variant.tsx.speculative;
 
@@ -755,7 +838,9 @@ static int process_stop_event(struct pt_insn_decoder *decoder,
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	/* This event can't be a status update. */
 	if (ev->status_update)
@@ -778,7 +863,9 @@ static int process_vmcs_event(struct pt_insn_decoder *decoder)
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	decoder->asid.vmcs = ev->variant.vmcs.base;
 
@@ -840,7 +927,9 @@ static inline int handle_erratum_skd022(struct pt_insn_decoder *decoder)
 	/* We turn the async disable into a sync disable.  It will be processed
 	 * after decoding the instruction.
 	 */
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
 
 	ip = ev->variant.async_disabled.ip;
 
@@ -858,7 +947,10 @@ static int process_one_event_before(struct pt_insn_decoder *decoder,
 	if (!decoder || !insn)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
+
 	switch (ev->type) {
 	case ptev_enabled:
 		return process_enabled_event(decoder, insn);
@@ -996,7 +1088,10 @@ static int process_one_event_after(struct pt_insn_decoder *decoder,
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
+
 	switch (ev->type) {
 	case ptev_enabled:
 	case ptev_overflow:
@@ -1099,7 +1194,10 @@ static int process_one_event_peek(struct pt_insn_decoder *decoder,
 	if (!decoder)
 		return -pte_internal;
 
-	ev = &decoder->event;
+	ev = decoder->event;
+	if (!ev)
+		return -pte_internal;
+
 	switch (ev->type) {
 	case ptev_async_disabled:
 		if (ev->variant.async_disabled.at == decoder->ip) {
@@ -1236,11 +1334,15 @@ static int process_events_peek(struct pt_insn_decoder *decoder,
 static int proceed(struct pt_insn_decoder *decoder)
 {
 	const struct pt_ild *ild;
+	struct pt_call_frame frame;
+	int call;
 
 	if (!decoder)
 		return -pte_internal;
 
 	ild = &decoder->ild;
+	decoder->branch_taken = 0;
+	call = 0;
 
 	if (!ild->u.s.branch) {
 		decoder->ip += ild->length;
@@ -1270,13 +1372,24 @@ static int proceed(struct pt_insn_decoder *decoder)
 		 * for position independent code.
 		 */
 		nip = decoder->ip + ild->length;
-		if (!ild->u.s.branch_direct || (nip != ild->direct_target))
+		if (!ild->u.s.branch_direct || (nip != ild->direct_target)) {
 			pt_retstack_push(&decoder->retstack, nip);
 
+			/* We log it on the shadow call stack once we know
+			 * the call target.
+			 */
+			frame.call = decoder->ip;
+			frame.ret = nip;
+			call = 1;
+		}
+
 		/* Fall through to process the call. */
 	} else if (ild->u.s.ret && !ild->u.s.branch_far) {
 		int taken, status;
 
+		/* Returns from calls we haven't seen are fine. */
+		(void) pt_callstack_pop(&decoder->callstack, NULL);
+
 		/* Check for a compressed return. */
 		status = pt_qry_cond_branch(&decoder->query, &taken);
 		if (status >= 0) {
@@ -1296,9 +1409,17 @@ static int proceed(struct pt_insn_decoder *decoder)
 	}
 
 	/* Process the actual branch. */
-	if (ild->u.s.branch_direct)
+	if (ild->u.s.branch_direct) {
 		decoder->ip = ild->direct_target;
-	else {
+
+		/* We only cache near branches; far branches may change the
+		 * execution mode.
+		 */
+		if (!ild->u.s.branch_far) {
+			decoder->branch_ip = ild->runtime_address;
+			decoder->branch_taken = 1;
+		}
+	} else {
 		int status;
 
 		status = pt_qry_indirect_branch(&decoder->query,
@@ -1314,6 +1435,12 @@ static int proceed(struct pt_insn_decoder *decoder)
 			return -pte_noip;
 	}
 
+	if (call) {
+		frame.target = decoder->ip;
+
+		return pt_callstack_push(&decoder->callstack, &frame);
+	}
+
 	return 0;
 }
 
@@ -1391,10 +1518,10 @@ int pt_insn_next(struct pt_insn_decoder *decoder, struct pt_insn *uinsn,
 	 * event.
 	 */
 	if (!decoder->enabled) {
-		struct pt_event event;
+		struct pt_event *event;
 
 		/* Any query should give us an end of stream, error. */
-		errcode = pt_qry_event(&decoder->query, &event, sizeof(event));
+		errcode = pt_qry_event_ref(&decoder->query, &event);
 		if (errcode != -pte_eos)
 			errcode = -pte_no_enable;
 
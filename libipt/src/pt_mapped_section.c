@@ -96,6 +96,27 @@ int pt_msec_matches_asid(const struct pt_mapped_section *msec,
 	return pt_asid_match(&msec->asid, asid);
 }
 
+int pt_msec_is_same(const struct pt_mapped_section *lhs,
+		    const struct pt_mapped_section *rhs)
+{
+	if (!lhs || !rhs)
+		return -pte_internal;
+
+	if (lhs->section != rhs->section)
+		return 0;
+
+	if (lhs->vaddr != rhs->vaddr)
+		return 0;
+
+	if (lhs->asid.cr3 != rhs->asid.cr3)
+		return 0;
+
+	if (lhs->asid.vmcs != rhs->asid.vmcs)
+		return 0;
+
+	return 1;
+}
+
 int pt_msec_read(const struct pt_mapped_section *msec, uint8_t *buffer,
 		 uint16_t size, const struct pt_asid *asid, uint64_t addr)
 {
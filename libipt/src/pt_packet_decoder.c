@@ -49,7 +49,7 @@ int pt_pkt_decoder_init(struct pt_packet_decoder *decoder,
 	if (errcode < 0)
 		return errcode;
 
-	return 0;
+	return pt_scatter_init(&decoder->scatter, &decoder->config);
 }
 
 struct pt_packet_decoder *pt_pkt_alloc_decoder(const struct pt_config *config)
@@ -72,9 +72,10 @@ struct pt_packet_decoder *pt_pkt_alloc_decoder(const struct pt_config *config)
 
 void pt_pkt_decoder_fini(struct pt_packet_decoder *decoder)
 {
-	(void) decoder;
+	if (!decoder)
+		return;
 
-	/* Nothing to do. */
+	pt_scatter_fini(&decoder->scatter);
 }
 
 void pt_pkt_free_decoder(struct pt_packet_decoder *decoder)
@@ -86,6 +87,7 @@ void pt_pkt_free_decoder(struct pt_packet_decoder *decoder)
 int pt_pkt_sync_forward(struct pt_packet_decoder *decoder)
 {
 	const uint8_t *pos, *sync;
+	uint64_t offset;
 	int errcode;
 
 	if (!decoder)
@@ -93,13 +95,19 @@ int pt_pkt_sync_forward(struct pt_packet_decoder *decoder)
 
 	sync = decoder->sync;
 	pos = decoder->pos;
-	if (!pos)
-		pos = decoder->config.begin;
-
-	if (pos == sync)
-		pos += ptps_psb;
+	offset = 0ull;
+	if (pos) {
+		errcode = pt_scatter_offset(&offset, &decoder->scatter, pos,
+					    &decoder->config);
+		if (errcode < 0)
+			return errcode;
+
+		if (pos == sync)
+			offset += ptps_psb;
+	}
 
-	errcode = pt_sync_forward(&sync, pos, &decoder->config);
+	errcode = pt_scatter_sync_forward(&sync, &decoder->config,
+					  &decoder->scatter, offset);
 	if (errcode < 0)
 		return errcode;
 
@@ -111,17 +119,24 @@ int pt_pkt_sync_forward(struct pt_packet_decoder *decoder)
 
 int pt_pkt_sync_backward(struct pt_packet_decoder *decoder)
 {
-	const uint8_t *pos, *sync;
+	const uint8_t *sync;
+	uint64_t offset;
 	int errcode;
 
 	if (!decoder)
 		return -pte_invalid;
 
-	pos = decoder->sync;
-	if (!pos)
-		pos = decoder->config.end;
-
-	errcode = pt_sync_backward(&sync, pos, &decoder->config);
+	sync = decoder->sync;
+	if (sync) {
+		errcode = pt_scatter_sync_offset(&offset, &decoder->scatter,
+						 sync, &decoder->config);
+		if (errcode < 0)
+			return errcode;
+	} else
+		offset = pt_scatter_size(&decoder->scatter, &decoder->config);
+
+	errcode = pt_scatter_sync_backward(&sync, &decoder->config,
+					   &decoder->scatter, offset);
 	if (errcode < 0)
 		return errcode;
 
@@ -133,17 +148,16 @@ int pt_pkt_sync_backward(struct pt_packet_decoder *decoder)
 
 int pt_pkt_sync_set(struct pt_packet_decoder *decoder, uint64_t offset)
 {
-	const uint8_t *begin, *end, *pos;
+	const uint8_t *pos;
+	int errcode;
 
 	if (!decoder)
 		return -pte_invalid;
 
-	begin = decoder->config.begin;
-	end = decoder->config.end;
-	pos = begin + offset;
-
-	if (end < pos || pos < begin)
-		return -pte_eos;
+	errcode = pt_scatter_seek(&pos, &decoder->config, &decoder->scatter,
+				  offset);
+	if (errcode < 0)
+		return errcode;
 
 	decoder->sync = pos;
 	decoder->pos = pos;
@@ -153,36 +167,34 @@ int pt_pkt_sync_set(struct pt_packet_decoder *decoder, uint64_t offset)
 
 int pt_pkt_get_offset(struct pt_packet_decoder *decoder, uint64_t *offset)
 {
-	const uint8_t *begin, *pos;
+	const uint8_t *pos;
 
 	if (!decoder || !offset)
 		return -pte_invalid;
 
-	begin = decoder->config.begin;
 	pos = decoder->pos;
 
 	if (!pos)
 		return -pte_nosync;
 
-	*offset = pos - begin;
-	return 0;
+	return pt_scatter_offset(offset, &decoder->scatter, pos,
+				 &decoder->config);
 }
 
 int pt_pkt_get_sync_offset(struct pt_packet_decoder *decoder, uint64_t *offset)
 {
-	const uint8_t *begin, *sync;
+	const uint8_t *sync;
 
 	if (!decoder || !offset)
 		return -pte_invalid;
 
-	begin = decoder->config.begin;
 	sync = decoder->sync;
 
 	if (!sync)
 		return -pte_nosync;
 
-	*offset = sync - begin;
-	return 0;
+	return pt_scatter_sync_offset(offset, &decoder->scatter, sync,
+				      &decoder->config);
 }
 
 const struct pt_config *
@@ -227,6 +239,11 @@ int pt_pkt_next(struct pt_packet_decoder *decoder, struct pt_packet *packet,
 
 	ppkt = psize == sizeof(pkt) ? packet : &pkt;
 
+	errcode = pt_scatter_normalize(&decoder->pos, &decoder->config,
+				       &decoder->scatter);
+	if (errcode < 0)
+		return errcode;
+
 	errcode = pt_df_fetch(&dfun, decoder->pos, &decoder->config);
 	if (errcode < 0)
 		return errcode;
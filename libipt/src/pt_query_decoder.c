@@ -81,6 +81,42 @@ static int pt_qry_find_header_fup(struct pt_packet *packet,
 	}
 }
 
+/* Initialize a packet decoder for @qry's trace.
+ *
+ * On success, the packet @decoder is synchronized onto the trace at @offset.
+ * It must be finalized by the caller.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_qry_pkt_decoder_init(struct pt_packet_decoder *decoder,
+				   const struct pt_query_decoder *qry,
+				   uint64_t offset)
+{
+	struct pt_config config;
+	int errcode;
+
+	if (!qry)
+		return -pte_internal;
+
+	config = qry->config;
+
+	errcode = pt_scatter_user_config(&config, &qry->scatter);
+	if (errcode < 0)
+		return errcode;
+
+	errcode = pt_pkt_decoder_init(decoder, &config);
+	if (errcode < 0)
+		return errcode;
+
+	errcode = pt_pkt_sync_set(decoder, offset);
+	if (errcode < 0) {
+		pt_pkt_decoder_fini(decoder);
+		return errcode;
+	}
+
+	return 0;
+}
+
 int pt_qry_decoder_init(struct pt_query_decoder *decoder,
 			const struct pt_config *config)
 {
@@ -95,12 +131,18 @@ int pt_qry_decoder_init(struct pt_query_decoder *decoder,
 	if (errcode < 0)
 		return errcode;
 
+	errcode = pt_scatter_init(&decoder->scatter, &decoder->config);
+	if (errcode < 0)
+		return errcode;
+
 	pt_last_ip_init(&decoder->ip);
 	pt_tnt_cache_init(&decoder->tnt);
 	pt_time_init(&decoder->time);
 	pt_tcal_init(&decoder->tcal);
 	pt_evq_init(&decoder->evq);
 
+	decoder->event_mask = UINT32_MAX;
+
 	return 0;
 }
 
@@ -124,9 +166,10 @@ struct pt_query_decoder *pt_qry_alloc_decoder(const struct pt_config *config)
 
 void pt_qry_decoder_fini(struct pt_query_decoder *decoder)
 {
-	(void) decoder;
+	if (!decoder)
+		return;
 
-	/* Nothing to do. */
+	pt_scatter_fini(&decoder->scatter);
 }
 
 void pt_qry_free_decoder(struct pt_query_decoder *decoder)
@@ -142,6 +185,7 @@ static void pt_qry_reset(struct pt_query_decoder *decoder)
 
 	decoder->enabled = 0;
 	decoder->consume_packet = 0;
+	decoder->event_pending = 0;
 	decoder->event = NULL;
 
 	pt_last_ip_init(&decoder->ip);
@@ -151,6 +195,23 @@ static void pt_qry_reset(struct pt_query_decoder *decoder)
 	pt_evq_init(&decoder->evq);
 }
 
+/* Check whether our user is interested in events of type @type. */
+static int pt_qry_event_wanted(const struct pt_query_decoder *decoder,
+			       enum pt_event_type type)
+{
+	return (decoder->event_mask & pt_event_mask(type)) != 0;
+}
+
+/* Check whether our user is interested in all events. */
+static int pt_qry_all_events_wanted(const struct pt_query_decoder *decoder)
+{
+	uint32_t all;
+
+	all = (pt_event_mask(ptev_async_vmcs) << 1) - 1;
+
+	return (decoder->event_mask & all) == all;
+}
+
 static int pt_qry_will_event(const struct pt_query_decoder *decoder)
 {
 	const struct pt_decoder_function *dfun;
@@ -158,6 +219,10 @@ static int pt_qry_will_event(const struct pt_query_decoder *decoder)
 	if (!decoder)
 		return -pte_internal;
 
+	/* We may have decoded the next event ahead of our user. */
+	if (decoder->event_pending)
+		return 1;
+
 	dfun = decoder->next;
 	if (!dfun)
 		return 0;
@@ -249,12 +314,31 @@ static int pt_qry_provoke_fetch_error(const struct pt_query_decoder *decoder)
 	return -pte_internal;
 }
 
+/* Move to the trace buffer window containing the current position.
+ *
+ * This must be called before fetching the next packet.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_qry_normalize(struct pt_query_decoder *decoder)
+{
+	if (!decoder)
+		return -pte_internal;
+
+	return pt_scatter_normalize(&decoder->pos, &decoder->config,
+				    &decoder->scatter);
+}
+
 static int pt_qry_read_ahead(struct pt_query_decoder *decoder)
 {
 	for (;;) {
 		const struct pt_decoder_function *dfun;
 		int errcode;
 
+		errcode = pt_qry_normalize(decoder);
+		if (errcode < 0)
+			return errcode;
+
 		errcode = pt_df_fetch(&decoder->next, decoder->pos,
 				      &decoder->config);
 		if (errcode)
@@ -284,6 +368,63 @@ static int pt_qry_read_ahead(struct pt_query_decoder *decoder)
 	}
 }
 
+/* Apply events our user is not interested in.
+ *
+ * If some event types are masked out, decode pending events ahead of our user
+ * until we find an event our user is interested in or until there are no more
+ * pending events.  We leave the former in @decoder->event for pt_qry_event().
+ *
+ * Like signaling events, this waits until our user consumed all cached TNT
+ * bits.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_qry_skip_events(struct pt_query_decoder *decoder)
+{
+	if (!decoder)
+		return -pte_internal;
+
+	if (pt_qry_all_events_wanted(decoder))
+		return 0;
+
+	if (!pt_tnt_cache_is_empty(&decoder->tnt))
+		return 0;
+
+	while (!decoder->event_pending && pt_qry_will_event(decoder)) {
+		const struct pt_decoder_function *dfun;
+		int errcode;
+
+		dfun = decoder->next;
+		if (!dfun || !dfun->decode)
+			return -pte_internal;
+
+		decoder->event = NULL;
+
+		errcode = dfun->decode(decoder);
+		if (errcode)
+			return errcode;
+
+		if (decoder->event &&
+		    pt_qry_event_wanted(decoder, decoder->event->type)) {
+			decoder->event_pending = 1;
+			break;
+		}
+
+		errcode = pt_qry_read_ahead(decoder);
+		if (errcode < 0) {
+			/* Running out of trace is not an error, here.  We
+			 * will report it on the next query.
+			 */
+			if (errcode == -pte_eos)
+				break;
+
+			return errcode;
+		}
+	}
+
+	return 0;
+}
+
 static int pt_qry_start(struct pt_query_decoder *decoder, const uint8_t *pos,
 			uint64_t *addr)
 {
@@ -331,11 +472,10 @@ static int pt_qry_start(struct pt_query_decoder *decoder, const uint8_t *pos,
 	if (errcode < 0)
 		return errcode;
 
-	/* We return the current decoder status. */
-	status = pt_qry_status_flags(decoder);
-	if (status < 0)
-		return status;
-
+	/* Fill in the start address before we skip any events that may again
+	 * change the decoder's IP.
+	 */
+	status = 0;
 	errcode = pt_last_ip_query(addr, &decoder->ip);
 	if (errcode < 0) {
 		/* Indicate the missing IP in the status. */
@@ -343,7 +483,16 @@ static int pt_qry_start(struct pt_query_decoder *decoder, const uint8_t *pos,
 			status |= pts_ip_suppressed;
 	}
 
-	return status;
+	errcode = pt_qry_skip_events(decoder);
+	if (errcode < 0)
+		return errcode;
+
+	/* We return the current decoder status. */
+	errcode = pt_qry_status_flags(decoder);
+	if (errcode < 0)
+		return errcode;
+
+	return status | errcode;
 }
 
 static int pt_qry_apply_tsc(struct pt_time *time, struct pt_time_cal *tcal,
@@ -540,6 +689,7 @@ static int pt_qry_apply_cyc(struct pt_time *time, struct pt_time_cal *tcal,
 int pt_qry_sync_forward(struct pt_query_decoder *decoder, uint64_t *ip)
 {
 	const uint8_t *pos, *sync;
+	uint64_t offset;
 	int errcode;
 
 	if (!decoder)
@@ -547,13 +697,19 @@ int pt_qry_sync_forward(struct pt_query_decoder *decoder, uint64_t *ip)
 
 	sync = decoder->sync;
 	pos = decoder->pos;
-	if (!pos)
-		pos = decoder->config.begin;
+	offset = 0ull;
+	if (pos) {
+		errcode = pt_scatter_offset(&offset, &decoder->scatter, pos,
+					    &decoder->config);
+		if (errcode < 0)
+			return errcode;
 
-	if (pos == sync)
-		pos += ptps_psb;
+		if (pos == sync)
+			offset += ptps_psb;
+	}
 
-	errcode = pt_sync_forward(&sync, pos, &decoder->config);
+	errcode = pt_scatter_sync_forward(&sync, &decoder->config,
+					  &decoder->scatter, offset);
 	if (errcode < 0)
 		return errcode;
 
@@ -562,17 +718,24 @@ int pt_qry_sync_forward(struct pt_query_decoder *decoder, uint64_t *ip)
 
 int pt_qry_sync_backward(struct pt_query_decoder *decoder, uint64_t *ip)
 {
-	const uint8_t *pos, *sync;
+	const uint8_t *sync;
+	uint64_t offset;
 	int errcode;
 
 	if (!decoder)
 		return -pte_invalid;
 
-	pos = decoder->sync;
-	if (!pos)
-		pos = decoder->config.end;
+	sync = decoder->sync;
+	if (sync) {
+		errcode = pt_scatter_sync_offset(&offset, &decoder->scatter,
+						 sync, &decoder->config);
+		if (errcode < 0)
+			return errcode;
+	} else
+		offset = pt_scatter_size(&decoder->scatter, &decoder->config);
 
-	errcode = pt_sync_backward(&sync, pos, &decoder->config);
+	errcode = pt_scatter_sync_backward(&sync, &decoder->config,
+					   &decoder->scatter, offset);
 	if (errcode < 0)
 		return errcode;
 
@@ -582,15 +745,14 @@ int pt_qry_sync_backward(struct pt_query_decoder *decoder, uint64_t *ip)
 int pt_qry_sync_set(struct pt_query_decoder *decoder, uint64_t *ip,
 		    uint64_t offset)
 {
-	const uint8_t *sync, *pos;
+	const uint8_t *sync;
 	int errcode;
 
 	if (!decoder)
 		return -pte_invalid;
 
-	pos = decoder->config.begin + offset;
-
-	errcode = pt_sync_set(&sync, pos, &decoder->config);
+	errcode = pt_scatter_sync_set(&sync, &decoder->config,
+				      &decoder->scatter, offset);
 	if (errcode < 0)
 		return errcode;
 
@@ -599,36 +761,34 @@ int pt_qry_sync_set(struct pt_query_decoder *decoder, uint64_t *ip,
 
 int pt_qry_get_offset(struct pt_query_decoder *decoder, uint64_t *offset)
 {
-	const uint8_t *begin, *pos;
+	const uint8_t *pos;
 
 	if (!decoder || !offset)
 		return -pte_invalid;
 
-	begin = decoder->config.begin;
 	pos = decoder->pos;
 
 	if (!pos)
 		return -pte_nosync;
 
-	*offset = pos - begin;
-	return 0;
+	return pt_scatter_offset(offset, &decoder->scatter, pos,
+				 &decoder->config);
 }
 
 int pt_qry_get_sync_offset(struct pt_query_decoder *decoder, uint64_t *offset)
 {
-	const uint8_t *begin, *sync;
+	const uint8_t *sync;
 
 	if (!decoder || !offset)
 		return -pte_invalid;
 
-	begin = decoder->config.begin;
 	sync = decoder->sync;
 
 	if (!sync)
 		return -pte_nosync;
 
-	*offset = sync - begin;
-	return 0;
+	return pt_scatter_sync_offset(offset, &decoder->scatter, sync,
+				      &decoder->config);
 }
 
 const struct pt_config *
@@ -716,6 +876,10 @@ int pt_qry_cond_branch(struct pt_query_decoder *decoder, int *taken)
 
 	*taken = query;
 
+	errcode = pt_qry_skip_events(decoder);
+	if (errcode < 0)
+		return errcode;
+
 	return pt_qry_status_flags(decoder);
 }
 
@@ -794,36 +958,42 @@ int pt_qry_indirect_branch(struct pt_query_decoder *decoder, uint64_t *addr)
 	if ((errcode < 0) && (errcode != -pte_eos))
 		return errcode;
 
+	errcode = pt_qry_skip_events(decoder);
+	if (errcode < 0)
+		return errcode;
+
 	flags |= pt_qry_status_flags(decoder);
 
 	return flags;
 }
 
-int pt_qry_event(struct pt_query_decoder *decoder, struct pt_event *event,
-		 size_t size)
+int pt_qry_event_ref(struct pt_query_decoder *decoder,
+		     struct pt_event **event)
 {
+	struct pt_event *ev;
 	int errcode, flags;
 
 	if (!decoder || !event)
 		return -pte_invalid;
 
-	if (size < offsetof(struct pt_event, variant))
-		return -pte_invalid;
-
 	/* We do not allow querying for events while there are still TNT
 	 * bits to consume.
 	 */
 	if (!pt_tnt_cache_is_empty(&decoder->tnt))
 		return -pte_bad_query;
 
-	/* Do not provide more than we actually have. */
-	if (sizeof(*event) < size)
-		size = sizeof(*event);
-
 	flags = 0;
 	for (;;) {
 		const struct pt_decoder_function *dfun;
 
+		/* We may have decoded the event ahead of our user. */
+		if (decoder->event_pending) {
+			decoder->event_pending = 0;
+
+			ev = decoder->event;
+			break;
+		}
+
 		dfun = decoder->next;
 		if (!dfun)
 			return pt_qry_provoke_fetch_error(decoder);
@@ -855,10 +1025,12 @@ int pt_qry_event(struct pt_query_decoder *decoder, struct pt_event *event,
 		/* Check if there has been an event.
 		 *
 		 * Some packets may result in events in some but not in all
-		 * configurations.
+		 * configurations.  We do not report events our user is not
+		 * interested in.
 		 */
-		if (decoder->event) {
-			(void) memcpy(event, decoder->event, size);
+		if (decoder->event &&
+		    pt_qry_event_wanted(decoder, decoder->event->type)) {
+			ev = decoder->event;
 			break;
 		}
 
@@ -873,11 +1045,65 @@ int pt_qry_event(struct pt_query_decoder *decoder, struct pt_event *event,
 	if ((errcode < 0) && (errcode != -pte_eos))
 		return errcode;
 
+	/* This may decode the next event ahead of our user.  The event queue
+	 * keeps @ev valid until the next query.
+	 */
+	errcode = pt_qry_skip_events(decoder);
+	if (errcode < 0)
+		return errcode;
+
 	flags |= pt_qry_status_flags(decoder);
 
+	*event = ev;
 	return flags;
 }
 
+int pt_qry_event(struct pt_query_decoder *decoder, struct pt_event *event,
+		 size_t size)
+{
+	struct pt_event *ev;
+	int status;
+
+	if (!decoder || !event)
+		return -pte_invalid;
+
+	if (size < offsetof(struct pt_event, variant))
+		return -pte_invalid;
+
+	/* Do not provide more than we actually have. */
+	if (sizeof(*event) < size)
+		size = sizeof(*event);
+
+	status = pt_qry_event_ref(decoder, &ev);
+	if (status < 0)
+		return status;
+
+	(void) memcpy(event, ev, size);
+
+	return status;
+}
+
+int pt_qry_set_event_mask(struct pt_query_decoder *decoder, uint32_t mask)
+{
+	if (!decoder)
+		return -pte_invalid;
+
+	decoder->event_mask = mask;
+
+	return 0;
+}
+
+int pt_qry_get_event_mask(const struct pt_query_decoder *decoder,
+			  uint32_t *mask)
+{
+	if (!decoder || !mask)
+		return -pte_invalid;
+
+	*mask = decoder->event_mask;
+
+	return 0;
+}
+
 int pt_qry_time(struct pt_query_decoder *decoder, uint64_t *time,
 		uint32_t *lost_mtc, uint32_t *lost_cyc)
 {
@@ -903,6 +1129,12 @@ static void pt_qry_add_event_time(struct pt_event *event,
 	if (!event || !decoder)
 		return;
 
+	/* Async branch events may later turn into async disabled events. */
+	if (!pt_qry_event_wanted(decoder, event->type) &&
+	    !((event->type == ptev_async_branch) &&
+	      pt_qry_event_wanted(decoder, ptev_async_disabled)))
+		return;
+
 	errcode = pt_time_query_tsc(&event->tsc, &event->lost_mtc,
 				    &event->lost_cyc, &decoder->time);
 	if (errcode >= 0)
@@ -937,6 +1169,10 @@ static int pt_qry_read_psb_header(struct pt_query_decoder *decoder)
 		const struct pt_decoder_function *dfun;
 		int errcode;
 
+		errcode = pt_qry_normalize(decoder);
+		if (errcode < 0)
+			return errcode;
+
 		errcode = pt_df_fetch(&decoder->next, decoder->pos,
 				      &decoder->config);
 		if (errcode)
@@ -961,12 +1197,17 @@ static int pt_qry_read_psb_header(struct pt_query_decoder *decoder)
 
 int pt_qry_decode_psb(struct pt_query_decoder *decoder)
 {
-	const uint8_t *pos;
+	uint64_t offset;
 	int size, errcode;
 
-	pos = decoder->pos;
+	/* Reading the PSB+ header may move us to a different part of a
+	 * scattered trace buffer.  Remember the PSB by its offset.
+	 */
+	errcode = pt_qry_get_offset(decoder, &offset);
+	if (errcode < 0)
+		return errcode;
 
-	size = pt_pkt_read_psb(pos, &decoder->config);
+	size = pt_pkt_read_psb(decoder->pos, &decoder->config);
 	if (size < 0)
 		return size;
 
@@ -977,7 +1218,8 @@ int pt_qry_decode_psb(struct pt_query_decoder *decoder)
 		/* Move back to the PSB so we have a chance to recover and
 		 * continue decoding.
 		 */
-		decoder->pos = pos;
+		(void) pt_scatter_seek(&decoder->pos, &decoder->config,
+				       &decoder->scatter, offset);
 
 		/* Clear any PSB+ events that have already been queued. */
 		(void) pt_evq_clear(&decoder->evq, evb_psbend);
@@ -1327,21 +1569,24 @@ static int scan_for_erratum_bdm70(struct pt_packet_decoder *decoder)
 }
 
 static int check_erratum_bdm70(const uint8_t *pos,
-			       const struct pt_config *config)
+			       const struct pt_query_decoder *qry)
 {
 	struct pt_packet_decoder decoder;
+	uint64_t offset;
 	int errcode;
 
-	if (!pos || !config)
+	if (!pos || !qry)
 		return -pte_internal;
 
-	errcode = pt_pkt_decoder_init(&decoder, config);
+	errcode = pt_scatter_offset(&offset, &qry->scatter, pos, &qry->config);
 	if (errcode < 0)
 		return errcode;
 
-	errcode = pt_pkt_sync_set(&decoder, (uint64_t) (pos - config->begin));
-	if (errcode >= 0)
-		errcode = scan_for_erratum_bdm70(&decoder);
+	errcode = pt_qry_pkt_decoder_init(&decoder, qry, offset);
+	if (errcode < 0)
+		return errcode;
+
+	errcode = scan_for_erratum_bdm70(&decoder);
 
 	pt_pkt_decoder_fini(&decoder);
 	return errcode;
@@ -1357,8 +1602,7 @@ int pt_qry_header_fup(struct pt_query_decoder *decoder)
 		return size;
 
 	if (decoder->config.errata.bdm70 && !decoder->enabled) {
-		errcode = check_erratum_bdm70(decoder->pos + size,
-					      &decoder->config);
+		errcode = check_erratum_bdm70(decoder->pos + size, decoder);
 		if (errcode < 0)
 			return errcode;
 
@@ -1472,9 +1716,16 @@ int pt_qry_decode_pip(struct pt_query_decoder *decoder)
 
 	/* Paging events are either standalone or bind to the same TIP packet
 	 * as an in-flight async branch event.
+	 *
+	 * Neither affects decoding so we may drop them right away.
 	 */
 	event = pt_evq_find(&decoder->evq, evb_tip, ptev_async_branch);
 	if (!event) {
+		if (!pt_qry_event_wanted(decoder, ptev_paging)) {
+			decoder->pos += size;
+			return 0;
+		}
+
 		event = pt_evq_standalone(&decoder->evq);
 		if (!event)
 			return -pte_internal;
@@ -1486,6 +1737,11 @@ int pt_qry_decode_pip(struct pt_query_decoder *decoder)
 
 		decoder->event = event;
 	} else {
+		if (!pt_qry_event_wanted(decoder, ptev_async_paging)) {
+			decoder->pos += size;
+			return 0;
+		}
+
 		event = pt_evq_enqueue(&decoder->evq, evb_tip);
 		if (!event)
 			return -pte_nomem;
@@ -1512,6 +1768,11 @@ int pt_qry_header_pip(struct pt_query_decoder *decoder)
 		return size;
 
 	/* Paging events are reported at the end of the PSB. */
+	if (!pt_qry_event_wanted(decoder, ptev_async_paging)) {
+		decoder->pos += size;
+		return 0;
+	}
+
 	event = pt_evq_enqueue(&decoder->evq, evb_psbend);
 	if (!event)
 		return -pte_nomem;
@@ -1576,6 +1837,10 @@ static int pt_qry_read_ahead_while(struct pt_query_decoder *decoder,
 		const struct pt_decoder_function *dfun;
 		int errcode;
 
+		errcode = pt_qry_normalize(decoder);
+		if (errcode < 0)
+			return errcode;
+
 		errcode = pt_df_fetch(&decoder->next, decoder->pos,
 				      &decoder->config);
 		if (errcode < 0)
@@ -1643,7 +1908,10 @@ static int skd010_recover(struct pt_query_decoder *decoder,
 		return -pte_bad_context;
 
 	/* We continue decoding at the given offset. */
-	decoder->pos = decoder->config.begin + offset;
+	errcode = pt_scatter_seek(&decoder->pos, &decoder->config,
+				  &decoder->scatter, offset);
+	if (errcode < 0)
+		return errcode;
 
 	/* Tracing is enabled. */
 	decoder->enabled = 1;
@@ -1737,8 +2005,13 @@ static int skd010_scan_for_ovf_resume(struct pt_packet_decoder *pkt,
 
 			decoder->time = time;
 			decoder->tcal = tcal;
-			decoder->pos = decoder->config.begin + offset
-				+ packet.size;
+
+			errcode = pt_scatter_seek(&decoder->pos,
+						  &decoder->config,
+						  &decoder->scatter,
+						  offset + packet.size);
+			if (errcode < 0)
+				return errcode;
 
 			/* Even though the erratum applies, tracing is disabled
 			 * at the time we're able to resync.  We can use the
@@ -1971,13 +2244,11 @@ static int pt_qry_handle_skd010(struct pt_query_decoder *decoder)
 	if (errcode < 0)
 		return errcode;
 
-	errcode = pt_pkt_decoder_init(&pkt, &decoder->config);
+	errcode = pt_qry_pkt_decoder_init(&pkt, decoder, offset);
 	if (errcode < 0)
 		return errcode;
 
-	errcode = pt_pkt_sync_set(&pkt, offset);
-	if (errcode >= 0)
-		errcode = skd010_scan_for_ovf_resume(&pkt, decoder);
+	errcode = skd010_scan_for_ovf_resume(&pkt, decoder);
 
 	pt_pkt_decoder_fini(&pkt);
 	return errcode;
@@ -2084,7 +2355,14 @@ static int pt_qry_decode_mode_exec(struct pt_query_decoder *decoder,
 {
 	struct pt_event *event;
 
-	/* MODE.EXEC binds to TIP. */
+	/* MODE.EXEC binds to TIP.
+	 *
+	 * The TIP is decoded the same with or without it so we may drop it
+	 * right away.
+	 */
+	if (!pt_qry_event_wanted(decoder, ptev_exec_mode))
+		return 0;
+
 	event = pt_evq_enqueue(&decoder->evq, evb_tip);
 	if (!event)
 		return -pte_nomem;
@@ -2104,6 +2382,9 @@ static int pt_qry_decode_mode_tsx(struct pt_query_decoder *decoder,
 
 	/* MODE.TSX is standalone if tracing is disabled. */
 	if (!decoder->enabled) {
+		if (!pt_qry_event_wanted(decoder, ptev_tsx))
+			return 0;
+
 		event = pt_evq_standalone(&decoder->evq);
 		if (!event)
 			return -pte_internal;
@@ -2115,7 +2396,11 @@ static int pt_qry_decode_mode_tsx(struct pt_query_decoder *decoder,
 		/* Publish the event. */
 		decoder->event = event;
 	} else {
-		/* MODE.TSX binds to FUP. */
+		/* MODE.TSX binds to FUP.
+		 *
+		 * We need the event even if our user is not interested in it.
+		 * Otherwise, we would mistake the FUP for an async branch.
+		 */
 		event = pt_evq_enqueue(&decoder->evq, evb_fup);
 		if (!event)
 			return -pte_nomem;
@@ -2161,12 +2446,28 @@ int pt_qry_header_mode(struct pt_query_decoder *decoder)
 {
 	struct pt_packet_mode packet;
 	struct pt_event *event;
-	int size;
+	int size, wanted;
 
 	size = pt_pkt_read_mode(&packet, decoder->pos, &decoder->config);
 	if (size < 0)
 		return size;
 
+	wanted = 1;
+	switch (packet.leaf) {
+	case pt_mol_exec:
+		wanted = pt_qry_event_wanted(decoder, ptev_exec_mode);
+		break;
+
+	case pt_mol_tsx:
+		wanted = pt_qry_event_wanted(decoder, ptev_tsx);
+		break;
+	}
+
+	if (!wanted) {
+		decoder->pos += size;
+		return 0;
+	}
+
 	/* Inside the header, events are reported at the end. */
 	event = pt_evq_enqueue(&decoder->evq, evb_psbend);
 	if (!event)
@@ -2397,6 +2698,11 @@ int pt_qry_decode_stop(struct pt_query_decoder *decoder)
 	struct pt_event *event;
 
 	/* Stop events are reported immediately. */
+	if (!pt_qry_event_wanted(decoder, ptev_stop)) {
+		decoder->pos += ptps_stop;
+		return 0;
+	}
+
 	event = pt_evq_standalone(&decoder->evq);
 	if (!event)
 		return -pte_internal;
@@ -2420,6 +2726,11 @@ int pt_qry_header_vmcs(struct pt_query_decoder *decoder)
 	if (size < 0)
 		return size;
 
+	if (!pt_qry_event_wanted(decoder, ptev_async_vmcs)) {
+		decoder->pos += size;
+		return 0;
+	}
+
 	event = pt_evq_enqueue(&decoder->evq, evb_psbend);
 	if (!event)
 		return -pte_nomem;
@@ -2446,6 +2757,20 @@ int pt_qry_decode_vmcs(struct pt_query_decoder *decoder)
 	 * In that case, the VMCS event should be applied first.  We reorder
 	 * events here to simplify the life of higher layers.
 	 */
+	event = pt_evq_find(&decoder->evq, evb_tip, ptev_async_paging);
+	if (!event)
+		event = pt_evq_find(&decoder->evq, evb_tip,
+				    ptev_async_branch);
+
+	/* Neither async nor standalone VMCS events affect decoding so we may
+	 * drop them right away.
+	 */
+	if (!pt_qry_event_wanted(decoder,
+				 event ? ptev_async_vmcs : ptev_vmcs)) {
+		decoder->pos += size;
+		return 0;
+	}
+
 	event = pt_evq_find(&decoder->evq, evb_tip, ptev_async_paging);
 	if (event) {
 		struct pt_event *paging;
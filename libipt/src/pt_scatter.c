@@ -0,0 +1,708 @@
+/*
+ * Copyright (c) 2014-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pt_scatter.h"
+#include "pt_sync.h"
+#include "pt_packet.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static uint64_t pt_scatter_window_size(const struct pt_scatter_window *window)
+{
+	return (uint64_t) (window->end - window->begin);
+}
+
+/* Return the trace offset at which @window's canonical range ends. */
+static uint64_t pt_scatter_window_limit(const struct pt_scatter_window *window)
+{
+	return window->offset + (uint64_t) (window->limit - window->begin);
+}
+
+/* Copy the trace bytes from @begin to @end into @buffer.
+ *
+ * The trace buffer parts must already have been set up in @window.
+ */
+static void pt_scatter_copy(uint8_t *buffer,
+			    const struct pt_scatter_window *window,
+			    uint32_t nwindows, uint64_t begin, uint64_t end)
+{
+	uint32_t idx;
+
+	/* The trace buffer parts are at even indices. */
+	for (idx = 0; (idx < nwindows) && (begin < end); idx += 2) {
+		const struct pt_scatter_window *part;
+		uint64_t wbegin, wend, size;
+
+		part = &window[idx];
+		wbegin = part->offset;
+		wend = wbegin + pt_scatter_window_size(part);
+
+		if (wend <= begin)
+			continue;
+
+		size = (end < wend ? end : wend) - begin;
+
+		memcpy(buffer, part->begin + (begin - wbegin), size);
+
+		buffer += size;
+		begin += size;
+	}
+}
+
+int pt_scatter_init(struct pt_scatter *scatter, struct pt_config *config)
+{
+	const struct pt_trace_part *parts;
+	struct pt_scatter_window *window;
+	uint32_t nparts, nwindows, idx, widx;
+	uint64_t offset;
+	uint8_t *stitch;
+
+	if (!scatter || !config)
+		return -pte_internal;
+
+	memset(scatter, 0, sizeof(*scatter));
+
+	/* Count the non-empty parts following the first part. */
+	parts = config->parts;
+	nparts = 0;
+	for (idx = 0; idx < config->nparts; ++idx) {
+		if (parts[idx].begin < parts[idx].end)
+			nparts += 1;
+	}
+
+	/* We're done if the trace buffer is contiguous. */
+	if (!nparts)
+		return 0;
+
+	/* Include the first part given by @config's begin and end fields.
+	 *
+	 * We need a stitch buffer between any two adjacent parts.
+	 */
+	nparts += 1;
+	nwindows = (2 * nparts) - 1;
+
+	window = malloc(nwindows * sizeof(*window));
+	if (!window)
+		return -pte_nomem;
+
+	stitch = malloc((nparts - 1) * pt_scatter_stitch_size);
+	if (!stitch) {
+		free(window);
+		return -pte_nomem;
+	}
+
+	memset(window, 0, nwindows * sizeof(*window));
+
+	/* Add the parts at even indices. */
+	window[0].begin = config->begin;
+	window[0].end = config->end;
+
+	offset = pt_scatter_window_size(&window[0]);
+	widx = 2;
+	for (idx = 0; idx < config->nparts; ++idx) {
+		if (parts[idx].end <= parts[idx].begin)
+			continue;
+
+		window[widx].begin = parts[idx].begin;
+		window[widx].end = parts[idx].end;
+		window[widx].offset = offset;
+
+		offset += pt_scatter_window_size(&window[widx]);
+		widx += 2;
+	}
+
+	/* Determine the canonical ranges and add the stitches in-between. */
+	for (idx = 0; idx < nwindows; idx += 2) {
+		struct pt_scatter_window *part, *stitcher;
+		uint64_t boundary, begin, end, limit;
+
+		part = &window[idx];
+		part->canonical = part->offset;
+
+		/* The last part extends to the end of the trace. */
+		if (idx + 1 == nwindows) {
+			part->limit = part->end;
+			break;
+		}
+
+		/* Positions close to the end of a part are represented in the
+		 * following stitch buffer.
+		 */
+		boundary = window[idx + 2].offset;
+
+		limit = part->offset;
+		if (limit + pt_scatter_overlap < boundary)
+			limit = boundary - pt_scatter_overlap;
+
+		part->limit = part->begin + (limit - part->offset);
+
+		begin = 0ull;
+		if (pt_scatter_overlap < boundary)
+			begin = boundary - pt_scatter_overlap;
+
+		end = boundary + pt_scatter_overlap;
+		if (offset < end)
+			end = offset;
+
+		stitcher = &window[idx + 1];
+		stitcher->begin = stitch + ((idx / 2) * pt_scatter_stitch_size);
+		stitcher->end = stitcher->begin + (end - begin);
+		stitcher->limit = stitcher->begin + (boundary - begin);
+		stitcher->offset = begin;
+		stitcher->canonical = limit;
+
+		pt_scatter_copy(stitcher->begin, window, nwindows, begin, end);
+	}
+
+	scatter->window = window;
+	scatter->stitch = stitch;
+	scatter->size = offset;
+	scatter->nwindows = nwindows;
+
+	config->begin = window[0].begin;
+	config->end = window[0].end;
+
+	return 0;
+}
+
+void pt_scatter_fini(struct pt_scatter *scatter)
+{
+	if (!scatter)
+		return;
+
+	free(scatter->window);
+	free(scatter->stitch);
+
+	memset(scatter, 0, sizeof(*scatter));
+}
+
+int pt_scatter_user_config(struct pt_config *config,
+			   const struct pt_scatter *scatter)
+{
+	const struct pt_scatter_window *window;
+
+	if (!config || !scatter)
+		return -pte_internal;
+
+	/* The first window is always the user's first trace buffer part. */
+	window = scatter->window;
+	if (window) {
+		config->begin = window->begin;
+		config->end = window->end;
+	}
+
+	return 0;
+}
+
+uint64_t pt_scatter_size(const struct pt_scatter *scatter,
+			 const struct pt_config *config)
+{
+	if (!scatter || !config)
+		return 0ull;
+
+	if (!scatter->window)
+		return (uint64_t) (config->end - config->begin);
+
+	return scatter->size;
+}
+
+int pt_scatter_offset(uint64_t *offset, const struct pt_scatter *scatter,
+		      const uint8_t *pos, const struct pt_config *config)
+{
+	const struct pt_scatter_window *window;
+
+	if (!offset || !scatter || !config)
+		return -pte_internal;
+
+	window = scatter->window;
+	if (!window) {
+		*offset = (uint64_t) (pos - config->begin);
+		return 0;
+	}
+
+	window += scatter->current;
+	if (pos < window->begin || window->end < pos)
+		return -pte_internal;
+
+	*offset = window->offset + (uint64_t) (pos - window->begin);
+	return 0;
+}
+
+int pt_scatter_sync_offset(uint64_t *offset, const struct pt_scatter *scatter,
+			   const uint8_t *sync, const struct pt_config *config)
+{
+	uint32_t idx;
+
+	if (!offset || !scatter || !config)
+		return -pte_internal;
+
+	if (!scatter->window) {
+		*offset = (uint64_t) (sync - config->begin);
+		return 0;
+	}
+
+	/* A synchronization point is at a canonical position, which lies
+	 * inside exactly one window.
+	 */
+	for (idx = 0; idx < scatter->nwindows; ++idx) {
+		const struct pt_scatter_window *window;
+
+		window = &scatter->window[idx];
+		if (sync < window->begin || window->end <= sync)
+			continue;
+
+		*offset = window->offset + (uint64_t) (sync - window->begin);
+		return 0;
+	}
+
+	return -pte_internal;
+}
+
+/* Find the window that contains @offset in its canonical range.
+ *
+ * Returns the window's index on success, a negative error code otherwise.
+ * Returns -pte_eos if @offset lies beyond the end of the trace.
+ */
+static int pt_scatter_find(const struct pt_scatter *scatter, uint64_t offset)
+{
+	const struct pt_scatter_window *window;
+	uint32_t idx, nwindows;
+
+	window = scatter->window;
+	nwindows = scatter->nwindows;
+
+	/* We're typically moving forward.  Start searching at the current
+	 * window.
+	 */
+	idx = scatter->current;
+	if (offset < window[idx].canonical)
+		idx = 0;
+
+	for (; idx < nwindows; ++idx) {
+		if (offset < pt_scatter_window_limit(&window[idx]))
+			return (int) idx;
+	}
+
+	/* The end of the trace is represented in the last window. */
+	if (offset == scatter->size)
+		return (int) (nwindows - 1);
+
+	return -pte_eos;
+}
+
+/* Move @scatter and @config to the window at index @idx. */
+static void pt_scatter_move(struct pt_config *config,
+			    struct pt_scatter *scatter, uint32_t idx)
+{
+	const struct pt_scatter_window *window;
+
+	window = &scatter->window[idx];
+
+	scatter->current = idx;
+	config->begin = window->begin;
+	config->end = window->end;
+}
+
+int pt_scatter_seek(const uint8_t **pos, struct pt_config *config,
+		    struct pt_scatter *scatter, uint64_t offset)
+{
+	const struct pt_scatter_window *window;
+	int idx;
+
+	if (!pos || !config || !scatter)
+		return -pte_internal;
+
+	if (!scatter->window) {
+		if ((uint64_t) (config->end - config->begin) < offset)
+			return -pte_eos;
+
+		*pos = config->begin + offset;
+		return 0;
+	}
+
+	idx = pt_scatter_find(scatter, offset);
+	if (idx < 0)
+		return idx;
+
+	pt_scatter_move(config, scatter, (uint32_t) idx);
+
+	window = &scatter->window[idx];
+	*pos = window->begin + (offset - window->offset);
+
+	return 0;
+}
+
+int pt_scatter_normalize(const uint8_t **pos, struct pt_config *config,
+			 struct pt_scatter *scatter)
+{
+	const struct pt_scatter_window *window;
+	uint32_t current;
+
+	if (!pos || !config || !scatter)
+		return -pte_internal;
+
+	window = scatter->window;
+	if (!window || !*pos)
+		return 0;
+
+	current = scatter->current;
+	window += current;
+
+	if (*pos < window->limit)
+		return 0;
+
+	/* The last window extends to the end of the trace. */
+	if (current + 1 == scatter->nwindows)
+		return 0;
+
+	return pt_scatter_seek(pos, config, scatter, window->offset +
+			       (uint64_t) (*pos - window->begin));
+}
+
+int pt_scatter_sync_set(const uint8_t **sync, struct pt_config *config,
+			struct pt_scatter *scatter, uint64_t offset)
+{
+	const struct pt_scatter_window *window;
+	struct pt_config wconfig;
+	const uint8_t *pos;
+	int idx, errcode;
+
+	if (!sync || !config || !scatter)
+		return -pte_internal;
+
+	if (!scatter->window) {
+		if ((uint64_t) (config->end - config->begin) < offset)
+			return -pte_eos;
+
+		return pt_sync_set(sync, config->begin + offset, config);
+	}
+
+	idx = pt_scatter_find(scatter, offset);
+	if (idx < 0)
+		return idx;
+
+	window = &scatter->window[idx];
+
+	wconfig = *config;
+	wconfig.begin = window->begin;
+	wconfig.end = window->end;
+
+	pos = window->begin + (offset - window->offset);
+
+	errcode = pt_sync_set(sync, pos, &wconfig);
+	if (errcode < 0)
+		return errcode;
+
+	pt_scatter_move(config, scatter, (uint32_t) idx);
+
+	return 0;
+}
+
+/* Provide the @size trace bytes at trace offset @offset.
+ *
+ * Searches for a window that contains all of them starting at window @*hint
+ * and updates @*hint to that window.
+ *
+ * Any range of up to ptps_psb bytes lies entirely inside some window.
+ *
+ * Returns a pointer to the bytes on success, NULL otherwise.
+ */
+static const uint8_t *pt_scatter_bytes(const struct pt_scatter *scatter,
+				       uint32_t *hint, uint64_t offset,
+				       uint64_t size)
+{
+	uint32_t delta, nwindows;
+
+	nwindows = scatter->nwindows;
+
+	/* We're typically moving sequentially.  Search outwards from @hint. */
+	for (delta = 0; delta < nwindows; ++delta) {
+		uint32_t idx[2];
+		int side;
+
+		idx[0] = *hint + delta;
+		idx[1] = *hint - delta;
+
+		for (side = 0; side < 2; ++side) {
+			const struct pt_scatter_window *window;
+
+			if (nwindows <= idx[side])
+				continue;
+
+			window = &scatter->window[idx[side]];
+			if (offset < window->offset)
+				continue;
+
+			if (pt_scatter_window_size(window) <
+			    (offset - window->offset) + size)
+				continue;
+
+			*hint = idx[side];
+			return window->begin + (offset - window->offset);
+		}
+	}
+
+	return NULL;
+}
+
+/* Read the 64bit word at trace offset @offset into @val.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_scatter_word(uint64_t *val, const struct pt_scatter *scatter,
+			   uint32_t *hint, uint64_t offset)
+{
+	const uint8_t *pos;
+
+	pos = pt_scatter_bytes(scatter, hint, offset, sizeof(*val));
+	if (!pos)
+		return -pte_internal;
+
+	memcpy(val, pos, sizeof(*val));
+	return 0;
+}
+
+/* Check whether the trace bytes at @offset are a pair of PSB payload bytes.
+ *
+ * Returns a positive integer if they are, zero otherwise.
+ */
+static int pt_scatter_is_psb_pair(const struct pt_scatter *scatter,
+				  uint32_t *hint, uint64_t offset)
+{
+	const uint8_t *pos;
+
+	pos = pt_scatter_bytes(scatter, hint, offset, 2ull);
+	if (!pos)
+		return 0;
+
+	return (pos[0] == pt_psb_hi) && (pos[1] == pt_psb_lo);
+}
+
+/* Find a PSB packet given trace offset @offset somewhere in its payload.
+ *
+ * This is pt_find_psb() for scattered trace buffers.
+ *
+ * Provides the trace offset of the PSB packet in @psb.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_nosync if this is not a PSB packet.
+ */
+static int pt_scatter_find_psb(uint64_t *psb, const struct pt_scatter *scatter,
+			       uint32_t *hint, uint64_t offset,
+			       const struct pt_config *config)
+{
+	const struct pt_scatter_window *window;
+	struct pt_config wconfig;
+	const uint8_t *pos;
+	int errcode;
+
+	/* Navigate to the end of the psb payload pattern.
+	 *
+	 * Beware that PSB is an extended opcode. We must not confuse the
+	 * extend opcode of the following packet as belonging to the PSB.
+	 */
+	pos = pt_scatter_bytes(scatter, hint, offset, 1ull);
+	if (!pos || *pos != pt_psb_hi)
+		offset++;
+
+	for (; (offset + 1) < scatter->size; offset += 2) {
+		if (!pt_scatter_is_psb_pair(scatter, hint, offset))
+			break;
+	}
+
+	/* Navigate to the expected beginning of the psb packet. */
+	if (offset < ptps_psb)
+		return -pte_nosync;
+
+	offset -= ptps_psb;
+
+	pos = pt_scatter_bytes(scatter, hint, offset, ptps_psb);
+	if (!pos)
+		return -pte_nosync;
+
+	/* Check that this is indeed a psb packet we're at. */
+	if (pos[0] != pt_opc_psb || pos[1] != pt_ext_psb)
+		return -pte_nosync;
+
+	window = &scatter->window[*hint];
+
+	wconfig = *config;
+	wconfig.begin = window->begin;
+	wconfig.end = window->end;
+
+	errcode = pt_pkt_read_psb(pos, &wconfig);
+	if (errcode < 0)
+		return -pte_nosync;
+
+	*psb = offset;
+	return 0;
+}
+
+/* Return the misalignment of trace offset @offset.
+ *
+ * We search for aligned 64bit words just like pt_sync_forward() and
+ * pt_sync_backward() do.  Where this matters, we would find different
+ * PSBs depending on the alignment.  We align offsets as if the trace
+ * buffer parts followed the first part contiguously in memory so a trace
+ * that is split into parts synchronizes onto the same PSBs as the
+ * contiguous trace.
+ */
+static uint64_t pt_scatter_misalignment(const struct pt_scatter *scatter,
+					uint64_t offset)
+{
+	uint64_t base;
+
+	base = (uint64_t) (uintptr_t) scatter->window[0].begin;
+
+	return (base + offset) % sizeof(uint64_t);
+}
+
+/* Check whether @val is a 64bit word's worth of psb payload pattern. */
+static int pt_scatter_is_psb_pattern(uint64_t val)
+{
+	return (val == psb_pattern[0]) || (val == psb_pattern[1]);
+}
+
+int pt_scatter_sync_forward(const uint8_t **sync, struct pt_config *config,
+			    struct pt_scatter *scatter, uint64_t offset)
+{
+	uint64_t pos, misalignment;
+	uint32_t hint;
+
+	if (!sync || !config || !scatter)
+		return -pte_internal;
+
+	if (!scatter->window) {
+		if ((uint64_t) (config->end - config->begin) < offset)
+			return -pte_internal;
+
+		return pt_sync_forward(sync, config->begin + offset, config);
+	}
+
+	if (scatter->size < offset)
+		return -pte_internal;
+
+	/* This is pt_sync_forward() on trace offsets.
+	 *
+	 * A PSB that starts before @offset is found if one of the aligned
+	 * words we search overlaps with its payload.
+	 */
+	pos = offset;
+	misalignment = pt_scatter_misalignment(scatter, pos);
+	if (misalignment)
+		pos += sizeof(uint64_t) - misalignment;
+
+	hint = scatter->current;
+	for (;;) {
+		uint64_t current, val, psb;
+		int errcode;
+
+		current = pos;
+
+		pos += sizeof(uint64_t);
+		if (scatter->size < pos)
+			return -pte_eos;
+
+		errcode = pt_scatter_word(&val, scatter, &hint, current);
+		if (errcode < 0)
+			return errcode;
+
+		if (!pt_scatter_is_psb_pattern(val))
+			continue;
+
+		/* We found a 64bit word's worth of psb payload pattern. */
+		errcode = pt_scatter_find_psb(&psb, scatter, &hint, pos,
+					      config);
+		if (errcode < 0)
+			continue;
+
+		return pt_scatter_seek(sync, config, scatter, psb);
+	}
+}
+
+int pt_scatter_sync_backward(const uint8_t **sync, struct pt_config *config,
+			     struct pt_scatter *scatter, uint64_t offset)
+{
+	uint64_t pos, misalignment;
+	uint32_t hint;
+
+	if (!sync || !config || !scatter)
+		return -pte_internal;
+
+	if (!scatter->window) {
+		if ((uint64_t) (config->end - config->begin) < offset)
+			return -pte_internal;
+
+		return pt_sync_backward(sync, config->begin + offset, config);
+	}
+
+	if (scatter->size < offset)
+		return -pte_internal;
+
+	/* This is pt_sync_backward() on trace offsets.
+	 *
+	 * The PSB we find may extend beyond @offset.
+	 */
+	misalignment = pt_scatter_misalignment(scatter, offset);
+	if (offset < misalignment)
+		return -pte_eos;
+
+	pos = offset - misalignment;
+
+	hint = scatter->current;
+	for (;;) {
+		uint64_t next, val, psb;
+		int errcode;
+
+		next = pos;
+
+		if (pos < sizeof(uint64_t))
+			return -pte_eos;
+
+		pos -= sizeof(uint64_t);
+
+		errcode = pt_scatter_word(&val, scatter, &hint, pos);
+		if (errcode < 0)
+			return errcode;
+
+		if (!pt_scatter_is_psb_pattern(val))
+			continue;
+
+		/* We found a 64bit word's worth of psb payload pattern. */
+		errcode = pt_scatter_find_psb(&psb, scatter, &hint, next,
+					      config);
+		if (errcode < 0)
+			continue;
+
+		return pt_scatter_seek(sync, config, scatter, psb);
+	}
+}
@@ -55,17 +55,40 @@ struct pt_section *pt_mk_section(const char *filename, uint64_t offset,
 				 uint64_t size)
 {
 	struct pt_section *section;
-	uint64_t fsize;
+	struct pt_file_id id;
 	void *status;
 	int errcode;
 
-	errcode = pt_section_mk_status(&status, &fsize, filename);
+	errcode = pt_section_mk_status(&status, &id, filename);
 	if (errcode < 0)
 		return NULL;
 
+	section = pt_mk_section_lazy(filename, offset, size, &id);
+	if (!section) {
+		free(status);
+		return NULL;
+	}
+
+	section->status = status;
+
+	return section;
+}
+
+struct pt_section *pt_mk_section_lazy(const char *filename, uint64_t offset,
+				      uint64_t size,
+				      const struct pt_file_id *id)
+{
+	struct pt_section *section;
+	uint64_t fsize;
+
+	if (!filename || !id)
+		return NULL;
+
+	fsize = id->size;
+
 	/* Fail if the requested @offset lies beyond the end of @file. */
 	if (fsize <= offset)
-		goto out_status;
+		return NULL;
 
 	/* Truncate @size so the entire range lies within @file. */
 	fsize -= offset;
@@ -74,32 +97,30 @@ struct pt_section *pt_mk_section(const char *filename, uint64_t offset,
 
 	section = malloc(sizeof(*section));
 	if (!section)
-		goto out_status;
+		return NULL;
 
 	memset(section, 0, sizeof(*section));
 
 	section->filename = dupstr(filename);
-	section->status = status;
 	section->offset = offset;
 	section->size = size;
+	section->id = *id;
 	section->ucount = 1;
 
 #if defined(FEATURE_THREADS)
+	{
+		int errcode;
 
-	errcode = mtx_init(&section->lock, mtx_plain);
-	if (errcode != thrd_success) {
-		free(section->filename);
-		free(section);
-		goto out_status;
+		errcode = mtx_init(&section->lock, mtx_plain);
+		if (errcode != thrd_success) {
+			free(section->filename);
+			free(section);
+			return NULL;
+		}
 	}
-
 #endif /* defined(FEATURE_THREADS) */
 
 	return section;
-
-out_status:
-	free(status);
-	return NULL;
 }
 
 int pt_section_lock(struct pt_section *section)
@@ -207,6 +228,22 @@ int pt_section_put(struct pt_section *section)
 	return 0;
 }
 
+int pt_section_advise(struct pt_section *section, uint32_t advice)
+{
+	int errcode;
+
+	if (!section)
+		return -pte_internal;
+
+	errcode = pt_section_lock(section);
+	if (errcode < 0)
+		return errcode;
+
+	section->advice |= advice;
+
+	return pt_section_unlock(section);
+}
+
 const char *pt_section_filename(const struct pt_section *section)
 {
 	if (!section)
@@ -223,6 +260,22 @@ uint64_t pt_section_size(const struct pt_section *section)
 	return section->size;
 }
 
+uint64_t pt_section_offset(const struct pt_section *section)
+{
+	if (!section)
+		return 0ull;
+
+	return section->offset;
+}
+
+const struct pt_file_id *pt_section_id(const struct pt_section *section)
+{
+	if (!section)
+		return NULL;
+
+	return &section->id;
+}
+
 int pt_section_unmap(struct pt_section *section)
 {
 	uint16_t mcount;
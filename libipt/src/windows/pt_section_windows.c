@@ -58,13 +58,14 @@ static int pt_sec_windows_fstat(const char *filename, struct _stat *stat)
 	return 0;
 }
 
-int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
+int pt_section_mk_status(void **pstatus, struct pt_file_id *id,
+			 const char *filename)
 {
 	struct pt_sec_windows_status *status;
 	struct _stat stat;
 	int errcode;
 
-	if (!pstatus || !psize)
+	if (!pstatus || !id)
 		return -pte_internal;
 
 	errcode = pt_sec_windows_fstat(filename, &stat);
@@ -81,7 +82,29 @@ int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
 	status->stat = stat;
 
 	*pstatus = status;
-	*psize = stat.st_size;
+	id->size = (uint64_t) stat.st_size;
+	id->mtime = (int64_t) stat.st_mtime;
+
+	return 0;
+}
+
+int pt_section_file_id(struct pt_file_id *id, const char *filename)
+{
+	struct _stat stat;
+	int errcode;
+
+	if (!id || !filename)
+		return -pte_internal;
+
+	errcode = pt_sec_windows_fstat(filename, &stat);
+	if (errcode < 0)
+		return errcode;
+
+	if (stat.st_size < 0)
+		return -pte_bad_image;
+
+	id->size = (uint64_t) stat.st_size;
+	id->mtime = (int64_t) stat.st_mtime;
 
 	return 0;
 }
@@ -100,8 +123,29 @@ static int check_file_status(struct pt_section *section, int fd)
 		return -pte_bad_image;
 
 	status = section->status;
-	if (!status)
-		return -pte_internal;
+	if (!status) {
+		/* A lazily created section takes the file status on first
+		 * map.  The file must not have changed since the section was
+		 * created.
+		 */
+		if (stat.st_size < 0)
+			return -pte_bad_image;
+
+		if ((uint64_t) stat.st_size != section->id.size)
+			return -pte_bad_image;
+
+		if ((int64_t) stat.st_mtime != section->id.mtime)
+			return -pte_bad_image;
+
+		status = malloc(sizeof(*status));
+		if (!status)
+			return -pte_nomem;
+
+		status->stat = stat;
+		section->status = status;
+
+		return 0;
+	}
 
 	if (stat.st_size != status->stat.st_size)
 		return -pte_bad_image;
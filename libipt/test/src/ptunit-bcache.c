@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ptunit.h"
+
+#include "pt_bcache.h"
+
+#include "intel-pt.h"
+
+#include <string.h>
+
+
+/* A test fixture providing a branch target cache. */
+struct bcache_fixture {
+	/* The cache. */
+	struct pt_bcache *bcache;
+
+	/* A test entry. */
+	struct pt_bcache_entry entry;
+
+	/* The test fixture initialization and finalization functions. */
+	struct ptunit_result (*init)(struct bcache_fixture *);
+	struct ptunit_result (*fini)(struct bcache_fixture *);
+};
+
+static struct ptunit_result bfix_init(struct bcache_fixture *bfix)
+{
+	bfix->bcache = pt_bcache_alloc();
+	ptu_ptr(bfix->bcache);
+
+	memset(&bfix->entry, 0, sizeof(bfix->entry));
+	bfix->entry.ip = 0x1000ull;
+	bfix->entry.ild.runtime_address = 0x1020ull;
+	bfix->entry.ild.length = 2;
+	bfix->entry.raw[0] = 0xeb;
+	bfix->entry.raw[1] = 0xfe;
+	bfix->entry.size = 2;
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bfix_fini(struct bcache_fixture *bfix)
+{
+	pt_bcache_free(bfix->bcache);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result free_null(void)
+{
+	pt_bcache_free(NULL);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result null(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	int errcode;
+
+	errcode = pt_bcache_lookup(NULL, &entry, 0x1000ull);
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_bcache_lookup(bfix->bcache, NULL, 0x1000ull);
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_bcache_add(NULL, &bfix->entry);
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_bcache_add(bfix->bcache, NULL);
+	ptu_int_eq(errcode, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result lookup_empty(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	int errcode;
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x0ull);
+	ptu_int_eq(errcode, -pte_nomap);
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x1000ull);
+	ptu_int_eq(errcode, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	uint8_t raw[] = { 0xeb, 0xfe };
+	int errcode;
+
+	bfix->entry.ild.itext = raw;
+
+	errcode = pt_bcache_add(bfix->bcache, &bfix->entry);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x1000ull);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(entry->ip, 0x1000ull);
+	ptu_uint_eq(entry->ild.runtime_address, 0x1020ull);
+	ptu_uint_eq(entry->ild.length, 2);
+	ptu_null(entry->ild.itext);
+	ptu_uint_eq(entry->size, 2);
+	ptu_uint_eq(entry->raw[0], 0xeb);
+	ptu_uint_eq(entry->raw[1], 0xfe);
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x1020ull);
+	ptu_int_eq(errcode, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_bad_size(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	int errcode;
+
+	bfix->entry.size = sizeof(bfix->entry.raw) + 1;
+
+	errcode = pt_bcache_add(bfix->bcache, &bfix->entry);
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x1000ull);
+	ptu_int_eq(errcode, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result replace(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	int errcode;
+
+	errcode = pt_bcache_add(bfix->bcache, &bfix->entry);
+	ptu_int_eq(errcode, 0);
+
+	bfix->entry.ild.runtime_address = 0x1040ull;
+
+	errcode = pt_bcache_add(bfix->bcache, &bfix->entry);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, 0x1000ull);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(entry->ild.runtime_address, 0x1040ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result conflict(struct bcache_fixture *bfix)
+{
+	const struct pt_bcache_entry *entry;
+	uint64_t ip, last;
+	int errcode, evicted;
+
+	/* Adding more entries than fit into the cache must evict some. */
+	last = bfix->entry.ip + pt_bcache_size;
+	for (ip = bfix->entry.ip; ip <= last; ++ip) {
+		bfix->entry.ip = ip;
+
+		errcode = pt_bcache_add(bfix->bcache, &bfix->entry);
+		ptu_int_eq(errcode, 0);
+	}
+
+	errcode = pt_bcache_lookup(bfix->bcache, &entry, last);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(entry->ip, last);
+
+	evicted = 0;
+	for (ip = last - pt_bcache_size; ip < last; ++ip) {
+		errcode = pt_bcache_lookup(bfix->bcache, &entry, ip);
+		if (errcode == -pte_nomap) {
+			evicted += 1;
+			continue;
+		}
+
+		ptu_int_eq(errcode, 0);
+		ptu_uint_eq(entry->ip, ip);
+	}
+
+	ptu_int_gt(evicted, 0);
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct bcache_fixture bfix;
+	struct ptunit_suite suite;
+
+	bfix.init = bfix_init;
+	bfix.fini = bfix_fini;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, free_null);
+	ptu_run_f(suite, null, bfix);
+	ptu_run_f(suite, lookup_empty, bfix);
+	ptu_run_f(suite, add, bfix);
+	ptu_run_f(suite, add_bad_size, bfix);
+	ptu_run_f(suite, replace, bfix);
+	ptu_run_f(suite, conflict, bfix);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptunit.h"
+
+#include "intel-pt.h"
+
+
+static void mk_insn(struct pt_insn *insn, uint64_t ip, uint8_t size,
+		    enum pt_insn_class iclass)
+{
+	uint8_t idx;
+
+	memset(insn, 0, sizeof(*insn));
+	insn->ip = ip;
+	insn->size = size;
+	insn->iclass = iclass;
+	insn->mode = ptem_64bit;
+
+	for (idx = 0; idx < size && idx < pt_max_insn_size; ++idx)
+		insn->raw[idx] = (uint8_t) (ip + idx);
+}
+
+static struct ptunit_result check_insn(const struct pt_insn *actual,
+				       const struct pt_insn *expected,
+				       int raw)
+{
+	ptu_uint_eq(actual->ip, expected->ip);
+	ptu_int_eq(actual->iclass, expected->iclass);
+	ptu_int_eq(actual->mode, expected->mode);
+	ptu_uint_eq(actual->size, expected->size);
+	ptu_uint_eq(actual->speculative, expected->speculative);
+	ptu_uint_eq(actual->aborted, expected->aborted);
+	ptu_uint_eq(actual->committed, expected->committed);
+	ptu_uint_eq(actual->disabled, expected->disabled);
+	ptu_uint_eq(actual->enabled, expected->enabled);
+	ptu_uint_eq(actual->resumed, expected->resumed);
+	ptu_uint_eq(actual->interrupted, expected->interrupted);
+	ptu_uint_eq(actual->resynced, expected->resynced);
+	ptu_uint_eq(actual->stopped, expected->stopped);
+
+	if (raw) {
+		int status;
+
+		status = memcmp(actual->raw, expected->raw, expected->size);
+		ptu_int_eq(status, 0);
+	} else
+		ptu_uint_eq(actual->raw[0], 0);
+
+	return ptu_passed();
+}
+
+/* Read the next non-sync record. */
+static int read_next(struct pt_bin_state *state, struct pt_bin_record *record,
+		     const uint8_t **pos, const uint8_t *end)
+{
+	for (;;) {
+		int size;
+
+		size = pt_bin_read(state, record, *pos, end);
+		if (size < 0)
+			return size;
+
+		*pos += size;
+
+		if (record->type != pbr_sync)
+			return 0;
+	}
+}
+
+static struct ptunit_result init_null(void)
+{
+	pt_bin_init(NULL);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result write_null(void)
+{
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	int status;
+
+	pt_bin_init(&state);
+	mk_insn(&insn, 0x1000ull, 1, ptic_other);
+
+	status = pt_bin_write_insn(NULL, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_write_insn(&state, NULL, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   NULL, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_write_error(NULL, buffer, buffer + sizeof(buffer),
+				    -pte_nomap, 0ull, 0ull);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_write_error(&state, NULL, buffer + sizeof(buffer),
+				    -pte_nomap, 0ull, 0ull);
+	ptu_int_eq(status, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result write_bad_insn(void)
+{
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	int status;
+
+	pt_bin_init(&state);
+
+	mk_insn(&insn, 0x1000ull, 0, ptic_other);
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	mk_insn(&insn, 0x1000ull, pt_max_insn_size + 1, ptic_other);
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	mk_insn(&insn, 0x1000ull, 1, (enum pt_insn_class) (ptic_far_jump + 1));
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	mk_insn(&insn, 0x1000ull, 1, ptic_other);
+	insn.mode = (enum pt_exec_mode) (ptem_64bit + 1);
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result write_eos(void)
+{
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	int status;
+
+	pt_bin_init(&state);
+	mk_insn(&insn, 0x1000ull, 1, ptic_other);
+
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer) - 1,
+				   &insn, 0);
+	ptu_int_eq(status, -pte_eos);
+	ptu_uint_eq(state.sync, 0);
+
+	status = pt_bin_write_error(&state, buffer,
+				    buffer + sizeof(buffer) - 1, -pte_nomap,
+				    0ull, 0ull);
+	ptu_int_eq(status, -pte_eos);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_null(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	uint8_t buffer[1];
+	int status;
+
+	pt_bin_init(&state);
+
+	status = pt_bin_read(NULL, &record, buffer, buffer + sizeof(buffer));
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_read(&state, NULL, buffer, buffer + sizeof(buffer));
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_bin_read(&state, &record, NULL, buffer + sizeof(buffer));
+	ptu_int_eq(status, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_empty(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	uint8_t buffer[1];
+	int status;
+
+	pt_bin_init(&state);
+
+	status = pt_bin_read(&state, &record, buffer, buffer);
+	ptu_int_eq(status, -pte_eos);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_nosync(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	uint8_t buffer[] = { ptic_other, 1 };
+	int status;
+
+	pt_bin_init(&state);
+
+	status = pt_bin_read(&state, &record, buffer, buffer + sizeof(buffer));
+	ptu_int_eq(status, -pte_nosync);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_bad(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	uint8_t buffer[] = {
+		0x0f, ptem_64bit, 0, 0x10, 0, 0, 0, 0, 0, 0,
+		ptic_far_jump + 1, 1,
+		0x80 | ptic_other, 1,
+		ptic_other, 0,
+		ptic_other, pt_max_insn_size + 1,
+		0x1f
+	};
+	const uint8_t *pos, *end;
+	int status;
+
+	pt_bin_init(&state);
+
+	pos = buffer;
+	end = buffer + sizeof(buffer);
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, 10);
+	ptu_int_eq(record.type, pbr_sync);
+	ptu_uint_eq(record.variant.sync.ip, 0x1000ull);
+	ptu_int_eq(record.variant.sync.mode, ptem_64bit);
+	pos += status;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_bad_opc);
+	pos += 2;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_bad_packet);
+	pos += 2;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_bad_packet);
+	pos += 2;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_bad_packet);
+	pos += 2;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_bad_packet);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result roundtrip(int raw)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	struct pt_insn insn[8];
+	uint8_t buffer[8 * pt_bin_max_record_size];
+	const uint8_t *pos, *end;
+	uint8_t *wpos;
+	int idx, status;
+
+	mk_insn(&insn[0], 0x1000ull, 1, ptic_other);
+	insn[0].enabled = 1;
+	mk_insn(&insn[1], 0x1001ull, 5, ptic_call);
+	mk_insn(&insn[2], 0x800ull, 15, ptic_cond_jump);
+	insn[2].speculative = 1;
+	insn[2].interrupted = 1;
+	mk_insn(&insn[3], 0x80full, 1, ptic_return);
+	insn[3].stopped = 1;
+	mk_insn(&insn[4], 0x1006ull, 2, ptic_jump);
+	insn[4].resynced = 1;
+	mk_insn(&insn[5], 0xffffffffffffff00ull, 3, ptic_far_call);
+	insn[5].aborted = 1;
+	insn[5].committed = 1;
+	mk_insn(&insn[6], 0x0ull, 4, ptic_far_return);
+	insn[6].resumed = 1;
+	mk_insn(&insn[7], 0x4ull, 7, ptic_far_jump);
+	insn[7].disabled = 1;
+
+	pt_bin_init(&state);
+
+	wpos = buffer;
+	for (idx = 0; idx < 8; ++idx) {
+		status = pt_bin_write_insn(&state, wpos,
+					   buffer + sizeof(buffer), &insn[idx],
+					   raw);
+		ptu_int_gt(status, 0);
+
+		wpos += status;
+	}
+
+	/* We have a single sync record and compress sequential IPs. */
+	if (!raw)
+		ptu_ptr_le(wpos, buffer + 10 + 8 * 7);
+
+	pt_bin_init(&state);
+
+	pos = buffer;
+	end = wpos;
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, 10);
+	ptu_int_eq(record.type, pbr_sync);
+	ptu_uint_eq(record.variant.sync.ip, 0x1000ull);
+
+	for (idx = 0; idx < 8; ++idx) {
+		status = read_next(&state, &record, &pos, end);
+		ptu_int_eq(status, 0);
+		ptu_int_eq(record.type, pbr_insn);
+		ptu_test(check_insn, &record.variant.insn, &insn[idx], raw);
+	}
+
+	ptu_ptr_eq(pos, end);
+
+	status = pt_bin_read(&state, &record, pos, end);
+	ptu_int_eq(status, -pte_eos);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result truncated(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	int size, status, wsize;
+
+	pt_bin_init(&state);
+
+	mk_insn(&insn, 0x1000ull, 3, ptic_jump);
+	insn.speculative = 1;
+	wsize = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				  &insn, 1);
+	ptu_int_gt(wsize, 10);
+
+	/* The instruction record follows the sync record. */
+	for (size = 10; size < wsize; ++size) {
+		pt_bin_init(&state);
+
+		status = pt_bin_read(&state, &record, buffer, buffer + 10);
+		ptu_int_eq(status, 10);
+
+		status = pt_bin_read(&state, &record, buffer + 10,
+				     buffer + size);
+		ptu_int_eq(status, -pte_eos);
+	}
+
+	for (size = 0; size < 10; ++size) {
+		pt_bin_init(&state);
+
+		status = pt_bin_read(&state, &record, buffer, buffer + size);
+		ptu_int_eq(status, -pte_eos);
+	}
+
+	return ptu_passed();
+}
+
+static struct ptunit_result error(void)
+{
+	struct pt_bin_record record;
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[3 * pt_bin_max_record_size];
+	const uint8_t *pos, *end;
+	uint8_t *wpos;
+	int status;
+
+	pt_bin_init(&state);
+
+	wpos = buffer;
+	mk_insn(&insn, 0x1000ull, 1, ptic_other);
+	status = pt_bin_write_insn(&state, wpos, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_gt(status, 0);
+	wpos += status;
+
+	status = pt_bin_write_error(&state, wpos, buffer + sizeof(buffer),
+				    -pte_nomap, 0x1234ull, 0x1001ull);
+	ptu_int_gt(status, 0);
+	wpos += status;
+
+	/* We need a new sync record after an error. */
+	status = pt_bin_write_insn(&state, wpos, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, 10 + 2);
+	wpos += status;
+
+	pt_bin_init(&state);
+
+	pos = buffer;
+	end = wpos;
+
+	status = read_next(&state, &record, &pos, end);
+	ptu_int_eq(status, 0);
+	ptu_int_eq(record.type, pbr_insn);
+
+	status = read_next(&state, &record, &pos, end);
+	ptu_int_eq(status, 0);
+	ptu_int_eq(record.type, pbr_error);
+	ptu_int_eq(record.variant.error.errcode, -pte_nomap);
+	ptu_uint_eq(record.variant.error.offset, 0x1234ull);
+	ptu_uint_eq(record.variant.error.ip, 0x1001ull);
+
+	status = read_next(&state, &record, &pos, end);
+	ptu_int_eq(status, 0);
+	ptu_int_eq(record.type, pbr_insn);
+	ptu_test(check_insn, &record.variant.insn, &insn, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sync_mode(void)
+{
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	int status;
+
+	pt_bin_init(&state);
+
+	mk_insn(&insn, 0x1000ull, 1, ptic_other);
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, 10 + 2);
+
+	mk_insn(&insn, 0x1001ull, 1, ptic_other);
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, 2);
+
+	mk_insn(&insn, 0x1002ull, 1, ptic_other);
+	insn.mode = ptem_32bit;
+	status = pt_bin_write_insn(&state, buffer, buffer + sizeof(buffer),
+				   &insn, 0);
+	ptu_int_eq(status, 10 + 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sync_period(void)
+{
+	struct pt_bin_state state;
+	struct pt_insn insn;
+	uint8_t buffer[pt_bin_max_record_size];
+	uint64_t ip;
+	int status, idx;
+
+	pt_bin_init(&state);
+
+	ip = 0x1000ull;
+	for (idx = 0; idx <= pt_bin_sync_period; ++idx, ++ip) {
+		mk_insn(&insn, ip, 1, ptic_other);
+		status = pt_bin_write_insn(&state, buffer,
+					   buffer + sizeof(buffer), &insn, 0);
+		if (!(idx % pt_bin_sync_period))
+			ptu_int_eq(status, 10 + 2);
+		else
+			ptu_int_eq(status, 2);
+	}
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct ptunit_suite suite;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, init_null);
+	ptu_run(suite, write_null);
+	ptu_run(suite, write_bad_insn);
+	ptu_run(suite, write_eos);
+	ptu_run(suite, read_null);
+	ptu_run(suite, read_empty);
+	ptu_run(suite, read_nosync);
+	ptu_run(suite, read_bad);
+	ptu_run_p(suite, roundtrip, 0);
+	ptu_run_p(suite, roundtrip, 1);
+	ptu_run(suite, truncated);
+	ptu_run(suite, error);
+	ptu_run(suite, sync_mode);
+	ptu_run(suite, sync_period);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
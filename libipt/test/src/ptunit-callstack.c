@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptunit.h"
+
+#include "pt_callstack.h"
+
+#include "intel-pt.h"
+
+
+static void mk_frame(struct pt_call_frame *frame, uint64_t idx)
+{
+	frame->call = 0x1000ull + idx;
+	frame->target = 0x2000ull + idx;
+	frame->ret = 0x3000ull + idx;
+}
+
+static struct ptunit_result check_frame(const struct pt_call_frame *frame,
+					uint64_t idx)
+{
+	ptu_uint_eq(frame->call, 0x1000ull + idx);
+	ptu_uint_eq(frame->target, 0x2000ull + idx);
+	ptu_uint_eq(frame->ret, 0x3000ull + idx);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init(void)
+{
+	struct pt_callstack callstack;
+	int depth;
+
+	memset(&callstack, 0xcd, sizeof(callstack));
+
+	pt_callstack_init(&callstack);
+
+	depth = pt_callstack_depth(&callstack);
+	ptu_int_eq(depth, 0);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_null(void)
+{
+	pt_callstack_init(NULL);
+	pt_callstack_fini(NULL);
+	pt_callstack_clear(NULL);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result push_null(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	mk_frame(&frame, 0);
+	pt_callstack_init(&callstack);
+
+	status = pt_callstack_push(NULL, &frame);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_callstack_push(&callstack, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result pop_null(void)
+{
+	int status;
+
+	status = pt_callstack_pop(NULL, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result pop_empty(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	mk_frame(&frame, 0);
+	status = pt_callstack_pop(&callstack, &frame);
+	ptu_int_eq(status, -pte_noip);
+	ptu_test(check_frame, &frame, 0);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result depth_null(void)
+{
+	int depth;
+
+	depth = pt_callstack_depth(NULL);
+	ptu_int_eq(depth, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result frame_null(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	status = pt_callstack_frame(NULL, &frame, 0);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_callstack_frame(&callstack, NULL, 0);
+	ptu_int_eq(status, -pte_internal);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result frame_empty(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	status = pt_callstack_frame(&callstack, &frame, 0);
+	ptu_int_eq(status, -pte_invalid);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result push_pop(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	mk_frame(&frame, 1);
+	status = pt_callstack_push(&callstack, &frame);
+	ptu_int_eq(status, 0);
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, 1);
+
+	memset(&frame, 0, sizeof(frame));
+	status = pt_callstack_pop(&callstack, &frame);
+	ptu_int_eq(status, 0);
+	ptu_test(check_frame, &frame, 1);
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, 0);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result frame_level(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	uint64_t idx;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	for (idx = 0; idx < 3; ++idx) {
+		mk_frame(&frame, idx);
+		status = pt_callstack_push(&callstack, &frame);
+		ptu_int_eq(status, 0);
+	}
+
+	for (idx = 0; idx < 3; ++idx) {
+		status = pt_callstack_frame(&callstack, &frame,
+					    (uint32_t) idx);
+		ptu_int_eq(status, 0);
+		ptu_test(check_frame, &frame, 2 - idx);
+	}
+
+	status = pt_callstack_frame(&callstack, &frame, 3);
+	ptu_int_eq(status, -pte_invalid);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result grow(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	uint64_t idx, depth;
+	int status;
+
+	pt_callstack_init(&callstack);
+	mk_frame(&frame, 0);
+
+	/* Wrap around before growing to check that the order is preserved. */
+	for (idx = 0; idx < pt_callstack_min / 2; ++idx) {
+		status = pt_callstack_push(&callstack, &frame);
+		ptu_int_eq(status, 0);
+	}
+
+	for (idx = 0; idx < pt_callstack_min / 2; ++idx) {
+		status = pt_callstack_pop(&callstack, NULL);
+		ptu_int_eq(status, 0);
+	}
+
+	depth = 4 * pt_callstack_min + 1;
+	for (idx = 0; idx < depth; ++idx) {
+		mk_frame(&frame, idx);
+		status = pt_callstack_push(&callstack, &frame);
+		ptu_int_eq(status, 0);
+	}
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, (int) depth);
+
+	status = pt_callstack_frame(&callstack, &frame, (uint32_t) depth - 1);
+	ptu_int_eq(status, 0);
+	ptu_test(check_frame, &frame, 0);
+
+	for (idx = depth; idx > 0;) {
+		idx -= 1;
+
+		status = pt_callstack_pop(&callstack, &frame);
+		ptu_int_eq(status, 0);
+		ptu_test(check_frame, &frame, idx);
+	}
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, 0);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result overflow(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	uint64_t idx;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	for (idx = 0; idx <= pt_callstack_max; ++idx) {
+		mk_frame(&frame, idx);
+		status = pt_callstack_push(&callstack, &frame);
+		ptu_int_eq(status, 0);
+	}
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, pt_callstack_max);
+
+	status = pt_callstack_frame(&callstack, &frame, 0);
+	ptu_int_eq(status, 0);
+	ptu_test(check_frame, &frame, pt_callstack_max);
+
+	/* The oldest frame has been dropped. */
+	status = pt_callstack_frame(&callstack, &frame, pt_callstack_max - 1);
+	ptu_int_eq(status, 0);
+	ptu_test(check_frame, &frame, 1);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result clear(void)
+{
+	struct pt_callstack callstack;
+	struct pt_call_frame frame;
+	int status;
+
+	pt_callstack_init(&callstack);
+
+	mk_frame(&frame, 0);
+	status = pt_callstack_push(&callstack, &frame);
+	ptu_int_eq(status, 0);
+
+	pt_callstack_clear(&callstack);
+
+	status = pt_callstack_depth(&callstack);
+	ptu_int_eq(status, 0);
+
+	status = pt_callstack_pop(&callstack, NULL);
+	ptu_int_eq(status, -pte_noip);
+
+	mk_frame(&frame, 1);
+	status = pt_callstack_push(&callstack, &frame);
+	ptu_int_eq(status, 0);
+
+	status = pt_callstack_frame(&callstack, &frame, 0);
+	ptu_int_eq(status, 0);
+	ptu_test(check_frame, &frame, 1);
+
+	pt_callstack_fini(&callstack);
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct ptunit_suite suite;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, init);
+	ptu_run(suite, init_null);
+	ptu_run(suite, push_null);
+	ptu_run(suite, pop_null);
+	ptu_run(suite, pop_empty);
+	ptu_run(suite, depth_null);
+	ptu_run(suite, frame_null);
+	ptu_run(suite, frame_empty);
+	ptu_run(suite, push_pop);
+	ptu_run(suite, frame_level);
+	ptu_run(suite, grow);
+	ptu_run(suite, overflow);
+	ptu_run(suite, clear);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
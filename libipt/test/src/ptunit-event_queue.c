@@ -168,7 +168,7 @@ static struct ptunit_result enqueue_all_dequeue(struct evq_fixture *efix,
 	struct pt_event *in[evq_max], *out[evq_max];
 	size_t idx;
 
-	ptu_uint_le(num, evq_max - 2);
+	ptu_uint_le(num, evq_max);
 
 	for (idx = 0; idx < num; ++idx) {
 		in[idx] = pt_evq_enqueue(&efix->evq, evb);
@@ -214,9 +214,9 @@ static struct ptunit_result overflow(struct evq_fixture *efix,
 	struct pt_event *in[evq_max], *out[evq_max], *ev;
 	size_t idx;
 
-	ptu_uint_le(num, evq_max - 2);
+	ptu_uint_le(num, evq_max);
 
-	for (idx = 0; idx < (evq_max - 2); ++idx) {
+	for (idx = 0; idx < evq_max; ++idx) {
 		in[idx] = pt_evq_enqueue(&efix->evq, evb);
 		ptu_ptr(in[idx]);
 	}
@@ -234,6 +234,73 @@ static struct ptunit_result overflow(struct evq_fixture *efix,
 	return ptu_passed();
 }
 
+static struct ptunit_result evq_fill(struct evq_fixture *efix,
+				     struct pt_event *out)
+{
+	int evb;
+
+	for (evb = 0; evb < evb_max; ++evb) {
+		size_t idx;
+
+		for (idx = 0; idx < evq_max; ++idx) {
+			struct pt_event *ev;
+
+			ev = pt_evq_enqueue(&efix->evq,
+					    (enum pt_event_binding) evb);
+			ptu_ptr(ev);
+			ptu_ptr_ne(ev, out);
+
+			ev->type = ptev_disabled;
+		}
+	}
+
+	return ptu_passed();
+}
+
+static struct ptunit_result dequeue_valid(struct evq_fixture *efix,
+					  enum pt_event_binding evb)
+{
+	struct pt_event *in, *out;
+
+	in = pt_evq_enqueue(&efix->evq, evb);
+	ptu_ptr(in);
+
+	in->type = ptev_enabled;
+
+	out = pt_evq_dequeue(&efix->evq, evb);
+	ptu_ptr_eq(out, in);
+
+	ptu_test(evq_fill, efix, out);
+	ptu_int_eq(out->type, ptev_enabled);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result standalone_full(struct evq_fixture *efix)
+{
+	struct pt_event *ev, *sev;
+
+	ev = pt_evq_standalone(&efix->evq);
+	ptu_ptr(ev);
+
+	ev->type = ptev_enabled;
+
+	ptu_test(evq_fill, efix, ev);
+	ptu_int_eq(ev->type, ptev_enabled);
+
+	sev = pt_evq_standalone(&efix->evq);
+	ptu_ptr(sev);
+	ptu_ptr_ne(sev, ev);
+	ptu_int_eq(sev->type, 0);
+	ptu_int_eq(ev->type, ptev_enabled);
+
+	ev = pt_evq_find(&efix->evq, evb_tip, ptev_disabled);
+	ptu_ptr(ev);
+	ptu_ptr_ne(ev, sev);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result clear_null(enum pt_event_binding evb)
 {
 	int errcode;
@@ -427,6 +494,11 @@ int main(int argc, char **argv)
 	ptu_run_fp(suite, overflow, efix, evb_tip, 2);
 	ptu_run_fp(suite, overflow, efix, evb_fup, 3);
 
+	ptu_run_fp(suite, dequeue_valid, efix, evb_psbend);
+	ptu_run_fp(suite, dequeue_valid, efix, evb_tip);
+	ptu_run_fp(suite, dequeue_valid, efix, evb_fup);
+	ptu_run_f(suite, standalone_full, efix);
+
 	ptu_run_p(suite, clear_null, evb_psbend);
 	ptu_run_p(suite, clear_null, evb_tip);
 	ptu_run_p(suite, clear_null, evb_fup);
@@ -464,7 +536,7 @@ int main(int argc, char **argv)
 
 	ptu_run_fp(suite, find, efix, evb_psbend, ptev_enabled, 0, 3);
 	ptu_run_fp(suite, find, efix, evb_tip, ptev_disabled, 2, 0);
-	ptu_run_fp(suite, find, efix, evb_fup, ptev_paging, 1, 4);
+	ptu_run_fp(suite, find, efix, evb_fup, ptev_paging, 1, 2);
 
 	ptunit_report(&suite);
 	return suite.nr_fails;
@@ -32,6 +32,11 @@
 
 #include <string.h>
 
+#if defined(PTUNIT_BENCH)
+# include <stdio.h>
+# include <time.h>
+#endif
+
 
 enum interest {
 	interesting = 1,
@@ -657,6 +662,503 @@ static struct ptunit_result evex_cutoff(void)
 	return ptu_passed();
 }
 
+static struct ptunit_result run_null(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = { 0x90 };
+	int errcode;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	errcode = pt_ild_run(NULL, &run, insn, sizeof(insn));
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_ild_run(&ild, NULL, insn, sizeof(insn));
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_ild_run(&ild, &run, NULL, sizeof(insn));
+	ptu_int_eq(errcode, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_no_mode(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = { 0x90 };
+	int errcode;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_unknown);
+
+	errcode = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_eq(errcode, -pte_bad_insn);
+	ptu_uint_eq(run.ninsn, 0ull);
+	ptu_uint_eq(run.size, 0ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_empty(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = { 0x90 };
+	int status;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, 0ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(run.ninsn, 0ull);
+	ptu_uint_eq(run.size, 0ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_branch(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = {
+		0x90,				/* nop */
+		0x48, 0x89, 0xe5,		/* mov %rsp, %rbp */
+		0x50,				/* push %rax */
+		0xe8, 0x10, 0x00, 0x00, 0x00,	/* call +0x10 */
+		0x90				/* nop */
+	};
+	int status;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_gt(status, 0);
+	ptu_uint_eq(run.ninsn, 4ull);
+	ptu_uint_eq(run.size, 10ull);
+	ptu_int_eq(ild.iclass, PTI_INST_CALL_E8);
+	ptu_uint_eq(ild.length, 5);
+	ptu_uint_eq(ild.runtime_address, pti_addr + 5ull);
+	ptu_uint_eq(ild.direct_target, pti_addr + 0x1aull);
+	ptu_uint_eq(ild.u.s.branch, 1);
+	ptu_uint_eq(ild.u.s.call, 1);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_first(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = { 0xc3, 0x90 };
+	int status;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_gt(status, 0);
+	ptu_uint_eq(run.ninsn, 1ull);
+	ptu_uint_eq(run.size, 1ull);
+	ptu_int_eq(ild.iclass, PTI_INST_RET_C3);
+	ptu_uint_eq(ild.runtime_address, pti_addr);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_end(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = {
+		0x90,				/* nop */
+		0x48, 0x89, 0xe5,		/* mov %rsp, %rbp */
+		0x50				/* push %rax */
+	};
+	int status;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(run.ninsn, 3ull);
+	ptu_uint_eq(run.size, 5ull);
+	ptu_int_eq(ild.iclass, PTI_INST_INVALID);
+	ptu_uint_eq(ild.length, 1);
+	ptu_uint_eq(ild.runtime_address, pti_addr + 4ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_cutoff(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[] = {
+		0x90,				/* nop */
+		0x48, 0x89			/* mov %rsp, %rbp (partial) */
+	};
+	int status;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(run.ninsn, 1ull);
+	ptu_uint_eq(run.size, 1ull);
+	ptu_uint_eq(ild.runtime_address, pti_addr);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result run_bad(void)
+{
+	struct pt_ild ild;
+	struct pt_ild_run run;
+	uint8_t insn[pt_max_insn_size + 1];
+	int status;
+
+	/* A nop followed by more prefixes than fit into an instruction. */
+	memset(insn, 0x66, sizeof(insn));
+	insn[0] = 0x90;
+
+	ptunit_ild_init(&ild, insn, sizeof(insn), ptem_64bit);
+
+	status = pt_ild_run(&ild, &run, insn, sizeof(insn));
+	ptu_int_eq(status, -pte_bad_insn);
+	ptu_uint_eq(run.ninsn, 1ull);
+	ptu_uint_eq(run.size, 1ull);
+
+	return ptu_passed();
+}
+
+/* A corpus of real 64-bit code.
+ *
+ * This is the .text of pt_last_ip.c and pt_time.c compiled with gcc -O2.
+ * Relocations are left unresolved; this does not affect instruction lengths.
+ */
+static const uint8_t corpus[] = {
+	0x48, 0x85, 0xff, 0x74, 0x0b, 0x80, 0x67, 0x08, 0xfc, 0x48, 0xc7, 0x07,
+	0x00, 0x00, 0x00, 0x00, 0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x0f, 0x1f, 0x40, 0x00, 0x48, 0x85, 0xf6, 0x74,
+	0x45, 0x0f, 0xb6, 0x46, 0x08, 0xa8, 0x01, 0x74, 0x13, 0xa8, 0x02, 0x75,
+	0x27, 0x48, 0x85, 0xff, 0x74, 0x06, 0x48, 0x8b, 0x06, 0x48, 0x89, 0x07,
+	0x31, 0xc0, 0xc3, 0x90, 0x48, 0x85, 0xff, 0x74, 0x07, 0x48, 0xc7, 0x07,
+	0x00, 0x00, 0x00, 0x00, 0xb8, 0xf5, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x0f,
+	0x1f, 0x44, 0x00, 0x00, 0x48, 0x85, 0xff, 0x74, 0x07, 0x48, 0xc7, 0x07,
+	0x00, 0x00, 0x00, 0x00, 0xb8, 0xf4, 0xff, 0xff, 0xff, 0xc3, 0xb8, 0xfe,
+	0xff, 0xff, 0xff, 0xc3, 0x48, 0x85, 0xff, 0x48, 0x89, 0xf8, 0x0f, 0x94,
+	0xc1, 0x48, 0x85, 0xf6, 0x0f, 0x94, 0xc2, 0x08, 0xd1, 0x0f, 0x85, 0xd9,
+	0x00, 0x00, 0x00, 0x83, 0x3e, 0x06, 0x0f, 0x87, 0xc0, 0x00, 0x00, 0x00,
+	0x8b, 0x16, 0x48, 0x8d, 0x3d, 0x00, 0x00, 0x00, 0x00, 0x48, 0x63, 0x14,
+	0x97, 0x48, 0x01, 0xfa, 0xff, 0xe2, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00,
+	0xb9, 0x01, 0x00, 0x00, 0x00, 0x8d, 0x14, 0x09, 0x0f, 0xb6, 0x48, 0x08,
+	0x83, 0xe1, 0xfd, 0x09, 0xd1, 0x88, 0x48, 0x08, 0x31, 0xc0, 0xc3, 0x90,
+	0x0f, 0xb7, 0x56, 0x08, 0x80, 0x48, 0x08, 0x01, 0x66, 0x89, 0x10, 0xeb,
+	0xe0, 0x0f, 0x1f, 0x00, 0x8b, 0x56, 0x08, 0x80, 0x48, 0x08, 0x01, 0x89,
+	0x10, 0xeb, 0xd2, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0xba, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x48, 0x8b, 0x76, 0x08, 0x48, 0x21,
+	0xf2, 0x48, 0x0f, 0xba, 0xe6, 0x2f, 0x73, 0x0d, 0x48, 0xba, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x48, 0x09, 0xf2, 0x80, 0x48, 0x08,
+	0x01, 0x48, 0x89, 0x10, 0xeb, 0x9f, 0x66, 0x90, 0x48, 0xba, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x48, 0x23, 0x10, 0x48, 0xbf, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x48, 0x23, 0x7e, 0x08, 0x48,
+	0x09, 0xfa, 0x80, 0x48, 0x08, 0x01, 0x48, 0x89, 0x10, 0xe9, 0x73, 0xff,
+	0xff, 0xff, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0x8b, 0x56, 0x08,
+	0xeb, 0xbf, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xb8, 0xfb, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xb8, 0xfe, 0xff, 0xff, 0xff, 0xc3, 0x48, 0x85,
+	0xff, 0x74, 0x0f, 0x66, 0x0f, 0xef, 0xc0, 0x0f, 0x11, 0x07, 0x0f, 0x11,
+	0x47, 0x10, 0x0f, 0x11, 0x47, 0x20, 0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xff, 0x74, 0x33, 0x48,
+	0x85, 0xc9, 0x74, 0x2e, 0x48, 0x8b, 0x01, 0x48, 0x89, 0x07, 0x48, 0x85,
+	0xf6, 0x74, 0x05, 0x8b, 0x41, 0x24, 0x89, 0x06, 0x48, 0x85, 0xd2, 0x74,
+	0x05, 0x8b, 0x41, 0x28, 0x89, 0x02, 0x0f, 0xb6, 0x41, 0x2d, 0x83, 0xe0,
+	0x01, 0x3c, 0x01, 0x19, 0xc0, 0x83, 0xe0, 0xf1, 0xc3, 0x0f, 0x1f, 0x44,
+	0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x90, 0x48, 0x85,
+	0xff, 0x74, 0x1b, 0x48, 0x85, 0xf6, 0x74, 0x16, 0xf6, 0x46, 0x2d, 0x02,
+	0x74, 0x20, 0x0f, 0xb6, 0x46, 0x2c, 0x89, 0x07, 0x31, 0xc0, 0xc3, 0x0f,
+	0x1f, 0x80, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xf0,
+	0xff, 0xff, 0xff, 0xc3, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x48, 0x85, 0xff, 0x74, 0x33, 0x48, 0x85, 0xf6, 0x74, 0x2e,
+	0x0f, 0xb6, 0x47, 0x2d, 0xf3, 0x0f, 0x7e, 0x06, 0x48, 0xc7, 0x47, 0x10,
+	0x00, 0x00, 0x00, 0x00, 0x48, 0xc7, 0x47, 0x24, 0x00, 0x00, 0x00, 0x00,
+	0x83, 0xe0, 0xfa, 0x66, 0x0f, 0x6c, 0xc0, 0x83, 0xc8, 0x01, 0x0f, 0x11,
+	0x07, 0x88, 0x47, 0x2d, 0x31, 0xc0, 0xc3, 0x0f, 0x1f, 0x00, 0xb8, 0xff,
+	0xff, 0xff, 0xff, 0xc3, 0x66, 0x90, 0x48, 0x85, 0xff, 0x74, 0x1b, 0x48,
+	0x85, 0xf6, 0x74, 0x16, 0x80, 0x4f, 0x2d, 0x02, 0x0f, 0xb6, 0x06, 0x88,
+	0x47, 0x2c, 0x31, 0xc0, 0xc3, 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x2e, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xf6, 0x48, 0x89, 0xf8,
+	0x0f, 0x94, 0xc1, 0x48, 0x85, 0xd2, 0x40, 0x0f, 0x94, 0xc7, 0x40, 0x08,
+	0xf9, 0x0f, 0x85, 0x8f, 0x00, 0x00, 0x00, 0x48, 0x85, 0xc0, 0x0f, 0x84,
+	0x86, 0x00, 0x00, 0x00, 0x0f, 0xb6, 0x78, 0x2d, 0x40, 0xf6, 0xc7, 0x01,
+	0x0f, 0x84, 0x80, 0x00, 0x00, 0x00, 0x0f, 0xb7, 0x4e, 0x02, 0x44, 0x0f,
+	0xb7, 0x06, 0xf3, 0x0f, 0x6f, 0x48, 0x08, 0xf3, 0x0f, 0x6f, 0x50, 0x08,
+	0x66, 0x48, 0x0f, 0x6e, 0xc1, 0x0f, 0xb6, 0x4a, 0x78, 0x89, 0xfa, 0x83,
+	0xca, 0x04, 0x66, 0x0f, 0x6c, 0xc0, 0x88, 0x50, 0x2d, 0xba, 0xff, 0xff,
+	0xff, 0xff, 0x66, 0x0f, 0xfb, 0xc8, 0x66, 0x0f, 0xd4, 0xc2, 0xd3, 0xe2,
+	0x66, 0x0f, 0xc6, 0xc8, 0x02, 0x0f, 0x11, 0x48, 0x08, 0xf7, 0xd2, 0x44,
+	0x21, 0xc2, 0x89, 0x50, 0x18, 0x8d, 0x51, 0x08, 0x83, 0xfa, 0x10, 0x77,
+	0x1f, 0xba, 0xff, 0x00, 0x00, 0x00, 0x83, 0xcf, 0x0c, 0xd3, 0xe2, 0x40,
+	0x88, 0x78, 0x2d, 0x44, 0x21, 0xc2, 0x66, 0x0f, 0x6e, 0xda, 0x66, 0x0f,
+	0x70, 0xc3, 0xe0, 0x66, 0x0f, 0xd6, 0x40, 0x1c, 0x31, 0xc0, 0xc3, 0x0f,
+	0x1f, 0x80, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x90, 0xb8, 0xfa, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x2e, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xf6, 0x0f, 0x94, 0xc0,
+	0x48, 0x85, 0xd2, 0x0f, 0x94, 0xc1, 0x08, 0xc8, 0x0f, 0x85, 0x3c, 0x01,
+	0x00, 0x00, 0x48, 0x85, 0xff, 0x0f, 0x84, 0x33, 0x01, 0x00, 0x00, 0x0f,
+	0xb6, 0x4f, 0x2d, 0x49, 0x89, 0xf1, 0x41, 0x89, 0xca, 0x89, 0xc8, 0x41,
+	0xc0, 0xea, 0x02, 0xc0, 0xe8, 0x03, 0x41, 0x83, 0xe2, 0x01, 0x83, 0xe0,
+	0x01, 0x83, 0xe1, 0x01, 0x74, 0x0c, 0x45, 0x84, 0xd2, 0x75, 0x07, 0x31,
+	0xc0, 0xc3, 0x0f, 0x1f, 0x40, 0x00, 0x44, 0x0f, 0xb6, 0xc0, 0x48, 0x8b,
+	0x77, 0x08, 0x44, 0x8b, 0x5f, 0x18, 0x55, 0x53, 0x0f, 0xb6, 0x6a, 0x78,
+	0x41, 0x0f, 0xb6, 0x01, 0x8b, 0x5f, 0x1c, 0x89, 0xe9, 0xd3, 0xe0, 0x48,
+	0x83, 0x7f, 0x10, 0x00, 0x74, 0x7c, 0x80, 0x4f, 0x2d, 0x08, 0x89, 0x47,
+	0x20, 0x48, 0xc7, 0x47, 0x10, 0x00, 0x00, 0x00, 0x00, 0xc7, 0x47, 0x18,
+	0x00, 0x00, 0x00, 0x00, 0x89, 0x47, 0x1c, 0xc7, 0x47, 0x28, 0x00, 0x00,
+	0x00, 0x00, 0x45, 0x85, 0xc0, 0x75, 0x73, 0x45, 0x84, 0xd2, 0x74, 0x47,
+	0xb8, 0x10, 0x00, 0x00, 0x00, 0x38, 0xc1, 0x0f, 0x42, 0xc8, 0xb8, 0x01,
+	0x00, 0x00, 0x00, 0xd3, 0xe0, 0x44, 0x39, 0xd8, 0x72, 0x74, 0x8b, 0x4a,
+	0x70, 0x44, 0x29, 0xd8, 0x8b, 0x52, 0x74, 0x85, 0xc9, 0x0f, 0x84, 0x99,
+	0x00, 0x00, 0x00, 0x85, 0xd2, 0x0f, 0x84, 0x91, 0x00, 0x00, 0x00, 0x48,
+	0x0f, 0xaf, 0xc2, 0x31, 0xd2, 0x48, 0xf7, 0xf1, 0x48, 0x01, 0xf0, 0x66,
+	0x48, 0x0f, 0x6e, 0xc0, 0x66, 0x0f, 0x6c, 0xc0, 0x0f, 0x11, 0x07, 0x31,
+	0xc0, 0x5b, 0x5d, 0xc3, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x44, 0x8b,
+	0x4f, 0x28, 0x45, 0x85, 0xc9, 0x0f, 0x85, 0x77, 0xff, 0xff, 0xff, 0x45,
+	0x85, 0xc0, 0x74, 0x36, 0xc7, 0x47, 0x18, 0x00, 0x00, 0x00, 0x00, 0x89,
+	0x47, 0x1c, 0x39, 0xd8, 0x73, 0x13, 0x8d, 0x4d, 0x08, 0x41, 0xb8, 0x01,
+	0x00, 0x00, 0x00, 0x41, 0xd3, 0xe0, 0x44, 0x01, 0xc0, 0x39, 0xd8, 0x72,
+	0x05, 0x29, 0xd8, 0xeb, 0x88, 0x90, 0x8b, 0x47, 0x24, 0x83, 0xc0, 0x01,
+	0x89, 0x47, 0x24, 0xb8, 0xfb, 0xff, 0xff, 0xff, 0xeb, 0xaf, 0x80, 0x4f,
+	0x2d, 0x08, 0x89, 0x47, 0x20, 0xc7, 0x47, 0x18, 0x00, 0x00, 0x00, 0x00,
+	0x89, 0x47, 0x1c, 0xe9, 0x4b, 0xff, 0xff, 0xff, 0x66, 0x2e, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0xb8, 0xf6, 0xff, 0xff, 0xff, 0xe9, 0x7f, 0xff, 0xff, 0xff, 0x48, 0x85,
+	0xf6, 0x49, 0x89, 0xf8, 0x48, 0x89, 0xcf, 0x0f, 0x94, 0xc0, 0x48, 0x85,
+	0xd2, 0x0f, 0x94, 0xc1, 0x08, 0xc8, 0x0f, 0x85, 0xa6, 0x00, 0x00, 0x00,
+	0x4d, 0x85, 0xc0, 0x0f, 0x84, 0x9d, 0x00, 0x00, 0x00, 0x48, 0x85, 0xff,
+	0x0f, 0x84, 0x8c, 0x00, 0x00, 0x00, 0x4c, 0x8b, 0x0e, 0x49, 0x8b, 0x70,
+	0x10, 0x48, 0x85, 0xf6, 0x74, 0x20, 0x49, 0x0f, 0xaf, 0xf9, 0x31, 0xc0,
+	0x48, 0xc1, 0xef, 0x08, 0x48, 0x01, 0xf7, 0x49, 0x89, 0x78, 0x10, 0x49,
+	0x03, 0x78, 0x08, 0x49, 0x89, 0x38, 0xc3, 0x0f, 0x1f, 0x80, 0x00, 0x00,
+	0x00, 0x00, 0x45, 0x8b, 0x50, 0x20, 0x41, 0x8b, 0x40, 0x1c, 0x41, 0x39,
+	0xc2, 0x74, 0xd3, 0x44, 0x39, 0xd0, 0x73, 0x18, 0x0f, 0xb6, 0x4a, 0x78,
+	0x41, 0xbb, 0x01, 0x00, 0x00, 0x00, 0x83, 0xc1, 0x08, 0x41, 0xd3, 0xe3,
+	0x44, 0x01, 0xd8, 0x44, 0x39, 0xd0, 0x72, 0x4a, 0x8b, 0x4a, 0x70, 0x8b,
+	0x52, 0x74, 0x85, 0xc9, 0x74, 0x3a, 0x85, 0xd2, 0x74, 0x36, 0x44, 0x29,
+	0xd0, 0x48, 0x0f, 0xaf, 0xc2, 0x31, 0xd2, 0x48, 0xf7, 0xf1, 0x31, 0xd2,
+	0x48, 0xc1, 0xe0, 0x08, 0x48, 0xf7, 0xf7, 0x49, 0x39, 0xc1, 0x4c, 0x0f,
+	0x42, 0xc8, 0x49, 0x29, 0xc1, 0xeb, 0x87, 0x0f, 0x1f, 0x80, 0x00, 0x00,
+	0x00, 0x00, 0x41, 0x83, 0x40, 0x28, 0x01, 0x31, 0xc0, 0xc3, 0xb8, 0xff,
+	0xff, 0xff, 0xff, 0xc3, 0xb8, 0xf6, 0xff, 0xff, 0xff, 0xc3, 0xb8, 0xfb,
+	0xff, 0xff, 0xff, 0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x0f, 0x1f, 0x00, 0x48, 0x85, 0xff, 0x74, 0x1b, 0x66,
+	0x0f, 0xef, 0xc0, 0x0f, 0x11, 0x07, 0x48, 0xc7, 0x47, 0x08, 0xff, 0xff,
+	0xff, 0xff, 0x0f, 0x11, 0x47, 0x10, 0x0f, 0x11, 0x47, 0x20, 0x0f, 0x11,
+	0x47, 0x30, 0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x0f, 0x1f, 0x40, 0x00, 0x48, 0x85, 0xff, 0x74, 0x1b, 0x48,
+	0x85, 0xf6, 0x74, 0x16, 0x48, 0x8b, 0x46, 0x08, 0x48, 0x39, 0x46, 0x10,
+	0x72, 0x1c, 0x48, 0x8b, 0x06, 0x48, 0x89, 0x07, 0x31, 0xc0, 0xc3, 0x0f,
+	0x1f, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x2e, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xf1, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85,
+	0xff, 0x74, 0x1a, 0x48, 0x89, 0x37, 0x48, 0x3b, 0x77, 0x08, 0x73, 0x04,
+	0x48, 0x89, 0x77, 0x08, 0x48, 0x39, 0x77, 0x10, 0x73, 0x04, 0x48, 0x89,
+	0x77, 0x10, 0x31, 0xc0, 0xc3, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3, 0x66,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85,
+	0xff, 0x74, 0x1b, 0x48, 0x85, 0xf6, 0x74, 0x16, 0x48, 0x8b, 0x06, 0x48,
+	0xc7, 0x47, 0x20, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89, 0x47, 0x18, 0x31,
+	0xc0, 0xc3, 0x0f, 0x1f, 0x40, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85,
+	0xff, 0x74, 0x7b, 0x48, 0x85, 0xf6, 0x74, 0x76, 0x48, 0x8b, 0x06, 0x48,
+	0x8b, 0x57, 0x18, 0x48, 0x8b, 0x4f, 0x20, 0x48, 0xc7, 0x47, 0x20, 0x00,
+	0x00, 0x00, 0x00, 0x48, 0x89, 0x47, 0x18, 0x48, 0x85, 0xd2, 0x74, 0x36,
+	0x48, 0x85, 0xc9, 0x74, 0x31, 0x48, 0x39, 0xd0, 0x72, 0x30, 0x48, 0x29,
+	0xd0, 0x48, 0x89, 0xc2, 0x48, 0xc1, 0xea, 0x38, 0x75, 0x44, 0x48, 0xc1,
+	0xe0, 0x08, 0x31, 0xd2, 0x48, 0xf7, 0xf1, 0x48, 0x89, 0x07, 0x48, 0x3b,
+	0x47, 0x08, 0x73, 0x04, 0x48, 0x89, 0x47, 0x08, 0x48, 0x39, 0x47, 0x10,
+	0x73, 0x04, 0x48, 0x89, 0x47, 0x10, 0x31, 0xc0, 0xc3, 0x90, 0x48, 0xbe,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x48, 0x01, 0xf0, 0x48,
+	0x39, 0xd0, 0x73, 0xbe, 0xb8, 0xfb, 0xff, 0xff, 0xff, 0xc3, 0x0f, 0x1f,
+	0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85,
+	0xff, 0x74, 0x53, 0x66, 0x0f, 0xef, 0xc0, 0x0f, 0x11, 0x07, 0x0f, 0x11,
+	0x47, 0x10, 0x48, 0xc7, 0x47, 0x08, 0xff, 0xff, 0xff, 0xff, 0x0f, 0x11,
+	0x47, 0x20, 0x0f, 0x11, 0x47, 0x30, 0x48, 0x85, 0xf6, 0x74, 0x33, 0x48,
+	0x85, 0xd2, 0x74, 0x2e, 0x0f, 0xb6, 0x42, 0x79, 0x48, 0x85, 0xc0, 0x74,
+	0x1c, 0x0f, 0xb6, 0x0e, 0x48, 0xc1, 0xe0, 0x08, 0x31, 0xd2, 0x48, 0xf7,
+	0xf1, 0x66, 0x48, 0x0f, 0x6e, 0xc0, 0x48, 0x89, 0x47, 0x10, 0x66, 0x0f,
+	0x6c, 0xc0, 0x0f, 0x11, 0x07, 0x31, 0xc0, 0xc3, 0x66, 0x0f, 0x1f, 0x44,
+	0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x90, 0x48, 0x85,
+	0xf6, 0x48, 0x89, 0xf9, 0x0f, 0x94, 0xc0, 0x48, 0x85, 0xd2, 0x40, 0x0f,
+	0x94, 0xc7, 0x40, 0x08, 0xf8, 0x75, 0x3b, 0x48, 0x85, 0xc9, 0x74, 0x36,
+	0x0f, 0xb6, 0x42, 0x79, 0x48, 0x85, 0xc0, 0x74, 0x23, 0x0f, 0xb6, 0x36,
+	0x48, 0xc1, 0xe0, 0x08, 0x31, 0xd2, 0x48, 0xf7, 0xf6, 0x48, 0x89, 0x01,
+	0x48, 0x3b, 0x41, 0x08, 0x73, 0x04, 0x48, 0x89, 0x41, 0x08, 0x48, 0x39,
+	0x41, 0x10, 0x73, 0x04, 0x48, 0x89, 0x41, 0x10, 0x31, 0xc0, 0xc3, 0x0f,
+	0x1f, 0x80, 0x00, 0x00, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x31, 0xc0,
+	0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x66, 0x90, 0x48, 0x85, 0xf6, 0x0f, 0x94, 0xc0, 0x48, 0x85, 0xd2, 0x0f,
+	0x94, 0xc1, 0x08, 0xc8, 0x0f, 0x85, 0xd4, 0x00, 0x00, 0x00, 0x48, 0x85,
+	0xff, 0x0f, 0x84, 0xcb, 0x00, 0x00, 0x00, 0x0f, 0xb6, 0x06, 0x0f, 0xb6,
+	0x4a, 0x78, 0x0f, 0xb6, 0x77, 0x38, 0x44, 0x8b, 0x4f, 0x30, 0x4c, 0x8b,
+	0x47, 0x28, 0xd3, 0xe0, 0x40, 0xf6, 0xc6, 0x01, 0x74, 0x78, 0x4d, 0x85,
+	0xc0, 0x75, 0x03, 0x31, 0xc0, 0xc3, 0x83, 0x47, 0x34, 0x01, 0x48, 0xc7,
+	0x47, 0x28, 0x00, 0x00, 0x00, 0x00, 0x89, 0x47, 0x30, 0x44, 0x39, 0xc8,
+	0x72, 0x74, 0x8b, 0x4a, 0x70, 0x8b, 0x52, 0x74, 0x85, 0xc9, 0x0f, 0x84,
+	0x8c, 0x00, 0x00, 0x00, 0x85, 0xd2, 0x0f, 0x84, 0x84, 0x00, 0x00, 0x00,
+	0x44, 0x29, 0xc8, 0x48, 0x0f, 0xaf, 0xc2, 0x31, 0xd2, 0x48, 0xf7, 0xf1,
+	0x48, 0x89, 0xc1, 0x48, 0xc1, 0xe9, 0x38, 0x75, 0x69, 0x48, 0xc1, 0xe0,
+	0x08, 0x31, 0xd2, 0x49, 0xf7, 0xf0, 0x48, 0x89, 0x07, 0x48, 0x3b, 0x47,
+	0x08, 0x73, 0x04, 0x48, 0x89, 0x47, 0x08, 0x48, 0x39, 0x47, 0x10, 0x73,
+	0x04, 0x48, 0x89, 0x47, 0x10, 0xc7, 0x47, 0x34, 0x00, 0x00, 0x00, 0x00,
+	0x31, 0xc0, 0xc3, 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x83, 0xce,
+	0x01, 0x89, 0x47, 0x30, 0x31, 0xc0, 0x48, 0xc7, 0x47, 0x28, 0x00, 0x00,
+	0x00, 0x00, 0x40, 0x88, 0x77, 0x38, 0xc3, 0x0f, 0x1f, 0x00, 0x83, 0xc1,
+	0x08, 0xbe, 0x01, 0x00, 0x00, 0x00, 0xd3, 0xe6, 0x01, 0xf0, 0x44, 0x39,
+	0xc8, 0x0f, 0x83, 0x77, 0xff, 0xff, 0xff, 0xb8, 0xfb, 0xff, 0xff, 0xff,
+	0xc3, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xc3,
+	0xb8, 0xf6, 0xff, 0xff, 0xff, 0xc3, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x48, 0x85, 0xff, 0x74, 0x23, 0x48,
+	0x85, 0xf6, 0x74, 0x1e, 0xf3, 0x0f, 0x7e, 0x06, 0xf3, 0x0f, 0x6f, 0x4f,
+	0x20, 0x31, 0xc0, 0x66, 0x0f, 0x6c, 0xc0, 0x66, 0x0f, 0xd4, 0xc1, 0x0f,
+	0x11, 0x47, 0x20, 0xc3, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0xb8, 0xff,
+	0xff, 0xff, 0xff, 0xc3,
+};
+
+/* The number of instructions in @corpus. */
+static const uint32_t corpus_ninsn = 647;
+
+/* Sweep @corpus once in 64-bit mode.
+ *
+ * Returns the number of instructions decoded on success, a negative error
+ * code otherwise.
+ */
+static int corpus_sweep(void)
+{
+	struct pt_ild ild;
+	uint32_t offset;
+	int ninsn;
+
+	memset(&ild, 0, sizeof(ild));
+	ild.mode = ptem_64bit;
+
+	ninsn = 0;
+	for (offset = 0; offset < sizeof(corpus); offset += ild.length) {
+		int errcode;
+
+		ild.itext = (uint8_t *) &corpus[offset];
+		ild.max_bytes = (uint8_t) (sizeof(corpus) - offset < 15 ?
+					   sizeof(corpus) - offset : 15);
+		ild.runtime_address = 0x1000ull + offset;
+
+		errcode = pt_instruction_length_decode(&ild);
+		if (errcode < 0)
+			return errcode;
+
+		(void) pt_instruction_decode(&ild);
+
+		ninsn += 1;
+	}
+
+	if (offset != sizeof(corpus))
+		return -pte_bad_insn;
+
+	return ninsn;
+}
+
+static struct ptunit_result corpus_decode(void)
+{
+	int ninsn;
+
+	ninsn = corpus_sweep();
+	ptu_int_eq(ninsn, (int) corpus_ninsn);
+
+	return ptu_passed();
+}
+
+/* Sweep @corpus once in 64-bit mode using instruction runs.
+ *
+ * Returns the number of instructions decoded on success, a negative error
+ * code otherwise.
+ */
+static int corpus_sweep_runs(void)
+{
+	struct pt_ild ild;
+	uint64_t ninsn, offset;
+
+	memset(&ild, 0, sizeof(ild));
+	ild.mode = ptem_64bit;
+
+	for (ninsn = 0ull, offset = 0ull; offset < sizeof(corpus);) {
+		struct pt_ild_run run;
+		int status;
+
+		ild.runtime_address = 0x1000ull + offset;
+
+		status = pt_ild_run(&ild, &run, &corpus[offset],
+				    sizeof(corpus) - offset);
+		if (status < 0)
+			return status;
+
+		if (!run.ninsn)
+			return -pte_bad_insn;
+
+		ninsn += run.ninsn;
+		offset += run.size;
+	}
+
+	if (offset != sizeof(corpus))
+		return -pte_bad_insn;
+
+	return (int) ninsn;
+}
+
+static struct ptunit_result corpus_run(void)
+{
+	int ninsn;
+
+	ninsn = corpus_sweep_runs();
+	ptu_int_eq(ninsn, (int) corpus_ninsn);
+
+	return ptu_passed();
+}
+
+#if defined(PTUNIT_BENCH)
+
+/* Measure decode throughput on @corpus.
+ *
+ * This does not fail on slow decodes; it only reports the throughput.
+ */
+static struct ptunit_result corpus_bench(int (*sweep)(void),
+					 const char *name)
+{
+	clock_t begin, end;
+	double seconds;
+	int iter;
+
+	begin = clock();
+	for (iter = 0; iter < 2000; ++iter) {
+		int ninsn;
+
+		ninsn = sweep();
+		ptu_int_eq(ninsn, (int) corpus_ninsn);
+	}
+	end = clock();
+
+	seconds = (double) (end - begin) / CLOCKS_PER_SEC;
+	if (seconds > 0.0)
+		fprintf(stdout, "%s: %.1f M insn/s, %.1f MB/s\n", name,
+			(iter * (double) corpus_ninsn) / seconds / 1e6,
+			(iter * (double) sizeof(corpus)) / seconds / 1e6);
+
+	return ptu_passed();
+}
+
+#endif /* defined(PTUNIT_BENCH) */
+
 int main(int argc, char **argv)
 {
 	struct ptunit_suite suite;
@@ -721,6 +1223,21 @@ int main(int argc, char **argv)
 	ptu_run(suite, vpshufb);
 	ptu_run(suite, bound);
 	ptu_run(suite, evex_cutoff);
+	ptu_run(suite, run_null);
+	ptu_run(suite, run_no_mode);
+	ptu_run(suite, run_empty);
+	ptu_run(suite, run_branch);
+	ptu_run(suite, run_first);
+	ptu_run(suite, run_end);
+	ptu_run(suite, run_cutoff);
+	ptu_run(suite, run_bad);
+	ptu_run(suite, corpus_decode);
+	ptu_run(suite, corpus_run);
+
+#if defined(PTUNIT_BENCH)
+	ptu_run_p(suite, corpus_bench, corpus_sweep, "ild");
+	ptu_run_p(suite, corpus_bench, corpus_sweep_runs, "ild run");
+#endif /* defined(PTUNIT_BENCH) */
 
 	ptunit_report(&suite);
 	return suite.nr_fails;
@@ -29,6 +29,7 @@
 #include "ptunit.h"
 
 #include "pt_image.h"
+#include "pt_bcache.h"
 #include "pt_section.h"
 #include "pt_mapped_section.h"
 
@@ -95,6 +96,14 @@ uint64_t pt_section_size(const struct pt_section *section)
 	return section->size;
 }
 
+uint64_t pt_section_offset(const struct pt_section *section)
+{
+	if (!section)
+		return 0ull;
+
+	return section->offset;
+}
+
 struct pt_section *pt_mk_section(const char *file, uint64_t offset,
 				 uint64_t size)
 {
@@ -106,6 +115,44 @@ struct pt_section *pt_mk_section(const char *file, uint64_t offset,
 	return NULL;
 }
 
+struct pt_section *pt_mk_section_lazy(const char *file, uint64_t offset,
+				      uint64_t size,
+				      const struct pt_file_id *id)
+{
+	(void) file;
+	(void) offset;
+	(void) size;
+	(void) id;
+
+	/* This function is not used by our tests. */
+	return NULL;
+}
+
+int pt_section_file_id(struct pt_file_id *id, const char *filename)
+{
+	if (!id || !filename)
+		return -pte_internal;
+
+	/* Our test files all have the size of struct ifix_mapping's content.
+	 * Other files do not exist.
+	 */
+	if (strncmp(filename, "file-", 5) != 0)
+		return -pte_bad_image;
+
+	id->size = 0x10ull;
+	id->mtime = 0ll;
+	return 0;
+}
+
+int pt_section_advise(struct pt_section *section, uint32_t advice)
+{
+	if (!section)
+		return -pte_internal;
+
+	section->advice |= advice;
+	return 0;
+}
+
 int pt_section_get(struct pt_section *section)
 {
 	if (!section)
@@ -301,6 +348,35 @@ static int image_readmem_callback(uint8_t *buffer, size_t size,
 	return (int) idx;
 }
 
+/* A test block read memory callback.
+ *
+ * Provides memory in [0x4000; 0x5800) with each byte holding the low byte of
+ * its address.  Counts the number of calls in @context.
+ */
+static int image_block_callback(uint8_t *buffer, size_t size,
+				const struct pt_asid *asid,
+				uint64_t ip, void *context)
+{
+	int *calls;
+	size_t idx;
+
+	(void) asid;
+
+	calls = (int *) context;
+	if (!buffer || !calls)
+		return -pte_invalid;
+
+	*calls += 1;
+
+	if (ip < 0x4000ull || 0x5800ull <= ip)
+		return -pte_nomap;
+
+	for (idx = 0; idx < size && (ip + idx) < 0x5800ull; ++idx)
+		buffer[idx] = (uint8_t) (ip + idx);
+
+	return (int) idx;
+}
+
 static struct ptunit_result init(void)
 {
 	struct pt_image image;
@@ -309,7 +385,10 @@ static struct ptunit_result init(void)
 
 	pt_image_init(&image, NULL);
 	ptu_null(image.name);
-	ptu_null(image.sections);
+	ptu_null(image.shared.sections);
+	ptu_uint_eq(image.shared.cr3, pt_asid_no_cr3);
+	ptu_uint_eq(image.current.cr3, pt_asid_no_cr3);
+	ptu_null(image.current.space);
 	ptu_null((void *) (uintptr_t) image.readmem.callback);
 	ptu_null(image.readmem.context);
 
@@ -322,7 +401,7 @@ static struct ptunit_result init_name(struct image_fixture *ifix)
 
 	pt_image_init(&ifix->image, "image-name");
 	ptu_str_eq(ifix->image.name, "image-name");
-	ptu_null(ifix->image.sections);
+	ptu_null(ifix->image.shared.sections);
 	ptu_null((void *) (uintptr_t) ifix->image.readmem.callback);
 	ptu_null(ifix->image.readmem.context);
 
@@ -491,6 +570,152 @@ static struct ptunit_result adjacent(struct image_fixture *ifix)
 	return ptu_passed();
 }
 
+static struct ptunit_result add_file_shared(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	uint16_t ucount;
+	int status;
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	ucount = ifix->section[0].ucount;
+
+	status = pt_image_add_file(&ifix->image, "file-0", 0ull,
+				   ifix->section[0].size, &ifix->asid[1],
+				   0x2000ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(ifix->section[0].ucount, ucount + 1);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x2003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_file_not_shared(struct image_fixture *ifix)
+{
+	uint16_t ucount;
+	int status;
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	ucount = ifix->section[0].ucount;
+
+	/* Our pt_mk_section() fails so we know we did not share. */
+	status = pt_image_add_file(&ifix->image, "file-0", 1ull,
+				   ifix->section[0].size - 1, &ifix->asid[1],
+				   0x2000ull);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_image_add_file(&ifix->image, "file-1", 0ull,
+				   ifix->section[0].size, &ifix->asid[1],
+				   0x2000ull);
+	ptu_int_eq(status, -pte_invalid);
+	ptu_uint_eq(ifix->section[0].ucount, ucount);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_file_segments_null(void)
+{
+	struct pt_file_segment segment;
+	struct pt_image image;
+	int status;
+
+	memset(&segment, 0, sizeof(segment));
+
+	status = pt_image_add_file_segments(NULL, "file-0", &segment, 1, NULL);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_image_add_file_segments(&image, NULL, &segment, 1, NULL);
+	ptu_int_eq(status, -pte_invalid);
+
+	status = pt_image_add_file_segments(&image, "file-0", NULL, 1, NULL);
+	ptu_int_eq(status, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_file_segments_bad_file(
+	struct image_fixture *ifix)
+{
+	struct pt_file_segment segment;
+	int status;
+
+	memset(&segment, 0, sizeof(segment));
+
+	status = pt_image_add_file_segments(&ifix->image, "bad-file", &segment,
+					    1, NULL);
+	ptu_int_eq(status, -pte_invalid);
+	ptu_int_eq(segment.status, -pte_invalid);
+	ptu_null(ifix->image.shared.sections);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_file_segments_none(struct image_fixture *ifix)
+{
+	int status;
+
+	status = pt_image_add_file_segments(&ifix->image, "file-0", NULL, 0,
+					    NULL);
+	ptu_int_eq(status, 0);
+	ptu_null(ifix->image.shared.sections);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_file_segments(struct image_fixture *ifix)
+{
+	struct pt_file_segment segment[3];
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	uint16_t ucount;
+	int status;
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	ucount = ifix->section[0].ucount;
+
+	/* This one shares section[0]. */
+	segment[0].offset = 0ull;
+	segment[0].size = ifix->section[0].size;
+	segment[0].vaddr = 0x2000ull;
+
+	/* This one lies beyond the end of the file. */
+	segment[1].offset = ifix->section[0].size;
+	segment[1].size = 1ull;
+	segment[1].vaddr = 0x4000ull;
+
+	/* This one overlaps with the first. */
+	segment[2] = segment[0];
+	segment[2].vaddr = 0x2008ull;
+
+	status = pt_image_add_file_segments(&ifix->image, "file-0", segment, 3,
+					    &ifix->asid[1]);
+	ptu_int_eq(status, 2);
+	ptu_int_eq(segment[0].status, 0);
+	ptu_int_eq(segment[1].status, -pte_invalid);
+	ptu_int_eq(segment[2].status, -pte_bad_image);
+	ptu_uint_eq(ifix->section[0].ucount, ucount + 1);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x2005ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x05);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result read(struct image_fixture *ifix)
 {
 	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
@@ -561,115 +786,419 @@ static struct ptunit_result read_null_asid(struct image_fixture *ifix)
 	return ptu_passed();
 }
 
-static struct ptunit_result read_callback(struct image_fixture *ifix)
+static struct ptunit_result read_shared(struct image_fixture *ifix)
 {
-	uint8_t memory[] = { 0xdd, 0x01, 0x02, 0xdd };
-	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	struct pt_asid asid;
 	int status;
 
-	status = pt_image_set_callback(&ifix->image, image_readmem_callback,
-				       memory);
+	pt_asid_init(&asid);
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
 	ptu_int_eq(status, 0);
 
-	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
-			       0x3001ull);
-	ptu_int_eq(status, 2);
-	ptu_uint_eq(buffer[0], 0x01);
-	ptu_uint_eq(buffer[1], 0x02);
-	ptu_uint_eq(buffer[2], 0xcc);
+	status = pt_image_add(&ifix->image, &ifix->section[1], &asid,
+			      0x2000ull);
+	ptu_int_eq(status, 0);
 
-	return ptu_passed();
-}
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x2003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+	ptu_uint_eq(buffer[1], 0xcc);
 
-static struct ptunit_result read_nomem(struct image_fixture *ifix)
-{
-	uint8_t buffer[] = { 0xcc, 0xcc };
-	int status;
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x2004ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x04);
+	ptu_uint_eq(buffer[1], 0xcc);
 
-	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
-			       &ifix->asid[1], 0x1010ull);
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x1004ull);
 	ptu_int_eq(status, -pte_nomap);
-	ptu_uint_eq(buffer[0], 0xcc);
+	ptu_uint_eq(buffer[0], 0x04);
 	ptu_uint_eq(buffer[1], 0xcc);
 
 	return ptu_passed();
 }
 
-static struct ptunit_result read_truncated(struct image_fixture *ifix)
+static struct ptunit_result read_no_cr3(struct image_fixture *ifix)
 {
 	uint8_t buffer[] = { 0xcc, 0xcc };
+	struct pt_asid asid;
 	int status;
 
-	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
-			       &ifix->asid[0], 0x100full);
+	pt_asid_init(&asid);
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_add(&ifix->image, &ifix->section[1], &ifix->asid[1],
+			      0x2000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &asid, 0x2002ull);
 	ptu_int_eq(status, 1);
-	ptu_uint_eq(buffer[0], 0x0f);
+	ptu_uint_eq(buffer[0], 0x02);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &asid, 0x1003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
 	ptu_uint_eq(buffer[1], 0xcc);
 
 	return ptu_passed();
 }
 
-static struct ptunit_result remove_section(struct image_fixture *ifix)
+static struct ptunit_result read_switch(struct image_fixture *ifix)
 {
-	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	uint8_t buffer[] = { 0xcc, 0xcc };
 	int status;
 
-	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
-			       0x1001ull);
-	ptu_int_eq(status, 2);
-	ptu_uint_eq(buffer[0], 0x01);
-	ptu_uint_eq(buffer[1], 0x02);
-	ptu_uint_eq(buffer[2], 0xcc);
-
-	status = pt_image_remove(&ifix->image, &ifix->section[0],
-				 &ifix->asid[0], 0x1000ull);
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
 	ptu_int_eq(status, 0);
 
-	ptu_int_ne(ifix->status[0].deleted, 0);
-	ptu_int_eq(ifix->status[1].deleted, 0);
-
-	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
-			       &ifix->asid[0], 0x1003ull);
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x1002ull);
 	ptu_int_eq(status, -pte_nomap);
-	ptu_uint_eq(buffer[0], 0x01);
-	ptu_uint_eq(buffer[1], 0x02);
-	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_uint_eq(ifix->image.current.cr3, ifix->asid[1].cr3);
+	ptu_null(ifix->image.current.space);
 
-	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[1],
-			       0x2003ull);
-	ptu_int_eq(status, 2);
+	/* Adding a section to the current address space must be noticed. */
+	status = pt_image_add(&ifix->image, &ifix->section[1], &ifix->asid[1],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x1002ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x02);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x1003ull);
+	ptu_int_eq(status, 1);
 	ptu_uint_eq(buffer[0], 0x03);
-	ptu_uint_eq(buffer[1], 0x04);
-	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_uint_eq(buffer[1], 0xcc);
+	ptu_uint_eq(ifix->image.current.cr3, ifix->asid[0].cr3);
+	ptu_ptr(ifix->image.current.space);
 
 	return ptu_passed();
 }
 
-static struct ptunit_result remove_bad_vaddr(struct image_fixture *ifix)
+static struct ptunit_result overlap_shared(struct image_fixture *ifix)
 {
-	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	struct pt_asid asid;
 	int status;
 
-	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
-			       0x1001ull);
-	ptu_int_eq(status, 2);
-	ptu_uint_eq(buffer[0], 0x01);
-	ptu_uint_eq(buffer[1], 0x02);
-	ptu_uint_eq(buffer[2], 0xcc);
+	pt_asid_init(&asid);
 
-	status = pt_image_remove(&ifix->image, &ifix->section[0],
-				 &ifix->asid[0], 0x2000ull);
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[1],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_add(&ifix->image, &ifix->section[1], &asid,
+			      0x1008ull);
 	ptu_int_eq(status, -pte_bad_image);
 
-	ptu_int_eq(ifix->status[0].deleted, 0);
-	ptu_int_eq(ifix->status[1].deleted, 0);
+	status = pt_image_add(&ifix->image, &ifix->section[1], &asid,
+			      0x2000ull);
+	ptu_int_eq(status, 0);
 
-	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
-			       0x1003ull);
-	ptu_int_eq(status, 2);
-	ptu_uint_eq(buffer[0], 0x03);
-	ptu_uint_eq(buffer[1], 0x04);
-	ptu_uint_eq(buffer[2], 0xcc);
+	status = pt_image_add(&ifix->image, &ifix->section[2], &ifix->asid[0],
+			      0x1ff8ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result set_advice_null(void)
+{
+	int errcode;
+
+	errcode = pt_image_set_advice(NULL, ptma_prefault);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result set_advice_bad(struct image_fixture *ifix)
+{
+	int errcode;
+
+	errcode = pt_image_set_advice(&ifix->image, 1u << 31);
+	ptu_int_eq(errcode, -pte_invalid);
+	ptu_uint_eq(ifix->image.advice, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_advice(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_add(&ifix->image, &ifix->section[1], &ifix->asid[0],
+			      0x2000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_set_advice(&ifix->image,
+				     ptma_prefault | ptma_random);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x1003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	/* Only the section containing the address is mapped and advised. */
+	ptu_uint_eq(ifix->section[0].advice, ptma_prefault | ptma_random);
+	ptu_uint_eq(ifix->section[1].advice, 0);
+	ptu_uint_eq(ifix->section[1].mcount, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_callback(struct image_fixture *ifix)
+{
+	uint8_t memory[] = { 0xdd, 0x01, 0x02, 0xdd };
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_set_callback(&ifix->image, image_readmem_callback,
+				       memory);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x3001ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x01);
+	ptu_uint_eq(buffer[1], 0x02);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_block_callback(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	int status, calls;
+
+	calls = 0;
+	status = pt_image_set_block_callback(&ifix->image, image_block_callback,
+					     &calls);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x4010ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x10);
+	ptu_uint_eq(buffer[1], 0x11);
+	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_int_eq(calls, 1);
+
+	/* The rest of the page is cached. */
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x4ff0ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0xf0);
+	ptu_uint_eq(buffer[1], 0xf1);
+	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_int_eq(calls, 1);
+
+	/* Other address spaces are not. */
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[1],
+			       0x4020ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x20);
+	ptu_uint_eq(buffer[1], 0x21);
+	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_int_eq(calls, 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_block_callback_cross(
+	struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc, 0xcc, 0xcc };
+	int status, calls;
+
+	calls = 0;
+	status = pt_image_set_block_callback(&ifix->image, image_block_callback,
+					     &calls);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 4, &ifix->asid[0],
+			       0x4ffeull);
+	ptu_int_eq(status, 4);
+	ptu_uint_eq(buffer[0], 0xfe);
+	ptu_uint_eq(buffer[1], 0xff);
+	ptu_uint_eq(buffer[2], 0x00);
+	ptu_uint_eq(buffer[3], 0x01);
+	ptu_uint_eq(buffer[4], 0xcc);
+	ptu_int_eq(calls, 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_block_callback_end(
+	struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc, 0xcc, 0xcc };
+	int status, calls;
+
+	calls = 0;
+	status = pt_image_set_block_callback(&ifix->image, image_block_callback,
+					     &calls);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 4, &ifix->asid[0],
+			       0x57feull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0xfe);
+	ptu_uint_eq(buffer[1], 0xff);
+	ptu_uint_eq(buffer[2], 0xcc);
+	ptu_int_eq(calls, 1);
+
+	/* We already know that the page ends early. */
+	status = pt_image_read(&ifix->image, buffer, 4, &ifix->asid[0],
+			       0x5800ull);
+	ptu_int_eq(status, -pte_nomap);
+	ptu_uint_eq(buffer[0], 0xfe);
+	ptu_int_eq(calls, 1);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_block_callback_flush(
+	struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status, calls;
+
+	calls = 0;
+	status = pt_image_set_block_callback(&ifix->image, image_block_callback,
+					     &calls);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x4010ull);
+	ptu_int_eq(status, 1);
+	ptu_int_eq(calls, 1);
+
+	status = pt_image_set_block_callback(&ifix->image, image_block_callback,
+					     &calls);
+	ptu_int_eq(status, 0);
+	ptu_null(ifix->image.readmem.blocks);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x4011ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x11);
+	ptu_uint_eq(buffer[1], 0xcc);
+	ptu_int_eq(calls, 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_nomem(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
+			       &ifix->asid[1], 0x1010ull);
+	ptu_int_eq(status, -pte_nomap);
+	ptu_uint_eq(buffer[0], 0xcc);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result read_truncated(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
+			       &ifix->asid[0], 0x100full);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x0f);
+	ptu_uint_eq(buffer[1], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result remove_section(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x1001ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x01);
+	ptu_uint_eq(buffer[1], 0x02);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	status = pt_image_remove(&ifix->image, &ifix->section[0],
+				 &ifix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	ptu_int_ne(ifix->status[0].deleted, 0);
+	ptu_int_eq(ifix->status[1].deleted, 0);
+
+	status = pt_image_read(&ifix->image, buffer, sizeof(buffer),
+			       &ifix->asid[0], 0x1003ull);
+	ptu_int_eq(status, -pte_nomap);
+	ptu_uint_eq(buffer[0], 0x01);
+	ptu_uint_eq(buffer[1], 0x02);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[1],
+			       0x2003ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x03);
+	ptu_uint_eq(buffer[1], 0x04);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result remove_bad_vaddr(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x1001ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x01);
+	ptu_uint_eq(buffer[1], 0x02);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	status = pt_image_remove(&ifix->image, &ifix->section[0],
+				 &ifix->asid[0], 0x2000ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	ptu_int_eq(ifix->status[0].deleted, 0);
+	ptu_int_eq(ifix->status[1].deleted, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[0],
+			       0x1003ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], 0x03);
+	ptu_uint_eq(buffer[1], 0x04);
+	ptu_uint_eq(buffer[2], 0xcc);
 
 	status = pt_image_read(&ifix->image, buffer, 2, &ifix->asid[1],
 			       0x2005ull);
@@ -981,6 +1510,348 @@ static struct ptunit_result copy_self(struct image_fixture *ifix)
 	return ptu_passed();
 }
 
+static struct ptunit_result copy_shared(struct image_fixture *ifix)
+{
+	int status;
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+	ptu_ptr(ifix->copy.index);
+	ptu_ptr_eq(ifix->copy.index, ifix->image.index);
+	ptu_uint_eq(ifix->image.index->ucount, 2);
+
+	/* Both images use their own mappings. */
+	ptu_null(ifix->copy.shared.sections);
+	ptu_null(ifix->copy.current.space);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result copy_add(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	struct pt_image_index *index;
+	int status;
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+
+	index = ifix->image.index;
+
+	status = pt_image_add(&ifix->copy, &ifix->section[2], &ifix->asid[2],
+			      0x3000ull);
+	ptu_int_eq(status, 0);
+	ptu_ptr_eq(ifix->image.index, index);
+	ptu_ptr_eq(ifix->copy.index->parent, index);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[2],
+			       0x3002ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x02);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[1],
+			       0x2003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[2],
+			       0x3002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result copy_add_source(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_add(&ifix->image, &ifix->section[2], &ifix->asid[2],
+			      0x3000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[2],
+			       0x3002ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x02);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[2],
+			       0x3002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result copy_remove(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[0],
+			       0x1001ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x01);
+
+	status = pt_image_remove(&ifix->copy, &ifix->section[0],
+				 &ifix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[0],
+			       0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+	ptu_uint_eq(buffer[0], 0x01);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[0],
+			       0x1002ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x02);
+
+	/* The copy can add the section back. */
+	status = pt_image_add(&ifix->copy, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[0],
+			       0x1003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result copy_remove_by_asid(struct image_fixture *ifix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc };
+	int status;
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_remove_by_asid(&ifix->image, &ifix->asid[1]);
+	ptu_int_eq(status, 1);
+
+	status = pt_image_read(&ifix->image, buffer, 1, &ifix->asid[1],
+			       0x2003ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[1],
+			       0x2003ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x03);
+
+	/* Removing all sections from the copy allows sharing again. */
+	status = pt_image_remove_by_asid(&ifix->copy, NULL);
+	ptu_int_eq(status, 2);
+
+	status = pt_image_copy(&ifix->copy, &ifix->image);
+	ptu_int_eq(status, 0);
+	ptu_ptr_eq(ifix->copy.index, ifix->image.index);
+
+	status = pt_image_read(&ifix->copy, buffer, 1, &ifix->asid[0],
+			       0x1004ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x04);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache_null(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	struct pt_bcache_entry bce;
+	int status;
+
+	memset(&bce, 0, sizeof(bce));
+
+	status = pt_image_bcache_lookup(NULL, &entry, &ifix->asid[0],
+					0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_bcache_lookup(&ifix->image, NULL, &ifix->asid[0],
+					0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, NULL,
+					0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_bcache_add(NULL, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_bcache_add(&ifix->image, NULL, &ifix->asid[0]);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_bcache_add(&ifix->image, &bce, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache_empty(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	int status;
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x3000ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	struct pt_bcache_entry bce;
+	int status;
+
+	memset(&bce, 0, sizeof(bce));
+	bce.ip = 0x1002ull;
+	bce.ild.runtime_address = 0x1008ull;
+	bce.ild.length = 1;
+	bce.raw[0] = 0x08;
+	bce.size = 1;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(entry->ip, 0x1002ull);
+	ptu_uint_eq(entry->ild.runtime_address, 0x1008ull);
+	ptu_uint_eq(entry->ild.length, 1);
+	ptu_uint_eq(entry->size, 1);
+	ptu_uint_eq(entry->raw[0], 0x08);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[1],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1003ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache_other_section(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	struct pt_bcache_entry bce;
+	int status;
+
+	status = pt_image_add(&ifix->image, &ifix->section[2], &ifix->asid[0],
+			      0x1010ull);
+	ptu_int_eq(status, 0);
+
+	memset(&bce, 0, sizeof(bce));
+	bce.ip = 0x1002ull;
+	bce.ild.runtime_address = 0x1012ull;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, -pte_nomap);
+
+	bce.ip = 0x3000ull;
+	bce.ild.runtime_address = 0x3002ull;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, -pte_nomap);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache_switch(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	struct pt_bcache_entry bce;
+	int status;
+
+	memset(&bce, 0, sizeof(bce));
+	bce.ip = 0x1002ull;
+	bce.ild.runtime_address = 0x1008ull;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, 0);
+
+	bce.ip = 0x2002ull;
+	bce.ild.runtime_address = 0x2004ull;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[1]);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(entry->ild.runtime_address, 0x1008ull);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[1],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[1],
+					0x2002ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(entry->ild.runtime_address, 0x2004ull);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(entry->ild.runtime_address, 0x1008ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result bcache_remove(struct image_fixture *ifix)
+{
+	const struct pt_bcache_entry *entry;
+	struct pt_bcache_entry bce;
+	int status;
+
+	memset(&bce, 0, sizeof(bce));
+	bce.ip = 0x1002ull;
+	bce.ild.runtime_address = 0x1008ull;
+
+	status = pt_image_bcache_add(&ifix->image, &bce, &ifix->asid[0]);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_remove(&ifix->image, &ifix->section[0],
+				 &ifix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	/* Adding the section back does not revive the cache. */
+	pt_init_section(&ifix->section[0], "file-0", &ifix->status[0],
+			&ifix->mapping[0]);
+
+	status = pt_image_add(&ifix->image, &ifix->section[0], &ifix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_bcache_lookup(&ifix->image, &entry, &ifix->asid[0],
+					0x1002ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	return ptu_passed();
+}
+
 struct ptunit_result ifix_init(struct image_fixture *ifix)
 {
 	pt_image_init(&ifix->image, NULL);
@@ -1079,12 +1950,29 @@ int main(int argc, char **argv)
 	ptu_run_f(suite, read_empty, ifix);
 	ptu_run_f(suite, overlap, ifix);
 	ptu_run_f(suite, adjacent, ifix);
+	ptu_run_f(suite, add_file_shared, ifix);
+	ptu_run_f(suite, add_file_not_shared, ifix);
+	ptu_run(suite, add_file_segments_null);
+	ptu_run_f(suite, add_file_segments_bad_file, ifix);
+	ptu_run_f(suite, add_file_segments_none, ifix);
+	ptu_run_f(suite, add_file_segments, ifix);
 
 	ptu_run_f(suite, read, rfix);
 	ptu_run_f(suite, read_asid, ifix);
 	ptu_run_f(suite, read_bad_asid, rfix);
 	ptu_run_f(suite, read_null_asid, rfix);
+	ptu_run_f(suite, read_shared, ifix);
+	ptu_run_f(suite, read_no_cr3, ifix);
+	ptu_run_f(suite, read_switch, ifix);
+	ptu_run_f(suite, overlap_shared, ifix);
+	ptu_run(suite, set_advice_null);
+	ptu_run_f(suite, set_advice_bad, ifix);
+	ptu_run_f(suite, read_advice, ifix);
 	ptu_run_f(suite, read_callback, rfix);
+	ptu_run_f(suite, read_block_callback, ifix);
+	ptu_run_f(suite, read_block_callback_cross, ifix);
+	ptu_run_f(suite, read_block_callback_end, ifix);
+	ptu_run_f(suite, read_block_callback_flush, ifix);
 	ptu_run_f(suite, read_nomem, rfix);
 	ptu_run_f(suite, read_truncated, rfix);
 
@@ -1101,6 +1989,18 @@ int main(int argc, char **argv)
 	ptu_run_f(suite, copy, rfix);
 	ptu_run_f(suite, copy_duplicate, rfix);
 	ptu_run_f(suite, copy_self, rfix);
+	ptu_run_f(suite, copy_shared, rfix);
+	ptu_run_f(suite, copy_add, rfix);
+	ptu_run_f(suite, copy_add_source, rfix);
+	ptu_run_f(suite, copy_remove, rfix);
+	ptu_run_f(suite, copy_remove_by_asid, rfix);
+
+	ptu_run_f(suite, bcache_null, rfix);
+	ptu_run_f(suite, bcache_empty, rfix);
+	ptu_run_f(suite, bcache, rfix);
+	ptu_run_f(suite, bcache_other_section, rfix);
+	ptu_run_f(suite, bcache_switch, rfix);
+	ptu_run_f(suite, bcache_remove, rfix);
 
 	ptunit_report(&suite);
 	return suite.nr_fails;
@@ -0,0 +1,693 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptunit.h"
+
+#include "pt_image_index.h"
+#include "pt_section.h"
+#include "pt_mapped_section.h"
+
+#include "intel-pt.h"
+
+#include <string.h>
+
+
+const char *pt_section_filename(const struct pt_section *section)
+{
+	if (!section)
+		return NULL;
+
+	return section->filename;
+}
+
+uint64_t pt_section_size(const struct pt_section *section)
+{
+	if (!section)
+		return 0ull;
+
+	return section->size;
+}
+
+uint64_t pt_section_offset(const struct pt_section *section)
+{
+	if (!section)
+		return 0ull;
+
+	return section->offset;
+}
+
+int pt_section_get(struct pt_section *section)
+{
+	if (!section)
+		return -pte_internal;
+
+	section->ucount += 1;
+	return 0;
+}
+
+int pt_section_put(struct pt_section *section)
+{
+	if (!section || !section->ucount)
+		return -pte_internal;
+
+	section->ucount -= 1;
+	return 0;
+}
+
+int pt_section_map(struct pt_section *section)
+{
+	(void) section;
+
+	/* This function is not used by our tests. */
+	return -pte_internal;
+}
+
+int pt_section_unmap(struct pt_section *section)
+{
+	(void) section;
+
+	/* This function is not used by our tests. */
+	return -pte_internal;
+}
+
+int pt_section_read(const struct pt_section *section, uint8_t *buffer,
+		    uint16_t size, uint64_t offset)
+{
+	(void) section;
+	(void) buffer;
+	(void) size;
+	(void) offset;
+
+	/* This function is not used by our tests. */
+	return -pte_internal;
+}
+
+/* A test fixture providing test sections and address spaces. */
+struct index_fixture {
+	/* The index - NULL if empty. */
+	struct pt_image_index *index;
+
+	/* Another index sharing sections with @index. */
+	struct pt_image_index *copy;
+
+	/* The test sections. */
+	struct pt_section section[3];
+
+	/* The test address spaces. */
+	struct pt_asid asid[3];
+
+	/* The test fixture initialization and finalization functions. */
+	struct ptunit_result (*init)(struct index_fixture *);
+	struct ptunit_result (*fini)(struct index_fixture *);
+};
+
+/* Count the sections in @index that match @asid. */
+static int xfix_count(const struct pt_image_index *index,
+		      const struct pt_asid *asid)
+{
+	const struct pt_mapped_section *msec;
+	struct pt_image_index_iter iter;
+	int count;
+
+	count = 0;
+
+	pt_image_index_begin(&iter, index, asid);
+	for (msec = pt_image_index_next(&iter); msec;
+	     msec = pt_image_index_next(&iter))
+		count += 1;
+
+	return count;
+}
+
+static struct ptunit_result xfix_contains(const struct pt_image_index *index,
+					  struct pt_section *section,
+					  const struct pt_asid *asid,
+					  uint64_t vaddr, int expected)
+{
+	struct pt_mapped_section msec;
+	int status;
+
+	pt_msec_init(&msec, section, asid, vaddr);
+
+	status = pt_image_index_contains(index, &msec);
+	ptu_int_eq(status, expected);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result put_null(void)
+{
+	int status;
+
+	status = pt_image_index_put(NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_get(NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result null(struct index_fixture *xfix)
+{
+	int status;
+
+	status = pt_image_index_add(NULL, &xfix->section[0], &xfix->asid[0],
+				    0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_add(&xfix->index, NULL, &xfix->asid[0],
+				    0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0], NULL,
+				    0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_remove(NULL, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_remove_by_filename(&xfix->index, NULL,
+						   &xfix->asid[0]);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_remove_by_asid(&xfix->index, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_image_index_contains(xfix->index, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	ptu_null(pt_image_index_find(xfix->index, NULL, 0ull, 0x10ull));
+	ptu_null(pt_image_index_next(NULL));
+	ptu_null(xfix->index);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result empty(struct index_fixture *xfix)
+{
+	int status;
+
+	ptu_int_eq(xfix_count(NULL, NULL), 0);
+	ptu_check(xfix_contains, NULL, &xfix->section[0], &xfix->asid[0],
+		  0x1000ull, 0);
+	ptu_null(pt_image_index_find(NULL, "file-0", 0ull, 0x10ull));
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+	ptu_null(xfix->index);
+
+	status = pt_image_index_remove_by_asid(&xfix->index, &xfix->asid[0]);
+	ptu_int_eq(status, 0);
+	ptu_null(xfix->index);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add(struct index_fixture *xfix)
+{
+	int status;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0],
+				    &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+	ptu_ptr(xfix->index);
+	ptu_uint_eq(xfix->index->ucount, 1);
+	ptu_uint_eq(xfix->section[0].ucount, 1);
+
+	ptu_int_eq(xfix_count(xfix->index, NULL), 1);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[0]), 1);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[1]), 0);
+
+	ptu_check(xfix_contains, xfix->index, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 1);
+	ptu_check(xfix_contains, xfix->index, &xfix->section[0],
+		  &xfix->asid[1], 0x1000ull, 0);
+	ptu_check(xfix_contains, xfix->index, &xfix->section[0],
+		  &xfix->asid[0], 0x1001ull, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_overlap(struct index_fixture *xfix)
+{
+	struct pt_asid asid;
+	int status;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0],
+				    &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], 0x100full);
+	ptu_int_eq(status, -pte_bad_image);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], 0x1010ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[1], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	/* Sections without cr3 overlap with sections in all address
+	 * spaces.
+	 */
+	pt_asid_init(&asid);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[2], &asid,
+				    0x1008ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[2], &asid,
+				    0x1020ull);
+	ptu_int_eq(status, 0);
+
+	ptu_int_eq(xfix_count(xfix->index, NULL), 4);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[0]), 3);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[1]), 2);
+	ptu_int_eq(xfix_count(xfix->index, &asid), 4);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result remove(struct index_fixture *xfix)
+{
+	int status;
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	/* The section is still used by the copy. */
+	ptu_uint_eq(xfix->section[0].ucount, 1);
+
+	ptu_int_eq(xfix_count(xfix->index, NULL), 1);
+	ptu_check(xfix_contains, xfix->index, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 0);
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[1],
+				       &xfix->asid[1], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result share(struct index_fixture *xfix)
+{
+	struct pt_image_index *index;
+	int status;
+
+	index = xfix->index;
+
+	status = pt_image_index_add(&xfix->copy, &xfix->section[2],
+				    &xfix->asid[2], 0x3000ull);
+	ptu_int_eq(status, 0);
+	ptu_ptr_eq(xfix->copy->parent, index);
+	ptu_uint_eq(xfix->copy->depth, 1);
+	ptu_uint_eq(index->ucount, 2);
+
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 3);
+	ptu_int_eq(xfix_count(xfix->index, NULL), 2);
+
+	/* The shared index is not modified. */
+	status = pt_image_index_add(&xfix->index, &xfix->section[2],
+				    &xfix->asid[0], 0x3000ull);
+	ptu_int_eq(status, 0);
+	ptu_ptr_eq(xfix->index->parent, index);
+	ptu_uint_eq(index->ucount, 2);
+
+	ptu_int_eq(xfix_count(xfix->copy, &xfix->asid[0]), 1);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[0]), 2);
+	ptu_int_eq(xfix_count(xfix->index, &xfix->asid[2]), 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result share_remove(struct index_fixture *xfix)
+{
+	struct pt_image_index *index;
+	int status;
+
+	index = xfix->index;
+
+	status = pt_image_index_remove(&xfix->copy, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+	ptu_ptr_eq(xfix->copy->parent, index);
+	ptu_uint_eq(xfix->section[0].ucount, 1);
+
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 1);
+	ptu_int_eq(xfix_count(xfix->index, NULL), 2);
+	ptu_check(xfix_contains, xfix->copy, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 0);
+	ptu_check(xfix_contains, xfix->index, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 1);
+
+	/* Removed sections can still be found for sharing. */
+	ptu_ptr_eq(pt_image_index_find(xfix->copy, "file-0", 0ull, 0x10ull),
+		   &xfix->section[0]);
+
+	status = pt_image_index_remove(&xfix->copy, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	/* The section can be added back. */
+	status = pt_image_index_add(&xfix->copy, &xfix->section[0],
+				    &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 2);
+	ptu_check(xfix_contains, xfix->copy, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 1);
+
+	status = pt_image_index_remove(&xfix->copy, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 1);
+	ptu_check(xfix_contains, xfix->copy, &xfix->section[0],
+		  &xfix->asid[0], 0x1000ull, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result remove_by_filename(struct index_fixture *xfix)
+{
+	int status;
+
+	status = pt_image_index_add(&xfix->copy, &xfix->section[0],
+				    &xfix->asid[2], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_remove_by_filename(&xfix->copy, "file-0",
+						   &xfix->asid[0]);
+	ptu_int_eq(status, 1);
+
+	status = pt_image_index_remove_by_filename(&xfix->copy, "file-1",
+						   &xfix->asid[0]);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_remove_by_filename(&xfix->copy, "file-0",
+						   &xfix->asid[2]);
+	ptu_int_eq(status, 1);
+
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 1);
+	ptu_int_eq(xfix_count(xfix->index, NULL), 2);
+	ptu_uint_eq(xfix->section[0].ucount, 1);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result remove_by_asid(struct index_fixture *xfix)
+{
+	struct pt_asid asid;
+	int status;
+
+	status = pt_image_index_add(&xfix->copy, &xfix->section[2],
+				    &xfix->asid[1], 0x3000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_remove_by_asid(&xfix->copy, &xfix->asid[1]);
+	ptu_int_eq(status, 2);
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 1);
+	ptu_uint_eq(xfix->section[2].ucount, 0);
+
+	pt_asid_init(&asid);
+
+	status = pt_image_index_remove_by_asid(&xfix->copy, &asid);
+	ptu_int_eq(status, 1);
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 0);
+	ptu_int_eq(xfix_count(xfix->index, NULL), 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result flatten(struct index_fixture *xfix)
+{
+	struct pt_image_index *index;
+	uint64_t vaddr;
+	int status;
+
+	/* Modify a shared index over and over again. */
+	for (vaddr = 0x10000ull; vaddr < 0x10000ull + 0x100ull;
+	     vaddr += 0x10ull) {
+		index = xfix->copy;
+
+		status = pt_image_index_get(index);
+		ptu_int_eq(status, 0);
+
+		status = pt_image_index_add(&xfix->copy, &xfix->section[2],
+					    &xfix->asid[2], vaddr);
+		ptu_int_eq(status, 0);
+		ptu_uint_le(xfix->copy->depth, pt_image_index_max_depth);
+
+		status = pt_image_index_put(index);
+		ptu_int_eq(status, 0);
+	}
+
+	ptu_int_eq(xfix_count(xfix->copy, NULL), 0x12);
+	ptu_int_eq(xfix_count(xfix->copy, &xfix->asid[2]), 0x10);
+	ptu_uint_eq(xfix->section[2].ucount, 0x10);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_overlap_slot(struct index_fixture *xfix)
+{
+	uint64_t slot;
+	int status;
+
+	slot = pt_image_index_slot_size;
+
+	/* This section ends in the slot after the one it begins in. */
+	xfix->section[0].size = slot;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0],
+				    &xfix->asid[0], slot - 0x8ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], (2 * slot) - 0x10ull);
+	ptu_int_eq(status, -pte_bad_image);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], (2 * slot) - 0x8ull);
+	ptu_int_eq(status, 0);
+
+	ptu_int_eq(xfix_count(xfix->index, NULL), 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result add_overlap_large(struct index_fixture *xfix)
+{
+	uint64_t slot;
+	int status;
+
+	slot = pt_image_index_slot_size;
+
+	/* This section spans several slots. */
+	xfix->section[0].size = 3 * slot;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0],
+				    &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], 2 * slot);
+	ptu_int_eq(status, -pte_bad_image);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], (3 * slot) + 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	/* This section spans more slots than there are buckets. */
+	xfix->section[2].size = (pt_image_index_nslots + 2) * slot;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[2],
+				    &xfix->asid[0], 4 * slot);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[2],
+				    &xfix->asid[1], 0ull);
+	ptu_int_eq(status, 0);
+
+	ptu_int_eq(xfix_count(xfix->index, NULL), 4);
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[0],
+				       &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0], 2 * slot);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[0],
+				    (pt_image_index_nslots + 4) * slot);
+	ptu_int_eq(status, -pte_bad_image);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result find(struct index_fixture *xfix)
+{
+	ptu_ptr_eq(pt_image_index_find(xfix->index, "file-1", 0ull, 0x10ull),
+		   &xfix->section[1]);
+	ptu_null(pt_image_index_find(xfix->index, "file-1", 1ull, 0x10ull));
+	ptu_null(pt_image_index_find(xfix->index, "file-1", 0ull, 0xfull));
+	ptu_null(pt_image_index_find(xfix->index, "file-2", 0ull, 0x10ull));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result find_removed(struct index_fixture *xfix)
+{
+	int status;
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[2],
+				    &xfix->asid[0], 0x3000ull);
+	ptu_int_eq(status, 0);
+
+	ptu_ptr_eq(pt_image_index_find(xfix->index, "file-2", 0ull, 0x10ull),
+		   &xfix->section[2]);
+
+	status = pt_image_index_remove(&xfix->index, &xfix->section[2],
+				       &xfix->asid[0], 0x3000ull);
+	ptu_int_eq(status, 0);
+
+	ptu_null(pt_image_index_find(xfix->index, "file-2", 0ull, 0x10ull));
+
+	/* Sections in the shared index are still found. */
+	ptu_ptr_eq(pt_image_index_find(xfix->index, "file-1", 0ull, 0x10ull),
+		   &xfix->section[1]);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result xfix_init(struct index_fixture *xfix)
+{
+	static char *filename[] = { "file-0", "file-1", "file-2" };
+	int idx;
+
+	xfix->index = NULL;
+	xfix->copy = NULL;
+
+	for (idx = 0; idx < 3; ++idx) {
+		memset(&xfix->section[idx], 0, sizeof(xfix->section[idx]));
+		xfix->section[idx].filename = filename[idx];
+		xfix->section[idx].size = 0x10ull;
+
+		pt_asid_init(&xfix->asid[idx]);
+		xfix->asid[idx].cr3 = 0xa000ull + (idx * 0x1000ull);
+	}
+
+	return ptu_passed();
+}
+
+/* Add sections and share the index with @copy. */
+static struct ptunit_result sfix_init(struct index_fixture *xfix)
+{
+	int status;
+
+	ptu_test(xfix_init, xfix);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[0],
+				    &xfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_add(&xfix->index, &xfix->section[1],
+				    &xfix->asid[1], 0x2000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_index_get(xfix->index);
+	ptu_int_eq(status, 0);
+
+	xfix->copy = xfix->index;
+
+	return ptu_passed();
+}
+
+static struct ptunit_result xfix_fini(struct index_fixture *xfix)
+{
+	int idx, status;
+
+	if (xfix->index) {
+		status = pt_image_index_put(xfix->index);
+		ptu_int_eq(status, 0);
+	}
+
+	if (xfix->copy) {
+		status = pt_image_index_put(xfix->copy);
+		ptu_int_eq(status, 0);
+	}
+
+	for (idx = 0; idx < 3; ++idx)
+		ptu_uint_eq(xfix->section[idx].ucount, 0);
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct index_fixture xfix, sfix;
+	struct ptunit_suite suite;
+
+	xfix.init = xfix_init;
+	xfix.fini = xfix_fini;
+
+	sfix.init = sfix_init;
+	sfix.fini = xfix_fini;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, put_null);
+	ptu_run_f(suite, null, xfix);
+	ptu_run_f(suite, empty, xfix);
+	ptu_run_f(suite, add, xfix);
+	ptu_run_f(suite, add_overlap, xfix);
+	ptu_run_f(suite, add_overlap_slot, xfix);
+	ptu_run_f(suite, add_overlap_large, xfix);
+
+	ptu_run_f(suite, remove, sfix);
+	ptu_run_f(suite, share, sfix);
+	ptu_run_f(suite, share_remove, sfix);
+	ptu_run_f(suite, remove_by_filename, sfix);
+	ptu_run_f(suite, remove_by_asid, sfix);
+	ptu_run_f(suite, flatten, sfix);
+	ptu_run_f(suite, find, sfix);
+	ptu_run_f(suite, find_removed, sfix);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptunit.h"
+#include "ptunit_mktempname.h"
+
+#include "pt_image.h"
+#include "pt_section.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+/* A test fixture providing a section file and a manifest file name as well
+ * as two images.
+ */
+struct manifest_fixture {
+	/* The section file name. */
+	char *name;
+
+	/* The manifest file name. */
+	char *manifest;
+
+	/* The image to save and the image to load. */
+	struct pt_image image;
+	struct pt_image copy;
+
+	/* Two address spaces. */
+	struct pt_asid asid[2];
+
+	/* The test fixture initialization and finalization functions. */
+	struct ptunit_result (*init)(struct manifest_fixture *);
+	struct ptunit_result (*fini)(struct manifest_fixture *);
+};
+
+static struct ptunit_result mfix_write(const char *name, const char *mode,
+				       const char *text)
+{
+	FILE *file;
+	int errcode;
+
+	file = fopen(name, mode);
+	ptu_ptr(file);
+
+	errcode = fputs(text, file);
+	ptu_int_ge(errcode, 0);
+
+	errcode = fclose(file);
+	ptu_int_eq(errcode, 0);
+
+	return ptu_passed();
+}
+
+/* Write a manifest and try to load it.
+ *
+ * Expects @expected from pt_image_load().
+ */
+static struct ptunit_result mfix_load(struct manifest_fixture *mfix,
+				      const char *text, int expected)
+{
+	int status;
+
+	ptu_check(mfix_write, mfix->manifest, "w", text);
+
+	status = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(status, expected);
+
+	return ptu_passed();
+}
+
+/* Save @mfix->image and load it into @mfix->copy. */
+static struct ptunit_result mfix_save_load(struct manifest_fixture *mfix)
+{
+	struct pt_section *section;
+	int errcode;
+
+	section = pt_mk_section(mfix->name, 0x1ull, 0x3ull);
+	ptu_ptr(section);
+
+	errcode = pt_image_add(&mfix->image, section, &mfix->asid[0],
+			       0x1000ull);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_image_add(&mfix->image, section, &mfix->asid[1],
+			       0x2000ull);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_section_put(section);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_image_save(&mfix->image, mfix->manifest);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(errcode, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result save_null(struct manifest_fixture *mfix)
+{
+	int errcode;
+
+	errcode = pt_image_save(NULL, mfix->manifest);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_image_save(&mfix->image, NULL);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result load_null(struct manifest_fixture *mfix)
+{
+	int errcode;
+
+	errcode = pt_image_load(NULL, mfix->manifest);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_image_load(&mfix->copy, NULL);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result load_missing(struct manifest_fixture *mfix)
+{
+	int errcode;
+
+	errcode = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result save_empty(struct manifest_fixture *mfix)
+{
+	int errcode;
+
+	errcode = pt_image_save(&mfix->image, mfix->manifest);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(errcode, 0);
+
+	ptu_null(mfix->copy.shared.sections);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result load_bad(struct manifest_fixture *mfix)
+{
+	ptu_check(mfix_load, mfix, "", -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 2\n", -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nfoo\n", -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nfile 4 0\n", -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nsection 0 0 1\n",
+		  -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nmap 0 1000 0 1000\n",
+		  -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nfile 4 0 x\nsection 0 0 1 2\n",
+		  -pte_bad_image);
+	ptu_check(mfix_load, mfix, "pt-image 1\nfile 4 0 x\nsection 0 8 1\n",
+		  -pte_bad_image);
+
+	ptu_null(mfix->copy.shared.sections);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result save_load(struct manifest_fixture *mfix)
+{
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc, 0xcc };
+	const struct pt_section *section;
+	int status;
+
+	ptu_test(mfix_save_load, mfix);
+
+	status = pt_image_read(&mfix->copy, buffer, sizeof(buffer),
+			       &mfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, 3);
+	ptu_uint_eq(buffer[0], 0x02);
+	ptu_uint_eq(buffer[1], 0x04);
+	ptu_uint_eq(buffer[2], 0x06);
+	ptu_uint_eq(buffer[3], 0xcc);
+
+	status = pt_image_read(&mfix->copy, buffer, 1, &mfix->asid[1],
+			       0x2002ull);
+	ptu_int_eq(status, 1);
+	ptu_uint_eq(buffer[0], 0x06);
+
+	ptu_ptr(mfix->copy.current.space);
+	ptu_ptr(mfix->copy.current.space->sections);
+	section = mfix->copy.current.space->sections->section.section;
+
+	status = pt_image_read(&mfix->copy, buffer, 1, &mfix->asid[0],
+			       0x2000ull);
+	ptu_int_eq(status, -pte_nomap);
+
+	/* Both address spaces share the same section. */
+	ptu_ptr(mfix->copy.current.space);
+	ptu_ptr(mfix->copy.current.space->sections);
+	ptu_ptr_eq(mfix->copy.current.space->sections->section.section,
+		   section);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result load_overlap(struct manifest_fixture *mfix)
+{
+	int status;
+
+	ptu_test(mfix_save_load, mfix);
+
+	status = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(status, 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result load_changed(struct manifest_fixture *mfix)
+{
+	uint8_t buffer[] = { 0xcc };
+	int status;
+
+	ptu_test(mfix_save_load, mfix);
+	ptu_check(mfix_write, mfix->name, "ab", "changed");
+
+	status = pt_image_read(&mfix->copy, buffer, sizeof(buffer),
+			       &mfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+	ptu_uint_eq(buffer[0], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result save_changed(struct manifest_fixture *mfix)
+{
+	uint8_t buffer[] = { 0xcc };
+	struct pt_section *section;
+	int status;
+
+	section = pt_mk_section(mfix->name, 0x1ull, 0x3ull);
+	ptu_ptr(section);
+
+	status = pt_image_add(&mfix->image, section, &mfix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_section_put(section);
+	ptu_int_eq(status, 0);
+
+	/* The manifest describes the file the section was created from. */
+	ptu_check(mfix_write, mfix->name, "ab", "changed");
+
+	status = pt_image_save(&mfix->image, mfix->manifest);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_load(&mfix->copy, mfix->manifest);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_read(&mfix->copy, buffer, sizeof(buffer),
+			       &mfix->asid[0], 0x1000ull);
+	ptu_int_eq(status, -pte_bad_image);
+	ptu_uint_eq(buffer[0], 0xcc);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result save_newline(struct manifest_fixture *mfix)
+{
+	struct pt_section *section;
+	struct pt_file_id id;
+	int status;
+
+	id.size = 0x1000ull;
+	id.mtime = 0ll;
+
+	section = pt_mk_section_lazy("new\nline", 0x0ull, 0x1000ull, &id);
+	ptu_ptr(section);
+
+	status = pt_image_add(&mfix->image, section, &mfix->asid[0],
+			      0x1000ull);
+	ptu_int_eq(status, 0);
+
+	status = pt_section_put(section);
+	ptu_int_eq(status, 0);
+
+	status = pt_image_save(&mfix->image, mfix->manifest);
+	ptu_int_eq(status, -pte_bad_image);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result mfix_init(struct manifest_fixture *mfix)
+{
+	mfix->name = mktempname();
+	ptu_ptr(mfix->name);
+
+	mfix->manifest = mktempname();
+	ptu_ptr(mfix->manifest);
+
+	ptu_check(mfix_write, mfix->name, "wb", "\xcc\x02\x04\x06");
+
+	pt_image_init(&mfix->image, NULL);
+	pt_image_init(&mfix->copy, NULL);
+
+	pt_asid_init(&mfix->asid[0]);
+	mfix->asid[0].cr3 = 0x1000ull;
+
+	pt_asid_init(&mfix->asid[1]);
+	mfix->asid[1].cr3 = 0x2000ull;
+
+	return ptu_passed();
+}
+
+static struct ptunit_result mfix_fini(struct manifest_fixture *mfix)
+{
+	pt_image_fini(&mfix->copy);
+	pt_image_fini(&mfix->image);
+
+	if (mfix->manifest) {
+		(void) remove(mfix->manifest);
+		free(mfix->manifest);
+		mfix->manifest = NULL;
+	}
+
+	if (mfix->name) {
+		(void) remove(mfix->name);
+		free(mfix->name);
+		mfix->name = NULL;
+	}
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct manifest_fixture mfix;
+	struct ptunit_suite suite;
+
+	mfix.init = mfix_init;
+	mfix.fini = mfix_fini;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run_f(suite, save_null, mfix);
+	ptu_run_f(suite, load_null, mfix);
+	ptu_run_f(suite, load_missing, mfix);
+	ptu_run_f(suite, save_empty, mfix);
+	ptu_run_f(suite, load_bad, mfix);
+	ptu_run_f(suite, save_load, mfix);
+	ptu_run_f(suite, load_overlap, mfix);
+	ptu_run_f(suite, load_changed, mfix);
+	ptu_run_f(suite, save_changed, mfix);
+	ptu_run_f(suite, save_newline, mfix);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
@@ -218,6 +218,54 @@ static struct ptunit_result asid(void)
 	return ptu_passed();
 }
 
+static struct ptunit_result is_same_null(void)
+{
+	struct pt_mapped_section msec;
+	int status;
+
+	pt_msec_init(&msec, NULL, NULL, 0ull);
+
+	status = pt_msec_is_same(NULL, &msec);
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_msec_is_same(&msec, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result is_same(struct section_fixture *sfix)
+{
+	struct pt_mapped_section msec;
+	struct pt_asid asid;
+	int status;
+
+	pt_msec_init(&msec, &sfix->section, &sfix->asid, sfix->vaddr);
+
+	status = pt_msec_is_same(&msec, &sfix->msec);
+	ptu_int_eq(status, 1);
+
+	pt_msec_init(&msec, &sfix->section, &sfix->asid, sfix->vaddr + 1);
+
+	status = pt_msec_is_same(&msec, &sfix->msec);
+	ptu_int_eq(status, 0);
+
+	asid = sfix->asid;
+	asid.vmcs = 0xb000;
+
+	pt_msec_init(&msec, &sfix->section, &asid, sfix->vaddr);
+
+	status = pt_msec_is_same(&msec, &sfix->msec);
+	ptu_int_eq(status, 0);
+
+	pt_msec_init(&msec, NULL, &sfix->asid, sfix->vaddr);
+
+	status = pt_msec_is_same(&msec, &sfix->msec);
+	ptu_int_eq(status, 0);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result read(struct section_fixture *sfix)
 {
 	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
@@ -357,6 +405,9 @@ int main(int argc, char **argv)
 	ptu_run(suite, asid_null);
 	ptu_run(suite, asid);
 
+	ptu_run(suite, is_same_null);
+	ptu_run_f(suite, is_same, sfix);
+
 	ptu_run_f(suite, read, sfix);
 	ptu_run_f(suite, read_default_asid, sfix);
 	ptu_run_f(suite, read_offset, sfix);
@@ -471,6 +471,109 @@ static struct ptunit_result cutoff_mode(struct packet_fixture *pfix,
 	return ptu_passed();
 }
 
+static struct ptunit_result split(struct packet_fixture *pfix)
+{
+	struct pt_packet_decoder decoder;
+	struct pt_trace_part part;
+	struct pt_config config;
+	uint8_t tail[sizeof(pfix->buffer)];
+	uint64_t boundary, size;
+	int errcode, status[2];
+
+	pfix->packet[0].type = ppt_psb;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_tsc;
+	pfix->packet[0].payload.tsc.tsc = 0x1234567890ull;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_fup;
+	pfix->packet[0].payload.ip.ipc = pt_ipc_sext_48;
+	pfix->packet[0].payload.ip.ip = 0x7fffabcdef12ull;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_mode;
+	pfix->packet[0].payload.mode.leaf = pt_mol_exec;
+	pfix->packet[0].payload.mode.bits.exec.csl = 1;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_psbend;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_mnt;
+	pfix->packet[0].payload.mnt.payload = 0xa5a5a5a5a5a5a5a5ull;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	pfix->packet[0].type = ppt_cbr;
+	pfix->packet[0].payload.cbr.ratio = 0x23;
+	errcode = pt_enc_next(&pfix->encoder, &pfix->packet[0]);
+	ptu_int_gt(errcode, 0);
+
+	/* Split the trace at every possible position and check that we get
+	 * the same packets at the same offsets.
+	 */
+	size = sizeof(pfix->buffer);
+	for (boundary = 1; boundary < size; ++boundary) {
+		memset(tail, 0xcc, sizeof(tail));
+		memcpy(tail, pfix->buffer + boundary, size - boundary);
+
+		part.begin = tail;
+		part.end = tail + (size - boundary);
+
+		config = pfix->config;
+		config.end = pfix->buffer + boundary;
+		config.decode.callback = NULL;
+		config.parts = &part;
+		config.nparts = 1;
+
+		errcode = pt_pkt_decoder_init(&decoder, &config);
+		ptu_int_eq(errcode, 0);
+
+		errcode = pt_pkt_sync_backward(&decoder);
+		ptu_int_eq(errcode, 0);
+
+		errcode = pt_pkt_sync_set(&pfix->decoder, 0ull);
+		ptu_int_eq(errcode, 0);
+
+		for (;;) {
+			uint64_t offset[2];
+
+			errcode = pt_pkt_get_offset(&pfix->decoder, &offset[0]);
+			ptu_int_eq(errcode, 0);
+
+			errcode = pt_pkt_get_offset(&decoder, &offset[1]);
+			ptu_int_eq(errcode, 0);
+			ptu_uint_eq(offset[1], offset[0]);
+
+			memset(pfix->packet, 0, sizeof(pfix->packet));
+
+			status[0] = pt_pkt_next(&pfix->decoder,
+						&pfix->packet[0],
+						sizeof(pfix->packet[0]));
+			status[1] = pt_pkt_next(&decoder, &pfix->packet[1],
+						sizeof(pfix->packet[1]));
+			ptu_int_eq(status[1], status[0]);
+			if (status[0] < 0)
+				break;
+
+			ptu_test(ptu_pkt_eq, &pfix->packet[0],
+				 &pfix->packet[1]);
+		}
+
+		ptu_int_eq(status[0], -pte_eos);
+
+		pt_pkt_decoder_fini(&decoder);
+	}
+
+	return ptu_passed();
+}
+
 int main(int argc, char **argv)
 {
 	struct packet_fixture pfix;
@@ -565,6 +668,8 @@ int main(int argc, char **argv)
 	ptu_run_fp(suite, cutoff, pfix, ppt_vmcs);
 	ptu_run_fp(suite, cutoff, pfix, ppt_mnt);
 
+	ptu_run_f(suite, split, pfix);
+
 	ptunit_report(&suite);
 	return suite.nr_fails;
 }
@@ -1790,6 +1790,138 @@ sync_ovf_event_cutoff_fail(struct ptu_decoder_fixture *dfix)
 	return ptu_passed();
 }
 
+static struct ptunit_result event_mask_null(struct ptu_decoder_fixture *dfix)
+{
+	struct pt_query_decoder *decoder = &dfix->decoder;
+	uint32_t mask;
+	int errcode;
+
+	errcode = pt_qry_set_event_mask(NULL, 0);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_qry_get_event_mask(NULL, &mask);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_qry_get_event_mask(decoder, NULL);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result event_mask(struct ptu_decoder_fixture *dfix)
+{
+	struct pt_query_decoder *decoder = &dfix->decoder;
+	uint32_t mask;
+	int errcode;
+
+	errcode = pt_qry_get_event_mask(decoder, &mask);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(mask, UINT32_MAX);
+
+	errcode = pt_qry_set_event_mask(decoder, pt_event_mask(ptev_stop));
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_qry_get_event_mask(decoder, &mask);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(mask, pt_event_mask(ptev_stop));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result event_mask_skip(struct ptu_decoder_fixture *dfix)
+{
+	struct pt_query_decoder *decoder = &dfix->decoder;
+	struct pt_encoder *encoder = &dfix->encoder;
+	struct pt_event event;
+	uint64_t addr;
+	int errcode, taken;
+
+	pt_encode_psb(encoder);
+	pt_encode_mode_exec(encoder, ptem_64bit);
+	pt_encode_pip(encoder, pt_dfix_max_cr3, 0);
+	pt_encode_fup(encoder, 0x1000ull, pt_ipc_sext_48);
+	pt_encode_psbend(encoder);
+	pt_encode_mode_exec(encoder, ptem_32bit);
+	pt_encode_tip(encoder, 0x2000ull, pt_ipc_sext_48);
+	pt_encode_pip(encoder, pt_dfix_max_cr3, 0);
+	pt_encode_mode_tsx(encoder, pt_mob_tsx_intx);
+	pt_encode_fup(encoder, 0x2004ull, pt_ipc_sext_48);
+	pt_encode_tnt_8(encoder, 1, 1);
+	pt_encode_tip_pgd(encoder, 0x3000ull, pt_ipc_sext_48);
+	pt_encode_stop(encoder);
+	pt_encode_tip_pge(encoder, 0x4000ull, pt_ipc_sext_48);
+
+	errcode = pt_qry_set_event_mask(decoder,
+					pt_event_mask(ptev_enabled) |
+					pt_event_mask(ptev_disabled));
+	ptu_int_eq(errcode, 0);
+
+	/* The PSB+ status events are not reported. */
+	errcode = pt_qry_sync_forward(decoder, &addr);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(addr, 0x1000ull);
+
+	/* Neither is the exec mode event binding to the TIP. */
+	errcode = pt_qry_indirect_branch(decoder, &addr);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(addr, 0x2000ull);
+
+	/* Nor the paging and tsx events.  The FUP must not be mistaken for an
+	 * async branch.
+	 */
+	errcode = pt_qry_cond_branch(decoder, &taken);
+	ptu_int_eq(errcode, pts_event_pending);
+	ptu_int_eq(taken, 1);
+
+	errcode = pt_qry_event(decoder, &event, sizeof(event));
+	ptu_int_eq(errcode, pts_event_pending);
+	ptu_int_eq(event.type, ptev_disabled);
+	ptu_uint_eq(event.variant.disabled.ip, 0x3000ull);
+
+	/* The stop event is not reported. */
+	errcode = pt_qry_event(decoder, &event, sizeof(event));
+	ptu_int_eq(errcode, pts_eos);
+	ptu_int_eq(event.type, ptev_enabled);
+	ptu_uint_eq(event.variant.enabled.ip, 0x4000ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result
+event_mask_skip_all(struct ptu_decoder_fixture *dfix)
+{
+	struct pt_query_decoder *decoder = &dfix->decoder;
+	struct pt_encoder *encoder = &dfix->encoder;
+	struct pt_event event;
+	uint64_t addr;
+	int errcode;
+
+	pt_encode_psb(encoder);
+	pt_encode_fup(encoder, 0x1000ull, pt_ipc_sext_48);
+	pt_encode_psbend(encoder);
+	pt_encode_fup(encoder, 0x1004ull, pt_ipc_sext_48);
+	pt_encode_pip(encoder, pt_dfix_max_cr3, 0);
+	pt_encode_tip(encoder, 0x2000ull, pt_ipc_sext_48);
+	pt_encode_tip(encoder, 0x3000ull, pt_ipc_sext_48);
+
+	errcode = pt_qry_set_event_mask(decoder, 0);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_qry_sync_forward(decoder, &addr);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(addr, 0x1000ull);
+
+	/* The async branch consumes the first TIP. */
+	errcode = pt_qry_indirect_branch(decoder, &addr);
+	ptu_int_eq(errcode, pts_eos);
+	ptu_uint_eq(addr, 0x3000ull);
+
+	errcode = pt_qry_event(decoder, &event, sizeof(event));
+	ptu_int_eq(errcode, -pte_eos);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result time_null_fail(struct ptu_decoder_fixture *dfix)
 {
 	struct pt_query_decoder *decoder = &dfix->decoder;
@@ -2304,6 +2436,11 @@ int main(int argc, char **argv)
 	ptu_run_fp(suite, sync_ovf_event, dfix_empty, pt_ipc_full);
 	ptu_run_f(suite, sync_ovf_event_cutoff_fail, dfix_empty);
 
+	ptu_run_f(suite, event_mask_null, dfix_empty);
+	ptu_run_f(suite, event_mask, dfix_empty);
+	ptu_run_f(suite, event_mask_skip, dfix_empty);
+	ptu_run_f(suite, event_mask_skip_all, dfix_empty);
+
 	ptu_run_fp(suite, event_enabled, dfix_event, pt_ipc_suppressed, 0x1000);
 	ptu_run_fp(suite, event_enabled, dfix_event, pt_ipc_update_16, 0x1000);
 	ptu_run_fp(suite, event_enabled, dfix_event, pt_ipc_update_32, 0x1000);
@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2014-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptunit.h"
+
+#include "pt_scatter.h"
+#include "pt_sync.h"
+
+#include "intel-pt.h"
+
+#include <string.h>
+
+
+/* A test fixture for scattered trace buffer tests.
+ *
+ * The trace is stored in a wrapped ring buffer starting at @head.
+ */
+struct scatter_fixture {
+	/* The ring buffer. */
+	uint8_t ring[256];
+
+	/* The contiguous trace for comparison. */
+	uint8_t trace[256];
+
+	/* The offset of the oldest trace byte in @ring. */
+	uint32_t head;
+
+	/* The second part of the ring buffer. */
+	struct pt_trace_part part;
+
+	/* A trace configuration. */
+	struct pt_config config;
+
+	/* The scattered trace buffer. */
+	struct pt_scatter scatter;
+
+	/* The test fixture initialization and finalization functions. */
+	struct ptunit_result (*init)(struct scatter_fixture *);
+	struct ptunit_result (*fini)(struct scatter_fixture *);
+};
+
+static void sfix_encode_psb(uint8_t *pos)
+{
+	int i;
+
+	*pos++ = pt_opc_psb;
+	*pos++ = pt_ext_psb;
+
+	for (i = 0; i < pt_psb_repeat_count; ++i) {
+		*pos++ = pt_psb_hi;
+		*pos++ = pt_psb_lo;
+	}
+}
+
+/* Store @trace in the ring buffer starting at @head. */
+static void sfix_wrap(struct scatter_fixture *sfix, uint32_t head)
+{
+	uint32_t size;
+
+	size = sizeof(sfix->ring) - head;
+
+	memcpy(sfix->ring + head, sfix->trace, size);
+	memcpy(sfix->ring, sfix->trace + size, head);
+
+	sfix->head = head;
+	sfix->config.begin = sfix->ring + head;
+	sfix->config.end = sfix->ring + sizeof(sfix->ring);
+	sfix->part.begin = sfix->ring;
+	sfix->part.end = sfix->ring + head;
+	sfix->config.parts = &sfix->part;
+	sfix->config.nparts = 1;
+}
+
+static struct ptunit_result sfix_init(struct scatter_fixture *sfix)
+{
+	uint32_t idx;
+
+	for (idx = 0; idx < sizeof(sfix->trace); ++idx)
+		sfix->trace[idx] = (uint8_t) idx;
+
+	memset(&sfix->config, 0, sizeof(sfix->config));
+	sfix->config.size = sizeof(sfix->config);
+	sfix->config.begin = sfix->trace;
+	sfix->config.end = sfix->trace + sizeof(sfix->trace);
+
+	memset(&sfix->scatter, 0, sizeof(sfix->scatter));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sfix_fini(struct scatter_fixture *sfix)
+{
+	pt_scatter_fini(&sfix->scatter);
+
+	return ptu_passed();
+}
+
+
+static struct ptunit_result init_null(void)
+{
+	struct pt_scatter scatter;
+	struct pt_config config;
+	int errcode;
+
+	errcode = pt_scatter_init(NULL, &config);
+	ptu_int_eq(errcode, -pte_internal);
+
+	errcode = pt_scatter_init(&scatter, NULL);
+	ptu_int_eq(errcode, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result fini_null(void)
+{
+	pt_scatter_fini(NULL);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result contiguous(struct scatter_fixture *sfix)
+{
+	const uint8_t *pos;
+	uint64_t offset;
+	int errcode;
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_null(sfix->scatter.window);
+	ptu_ptr_eq(sfix->config.begin, sfix->trace);
+	ptu_ptr_eq(sfix->config.end, sfix->trace + sizeof(sfix->trace));
+	ptu_uint_eq(pt_scatter_size(&sfix->scatter, &sfix->config),
+		    sizeof(sfix->trace));
+
+	errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter, 0x42);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(pos, sfix->trace + 0x42);
+
+	errcode = pt_scatter_normalize(&pos, &sfix->config, &sfix->scatter);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(pos, sfix->trace + 0x42);
+
+	errcode = pt_scatter_offset(&offset, &sfix->scatter, pos,
+				    &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(offset, 0x42);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result empty_parts(struct scatter_fixture *sfix)
+{
+	int errcode;
+
+	sfix->part.begin = sfix->ring;
+	sfix->part.end = sfix->ring;
+	sfix->config.parts = &sfix->part;
+	sfix->config.nparts = 1;
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_null(sfix->scatter.window);
+	ptu_ptr_eq(sfix->config.begin, sfix->trace);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result user_config(struct scatter_fixture *sfix)
+{
+	const uint8_t *pos;
+	int errcode;
+
+	sfix_wrap(sfix, 0x80);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter, 0xf0);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_ne(sfix->config.begin, sfix->ring + 0x80);
+
+	errcode = pt_scatter_user_config(&sfix->config, &sfix->scatter);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(sfix->config.begin, sfix->ring + 0x80);
+	ptu_ptr_eq(sfix->config.end, sfix->ring + sizeof(sfix->ring));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result seek(struct scatter_fixture *sfix, uint32_t head)
+{
+	uint64_t offset, size;
+	int errcode;
+
+	sfix_wrap(sfix, head);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	size = pt_scatter_size(&sfix->scatter, &sfix->config);
+	ptu_uint_eq(size, sizeof(sfix->trace));
+
+	for (offset = 0; offset <= size; ++offset) {
+		const uint8_t *pos;
+		uint64_t pos_offset, space;
+
+		errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter,
+					  offset);
+		ptu_int_eq(errcode, 0);
+		ptu_ptr_ge(pos, sfix->config.begin);
+		ptu_ptr_le(pos, sfix->config.end);
+
+		errcode = pt_scatter_offset(&pos_offset, &sfix->scatter, pos,
+					    &sfix->config);
+		ptu_int_eq(errcode, 0);
+		ptu_uint_eq(pos_offset, offset);
+
+		/* There must be room for the biggest packet. */
+		space = (uint64_t) (sfix->config.end - pos);
+		if (pt_scatter_overlap < size - offset)
+			ptu_uint_gt(space, pt_scatter_overlap);
+		else
+			ptu_uint_eq(space, size - offset);
+
+		/* The window contents must match the trace. */
+		for (; pos < sfix->config.end; ++pos, ++pos_offset)
+			ptu_uint_eq(*pos, sfix->trace[pos_offset]);
+	}
+
+	errcode = pt_scatter_seek(NULL, &sfix->config, &sfix->scatter, 0ull);
+	ptu_int_eq(errcode, -pte_internal);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result seek_eos(struct scatter_fixture *sfix)
+{
+	const uint8_t *pos;
+	int errcode;
+
+	sfix_wrap(sfix, 0x10);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter,
+				  sizeof(sfix->trace) + 1);
+	ptu_int_eq(errcode, -pte_eos);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result normalize(struct scatter_fixture *sfix,
+				      uint32_t head)
+{
+	const uint8_t *pos;
+	uint64_t offset, expected;
+	int errcode;
+
+	sfix_wrap(sfix, head);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter, 0ull);
+	ptu_int_eq(errcode, 0);
+
+	/* Walk through the trace in steps of varying size as a decoder
+	 * would do.
+	 */
+	for (expected = 0; expected < sizeof(sfix->trace);) {
+		uint64_t step;
+
+		errcode = pt_scatter_normalize(&pos, &sfix->config,
+					       &sfix->scatter);
+		ptu_int_eq(errcode, 0);
+
+		errcode = pt_scatter_offset(&offset, &sfix->scatter, pos,
+					    &sfix->config);
+		ptu_int_eq(errcode, 0);
+		ptu_uint_eq(offset, expected);
+		ptu_uint_eq(*pos, sfix->trace[expected]);
+
+		step = 1 + (expected % ptps_psb);
+		if (sizeof(sfix->trace) - expected < step)
+			step = sizeof(sfix->trace) - expected;
+
+		pos += step;
+		expected += step;
+	}
+
+	errcode = pt_scatter_normalize(&pos, &sfix->config, &sfix->scatter);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(pos, sfix->config.end);
+
+	errcode = pt_scatter_offset(&offset, &sfix->scatter, pos,
+				    &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(offset, sizeof(sfix->trace));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sync_fwd(struct scatter_fixture *sfix,
+				     uint32_t head, uint32_t psb)
+{
+	const uint8_t *sync;
+	uint64_t offset;
+	int errcode;
+
+	memset(sfix->trace, 0xcd, sizeof(sfix->trace));
+	sfix_encode_psb(sfix->trace + psb);
+	sfix_wrap(sfix, head);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_forward(&sync, &sfix->config,
+					  &sfix->scatter, 0ull);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_offset(&offset, &sfix->scatter, sync,
+					 &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(offset, psb);
+
+	errcode = pt_scatter_sync_forward(&sync, &sfix->config,
+					  &sfix->scatter, psb + ptps_psb);
+	ptu_int_eq(errcode, -pte_eos);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sync_bwd(struct scatter_fixture *sfix,
+				     uint32_t head, uint32_t psb)
+{
+	const uint8_t *sync;
+	uint64_t offset;
+	int errcode;
+
+	memset(sfix->trace, 0xcd, sizeof(sfix->trace));
+	sfix_encode_psb(sfix->trace + psb);
+	sfix_wrap(sfix, head);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_backward(&sync, &sfix->config,
+					   &sfix->scatter,
+					   sizeof(sfix->trace));
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_offset(&offset, &sfix->scatter, sync,
+					 &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(offset, psb);
+
+	errcode = pt_scatter_sync_backward(&sync, &sfix->config,
+					   &sfix->scatter, psb);
+	ptu_int_eq(errcode, -pte_eos);
+
+	return ptu_passed();
+}
+
+/* Split the trace at @first and @second and compare synchronizing onto the
+ * scattered trace with synchronizing onto the contiguous trace from every
+ * trace offset.
+ */
+static struct ptunit_result sync_split(struct scatter_fixture *sfix,
+				       uint32_t first, uint32_t second)
+{
+	struct pt_trace_part parts[2];
+	struct pt_config config;
+	uint64_t offset;
+	int errcode;
+
+	memset(sfix->trace, 0xcd, sizeof(sfix->trace));
+	sfix_encode_psb(sfix->trace + 0x13);
+	sfix_encode_psb(sfix->trace + 0x45);
+	sfix_encode_psb(sfix->trace + 0x61);
+	sfix_encode_psb(sfix->trace + 0x71);
+	sfix_encode_psb(sfix->trace + 0xa6);
+
+	config = sfix->config;
+
+	sfix->config.end = sfix->trace + first;
+	parts[0].begin = sfix->trace + first;
+	parts[0].end = sfix->trace + second;
+	parts[1].begin = sfix->trace + second;
+	parts[1].end = sfix->trace + sizeof(sfix->trace);
+	sfix->config.parts = parts;
+	sfix->config.nparts = 2;
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	for (offset = 0; offset <= sizeof(sfix->trace); ++offset) {
+		const uint8_t *sync, *expected;
+		uint64_t sync_offset;
+		int status;
+
+		status = pt_sync_forward(&expected, sfix->trace + offset,
+					 &config);
+		errcode = pt_scatter_sync_forward(&sync, &sfix->config,
+						  &sfix->scatter, offset);
+		ptu_int_eq(errcode, status);
+		if (!status) {
+			errcode = pt_scatter_sync_offset(&sync_offset,
+							 &sfix->scatter, sync,
+							 &sfix->config);
+			ptu_int_eq(errcode, 0);
+			ptu_uint_eq(sync_offset,
+				    (uint64_t) (expected - sfix->trace));
+		}
+
+		status = pt_sync_backward(&expected, sfix->trace + offset,
+					  &config);
+		errcode = pt_scatter_sync_backward(&sync, &sfix->config,
+						   &sfix->scatter, offset);
+		ptu_int_eq(errcode, status);
+		if (!status) {
+			errcode = pt_scatter_sync_offset(&sync_offset,
+							 &sfix->scatter, sync,
+							 &sfix->config);
+			ptu_int_eq(errcode, 0);
+			ptu_uint_eq(sync_offset,
+				    (uint64_t) (expected - sfix->trace));
+		}
+	}
+
+	return ptu_passed();
+}
+
+static struct ptunit_result sync_set(struct scatter_fixture *sfix,
+				     uint32_t head, uint32_t psb)
+{
+	const uint8_t *sync;
+	uint64_t offset;
+	int errcode;
+
+	memset(sfix->trace, 0xcd, sizeof(sfix->trace));
+	sfix_encode_psb(sfix->trace + psb);
+	sfix_wrap(sfix, head);
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_set(&sync, &sfix->config, &sfix->scatter,
+				      psb + 1);
+	ptu_int_eq(errcode, -pte_nosync);
+
+	errcode = pt_scatter_sync_set(&sync, &sfix->config, &sfix->scatter,
+				      psb);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_scatter_sync_offset(&offset, &sfix->scatter, sync,
+					 &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(offset, psb);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result many_parts(struct scatter_fixture *sfix)
+{
+	struct pt_trace_part parts[5];
+	const uint8_t *pos;
+	uint64_t offset;
+	int errcode;
+
+	/* Split the trace into tiny and empty parts. */
+	sfix->config.begin = sfix->trace;
+	sfix->config.end = sfix->trace + 3;
+	parts[0].begin = sfix->trace + 3;
+	parts[0].end = sfix->trace + 4;
+	parts[1].begin = sfix->trace + 4;
+	parts[1].end = sfix->trace + 4;
+	parts[2].begin = sfix->trace + 4;
+	parts[2].end = sfix->trace + 0x20;
+	parts[3].begin = sfix->trace + 0x20;
+	parts[3].end = sfix->trace + 0x22;
+	parts[4].begin = sfix->trace + 0x22;
+	parts[4].end = sfix->trace + sizeof(sfix->trace);
+	sfix->config.parts = parts;
+	sfix->config.nparts = 5;
+
+	errcode = pt_scatter_init(&sfix->scatter, &sfix->config);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(sfix->scatter.nwindows, 9);
+	ptu_uint_eq(pt_scatter_size(&sfix->scatter, &sfix->config),
+		    sizeof(sfix->trace));
+
+	for (offset = 0; offset < sizeof(sfix->trace); ++offset) {
+		uint64_t pos_offset;
+
+		errcode = pt_scatter_seek(&pos, &sfix->config, &sfix->scatter,
+					  offset);
+		ptu_int_eq(errcode, 0);
+		ptu_uint_eq(*pos, sfix->trace[offset]);
+
+		errcode = pt_scatter_offset(&pos_offset, &sfix->scatter, pos,
+					    &sfix->config);
+		ptu_int_eq(errcode, 0);
+		ptu_uint_eq(pos_offset, offset);
+	}
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct scatter_fixture sfix;
+	struct ptunit_suite suite;
+
+	sfix.init = sfix_init;
+	sfix.fini = sfix_fini;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, init_null);
+	ptu_run(suite, fini_null);
+
+	ptu_run_f(suite, contiguous, sfix);
+	ptu_run_f(suite, empty_parts, sfix);
+	ptu_run_f(suite, user_config, sfix);
+
+	ptu_run_fp(suite, seek, sfix, 0x1);
+	ptu_run_fp(suite, seek, sfix, 0x8);
+	ptu_run_fp(suite, seek, sfix, 0x80);
+	ptu_run_fp(suite, seek, sfix, 0xff);
+	ptu_run_f(suite, seek_eos, sfix);
+
+	ptu_run_fp(suite, normalize, sfix, 0x3);
+	ptu_run_fp(suite, normalize, sfix, 0x80);
+	ptu_run_fp(suite, normalize, sfix, 0xfe);
+
+	ptu_run_fp(suite, sync_fwd, sfix, 0x80, 0x20);
+	ptu_run_fp(suite, sync_fwd, sfix, 0x80, 0x7a);
+	ptu_run_fp(suite, sync_fwd, sfix, 0x80, 0x80);
+	ptu_run_fp(suite, sync_fwd, sfix, 0x80, 0xa0);
+	ptu_run_fp(suite, sync_fwd, sfix, 0x83, 0x7a);
+
+	ptu_run_fp(suite, sync_bwd, sfix, 0x80, 0x20);
+	ptu_run_fp(suite, sync_bwd, sfix, 0x80, 0x7a);
+	ptu_run_fp(suite, sync_bwd, sfix, 0x80, 0x80);
+	ptu_run_fp(suite, sync_bwd, sfix, 0x80, 0xa0);
+	ptu_run_fp(suite, sync_bwd, sfix, 0x83, 0x7a);
+
+	ptu_run_fp(suite, sync_split, sfix, 0x1d, 0x2f);
+	ptu_run_fp(suite, sync_split, sfix, 0x16, 0x4a);
+	ptu_run_fp(suite, sync_split, sfix, 0x40, 0x48);
+	ptu_run_fp(suite, sync_split, sfix, 0x68, 0x75);
+	ptu_run_fp(suite, sync_split, sfix, 0xa9, 0xab);
+
+	ptu_run_fp(suite, sync_set, sfix, 0x80, 0x20);
+	ptu_run_fp(suite, sync_set, sfix, 0x80, 0x7a);
+	ptu_run_fp(suite, sync_set, sfix, 0x83, 0x79);
+
+	ptu_run_f(suite, many_parts, sfix);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
@@ -52,14 +52,15 @@ struct pt_file_status {
 	long size;
 };
 
-int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
+int pt_section_mk_status(void **pstatus, struct pt_file_id *id,
+			 const char *filename)
 {
 	struct pt_file_status *status;
 	FILE *file;
 	long size;
 	int errcode;
 
-	if (!pstatus || !psize)
+	if (!pstatus || !id)
 		return -pte_internal;
 
 	file = fopen(filename, "rb");
@@ -87,7 +88,44 @@ int pt_section_mk_status(void **pstatus, uint64_t *psize, const char *filename)
 	status->size = size;
 
 	*pstatus = status;
-	*psize = (uint64_t) size;
+	id->size = (uint64_t) size;
+	id->mtime = 0ll;
+
+	errcode = 0;
+
+out_file:
+	fclose(file);
+	return errcode;
+}
+
+int pt_section_file_id(struct pt_file_id *id, const char *filename)
+{
+	FILE *file;
+	long size;
+	int errcode;
+
+	if (!id || !filename)
+		return -pte_internal;
+
+	file = fopen(filename, "rb");
+	if (!file)
+		return -pte_bad_image;
+
+	errcode = fseek(file, 0, SEEK_END);
+	if (errcode) {
+		errcode = -pte_bad_image;
+		goto out_file;
+	}
+
+	size = ftell(file);
+	if (size < 0) {
+		errcode = -pte_bad_image;
+		goto out_file;
+	}
+
+	/* We only check the size. */
+	id->size = (uint64_t) size;
+	id->mtime = 0ll;
 
 	errcode = 0;
 
@@ -98,7 +136,7 @@ out_file:
 
 int pt_section_map(struct pt_section *section)
 {
-	struct pt_file_status *status;
+	struct pt_file_status *status, *lazy;
 	const char *filename;
 	uint16_t mcount;
 	FILE *file;
@@ -129,15 +167,13 @@ int pt_section_map(struct pt_section *section)
 	if (!filename)
 		goto out_unlock;
 
-	status = section->status;
-	if (!status)
-		goto out_unlock;
-
 	errcode = -pte_bad_image;
 	file = fopen(filename, "rb");
 	if (!file)
 		goto out_unlock;
 
+	lazy = NULL;
+
 	errcode = fseek(file, 0, SEEK_END);
 	if (errcode) {
 		errcode = -pte_bad_image;
@@ -149,6 +185,24 @@ int pt_section_map(struct pt_section *section)
 	if (size < 0)
 		goto out_file;
 
+	/* A lazily created section takes the file status on first map.  The
+	 * file must not have changed since the section was created.
+	 */
+	status = section->status;
+	if (!status) {
+		if ((uint64_t) size != section->id.size)
+			goto out_file;
+
+		errcode = -pte_nomem;
+		lazy = malloc(sizeof(*lazy));
+		if (!lazy)
+			goto out_file;
+
+		lazy->size = size;
+		status = lazy;
+	}
+
+	errcode = -pte_bad_image;
 	if (size != status->size)
 		goto out_file;
 
@@ -157,11 +211,13 @@ int pt_section_map(struct pt_section *section)
 	 */
 	errcode = pt_sec_file_map(section, file);
 	if (!errcode) {
+		section->status = status;
 		section->mcount = 1;
 		return pt_section_unlock(section);
 	}
 
 out_file:
+	free(lazy);
 	fclose(file);
 
 out_unlock:
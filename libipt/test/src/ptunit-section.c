@@ -82,6 +82,48 @@ static struct ptunit_result sfix_write_aux(struct section_fixture *sfix,
 #define sfix_write(sfix, buffer)				\
 	ptu_check(sfix_write_aux, sfix, buffer, sizeof(buffer))
 
+/* The size of a big section file.
+ *
+ * It is big enough to be mapped in windows.
+ */
+static const uint64_t big_size = 0x1100000ull;
+
+/* The byte at @offset in a big section file. */
+static uint8_t big_byte(uint64_t offset)
+{
+	return (uint8_t) (offset ^ (offset >> 8) ^ (offset >> 16));
+}
+
+static struct ptunit_result sfix_write_big(struct section_fixture *sfix)
+{
+	uint8_t buffer[0x1000];
+	uint64_t offset;
+
+	for (offset = 0ull; offset < big_size; offset += sizeof(buffer)) {
+		size_t idx;
+
+		for (idx = 0; idx < sizeof(buffer); ++idx)
+			buffer[idx] = big_byte(offset + idx);
+
+		sfix_write(sfix, buffer);
+	}
+
+	return ptu_passed();
+}
+
+/* Check that @size bytes in @buffer match a big section file at @offset. */
+static int big_check(const uint8_t *buffer, int size, uint64_t offset)
+{
+	int idx;
+
+	for (idx = 0; idx < size; ++idx) {
+		if (buffer[idx] != big_byte(offset + idx))
+			return 0;
+	}
+
+	return 1;
+}
+
 static struct ptunit_result create(struct section_fixture *sfix)
 {
 	const char *name;
@@ -138,6 +180,71 @@ static struct ptunit_result create_empty(struct section_fixture *sfix)
 	return ptu_passed();
 }
 
+static struct ptunit_result create_lazy(struct section_fixture *sfix)
+{
+	struct pt_file_id id;
+	uint64_t size;
+
+	id.size = 0x5ull;
+	id.mtime = 0ll;
+
+	/* The file is not accessed. */
+	sfix->section = pt_mk_section_lazy(sfix->name, 0x1ull, 0x10ull, &id);
+	ptu_ptr(sfix->section);
+	ptu_null(sfix->section->status);
+
+	size = pt_section_size(sfix->section);
+	ptu_uint_eq(size, 0x4ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result create_lazy_bad_offset(
+	struct section_fixture *sfix)
+{
+	struct pt_file_id id;
+
+	id.size = 0x5ull;
+	id.mtime = 0ll;
+
+	sfix->section = pt_mk_section_lazy(sfix->name, 0x5ull, 0x10ull, &id);
+	ptu_null(sfix->section);
+
+	sfix->section = pt_mk_section_lazy(sfix->name, 0x0ull, 0x10ull, NULL);
+	ptu_null(sfix->section);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result file_id(struct section_fixture *sfix)
+{
+	uint8_t bytes[] = { 0xcc, 0xcc, 0xcc, 0xcc, 0xcc };
+	struct pt_file_id id;
+	int status;
+
+	sfix_write(sfix, bytes);
+
+	status = pt_section_file_id(&id, sfix->name);
+	ptu_int_eq(status, 0);
+	ptu_uint_eq(id.size, sizeof(bytes));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result file_id_null(void)
+{
+	struct pt_file_id id;
+	int status;
+
+	status = pt_section_file_id(NULL, "file");
+	ptu_int_eq(status, -pte_internal);
+
+	status = pt_section_file_id(&id, NULL);
+	ptu_int_eq(status, -pte_internal);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result filename_null(void)
 {
 	const char *name;
@@ -370,6 +477,62 @@ static struct ptunit_result read(struct section_fixture *sfix)
 	return ptu_passed();
 }
 
+static struct ptunit_result read_lazy(struct section_fixture *sfix)
+{
+	uint8_t bytes[] = { 0xcc, 0x2, 0x4, 0x6 };
+	uint8_t buffer[] = { 0xcc, 0xcc, 0xcc };
+	struct pt_file_id id;
+	int status;
+
+	sfix_write(sfix, bytes);
+
+	status = pt_section_file_id(&id, sfix->name);
+	ptu_int_eq(status, 0);
+
+	sfix->section = pt_mk_section_lazy(sfix->name, 0x1ull, 0x3ull, &id);
+	ptu_ptr(sfix->section);
+	ptu_null(sfix->section->status);
+
+	status = pt_section_map(sfix->section);
+	ptu_int_eq(status, 0);
+	ptu_ptr(sfix->section->status);
+
+	status = pt_section_read(sfix->section, buffer, 2, 0x0ull);
+	ptu_int_eq(status, 2);
+	ptu_uint_eq(buffer[0], bytes[1]);
+	ptu_uint_eq(buffer[1], bytes[2]);
+	ptu_uint_eq(buffer[2], 0xcc);
+
+	status = pt_section_unmap(sfix->section);
+	ptu_int_eq(status, 0);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result map_lazy_changed(struct section_fixture *sfix)
+{
+	uint8_t bytes[] = { 0xcc, 0x2, 0x4, 0x6 };
+	struct pt_file_id id;
+	int status;
+
+	sfix_write(sfix, bytes);
+
+	status = pt_section_file_id(&id, sfix->name);
+	ptu_int_eq(status, 0);
+
+	sfix->section = pt_mk_section_lazy(sfix->name, 0x1ull, 0x2ull, &id);
+	ptu_ptr(sfix->section);
+
+	/* The file changed since we determined its identity. */
+	sfix_write(sfix, bytes);
+
+	status = pt_section_map(sfix->section);
+	ptu_int_eq(status, -pte_bad_image);
+	ptu_null(sfix->section->status);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result read_offset(struct section_fixture *sfix)
 {
 	uint8_t bytes[] = { 0xcc, 0x2, 0x4, 0x6 };
@@ -578,6 +741,47 @@ static struct ptunit_result read_unmap_map(struct section_fixture *sfix)
 	return ptu_passed();
 }
 
+static struct ptunit_result read_big(struct section_fixture *sfix)
+{
+	uint64_t offset[] = {
+		0x0ull, 0x1ffff8ull, 0x200000ull, 0x5ffff0ull, 0xa00000ull,
+		0xe00123ull, 0x1000000ull, 0x7ull, 0x10fffdfull
+	};
+	uint8_t buffer[0x20];
+	int idx, status;
+
+	ptu_test(sfix_write_big, sfix);
+
+	/* Start at an offset that isn't page-aligned. */
+	sfix->section = pt_mk_section(sfix->name, 0x1ull, big_size);
+	ptu_ptr(sfix->section);
+	ptu_uint_eq(pt_section_size(sfix->section), big_size - 1ull);
+
+	status = pt_section_map(sfix->section);
+	ptu_int_eq(status, 0);
+
+	/* The reads cross windows and touch more windows than are kept. */
+	for (idx = 0; idx < (int) (sizeof(offset) / sizeof(offset[0])); ++idx) {
+		memset(buffer, 0xcc, sizeof(buffer));
+
+		status = pt_section_read(sfix->section, buffer, sizeof(buffer),
+					 offset[idx]);
+		ptu_int_eq(status, sizeof(buffer));
+		ptu_int_eq(big_check(buffer, status, offset[idx] + 1ull), 1);
+	}
+
+	/* The read is truncated at the end of the section. */
+	status = pt_section_read(sfix->section, buffer, sizeof(buffer),
+				 big_size - 0x9ull);
+	ptu_int_eq(status, 0x8);
+	ptu_int_eq(big_check(buffer, status, big_size - 0x8ull), 1);
+
+	status = pt_section_unmap(sfix->section);
+	ptu_int_eq(status, 0);
+
+	return ptu_passed();
+}
+
 static int worker(void *arg)
 {
 	struct section_fixture *sfix;
@@ -651,6 +855,72 @@ static struct ptunit_result stress(struct section_fixture *sfix)
 	return ptu_passed();
 }
 
+static int worker_big(void *arg)
+{
+	struct section_fixture *sfix;
+	uint64_t offset;
+	int it, errcode;
+
+	sfix = arg;
+	if (!sfix)
+		return -pte_internal;
+
+	errcode = pt_section_map(sfix->section);
+	if (errcode < 0)
+		return errcode;
+
+	offset = 0ull;
+	for (it = 0; it < num_work; ++it) {
+		uint8_t buffer[0x10];
+		int read;
+
+		/* Walk through the windows in a pseudo-random order. */
+		offset = (offset + 0x1234567ull) % (big_size - 0x10ull);
+
+		read = pt_section_read(sfix->section, buffer, sizeof(buffer),
+				       offset);
+		if (read < 0) {
+			errcode = read;
+			goto out_unmap;
+		}
+
+		errcode = -pte_invalid;
+		if ((read != sizeof(buffer)) || !big_check(buffer, read, offset))
+			goto out_unmap;
+	}
+
+	return pt_section_unmap(sfix->section);
+
+out_unmap:
+	(void) pt_section_unmap(sfix->section);
+	return errcode;
+}
+
+static struct ptunit_result stress_big(struct section_fixture *sfix)
+{
+	int errcode;
+
+	ptu_test(sfix_write_big, sfix);
+
+	sfix->section = pt_mk_section(sfix->name, 0x0ull, big_size);
+	ptu_ptr(sfix->section);
+
+#if defined(FEATURE_THREADS)
+	{
+		int thrd;
+
+		for (thrd = 0; thrd < num_threads; ++thrd)
+			ptu_test(ptunit_thrd_create, &sfix->thrd, worker_big,
+				 sfix);
+	}
+#endif /* defined(FEATURE_THREADS) */
+
+	errcode = worker_big(sfix);
+	ptu_int_eq(errcode, 0);
+
+	return ptu_passed();
+}
+
 static struct ptunit_result sfix_init(struct section_fixture *sfix)
 {
 	sfix->section = NULL;
@@ -709,6 +979,9 @@ int main(int argc, char **argv)
 	ptu_run_f(suite, create_bad_offset, sfix);
 	ptu_run_f(suite, create_truncated, sfix);
 	ptu_run_f(suite, create_empty, sfix);
+	ptu_run_f(suite, create_lazy, sfix);
+	ptu_run_f(suite, create_lazy_bad_offset, sfix);
+	ptu_run_f(suite, file_id, sfix);
 
 	ptu_run(suite, filename_null);
 	ptu_run(suite, size_null);
@@ -716,6 +989,7 @@ int main(int argc, char **argv)
 	ptu_run(suite, put_null);
 	ptu_run(suite, map_null);
 	ptu_run(suite, unmap_null);
+	ptu_run(suite, file_id_null);
 
 	ptu_run_f(suite, get_overflow, sfix);
 	ptu_run_f(suite, map_change, sfix);
@@ -725,6 +999,8 @@ int main(int argc, char **argv)
 	ptu_run_f(suite, get_put, sfix);
 	ptu_run_f(suite, map_unmap, sfix);
 	ptu_run_f(suite, read, sfix);
+	ptu_run_f(suite, read_lazy, sfix);
+	ptu_run_f(suite, map_lazy_changed, sfix);
 	ptu_run_f(suite, read_offset, sfix);
 	ptu_run_f(suite, read_truncated, sfix);
 	ptu_run_f(suite, read_from_truncated, sfix);
@@ -733,7 +1009,9 @@ int main(int argc, char **argv)
 	ptu_run_f(suite, read_overflow_32bit, sfix);
 	ptu_run_f(suite, read_nomap, sfix);
 	ptu_run_f(suite, read_unmap_map, sfix);
+	ptu_run_f(suite, read_big, sfix);
 	ptu_run_f(suite, stress, sfix);
+	ptu_run_f(suite, stress_big, sfix);
 
 	ptunit_report(&suite);
 	return suite.nr_fails;
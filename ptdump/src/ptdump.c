@@ -26,9 +26,16 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(FEATURE_MMAP)
+# define _POSIX_C_SOURCE 200112L
+# define _DEFAULT_SOURCE 1
+# define _DARWIN_C_SOURCE 1
+#endif /* defined(FEATURE_MMAP) */
+
 #include "pt_cpu.h"
 #include "pt_last_ip.h"
 #include "pt_time.h"
+#include "pt_perf.h"
 
 #include "intel-pt.h"
 
@@ -39,6 +46,25 @@
 #include <stdio.h>
 #include <errno.h>
 
+#if defined(FEATURE_MMAP)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif /* defined(FEATURE_MMAP) */
+
+#if defined(FEATURE_THREADS)
+# include <threads.h>
+
+# if defined(_MSC_VER)
+#  define ptdump_thread_local __declspec(thread)
+# else
+#  define ptdump_thread_local __thread
+# endif
+#else
+# define ptdump_thread_local
+#endif /* defined(FEATURE_THREADS) */
+
 
 struct ptdump_options {
 	/* Show the current offset in the trace stream. */
@@ -85,6 +111,27 @@ struct ptdump_options {
 
 	/* Don't show CYC packets and ignore them when tracking time. */
 	uint32_t no_cyc:1;
+
+	/* Prefault the trace file when mapping it. */
+	uint32_t pt_populate:1;
+
+	/* Print statistics instead of packets. */
+	uint32_t stats:1;
+
+	/* The number of threads to use for decoding. */
+	uint32_t threads;
+};
+
+/* A trace file loaded into memory. */
+struct ptdump_file {
+	/* The mapped or allocated memory. */
+	void *base;
+
+	/* The size of @base in bytes. */
+	size_t size;
+
+	/* A flag telling whether @base has been mapped. */
+	uint32_t mapped:1;
 };
 
 struct ptdump_buffer {
@@ -147,6 +194,135 @@ struct ptdump_tracking {
 	uint32_t in_header:1;
 };
 
+/* The packet types we distinguish in statistics. */
+enum ptdump_stats_type {
+	pst_pad,
+	pst_psb,
+	pst_psbend,
+	pst_ovf,
+	pst_stop,
+	pst_fup,
+	pst_tip,
+	pst_tip_pge,
+	pst_tip_pgd,
+	pst_tnt_8,
+	pst_tnt_64,
+	pst_mode,
+	pst_pip,
+	pst_vmcs,
+	pst_tsc,
+	pst_cbr,
+	pst_tma,
+	pst_mtc,
+	pst_cyc,
+	pst_mnt,
+	pst_unknown,
+
+	pst_num
+};
+
+/* The packet type names in statistics indexed by enum ptdump_stats_type. */
+static const char * const stats_type_name[pst_num] = {
+	"pad",
+	"psb",
+	"psbend",
+	"ovf",
+	"stop",
+	"fup",
+	"tip",
+	"tip.pge",
+	"tip.pgd",
+	"tnt.8",
+	"tnt.64",
+	"mode",
+	"pip",
+	"vmcs",
+	"tsc",
+	"cbr",
+	"tma",
+	"mtc",
+	"cyc",
+	"mnt",
+	"<unknown>"
+};
+
+struct ptdump_stats {
+	/* The number of packets per packet type. */
+	uint64_t packets[pst_num];
+
+	/* The number of bytes per packet type. */
+	uint64_t bytes[pst_num];
+
+	/* The number of decode errors. */
+	uint64_t errors;
+
+	/* The offset of the last PSB packet. */
+	uint64_t psb_offset;
+
+	/* The sum, minimum, and maximum distance between PSB packets. */
+	uint64_t psb_gap_sum;
+	uint64_t psb_gap_min;
+	uint64_t psb_gap_max;
+
+	/* The first, minimal, and maximal TSC. */
+	uint64_t tsc_first;
+	uint64_t tsc_min;
+	uint64_t tsc_max;
+};
+
+/* The formatted output for a part of the trace between two PSB packets.
+ *
+ * When decoding with multiple threads, each thread formats the segments it
+ * decodes into memory.  The main thread writes them to stdout in order.
+ */
+struct ptdump_segment {
+	/* The formatted output. */
+	char *text;
+
+	/* The number of bytes used and allocated in @text. */
+	size_t size;
+	size_t capacity;
+
+	/* The index of the segment at which decoding continued. */
+	size_t next;
+
+	/* The error code with which decoding ended, if @next is the end. */
+	int errcode;
+
+	/* A flag saying whether the segment has been decoded. */
+	uint32_t done:1;
+
+	/* A flag saying whether the segment's output is not needed. */
+	uint32_t discard:1;
+};
+
+/* The size of the output buffer in bytes. */
+enum {
+	ptdump_output_size	= 1 << 16
+};
+
+/* A buffer for formatted output.
+ *
+ * We format everything we print to stdout into this buffer and write it out
+ * in large chunks to avoid the overhead of stdio formatting and locking.
+ */
+struct ptdump_output {
+	/* The formatted output. */
+	char data[ptdump_output_size];
+
+	/* The number of bytes used in @data. */
+	size_t size;
+
+	/* The segment to write to instead of stdout - NULL for stdout. */
+	struct ptdump_segment *segment;
+};
+
+/* The output buffer.
+ *
+ * Each thread formats into its own buffer.
+ */
+static ptdump_thread_local struct ptdump_output output;
+
 static int usage(const char *name)
 {
 	fprintf(stderr,
@@ -170,7 +346,8 @@ static int unknown_option_error(const char *arg, const char *name)
 static int help(const char *name)
 {
 	fprintf(stderr,
-		"usage: %s [<options>] <ptfile>[:<from>[-<to>]\n\n"
+		"usage: %s [<options>] <ptfile>[:<from>[-<to>]\n"
+		"       %s [<options>] --perf <file>[:<idx>]\n\n"
 		"options:\n"
 		"  --help|-h                 this text.\n"
 		"  --version                 display version information and exit.\n"
@@ -198,9 +375,17 @@ static int help(const char *name)
 		"  --nom-freq <n>            set the nominal frequency (MSR_PLATFORM_INFO[15:8]) to <n>.\n"
 		"  --cpuid-0x15.eax          set the value of cpuid[0x15].eax.\n"
 		"  --cpuid-0x15.ebx          set the value of cpuid[0x15].ebx.\n"
+		"  --pt-populate             prefault the trace file when mapping it.\n"
+		"  --stats                   print packet statistics instead of packets.\n"
+		"  --threads <n>             decode in <n> threads (default: 1).\n"
+		"                            ignored with --time, --tcal, and --stats.\n"
+		"  --perf <file>[:<idx>]     load the processor trace data for AUX area <idx>\n"
+		"                            (default: 0) from the perf.data file <file>.\n"
+		"                            the cpu and timing configuration is taken from\n"
+		"                            <file> unless given explicitly.\n"
 		"  <ptfile>[:<from>[-<to>]]  load the processor trace data from <ptfile>;\n"
 		"                            an optional offset or range can be given.\n",
-		name);
+		name, name);
 
 	return 0;
 }
@@ -240,8 +425,201 @@ static int parse_range(const char *arg, uint64_t *begin, uint64_t *end)
 	return 2;
 }
 
-static int load_file(uint8_t **buffer, size_t *size, char *arg,
-		     const char *prog)
+static int check_range(uint64_t *pbegin, uint64_t *pend, uint64_t fsize,
+		       int range_parts, const char *arg, const char *prog)
+{
+	uint64_t begin, end;
+
+	begin = *pbegin;
+	end = *pend;
+
+	/* Truncate the range to fit into the file unless an explicit range end
+	 * was provided.
+	 */
+	if (range_parts < 2)
+		end = fsize;
+
+	if (fsize <= begin) {
+		fprintf(stderr, "%s: offset 0x%" PRIx64 " outside of %s.\n",
+			prog, begin, arg);
+		return -1;
+	}
+
+	if (fsize < end) {
+		fprintf(stderr, "%s: range 0x%" PRIx64 " outside of %s.\n",
+			prog, end, arg);
+		return -1;
+	}
+
+	if (end <= begin) {
+		fprintf(stderr, "%s: bad range.\n", prog);
+		return -1;
+	}
+
+	*pend = end;
+
+	return 0;
+}
+
+#if defined(FEATURE_MMAP)
+
+/* Map the trace file @file read-only.
+ *
+ * Returns zero on success.
+ * Returns a negative value if the requested range is not valid.
+ * Returns a positive value if @file can not be mapped and should be read,
+ * instead.
+ */
+static int map_file(struct ptdump_file *loaded, uint8_t **buffer, size_t *size,
+		    FILE *file, uint64_t begin, uint64_t end, int range_parts,
+		    int populate, const char *arg, const char *prog)
+{
+	struct stat stat;
+	uint64_t offset, length;
+	uint8_t *base;
+	long page_size;
+	int fd, errcode, flags;
+
+	fd = fileno(file);
+	if (fd < 0)
+		return 1;
+
+	errcode = fstat(fd, &stat);
+	if (errcode < 0)
+		return 1;
+
+	/* Pipes and other special files are read. */
+	if (!S_ISREG(stat.st_mode) || stat.st_size <= 0)
+		return 1;
+
+	errcode = check_range(&begin, &end, (uint64_t) stat.st_size,
+			      range_parts, arg, prog);
+	if (errcode < 0)
+		return errcode;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0)
+		return 1;
+
+	/* The mapping must start at a page boundary. */
+	offset = begin - (begin % (uint64_t) page_size);
+	length = end - offset;
+
+	if ((uint64_t) (size_t) length != length ||
+	    (uint64_t) (off_t) offset != offset)
+		return 1;
+
+	flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+	if (populate)
+		flags |= MAP_POPULATE;
+#endif /* defined(MAP_POPULATE) */
+
+	base = mmap(NULL, (size_t) length, PROT_READ, flags, fd,
+		    (off_t) offset);
+	if (base == MAP_FAILED)
+		return 1;
+
+	/* The hints are only an optimization - we ignore errors. */
+	(void) posix_madvise(base, (size_t) length, POSIX_MADV_SEQUENTIAL);
+#if !defined(MAP_POPULATE)
+	if (populate)
+		(void) posix_madvise(base, (size_t) length,
+				     POSIX_MADV_WILLNEED);
+#endif /* !defined(MAP_POPULATE) */
+
+	loaded->base = base;
+	loaded->size = (size_t) length;
+	loaded->mapped = 1;
+
+	*buffer = base + (begin - offset);
+	*size = (size_t) (end - begin);
+
+	return 0;
+}
+
+#endif /* defined(FEATURE_MMAP) */
+
+/* Read the trace file @file that does not support seeking, e.g. a pipe.
+ *
+ * Returns zero on success, a negative value otherwise.
+ */
+static int read_stream(struct ptdump_file *loaded, uint8_t **buffer,
+		       size_t *size, FILE *file, uint64_t begin, uint64_t end,
+		       int range_parts, const char *arg, const char *prog)
+{
+	uint8_t *content;
+	size_t fsize, capacity;
+	int errcode;
+
+	content = NULL;
+	fsize = 0;
+	capacity = 0;
+
+	for (;;) {
+		size_t read, request;
+
+		/* We do not need to read beyond an explicit range end. */
+		if (range_parts == 2 && end <= fsize)
+			break;
+
+		if (fsize == capacity) {
+			uint8_t *grown;
+
+			capacity = capacity ? capacity * 2 : 0x10000;
+			if (capacity <= fsize) {
+				fprintf(stderr, "%s: %s is too big.\n",
+					prog, arg);
+				goto err_content;
+			}
+
+			grown = realloc(content, capacity);
+			if (!grown) {
+				fprintf(stderr,
+					"%s: failed to allocated memory %s.\n",
+					prog, arg);
+				goto err_content;
+			}
+
+			content = grown;
+		}
+
+		request = capacity - fsize;
+		read = fread(content + fsize, 1, request, file);
+		fsize += read;
+
+		if (read < request) {
+			if (ferror(file)) {
+				fprintf(stderr, "%s: failed to load %s: %d.\n",
+					prog, arg, errno);
+				goto err_content;
+			}
+
+			break;
+		}
+	}
+
+	errcode = check_range(&begin, &end, (uint64_t) fsize, range_parts,
+			      arg, prog);
+	if (errcode < 0)
+		goto err_content;
+
+	loaded->base = content;
+	loaded->size = capacity;
+	loaded->mapped = 0;
+
+	*buffer = content + begin;
+	*size = (size_t) (end - begin);
+
+	return 0;
+
+err_content:
+	free(content);
+	return -1;
+}
+
+static int load_file(struct ptdump_file *loaded, uint8_t **buffer, size_t *size,
+		     char *arg, int populate, const char *prog)
 {
 	uint64_t begin_arg, end_arg;
 	uint8_t *content;
@@ -251,7 +629,7 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 	int errcode, range_parts;
 	char *range;
 
-	if (!buffer || !size || !arg || !prog) {
+	if (!loaded || !buffer || !size || !arg || !prog) {
 		fprintf(stderr, "%s: internal error.\n", prog ? prog : "");
 		return -1;
 	}
@@ -286,11 +664,20 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		return -1;
 	}
 
+#if defined(FEATURE_MMAP)
+	errcode = map_file(loaded, buffer, size, file, begin_arg, end_arg,
+			   range_parts, populate, arg, prog);
+	if (errcode <= 0)
+		goto out_file;
+#else
+	(void) populate;
+#endif /* defined(FEATURE_MMAP) */
+
 	errcode = fseek(file, 0, SEEK_END);
 	if (errcode) {
-		fprintf(stderr, "%s: failed to determine size of %s: %d.\n",
-			prog, arg, errno);
-		goto err_file;
+		errcode = read_stream(loaded, buffer, size, file, begin_arg,
+				      end_arg, range_parts, arg, prog);
+		goto out_file;
 	}
 
 	fsize = ftell(file);
@@ -300,11 +687,10 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		goto err_file;
 	}
 
-	/* Truncate the range to fit into the file unless an explicit range end
-	 * was provided.
-	 */
-	if (range_parts < 2)
-		end_arg = (uint64_t) fsize;
+	errcode = check_range(&begin_arg, &end_arg, (uint64_t) fsize,
+			      range_parts, arg, prog);
+	if (errcode < 0)
+		goto err_file;
 
 	begin = (long) begin_arg;
 	end = (long) end_arg;
@@ -313,23 +699,6 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		goto err_file;
 	}
 
-	if (fsize <= begin) {
-		fprintf(stderr, "%s: offset 0x%lx outside of %s.\n",
-			prog, begin, arg);
-		goto err_file;
-	}
-
-	if (fsize < end) {
-		fprintf(stderr, "%s: range 0x%lx outside of %s.\n",
-			prog, end, arg);
-		goto err_file;
-	}
-
-	if (end <= begin) {
-		fprintf(stderr, "%s: bad range.\n", prog);
-		goto err_file;
-	}
-
 	fsize = end - begin;
 
 	content = malloc(fsize);
@@ -355,11 +724,19 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 
 	fclose(file);
 
+	loaded->base = content;
+	loaded->size = (size_t) fsize;
+	loaded->mapped = 0;
+
 	*buffer = content;
 	*size = fsize;
 
 	return 0;
 
+out_file:
+	fclose(file);
+	return errcode;
+
 err_content:
 	free(content);
 
@@ -368,13 +745,30 @@ err_file:
 	return -1;
 }
 
-static int load_pt(struct pt_config *config, char *arg, const char *prog)
+static void unload_file(struct ptdump_file *loaded)
+{
+	if (!loaded || !loaded->base)
+		return;
+
+#if defined(FEATURE_MMAP)
+	if (loaded->mapped)
+		(void) munmap(loaded->base, loaded->size);
+	else
+#endif /* defined(FEATURE_MMAP) */
+		free(loaded->base);
+
+	loaded->base = NULL;
+	loaded->size = 0;
+}
+
+static int load_pt(struct pt_config *config, struct ptdump_file *loaded,
+		   char *arg, int populate, const char *prog)
 {
 	uint8_t *buffer;
 	size_t size;
 	int errcode;
 
-	errcode = load_file(&buffer, &size, arg, prog);
+	errcode = load_file(loaded, &buffer, &size, arg, populate, prog);
 	if (errcode < 0)
 		return errcode;
 
@@ -384,141 +778,415 @@ static int load_pt(struct pt_config *config, char *arg, const char *prog)
 	return 0;
 }
 
-static int diag(const char *errstr, uint64_t offset, int errcode)
+/* Load the trace for one AUX area from a perf.data file.
+ *
+ * The AUX area index may be given as :<idx> suffix to @arg.  It defaults to
+ * zero.
+ *
+ * The trace is not copied.  @config points into @loaded via @perf, both of
+ * which must remain valid while @config is used.
+ */
+static int load_perf(struct pt_config *config, struct pt_perf *perf,
+		     struct ptdump_file *loaded, char *arg, int populate,
+		     const char *prog)
 {
-	if (errcode)
-		printf("[%" PRIx64 ": %s: %s]\n", offset, errstr,
-		       pt_errstr(pt_errcode(errcode)));
-	else
-		printf("[%" PRIx64 ": %s]\n", offset, errstr);
+	uint64_t idx;
+	uint8_t *buffer;
+	size_t size;
+	char *sep;
+	int errcode;
 
-	return errcode;
+	idx = 0ull;
+
+	sep = strrchr(arg, ':');
+	if (sep) {
+		char *rest;
+
+		/* If we can't parse the index, assume that the ':' is part
+		 * of the filename, e.g. a drive letter on Windows.
+		 */
+		errno = 0;
+		idx = strtoull(sep + 1, &rest, 0);
+		if (errno || !sep[1] || *rest || (UINT32_MAX < idx))
+			idx = 0ull;
+		else
+			*sep = 0;
+	}
+
+	errcode = load_file(loaded, &buffer, &size, arg, populate, prog);
+	if (errcode < 0)
+		return errcode;
+
+	errcode = pt_perf_init(perf, buffer, buffer + size);
+	if (errcode < 0) {
+		fprintf(stderr, "%s: failed to read %s: %s.\n", prog, arg,
+			pt_errstr(pt_errcode(errcode)));
+		return errcode;
+	}
+
+	errcode = pt_perf_config(config, perf, (uint32_t) idx);
+	if (errcode < 0) {
+		fprintf(stderr, "%s: no trace for AUX area %" PRIu64 " in %s.\n",
+			prog, idx, arg);
+		return errcode;
+	}
+
+	return 0;
 }
 
-static void ptdump_tracking_init(struct ptdump_tracking *tracking)
+/* Append @size bytes from @data to @segment's text. */
+static void segment_append(struct ptdump_segment *segment, const char *data,
+			   size_t size)
 {
-	if (!tracking)
-		return;
+	if (segment->capacity - segment->size < size) {
+		size_t capacity;
+		char *text;
+
+		capacity = segment->capacity ? segment->capacity : size;
+		while (capacity - segment->size < size)
+			capacity *= 2;
+
+		text = realloc(segment->text, capacity);
+		if (!text) {
+			fprintf(stderr, "ptdump: out of memory.\n");
+			return;
+		}
 
-	pt_last_ip_init(&tracking->last_ip);
-	pt_tcal_init(&tracking->tcal);
-	pt_time_init(&tracking->time);
+		segment->text = text;
+		segment->capacity = capacity;
+	}
 
-	tracking->tsc = 0ull;
-	tracking->fcr = 0ull;
-	tracking->in_header = 0;
+	memcpy(segment->text + segment->size, data, size);
+	segment->size += size;
 }
 
-static void ptdump_tracking_reset(struct ptdump_tracking *tracking)
+static void output_flush(void)
 {
-	if (!tracking)
+	if (!output.size)
 		return;
 
-	pt_last_ip_init(&tracking->last_ip);
-	pt_tcal_init(&tracking->tcal);
-	pt_time_init(&tracking->time);
+	if (output.segment)
+		segment_append(output.segment, output.data, output.size);
+	else {
+		fwrite(output.data, output.size, 1, stdout);
+		fflush(stdout);
+	}
 
-	tracking->tsc = 0ull;
-	tracking->fcr = 0ull;
-	tracking->in_header = 0;
+	output.size = 0;
 }
 
-static void ptdump_tracking_fini(struct ptdump_tracking *tracking)
+/* Reserve @size bytes in the output buffer.
+ *
+ * Returns a pointer to the reserved bytes.  The caller must not reserve more
+ * than ptdump_output_size bytes.
+ */
+static char *output_reserve(size_t size)
 {
-	(void) tracking;
+	char *pos;
 
-	/* Nothing to do. */
-}
+	if ((sizeof(output.data) - output.size) < size)
+		output_flush();
 
-#define print_field(field, ...)					\
-	do {							\
-		/* Avoid partial overwrites. */			\
-		memset(field, 0, sizeof(field));		\
-		snprintf(field, sizeof(field), __VA_ARGS__);	\
-	} while (0)
+	pos = &output.data[output.size];
+	output.size += size;
 
+	return pos;
+}
 
-static int print_buffer(struct ptdump_buffer *buffer, uint64_t offset,
-			const struct ptdump_options *options)
+static void output_char(char c)
 {
-	const char *sep;
-
-	if (!buffer)
-		return diag("error printing buffer", offset, -pte_internal);
+	*output_reserve(1) = c;
+}
 
-	if (buffer->skip || options->quiet)
-		return 0;
+static void output_str(const char *str)
+{
+	size_t size;
 
-	/* Make sure the first column starts at the beginning of the line - no
-	 * matter what column is first.
-	 */
-	sep = "";
+	size = strlen(str);
+	memcpy(output_reserve(size), str, size);
+}
+
+/* Print @str left-aligned in a column of @width characters.
+ *
+ * This is equivalent to printf("%-*s", width, str).
+ */
+static void output_padded(const char *str, size_t width)
+{
+	size_t size;
+	char *pos;
+
+	size = strlen(str);
+	if (width < size)
+		width = size;
+
+	pos = output_reserve(width);
+	memcpy(pos, str, size);
+	memset(pos + size, ' ', width - size);
+}
+
+static void output_printf(const char *format, ...)
+{
+	size_t avail;
+	va_list ap;
+	int size;
+
+	avail = sizeof(output.data) - output.size;
+
+	va_start(ap, format);
+	size = vsnprintf(&output.data[output.size], avail, format, ap);
+	va_end(ap);
+
+	if (size < 0)
+		return;
+
+	/* If it didn't fit, flush and try again.  We truncate anything that
+	 * doesn't fit into an empty buffer.
+	 */
+	if (avail <= (size_t) size) {
+		output_flush();
+
+		avail = sizeof(output.data);
+
+		va_start(ap, format);
+		size = vsnprintf(output.data, avail, format, ap);
+		va_end(ap);
+
+		if (size < 0)
+			return;
+
+		if (avail <= (size_t) size)
+			size = (int) avail - 1;
+	}
+
+	output.size += (size_t) size;
+}
+
+static int diag(const char *errstr, uint64_t offset, int errcode)
+{
+	if (errcode)
+		output_printf("[%" PRIx64 ": %s: %s]\n", offset, errstr,
+			      pt_errstr(pt_errcode(errcode)));
+	else
+		output_printf("[%" PRIx64 ": %s]\n", offset, errstr);
+
+	return errcode;
+}
+
+static void ptdump_tracking_init(struct ptdump_tracking *tracking)
+{
+	if (!tracking)
+		return;
+
+	pt_last_ip_init(&tracking->last_ip);
+	pt_tcal_init(&tracking->tcal);
+	pt_time_init(&tracking->time);
+
+	tracking->tsc = 0ull;
+	tracking->fcr = 0ull;
+	tracking->in_header = 0;
+}
+
+static void ptdump_tracking_reset(struct ptdump_tracking *tracking)
+{
+	if (!tracking)
+		return;
+
+	pt_last_ip_init(&tracking->last_ip);
+	pt_tcal_init(&tracking->tcal);
+	pt_time_init(&tracking->time);
+
+	tracking->tsc = 0ull;
+	tracking->fcr = 0ull;
+	tracking->in_header = 0;
+}
+
+static void ptdump_tracking_fini(struct ptdump_tracking *tracking)
+{
+	(void) tracking;
+
+	/* Nothing to do. */
+}
+
+#define print_field(field, ...)					\
+	do {							\
+		/* Avoid partial overwrites. */			\
+		memset(field, 0, sizeof(field));		\
+		snprintf(field, sizeof(field), __VA_ARGS__);	\
+	} while (0)
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* Format @value in hexadecimal into @pos.
+ *
+ * Pads to @width digits with leading zeros.  With a @width of zero, this is
+ * equivalent to printf("%" PRIx64, value).
+ *
+ * Returns a pointer one past the last digit.  Does not terminate the string.
+ */
+static char *format_hex(char *pos, uint64_t value, int width)
+{
+	char digits[16];
+	int ndigits;
+
+	ndigits = 0;
+	do {
+		digits[ndigits++] = hex_digits[value & 0xf];
+		value >>= 4;
+	} while (value);
+
+	for (; ndigits < width; --width)
+		*pos++ = '0';
+
+	while (ndigits)
+		*pos++ = digits[--ndigits];
+
+	return pos;
+}
+
+/* Print @value in hexadecimal into @field.
+ *
+ * This is equivalent to print_field(field, "%0*" PRIx64, width, value).  The
+ * caller must ensure that the result fits into @field.
+ */
+#define print_field_hex(field, value, width)			\
+	do {							\
+		char *end;					\
+								\
+		end = format_hex(field, value, width);		\
+		*end = 0;					\
+	} while (0)
+
+
+static int print_buffer(struct ptdump_buffer *buffer, uint64_t offset,
+			const struct ptdump_options *options)
+{
+	const char *sep;
+
+	if (!buffer)
+		return diag("error printing buffer", offset, -pte_internal);
+
+	if (buffer->skip || options->quiet)
+		return 0;
+
+	/* Make sure the first column starts at the beginning of the line - no
+	 * matter what column is first.
+	 */
+	sep = "";
 
 	if (options->show_offset) {
-		printf("%-*s", (int) sizeof(buffer->offset), buffer->offset);
+		output_padded(buffer->offset, sizeof(buffer->offset));
 		sep = " ";
 	}
 
 	if (buffer->raw[0]) {
-		printf("%s%-*s", sep, (int) sizeof(buffer->raw), buffer->raw);
+		output_str(sep);
+		output_padded(buffer->raw, sizeof(buffer->raw));
 		sep = " ";
 	}
 
+	output_str(sep);
 	if (buffer->payload.standard[0])
-		printf("%s%-*s", sep, (int) sizeof(buffer->opcode),
-		       buffer->opcode);
+		output_padded(buffer->opcode, sizeof(buffer->opcode));
 	else
-		printf("%s%s", sep, buffer->opcode);
+		output_str(buffer->opcode);
 
 	/* We printed at least one column.  From this point on, we don't need
 	 * the separator any longer.
 	 */
 
-	if (buffer->use_ext_payload)
-		printf(" %s", buffer->payload.extended);
-	else if (buffer->tracking.id[0]) {
-		printf(" %-*s", (int) sizeof(buffer->payload.standard),
-		       buffer->payload.standard);
-
-		printf(" %-*s", (int) sizeof(buffer->tracking.id),
-		       buffer->tracking.id);
-		printf("%s", buffer->tracking.payload);
-	} else if (buffer->payload.standard[0])
-		printf(" %s", buffer->payload.standard);
+	if (buffer->use_ext_payload) {
+		output_char(' ');
+		output_str(buffer->payload.extended);
+	} else if (buffer->tracking.id[0]) {
+		output_char(' ');
+		output_padded(buffer->payload.standard,
+			      sizeof(buffer->payload.standard));
+
+		output_char(' ');
+		output_padded(buffer->tracking.id, sizeof(buffer->tracking.id));
+		output_str(buffer->tracking.payload);
+	} else if (buffer->payload.standard[0]) {
+		output_char(' ');
+		output_str(buffer->payload.standard);
+	}
 
-	printf("\n");
+	output_char('\n');
 	return 0;
 }
 
+/* Find the trace byte at @offset in @config's trace buffer.
+ *
+ * The trace may be split into several parts.  Provides the end of the part
+ * containing @offset in @end.
+ *
+ * Returns a pointer to the byte on success, NULL if @offset is outside of
+ * the trace.
+ */
+static const uint8_t *trace_at(const struct pt_config *config, uint64_t offset,
+			       const uint8_t **end)
+{
+	const struct pt_trace_part *part;
+	uint64_t size;
+	uint32_t idx;
+
+	size = (uint64_t) (config->end - config->begin);
+	if (offset < size) {
+		*end = config->end;
+		return config->begin + offset;
+	}
+
+	offset -= size;
+	part = config->parts;
+	for (idx = 0; idx < config->nparts; ++idx, ++part) {
+		size = (uint64_t) (part->end - part->begin);
+		if (offset < size) {
+			*end = part->end;
+			return part->begin + offset;
+		}
+
+		offset -= size;
+	}
+
+	return NULL;
+}
+
 static int print_raw(struct ptdump_buffer *buffer, uint64_t offset,
 		     const struct pt_packet *packet,
 		     const struct pt_config *config)
 {
 	const uint8_t *begin, *end;
 	char *bbegin, *bend;
+	uint8_t size;
 
 	if (!buffer || !packet)
 		return diag("error printing packet", offset, -pte_internal);
 
-	begin = config->begin + offset;
-	end = begin + packet->size;
-
-	if (config->end < end)
-		return diag("bad packet size", offset, -pte_bad_packet);
+	begin = NULL;
+	end = NULL;
 
 	bbegin = buffer->raw;
 	bend = bbegin + sizeof(buffer->raw);
 
-	for (; begin < end; ++begin) {
+	for (size = 0; size < packet->size; ++size, ++begin) {
 		char *pos;
 
+		/* The packet may continue in the next part. */
+		if (begin == end) {
+			begin = trace_at(config, offset + size, &end);
+			if (!begin)
+				return diag("bad packet size", offset,
+					    -pte_bad_packet);
+		}
+
 		pos = bbegin;
 		bbegin += 2;
 
 		if (bend <= bbegin)
 			return diag("truncating raw packet", offset, 0);
 
-		sprintf(pos, "%02x", *begin);
+		pos[0] = hex_digits[*begin >> 4];
+		pos[1] = hex_digits[*begin & 0xf];
+		pos[2] = 0;
 	}
 
 	return 0;
@@ -555,7 +1223,7 @@ static int track_last_ip(struct ptdump_buffer *buffer,
 			return diag("error tracking last-ip", offset, errcode);
 		}
 	} else
-		print_field(buffer->tracking.payload, "%016" PRIx64, ip);
+		print_field_hex(buffer->tracking.payload, ip, 16);
 
 	return 0;
 }
@@ -601,7 +1269,7 @@ static int print_time(struct ptdump_buffer *buffer,
 
 		tracking->tsc = tsc;
 	} else
-		print_field(buffer->tracking.payload, "%016" PRIx64, tsc);
+		print_field_hex(buffer->tracking.payload, tsc, 16);
 
 	return 0;
 }
@@ -822,6 +1490,33 @@ static uint64_t sext(uint64_t val, uint8_t sign)
 	return val & signbit ? val | mask : val & ~mask;
 }
 
+/* Print an IP payload with @ipc compression into @field.
+ *
+ * The upper @unknown nibbles of @ip are printed as '?'.
+ */
+static void print_ip_field(char *field, enum pt_ip_compression ipc,
+			   uint64_t ip, int unknown)
+{
+	char *pos;
+	int known;
+
+	pos = field;
+	*pos++ = hex_digits[ipc];
+	*pos++ = ':';
+	*pos++ = ' ';
+
+	for (known = 16; unknown > 0; --unknown, --known)
+		*pos++ = '?';
+
+	if (known < 16)
+		ip &= (1ull << (known * 4)) - 1ull;
+
+	if (known)
+		pos = format_hex(pos, ip, known);
+
+	*pos = 0;
+}
+
 static int print_ip_payload(struct ptdump_buffer *buffer, uint64_t offset,
 			    const struct pt_packet_ip *packet)
 {
@@ -830,33 +1525,33 @@ static int print_ip_payload(struct ptdump_buffer *buffer, uint64_t offset,
 
 	switch (packet->ipc) {
 	case pt_ipc_suppressed:
-		print_field(buffer->payload.standard, "%x: ????????????????",
-			    pt_ipc_suppressed);
+		print_ip_field(buffer->payload.standard, pt_ipc_suppressed, 0ull,
+			       16);
 		return 0;
 
 	case pt_ipc_update_16:
-		print_field(buffer->payload.standard, "%x: ????????????%04"
-			    PRIx64, pt_ipc_update_16, packet->ip);
+		print_ip_field(buffer->payload.standard, pt_ipc_update_16,
+			       packet->ip, 12);
 		return 0;
 
 	case pt_ipc_update_32:
-		print_field(buffer->payload.standard, "%x: ????????%08"
-			    PRIx64, pt_ipc_update_32, packet->ip);
+		print_ip_field(buffer->payload.standard, pt_ipc_update_32,
+			       packet->ip, 8);
 		return 0;
 
 	case pt_ipc_update_48:
-		print_field(buffer->payload.standard, "%x: ????%012"
-			    PRIx64, pt_ipc_update_48, packet->ip);
+		print_ip_field(buffer->payload.standard, pt_ipc_update_48,
+			       packet->ip, 4);
 		return 0;
 
 	case pt_ipc_sext_48:
-		print_field(buffer->payload.standard, "%x: %016" PRIx64,
-			    pt_ipc_sext_48, sext(packet->ip, 48));
+		print_ip_field(buffer->payload.standard, pt_ipc_sext_48,
+			       sext(packet->ip, 48), 0);
 		return 0;
 
 	case pt_ipc_full:
-		print_field(buffer->payload.standard, "%x: %016" PRIx64,
-			    pt_ipc_full, packet->ip);
+		print_ip_field(buffer->payload.standard, pt_ipc_full,
+			       packet->ip, 0);
 		return 0;
 	}
 
@@ -938,6 +1633,9 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 	case ppt_psb:
 		print_field(buffer->opcode, "psb");
 
+		/* The last-ip is reset at PSB. */
+		pt_last_ip_init(&tracking->last_ip);
+
 		tracking->in_header = 1;
 		return 0;
 
@@ -1005,18 +1703,18 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 			    packet->payload.pip.nr ? ", nr" : "");
 
 		print_field(buffer->tracking.id, "cr3");
-		print_field(buffer->tracking.payload, "%016" PRIx64,
-			    packet->payload.pip.cr3);
+		print_field_hex(buffer->tracking.payload,
+				packet->payload.pip.cr3, 16);
 		return 0;
 
 	case ppt_vmcs:
 		print_field(buffer->opcode, "vmcs");
-		print_field(buffer->payload.standard, "%" PRIx64,
-			    packet->payload.vmcs.base);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.vmcs.base, 0);
 
 		print_field(buffer->tracking.id, "vmcs");
-		print_field(buffer->tracking.payload, "%016" PRIx64,
-			    packet->payload.vmcs.base);
+		print_field_hex(buffer->tracking.payload,
+				packet->payload.vmcs.base, 16);
 		return 0;
 
 	case ppt_tnt_8:
@@ -1077,8 +1775,8 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 
 	case ppt_tsc:
 		print_field(buffer->opcode, "tsc");
-		print_field(buffer->payload.standard, "%" PRIx64,
-			    packet->payload.tsc.tsc);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.tsc.tsc, 0);
 
 		if (options->track_time)
 			track_tsc(buffer, tracking, offset,
@@ -1091,8 +1789,8 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 
 	case ppt_cbr:
 		print_field(buffer->opcode, "cbr");
-		print_field(buffer->payload.standard, "%x",
-			    packet->payload.cbr.ratio);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.cbr.ratio, 0);
 
 		if (options->track_time)
 			track_cbr(buffer, tracking, offset,
@@ -1119,8 +1817,8 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 
 	case ppt_mtc:
 		print_field(buffer->opcode, "mtc");
-		print_field(buffer->payload.standard, "%x",
-			    packet->payload.mtc.ctc);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.mtc.ctc, 0);
 
 		if (options->track_time)
 			track_mtc(buffer, tracking, offset,
@@ -1133,8 +1831,8 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 
 	case ppt_cyc:
 		print_field(buffer->opcode, "cyc");
-		print_field(buffer->payload.standard, "%" PRIx64,
-			    packet->payload.cyc.value);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.cyc.value, 0);
 
 		if (options->track_time && !options->no_cyc)
 			track_cyc(buffer, tracking, offset,
@@ -1147,14 +1845,173 @@ static int print_packet(struct ptdump_buffer *buffer, uint64_t offset,
 
 	case ppt_mnt:
 		print_field(buffer->opcode, "mnt");
-		print_field(buffer->payload.standard, "%" PRIx64,
-			    packet->payload.mnt.payload);
+		print_field_hex(buffer->payload.standard,
+				packet->payload.mnt.payload, 0);
 		return 0;
 	}
 
 	return diag("unknown packet", offset, -pte_bad_opc);
 }
 
+static enum ptdump_stats_type stats_type(enum pt_packet_type type)
+{
+	switch (type) {
+	case ppt_pad:
+		return pst_pad;
+
+	case ppt_psb:
+		return pst_psb;
+
+	case ppt_psbend:
+		return pst_psbend;
+
+	case ppt_ovf:
+		return pst_ovf;
+
+	case ppt_stop:
+		return pst_stop;
+
+	case ppt_fup:
+		return pst_fup;
+
+	case ppt_tip:
+		return pst_tip;
+
+	case ppt_tip_pge:
+		return pst_tip_pge;
+
+	case ppt_tip_pgd:
+		return pst_tip_pgd;
+
+	case ppt_tnt_8:
+		return pst_tnt_8;
+
+	case ppt_tnt_64:
+		return pst_tnt_64;
+
+	case ppt_mode:
+		return pst_mode;
+
+	case ppt_pip:
+		return pst_pip;
+
+	case ppt_vmcs:
+		return pst_vmcs;
+
+	case ppt_tsc:
+		return pst_tsc;
+
+	case ppt_cbr:
+		return pst_cbr;
+
+	case ppt_tma:
+		return pst_tma;
+
+	case ppt_mtc:
+		return pst_mtc;
+
+	case ppt_cyc:
+		return pst_cyc;
+
+	case ppt_mnt:
+		return pst_mnt;
+
+	case ppt_unknown:
+	case ppt_invalid:
+		break;
+	}
+
+	return pst_unknown;
+}
+
+static void stats_packet(struct ptdump_stats *stats, uint64_t offset,
+			 const struct pt_packet *packet)
+{
+	enum ptdump_stats_type type;
+
+	type = stats_type(packet->type);
+
+	stats->packets[type] += 1;
+	stats->bytes[type] += packet->size;
+
+	switch (type) {
+	default:
+		break;
+
+	case pst_psb:
+		if (stats->packets[pst_psb] > 1) {
+			uint64_t gap;
+
+			gap = offset - stats->psb_offset;
+
+			stats->psb_gap_sum += gap;
+			if (gap < stats->psb_gap_min)
+				stats->psb_gap_min = gap;
+			if (stats->psb_gap_max < gap)
+				stats->psb_gap_max = gap;
+		}
+
+		stats->psb_offset = offset;
+		break;
+
+	case pst_tsc: {
+		uint64_t tsc;
+
+		tsc = packet->payload.tsc.tsc;
+		if (stats->packets[pst_tsc] == 1) {
+			stats->tsc_first = tsc;
+			stats->tsc_min = tsc;
+			stats->tsc_max = tsc;
+		}
+
+		if (tsc < stats->tsc_min)
+			stats->tsc_min = tsc;
+		if (stats->tsc_max < tsc)
+			stats->tsc_max = tsc;
+	}
+		break;
+	}
+}
+
+static void print_stats(const struct ptdump_stats *stats)
+{
+	uint64_t packets, bytes, psb;
+	int type;
+
+	packets = 0ull;
+	bytes = 0ull;
+
+	output_printf("%-10s %16s %16s\n", "packet", "count", "bytes");
+	for (type = 0; type < pst_num; ++type) {
+		if (!stats->packets[type])
+			continue;
+
+		output_printf("%-10s %16" PRIu64 " %16" PRIu64 "\n",
+			      stats_type_name[type], stats->packets[type],
+			      stats->bytes[type]);
+
+		packets += stats->packets[type];
+		bytes += stats->bytes[type];
+	}
+	output_printf("%-10s %16" PRIu64 " %16" PRIu64 "\n", "total", packets,
+		      bytes);
+
+	output_printf("\nerrors: %" PRIu64 ".\n", stats->errors);
+	output_printf("overflows: %" PRIu64 ".\n", stats->packets[pst_ovf]);
+
+	psb = stats->packets[pst_psb];
+	if (psb > 1)
+		output_printf("psb gap: %" PRIu64 " min, %" PRIu64 " avg, %"
+			      PRIu64 " max.\n", stats->psb_gap_min,
+			      stats->psb_gap_sum / (psb - 1),
+			      stats->psb_gap_max);
+
+	if (stats->packets[pst_tsc])
+		output_printf("tsc: %" PRIx64 " first, %" PRIx64 " min, %"
+			      PRIx64 " max.\n", stats->tsc_first,
+			      stats->tsc_min, stats->tsc_max);
+}
+
 static int dump_one_packet(uint64_t offset, const struct pt_packet *packet,
 			   struct ptdump_tracking *tracking,
 			   const struct ptdump_options *options,
@@ -1165,7 +2022,7 @@ static int dump_one_packet(uint64_t offset, const struct pt_packet *packet,
 
 	memset(&buffer, 0, sizeof(buffer));
 
-	print_field(buffer.offset, "%016" PRIx64, offset);
+	print_field_hex(buffer.offset, offset, 16);
 
 	if (options->show_raw_bytes) {
 		errcode = print_raw(&buffer, offset, packet, config);
@@ -1183,6 +2040,7 @@ static int dump_one_packet(uint64_t offset, const struct pt_packet *packet,
 
 static int dump_packets(struct pt_packet_decoder *decoder,
 			struct ptdump_tracking *tracking,
+			struct ptdump_stats *stats,
 			const struct ptdump_options *options,
 			const struct pt_config *config)
 {
@@ -1205,6 +2063,11 @@ static int dump_packets(struct pt_packet_decoder *decoder,
 			return diag("error decoding packet", offset, errcode);
 		}
 
+		if (options->stats) {
+			stats_packet(stats, offset, &packet);
+			continue;
+		}
+
 		errcode = dump_one_packet(offset, &packet, tracking, options,
 					  config);
 		if (errcode < 0)
@@ -1214,12 +2077,13 @@ static int dump_packets(struct pt_packet_decoder *decoder,
 
 static int dump_sync(struct pt_packet_decoder *decoder,
 		     struct ptdump_tracking *tracking,
+		     struct ptdump_stats *stats,
 		     const struct ptdump_options *options,
 		     const struct pt_config *config)
 {
 	int errcode;
 
-	if (!options)
+	if (!stats || !options)
 		return diag("setup error", 0ull, -pte_internal);
 
 	if (options->no_sync) {
@@ -1233,10 +2097,13 @@ static int dump_sync(struct pt_packet_decoder *decoder,
 	}
 
 	for (;;) {
-		errcode = dump_packets(decoder, tracking, options, config);
+		errcode = dump_packets(decoder, tracking, stats, options,
+				       config);
 		if (!errcode)
 			break;
 
+		stats->errors += 1;
+
 		errcode = pt_pkt_sync_forward(decoder);
 		if (errcode < 0)
 			return diag("sync error", 0ull, errcode);
@@ -1247,20 +2114,473 @@ static int dump_sync(struct pt_packet_decoder *decoder,
 	return errcode;
 }
 
+#if defined(FEATURE_THREADS)
+
+/* The maximal number of decode threads. */
+enum {
+	ptdump_threads_max	= 64,
+
+	/* The number of segments per thread that may be decoded ahead of
+	 * the output.
+	 */
+	ptdump_threads_window	= 4
+};
+
+/* The state shared between the decode threads and the main thread. */
+struct ptdump_parallel {
+	/* The decoder configuration. */
+	const struct pt_config *config;
+
+	/* The options. */
+	const struct ptdump_options *options;
+
+	/* The trace offsets at which segments start in increasing order. */
+	uint64_t *boundary;
+
+	/* The segments - one for each boundary. */
+	struct ptdump_segment *segment;
+
+	/* The number of segments. */
+	size_t nsegments;
+
+	/* The index of the next segment to decode. */
+	size_t pick;
+
+	/* The index of the next segment to print. */
+	size_t emit;
+
+	/* The maximal number of segments to decode ahead of @emit. */
+	size_t window;
+
+	/* A lock protecting the above and the segments' flags. */
+	mtx_t lock;
+
+	/* Signaled when a segment is done or output progresses. */
+	cnd_t cond;
+};
+
+/* Advance @next to the first boundary not smaller than @offset.
+ *
+ * Returns non-zero if @offset is a segment boundary.
+ */
+static int segment_at_boundary(const struct ptdump_parallel *par,
+			       size_t *next, uint64_t offset)
+{
+	size_t idx;
+
+	for (idx = *next; idx < par->nsegments; ++idx) {
+		if (offset <= par->boundary[idx])
+			break;
+	}
+
+	*next = idx;
+
+	return (idx < par->nsegments) && (offset == par->boundary[idx]);
+}
+
+/* Dump packets until we reach the next segment boundary.
+ *
+ * Updates @next to the segment at which we stopped, or to the number of
+ * segments if we reached the end of the trace.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int dump_segment_packets(struct pt_packet_decoder *decoder,
+				struct ptdump_tracking *tracking,
+				const struct ptdump_parallel *par,
+				size_t *next)
+{
+	uint64_t offset;
+	int errcode;
+
+	offset = 0ull;
+	for (;;) {
+		struct pt_packet packet;
+
+		errcode = pt_pkt_get_offset(decoder, &offset);
+		if (errcode < 0)
+			return diag("error getting offset", offset, errcode);
+
+		if (segment_at_boundary(par, next, offset))
+			return 0;
+
+		errcode = pt_pkt_next(decoder, &packet, sizeof(packet));
+		if (errcode < 0) {
+			if (errcode == -pte_eos) {
+				*next = par->nsegments;
+				return 0;
+			}
+
+			return diag("error decoding packet", offset, errcode);
+		}
+
+		errcode = dump_one_packet(offset, &packet, tracking,
+					  par->options, par->config);
+		if (errcode < 0)
+			return errcode;
+	}
+}
+
+/* Dump packets from the segment at @index until we reach another segment.
+ *
+ * This does what dump_sync() does, starting at the segment's boundary.
+ *
+ * Updates @next to the segment at which we stopped, or to the number of
+ * segments if we reached the end of the trace.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int dump_segment_sync(struct pt_packet_decoder *decoder,
+			     struct ptdump_tracking *tracking,
+			     const struct ptdump_parallel *par, size_t index,
+			     size_t *next)
+{
+	int errcode;
+
+	*next = par->nsegments;
+
+	if (!decoder)
+		return diag("failed to allocate decoder", par->boundary[index],
+			    -pte_nomem);
+
+	errcode = pt_pkt_sync_set(decoder, par->boundary[index]);
+	if (errcode < 0)
+		return diag("sync error", par->boundary[index], errcode);
+
+	*next = index + 1;
+	for (;;) {
+		errcode = dump_segment_packets(decoder, tracking, par, next);
+		if (!errcode)
+			break;
+
+		errcode = pt_pkt_sync_forward(decoder);
+		if (errcode < 0) {
+			*next = par->nsegments;
+			return diag("sync error", 0ull, errcode);
+		}
+
+		ptdump_tracking_reset(tracking);
+	}
+
+	return errcode;
+}
+
+/* Dump the segment at @index into its text. */
+static void dump_segment(struct pt_packet_decoder *decoder,
+			 struct ptdump_parallel *par, size_t index)
+{
+	struct ptdump_tracking tracking;
+	struct ptdump_segment *segment;
+	size_t next;
+	int errcode;
+
+	segment = &par->segment[index];
+	output.segment = segment;
+
+	ptdump_tracking_init(&tracking);
+
+	errcode = dump_segment_sync(decoder, &tracking, par, index, &next);
+
+	output_flush();
+	output.segment = NULL;
+
+	ptdump_tracking_fini(&tracking);
+
+	segment->next = next;
+	segment->errcode = errcode;
+}
+
+static int dump_worker(void *arg)
+{
+	struct pt_packet_decoder *decoder;
+	struct ptdump_parallel *par;
+
+	par = arg;
+
+	/* If we fail to allocate a decoder, we report it in each segment we
+	 * pick so the main thread doesn't wait for them forever.
+	 */
+	decoder = pt_pkt_alloc_decoder(par->config);
+
+	for (;;) {
+		struct ptdump_segment *segment;
+		size_t index;
+
+		mtx_lock(&par->lock);
+		while ((par->pick < par->nsegments) &&
+		       ((par->emit + par->window) <= par->pick))
+			cnd_wait(&par->cond, &par->lock);
+
+		index = par->pick;
+		if (index < par->nsegments)
+			par->pick += 1;
+		mtx_unlock(&par->lock);
+
+		if (par->nsegments <= index)
+			break;
+
+		segment = &par->segment[index];
+
+		dump_segment(decoder, par, index);
+
+		mtx_lock(&par->lock);
+		segment->done = 1;
+		if (segment->discard) {
+			free(segment->text);
+			segment->text = NULL;
+		}
+		cnd_broadcast(&par->cond);
+		mtx_unlock(&par->lock);
+	}
+
+	pt_pkt_free_decoder(decoder);
+	return 0;
+}
+
+/* Print the decoded segments in order.
+ *
+ * We follow the chain of segments from the first segment.  A segment may end
+ * beyond the next boundary, e.g. after a decode error.  The segments we skip
+ * are discarded.
+ *
+ * Returns the error code with which decoding ended.
+ */
+static int dump_emit(struct ptdump_parallel *par)
+{
+	size_t index;
+	int errcode;
+
+	errcode = 0;
+	index = 0;
+	while (index < par->nsegments) {
+		struct ptdump_segment *segment;
+		size_t next, idx;
+
+		segment = &par->segment[index];
+
+		mtx_lock(&par->lock);
+		while (!segment->done)
+			cnd_wait(&par->cond, &par->lock);
+		mtx_unlock(&par->lock);
+
+		if (segment->size)
+			fwrite(segment->text, segment->size, 1, stdout);
+
+		free(segment->text);
+		segment->text = NULL;
+
+		next = segment->next;
+		errcode = segment->errcode;
+
+		mtx_lock(&par->lock);
+		for (idx = index + 1; idx < next; ++idx) {
+			struct ptdump_segment *skipped;
+
+			skipped = &par->segment[idx];
+			if (skipped->done) {
+				free(skipped->text);
+				skipped->text = NULL;
+			} else
+				skipped->discard = 1;
+		}
+
+		if (par->nsegments <= next)
+			par->pick = par->nsegments;
+
+		par->emit = next;
+		cnd_broadcast(&par->cond);
+		mtx_unlock(&par->lock);
+
+		index = next;
+	}
+
+	fflush(stdout);
+
+	return errcode;
+}
+
+/* Find the segment boundaries.
+ *
+ * The first segment starts at @decoder's current position.  Each PSB after
+ * that starts another segment.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int dump_find_segments(struct ptdump_parallel *par,
+			      struct pt_packet_decoder *decoder)
+{
+	uint64_t *boundary, offset;
+	size_t nsegments, capacity;
+	int errcode;
+
+	errcode = pt_pkt_get_offset(decoder, &offset);
+	if (errcode < 0)
+		return errcode;
+
+	capacity = 64;
+	boundary = malloc(capacity * sizeof(*boundary));
+	if (!boundary)
+		return -pte_nomem;
+
+	boundary[0] = offset;
+	nsegments = 1;
+
+	/* We stop at the first error.  Missing a PSB only means that we
+	 * decode a bigger segment.
+	 */
+	for (;;) {
+		errcode = pt_pkt_sync_forward(decoder);
+		if (errcode < 0)
+			break;
+
+		errcode = pt_pkt_get_sync_offset(decoder, &offset);
+		if (errcode < 0)
+			break;
+
+		if (offset <= boundary[nsegments - 1])
+			continue;
+
+		if (nsegments == capacity) {
+			uint64_t *grown;
+
+			capacity *= 2;
+			grown = realloc(boundary, capacity * sizeof(*boundary));
+			if (!grown) {
+				free(boundary);
+				return -pte_nomem;
+			}
+
+			boundary = grown;
+		}
+
+		boundary[nsegments++] = offset;
+	}
+
+	par->boundary = boundary;
+	par->nsegments = nsegments;
+
+	return 0;
+}
+
+/* Dump the trace in multiple threads.
+ *
+ * Packets between two PSB packets can be decoded independently since we do
+ * not track time.  Each thread decodes and formats entire segments into
+ * memory.  The main thread prints them in order so the output is the same
+ * as with a single thread.
+ */
+static int dump_parallel(const struct pt_config *config,
+			 const struct ptdump_options *options)
+{
+	struct ptdump_parallel par;
+	struct pt_packet_decoder *decoder;
+	thrd_t thread[ptdump_threads_max];
+	uint32_t nthreads, thrd;
+	int errcode;
+
+	memset(&par, 0, sizeof(par));
+	par.config = config;
+	par.options = options;
+
+	decoder = pt_pkt_alloc_decoder(config);
+	if (!decoder)
+		return diag("failed to allocate decoder", 0ull, 0);
+
+	if (options->no_sync) {
+		errcode = pt_pkt_sync_set(decoder, 0ull);
+		if (errcode < 0) {
+			pt_pkt_free_decoder(decoder);
+			return diag("sync error", 0ull, errcode);
+		}
+	} else {
+		errcode = pt_pkt_sync_forward(decoder);
+		if (errcode < 0) {
+			pt_pkt_free_decoder(decoder);
+			return diag("sync error", 0ull, errcode);
+		}
+	}
+
+	errcode = dump_find_segments(&par, decoder);
+	pt_pkt_free_decoder(decoder);
+	if (errcode < 0)
+		return diag("error finding segments", 0ull, errcode);
+
+	par.segment = calloc(par.nsegments, sizeof(*par.segment));
+	if (!par.segment) {
+		free(par.boundary);
+		return diag("error finding segments", 0ull, -pte_nomem);
+	}
+
+	nthreads = options->threads;
+	if (ptdump_threads_max < nthreads)
+		nthreads = ptdump_threads_max;
+
+	par.window = (size_t) nthreads * ptdump_threads_window;
+
+	mtx_init(&par.lock, mtx_plain);
+	cnd_init(&par.cond);
+
+	for (thrd = 0; thrd < nthreads; ++thrd) {
+		errcode = thrd_create(&thread[thrd], dump_worker, &par);
+		if (errcode != thrd_success)
+			break;
+	}
+
+	nthreads = thrd;
+	if (nthreads) {
+		/* Make sure our own output appears before the segments. */
+		output_flush();
+
+		errcode = dump_emit(&par);
+	} else
+		errcode = diag("error creating threads", 0ull, -pte_nomem);
+
+	for (thrd = 0; thrd < nthreads; ++thrd)
+		thrd_join(&thread[thrd], NULL);
+
+	cnd_destroy(&par.cond);
+	mtx_destroy(&par.lock);
+
+	while (par.nsegments)
+		free(par.segment[--par.nsegments].text);
+
+	free(par.segment);
+	free(par.boundary);
+
+	return errcode;
+}
+
+#endif /* defined(FEATURE_THREADS) */
+
 static int dump(const struct pt_config *config,
 		const struct ptdump_options *options)
 {
 	struct pt_packet_decoder *decoder;
 	struct ptdump_tracking tracking;
+	struct ptdump_stats stats;
 	int errcode;
 
+#if defined(FEATURE_THREADS)
+	/* Time is tracked across PSB packets.  We need to decode the entire
+	 * trace in order.
+	 */
+	if ((1 < options->threads) && !options->track_time && !options->stats)
+		return dump_parallel(config, options);
+#endif /* defined(FEATURE_THREADS) */
+
 	decoder = pt_pkt_alloc_decoder(config);
 	if (!decoder)
 		return diag("failed to allocate decoder", 0ull, 0);
 
 	ptdump_tracking_init(&tracking);
 
-	errcode = dump_sync(decoder, &tracking, options, config);
+	memset(&stats, 0, sizeof(stats));
+	stats.psb_gap_min = UINT64_MAX;
+
+	errcode = dump_sync(decoder, &tracking, &stats, options, config);
+
+	if (options->stats)
+		print_stats(&stats);
 
 	ptdump_tracking_fini(&tracking);
 	pt_pkt_free_decoder(decoder);
@@ -1334,11 +2654,14 @@ static int get_arg_uint8(uint8_t *value, const char *option, const char *arg,
 int main(int argc, char *argv[])
 {
 	struct ptdump_options options;
+	struct ptdump_file file;
 	struct pt_config config;
+	struct pt_perf perf;
 	int errcode, idx;
-	char *ptfile;
+	char *ptfile, *perffile;
 
 	ptfile = NULL;
+	perffile = NULL;
 
 	memset(&options, 0, sizeof(options));
 	options.show_offset = 1;
@@ -1370,6 +2693,22 @@ int main(int argc, char *argv[])
 			options.no_timing = 1;
 		else if (strcmp(argv[idx], "--no-cyc") == 0)
 			options.no_cyc = 1;
+		else if (strcmp(argv[idx], "--stats") == 0)
+			options.stats = 1;
+		else if (strcmp(argv[idx], "--threads") == 0) {
+			if (!get_arg_uint32(&options.threads, "--threads",
+					    argv[++idx], argv[0]))
+				return 1;
+		} else if (strcmp(argv[idx], "--perf") == 0) {
+			perffile = argv[++idx];
+			if (!perffile) {
+				fprintf(stderr,
+					"%s: --perf: missing argument.\n",
+					argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[idx], "--pt-populate") == 0)
+			options.pt_populate = 1;
 		else if (strcmp(argv[idx], "--no-offset") == 0)
 			options.show_offset = 0;
 		else if (strcmp(argv[idx], "--raw") == 0)
@@ -1459,20 +2798,34 @@ int main(int argc, char *argv[])
 			return unknown_option_error(argv[idx], argv[0]);
 	}
 
-	if (!ptfile)
+	if (ptfile && perffile)
+		return usage(argv[0]);
+
+	memset(&file, 0, sizeof(file));
+	memset(&perf, 0, sizeof(perf));
+	if (perffile)
+		errcode = load_perf(&config, &perf, &file, perffile,
+				    options.pt_populate, argv[0]);
+	else if (ptfile)
+		errcode = load_pt(&config, &file, ptfile, options.pt_populate,
+				  argv[0]);
+	else
 		return no_file_error(argv[0]);
 
-	errcode = pt_cpu_errata(&config.errata, &config.cpu);
 	if (errcode < 0)
-		diag("failed to determine errata", 0ull, errcode);
+		goto out;
 
-	errcode = load_pt(&config, ptfile, argv[0]);
+	/* The perf.data file may have provided the cpu. */
+	errcode = pt_cpu_errata(&config.errata, &config.cpu);
 	if (errcode < 0)
-		return errcode;
+		diag("failed to determine errata", 0ull, errcode);
 
 	errcode = dump(&config, &options);
 
-	free(config.begin);
+out:
+	output_flush();
+	pt_perf_fini(&perf);
+	unload_file(&file);
 
 	return -errcode;
 }
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PT_PERF_H
+#define PT_PERF_H
+
+#include "intel-pt.h"
+
+#include <stdint.h>
+
+
+/* The Intel PT trace collected in one perf AUX area.
+ *
+ * perf writes the trace in chunks, each in its own PERF_RECORD_AUXTRACE
+ * record followed by the trace bytes.  The chunks of one AUX area are
+ * collected in file order.  They point into the perf.data file; nothing is
+ * copied.
+ */
+struct pt_perf_buffer {
+	/* The chunks in trace order. */
+	struct pt_trace_part *part;
+
+	/* The number of chunks in @part. */
+	uint32_t nparts;
+
+	/* The number of allocated entries in @part. */
+	uint32_t capacity;
+
+	/* The index of the AUX area. */
+	uint32_t idx;
+
+	/* The cpu and thread given in the first record.
+	 *
+	 * The cpu is UINT32_MAX for per-thread tracing.  The thread is
+	 * UINT32_MAX for per-cpu tracing.
+	 */
+	uint32_t cpu;
+	uint32_t tid;
+
+	/* The total size of the trace in bytes. */
+	uint64_t size;
+};
+
+/* A file mapping described by a PERF_RECORD_MMAP or PERF_RECORD_MMAP2
+ * record.
+ *
+ * Only executable mappings are collected.
+ */
+struct pt_perf_mapping {
+	/* The name of the mapped file.
+	 *
+	 * This points into the perf.data file.  It may also be a special
+	 * name like [vdso] or //anon.
+	 */
+	const char *filename;
+
+	/* The virtual address at which the file is mapped. */
+	uint64_t vaddr;
+
+	/* The size of the mapping in bytes. */
+	uint64_t size;
+
+	/* The offset of the mapping in the file. */
+	uint64_t offset;
+
+	/* The process and thread that mapped the file.
+	 *
+	 * The process is UINT32_MAX for kernel mappings.
+	 */
+	uint32_t pid;
+	uint32_t tid;
+};
+
+/* A perf.data file.
+ *
+ * This does not own the file contents.  They must remain valid for as long
+ * as this object and any configuration it provided is used.
+ */
+struct pt_perf {
+	/* The perf.data file contents. */
+	const uint8_t *begin;
+	const uint8_t *end;
+
+	/* The AUX area buffers in order of their first record. */
+	struct pt_perf_buffer *buffer;
+
+	/* The number of buffers in @buffer. */
+	uint32_t nbuffers;
+
+	/* The executable file mappings in file order. */
+	struct pt_perf_mapping *mapping;
+
+	/* The number of mappings in @mapping. */
+	uint32_t nmappings;
+
+	/* The number of allocated entries in @mapping. */
+	uint32_t mapping_capacity;
+
+	/* The cpu on which the trace was recorded - zero if unknown. */
+	struct pt_cpu cpu;
+
+	/* The Intel PT configuration - zero if unknown.
+	 *
+	 * See struct pt_config.
+	 */
+	uint32_t cpuid_0x15_eax, cpuid_0x15_ebx;
+	uint8_t mtc_freq;
+	uint8_t nom_freq;
+};
+
+/* Initialize a perf.data file.
+ *
+ * Reads the perf.data file contained in the memory between @begin and @end.
+ * Collects the Intel PT trace in PERF_RECORD_AUXTRACE records per AUX area,
+ * the executable file mappings in PERF_RECORD_MMAP and PERF_RECORD_MMAP2
+ * records, as well as the cpu and trace configuration, if available.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_invalid if @perf, @begin, or @end is NULL.
+ * Returns -pte_bad_config if the memory does not contain a perf.data file.
+ * Returns -pte_not_supported if the file is in a different byte order.
+ * Returns -pte_bad_packet if a record is corrupt.
+ * Returns -pte_nomem if memory allocation failed.
+ */
+extern int pt_perf_init(struct pt_perf *perf, const uint8_t *begin,
+			const uint8_t *end);
+
+/* Finalize a perf.data file. */
+extern void pt_perf_fini(struct pt_perf *perf);
+
+/* Find the buffer for AUX area @idx.
+ *
+ * Returns a pointer to the buffer on success, NULL otherwise.
+ */
+extern const struct pt_perf_buffer *
+pt_perf_find_buffer(const struct pt_perf *perf, uint32_t idx);
+
+/* Configure a decoder for the trace in AUX area @idx.
+ *
+ * Sets @config's trace buffer to the chunks of AUX area @idx.  The first
+ * chunk is given in @config's begin and end fields, the remaining chunks in
+ * its parts field.
+ *
+ * Fills in the cpu and the timing related configuration fields from @perf
+ * unless they have already been set.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ * Returns -pte_invalid if @config or @perf is NULL.
+ * Returns -pte_invalid if there is no AUX area @idx.
+ */
+extern int pt_perf_config(struct pt_config *config, const struct pt_perf *perf,
+			  uint32_t idx);
+
+/* Add the file mappings of process @pid to @image.
+ *
+ * Adds the file mappings of process @pid from @perf to @image for address
+ * space @asid.  Files mapped into several processes share their sections
+ * inside @image.  The files are not read until the decoder needs them.
+ *
+ * Mappings that can not be added, e.g. because the file does not exist or
+ * because it overlaps with an earlier mapping, are skipped.
+ *
+ * Returns the number of skipped mappings on success, a negative error code
+ * otherwise.
+ * Returns -pte_invalid if @image or @perf is NULL.
+ */
+extern int pt_perf_image(struct pt_image *image, const struct pt_perf *perf,
+			 uint32_t pid, const struct pt_asid *asid);
+
+#endif /* PT_PERF_H */
@@ -0,0 +1,677 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pt_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The perf.data file format.
+ *
+ * The file starts with the magic number "PERFILE2".
+ *
+ * We only support the file format written by perf record, not the pipe
+ * format.  The file is in the byte order of the machine that recorded it.
+ * We only support files in our own byte order.
+ */
+static const uint64_t pt_perf_magic = 0x32454c4946524550ull;
+
+/* The magic number in the opposite byte order. */
+static const uint64_t pt_perf_magic_swapped = 0x50455246494c4532ull;
+
+enum {
+	/* The size of the file header in bytes.
+	 *
+	 * It consists of: magic, size, and attr_size followed by the attrs,
+	 * data, and event_types sections of 16 bytes each and a 256 bit
+	 * bitmap of header features.
+	 */
+	pt_perf_header_size		= 104,
+
+	/* The offsets of the file header fields we need. */
+	pt_perf_header_attr_size	= 16,
+	pt_perf_header_attrs		= 24,
+	pt_perf_header_data		= 40,
+	pt_perf_header_features		= 72,
+
+	/* The number of header feature bits. */
+	pt_perf_feature_bits		= 256,
+
+	/* The header feature containing the cpuid string. */
+	pt_perf_feature_cpuid		= 9,
+
+	/* The size of a file section in bytes: offset and size. */
+	pt_perf_section_size		= 16,
+
+	/* The offset of the config field in struct perf_event_attr. */
+	pt_perf_attr_config		= 8,
+
+	/* The size of struct perf_event_header in bytes. */
+	pt_perf_event_header_size	= 8,
+
+	/* The offset of the misc field in struct perf_event_header. */
+	pt_perf_event_header_misc	= 4,
+
+	/* The record types we're interested in. */
+	pt_perf_record_mmap		= 1,
+	pt_perf_record_mmap2		= 10,
+	pt_perf_record_auxtrace_info	= 70,
+	pt_perf_record_auxtrace		= 71,
+
+	/* The offset of the filename in PERF_RECORD_MMAP and
+	 * PERF_RECORD_MMAP2 records, respectively.
+	 */
+	pt_perf_mmap_filename		= 40,
+	pt_perf_mmap2_filename		= 72,
+
+	/* The offset of the protection in PERF_RECORD_MMAP2 records. */
+	pt_perf_mmap2_prot		= 64,
+
+	/* The misc flag marking non-executable mappings. */
+	pt_perf_misc_mmap_data		= 1 << 13,
+
+	/* The protection flag for executable mappings. */
+	pt_perf_prot_exec		= 4,
+
+	/* The size of a PERF_RECORD_AUXTRACE record in bytes without the
+	 * trace that follows it.
+	 */
+	pt_perf_auxtrace_size		= 48,
+
+	/* The size of a PERF_RECORD_AUXTRACE_INFO record in bytes without
+	 * the private data.
+	 */
+	pt_perf_auxtrace_info_size	= 16,
+
+	/* The auxtrace type for Intel PT. */
+	pt_perf_auxtrace_intel_pt	= 1
+};
+
+/* The Intel PT private data in PERF_RECORD_AUXTRACE_INFO. */
+enum pt_perf_intel_pt_priv {
+	pt_perf_ipt_pmu_type		= 0,
+	pt_perf_ipt_mtc_bit		= 10,
+	pt_perf_ipt_mtc_freq_bits	= 11,
+	pt_perf_ipt_tsc_ctc_n		= 12,
+	pt_perf_ipt_tsc_ctc_d		= 13,
+	pt_perf_ipt_max_nonturbo_ratio	= 15,
+
+	/* The number of private data fields we need. */
+	pt_perf_ipt_priv_size		= 16
+};
+
+static uint16_t pt_perf_read_u16(const uint8_t *pos)
+{
+	uint16_t value;
+
+	memcpy(&value, pos, sizeof(value));
+	return value;
+}
+
+static uint32_t pt_perf_read_u32(const uint8_t *pos)
+{
+	uint32_t value;
+
+	memcpy(&value, pos, sizeof(value));
+	return value;
+}
+
+static uint64_t pt_perf_read_u64(const uint8_t *pos)
+{
+	uint64_t value;
+
+	memcpy(&value, pos, sizeof(value));
+	return value;
+}
+
+/* Read the file section at @pos.
+ *
+ * Provides the memory described by the section in @begin and @end.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_perf_read_section(const uint8_t **begin, const uint8_t **end,
+				const struct pt_perf *perf, const uint8_t *pos)
+{
+	uint64_t offset, size, fsize;
+
+	offset = pt_perf_read_u64(pos);
+	size = pt_perf_read_u64(pos + 8);
+
+	fsize = (uint64_t) (perf->end - perf->begin);
+	if ((fsize < offset) || ((fsize - offset) < size))
+		return -pte_bad_config;
+
+	*begin = perf->begin + offset;
+	*end = *begin + size;
+
+	return 0;
+}
+
+static struct pt_perf_buffer *pt_perf_get_buffer(struct pt_perf *perf,
+						 uint32_t idx)
+{
+	struct pt_perf_buffer *buffer;
+	uint32_t nbuffers;
+
+	nbuffers = perf->nbuffers;
+	for (buffer = perf->buffer; buffer < perf->buffer + nbuffers;
+	     ++buffer) {
+		if (buffer->idx == idx)
+			return buffer;
+	}
+
+	buffer = realloc(perf->buffer, (nbuffers + 1) * sizeof(*buffer));
+	if (!buffer)
+		return NULL;
+
+	perf->buffer = buffer;
+	perf->nbuffers = nbuffers + 1;
+
+	buffer += nbuffers;
+	memset(buffer, 0, sizeof(*buffer));
+	buffer->idx = idx;
+
+	return buffer;
+}
+
+/* Add the trace following the PERF_RECORD_AUXTRACE record at @pos.
+ *
+ * Provides the end of the trace in @end.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_perf_add_auxtrace(struct pt_perf *perf, const uint8_t **end,
+				const uint8_t *pos, uint16_t size)
+{
+	struct pt_perf_buffer *buffer;
+	struct pt_trace_part *part;
+	const uint8_t *begin;
+	uint64_t asize;
+	uint32_t idx;
+
+	if (size < pt_perf_auxtrace_size)
+		return -pte_bad_packet;
+
+	asize = pt_perf_read_u64(pos + 8);
+	idx = pt_perf_read_u32(pos + 32);
+
+	/* The trace follows the record.
+	 *
+	 * If perf was interrupted, the last chunk may be truncated.  We use
+	 * what we have.
+	 */
+	begin = pos + size;
+	if ((uint64_t) (perf->end - begin) < asize)
+		asize = (uint64_t) (perf->end - begin);
+
+	*end = begin + asize;
+
+	if (!asize)
+		return 0;
+
+	buffer = pt_perf_get_buffer(perf, idx);
+	if (!buffer)
+		return -pte_nomem;
+
+	if (!buffer->nparts) {
+		buffer->tid = pt_perf_read_u32(pos + 36);
+		buffer->cpu = pt_perf_read_u32(pos + 40);
+	}
+
+	if (buffer->nparts == buffer->capacity) {
+		uint32_t capacity;
+
+		capacity = buffer->capacity ? buffer->capacity * 2 : 16;
+		part = realloc(buffer->part, capacity * sizeof(*part));
+		if (!part)
+			return -pte_nomem;
+
+		buffer->part = part;
+		buffer->capacity = capacity;
+	}
+
+	/* The decoders don't write to the trace. */
+	part = &buffer->part[buffer->nparts++];
+	part->begin = (uint8_t *) begin;
+	part->end = (uint8_t *) *end;
+
+	buffer->size += asize;
+
+	return 0;
+}
+
+/* Add the file mapping in the PERF_RECORD_MMAP or PERF_RECORD_MMAP2 record
+ * of @type at @pos.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_perf_add_mmap(struct pt_perf *perf, const uint8_t *pos,
+			    uint32_t type, uint16_t size)
+{
+	struct pt_perf_mapping *mapping;
+	const uint8_t *filename;
+	uint16_t misc, offset;
+
+	misc = pt_perf_read_u16(pos + pt_perf_event_header_misc);
+	if (misc & pt_perf_misc_mmap_data)
+		return 0;
+
+	if (type == pt_perf_record_mmap2) {
+		offset = pt_perf_mmap2_filename;
+		if (size < offset)
+			return -pte_bad_packet;
+
+		if (!(pt_perf_read_u32(pos + pt_perf_mmap2_prot) &
+		      pt_perf_prot_exec))
+			return 0;
+	} else {
+		offset = pt_perf_mmap_filename;
+		if (size < offset)
+			return -pte_bad_packet;
+	}
+
+	/* The filename must be terminated inside the record. */
+	filename = pos + offset;
+	if (!memchr(filename, 0, size - offset))
+		return -pte_bad_packet;
+
+	if (perf->nmappings == perf->mapping_capacity) {
+		uint32_t capacity;
+
+		capacity = perf->mapping_capacity ?
+			perf->mapping_capacity * 2 : 64;
+		mapping = realloc(perf->mapping, capacity * sizeof(*mapping));
+		if (!mapping)
+			return -pte_nomem;
+
+		perf->mapping = mapping;
+		perf->mapping_capacity = capacity;
+	}
+
+	mapping = &perf->mapping[perf->nmappings++];
+	mapping->filename = (const char *) filename;
+	mapping->pid = pt_perf_read_u32(pos + 8);
+	mapping->tid = pt_perf_read_u32(pos + 12);
+	mapping->vaddr = pt_perf_read_u64(pos + 16);
+	mapping->size = pt_perf_read_u64(pos + 24);
+	mapping->offset = pt_perf_read_u64(pos + 32);
+
+	return 0;
+}
+
+/* Read the records in the data section between @begin and @end.
+ *
+ * Provides the Intel PT private data of the PERF_RECORD_AUXTRACE_INFO record
+ * in @info, if there is one.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_perf_read_records(struct pt_perf *perf, const uint8_t **info,
+				const uint8_t *begin, const uint8_t *end)
+{
+	const uint8_t *pos;
+
+	for (pos = begin; pos < end;) {
+		uint32_t type;
+		uint16_t size;
+
+		if ((end - pos) < pt_perf_event_header_size)
+			return -pte_bad_packet;
+
+		type = pt_perf_read_u32(pos);
+		size = pt_perf_read_u16(pos + 6);
+
+		if ((size < pt_perf_event_header_size) ||
+		    ((end - pos) < size))
+			return -pte_bad_packet;
+
+		if (type == pt_perf_record_auxtrace) {
+			int errcode;
+
+			errcode = pt_perf_add_auxtrace(perf, &pos, pos, size);
+			if (errcode < 0)
+				return errcode;
+
+			continue;
+		}
+
+		if ((type == pt_perf_record_mmap) ||
+		    (type == pt_perf_record_mmap2)) {
+			int errcode;
+
+			errcode = pt_perf_add_mmap(perf, pos, type, size);
+			if (errcode < 0)
+				return errcode;
+		}
+
+		if ((type == pt_perf_record_auxtrace_info) &&
+		    ((pt_perf_auxtrace_info_size +
+		      (pt_perf_ipt_priv_size * 8)) <= size) &&
+		    (pt_perf_read_u32(pos + 8) == pt_perf_auxtrace_intel_pt))
+			*info = pos + pt_perf_auxtrace_info_size;
+
+		pos += size;
+	}
+
+	return 0;
+}
+
+/* Parse a cpuid string of the form "GenuineIntel,<family>,<model>,<step>".
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int pt_perf_parse_cpuid(struct pt_cpu *cpu, const char *str,
+			       const char *end)
+{
+	static const char vendor[] = "GenuineIntel,";
+	unsigned long value[3];
+	int field;
+
+	if ((size_t) (end - str) < (sizeof(vendor) - 1))
+		return -pte_not_supported;
+
+	if (memcmp(str, vendor, sizeof(vendor) - 1) != 0)
+		return -pte_not_supported;
+
+	str += sizeof(vendor) - 1;
+	for (field = 0; field < 3; ++field) {
+		value[field] = 0ul;
+
+		if ((str == end) || (*str < '0') || ('9' < *str))
+			return -pte_bad_config;
+
+		for (; (str < end) && ('0' <= *str) && (*str <= '9'); ++str)
+			value[field] = (value[field] * 10) + (*str - '0');
+
+		if ((str < end) && (*str == ','))
+			str += 1;
+	}
+
+	if ((UINT16_MAX < value[0]) || (UINT8_MAX < value[1]) ||
+	    (UINT8_MAX < value[2]))
+		return -pte_bad_config;
+
+	cpu->vendor = pcv_intel;
+	cpu->family = (uint16_t) value[0];
+	cpu->model = (uint8_t) value[1];
+	cpu->stepping = (uint8_t) value[2];
+
+	return 0;
+}
+
+/* Read the cpu from the header features.
+ *
+ * The feature sections follow the data section.  There is one section for
+ * each feature bit that is set, in order.
+ *
+ * We ignore errors.  The cpu is optional.
+ */
+static void pt_perf_read_cpu(struct pt_perf *perf, const uint8_t *features)
+{
+	const uint8_t *begin, *end, *section;
+	uint32_t size;
+	int bit;
+
+	section = features;
+	for (bit = 0; bit < pt_perf_feature_cpuid; ++bit) {
+		uint8_t byte;
+
+		byte = perf->begin[pt_perf_header_features + (bit / 8)];
+		if (byte & (1 << (bit % 8)))
+			section += pt_perf_section_size;
+	}
+
+	if (!(perf->begin[pt_perf_header_features +
+			  (pt_perf_feature_cpuid / 8)] &
+	      (1 << (pt_perf_feature_cpuid % 8))))
+		return;
+
+	if ((perf->end - section) < pt_perf_section_size)
+		return;
+
+	if (pt_perf_read_section(&begin, &end, perf, section) < 0)
+		return;
+
+	/* The string is preceded by its size and padded with zeros. */
+	if ((end - begin) < 4)
+		return;
+
+	size = pt_perf_read_u32(begin);
+	begin += 4;
+
+	if ((uint64_t) (end - begin) < size)
+		return;
+
+	end = memchr(begin, 0, size);
+	if (!end)
+		end = begin + size;
+
+	(void) pt_perf_parse_cpuid(&perf->cpu, (const char *) begin,
+				   (const char *) end);
+}
+
+/* Read the Intel PT configuration from the private data in the
+ * PERF_RECORD_AUXTRACE_INFO record at @info.
+ *
+ * The MTC frequency is part of the perf_event_attr config of the Intel PT
+ * event.  We find it by the PMU type.
+ */
+static void pt_perf_read_info(struct pt_perf *perf, const uint8_t *info)
+{
+	const uint8_t *attrs, *end, *pos;
+	uint64_t attr_size, pmu_type, mtc_bit, mtc_bits;
+
+	perf->cpuid_0x15_eax = (uint32_t)
+		pt_perf_read_u64(info + (pt_perf_ipt_tsc_ctc_d * 8));
+	perf->cpuid_0x15_ebx = (uint32_t)
+		pt_perf_read_u64(info + (pt_perf_ipt_tsc_ctc_n * 8));
+	perf->nom_freq = (uint8_t)
+		pt_perf_read_u64(info + (pt_perf_ipt_max_nonturbo_ratio * 8));
+
+	pmu_type = pt_perf_read_u64(info + (pt_perf_ipt_pmu_type * 8));
+	mtc_bit = pt_perf_read_u64(info + (pt_perf_ipt_mtc_bit * 8));
+	mtc_bits = pt_perf_read_u64(info + (pt_perf_ipt_mtc_freq_bits * 8));
+	if (!mtc_bits)
+		return;
+
+	attr_size = pt_perf_read_u64(perf->begin + pt_perf_header_attr_size);
+	if (attr_size < (pt_perf_attr_config + 8))
+		return;
+
+	if (pt_perf_read_section(&attrs, &end, perf,
+				 perf->begin + pt_perf_header_attrs) < 0)
+		return;
+
+	for (pos = attrs; attr_size <= (uint64_t) (end - pos);
+	     pos += attr_size) {
+		uint64_t config;
+
+		if (pt_perf_read_u32(pos) != pmu_type)
+			continue;
+
+		config = pt_perf_read_u64(pos + pt_perf_attr_config);
+		if (!(config & mtc_bit))
+			return;
+
+		config &= mtc_bits;
+		for (; !(mtc_bits & 1ull); mtc_bits >>= 1)
+			config >>= 1;
+
+		perf->mtc_freq = (uint8_t) config;
+		return;
+	}
+}
+
+int pt_perf_init(struct pt_perf *perf, const uint8_t *begin,
+		 const uint8_t *end)
+{
+	const uint8_t *data, *data_end, *info;
+	uint64_t magic;
+	int errcode;
+
+	if (!perf || !begin || !end || (end < begin))
+		return -pte_invalid;
+
+	memset(perf, 0, sizeof(*perf));
+	perf->begin = begin;
+	perf->end = end;
+
+	if ((end - begin) < pt_perf_header_size)
+		return -pte_bad_config;
+
+	magic = pt_perf_read_u64(begin);
+	if (magic == pt_perf_magic_swapped)
+		return -pte_not_supported;
+
+	if (magic != pt_perf_magic)
+		return -pte_bad_config;
+
+	errcode = pt_perf_read_section(&data, &data_end, perf,
+				       begin + pt_perf_header_data);
+	if (errcode < 0)
+		return errcode;
+
+	/* If perf was interrupted, the header says the data section is
+	 * empty.  We read until the end of the file in this case.
+	 */
+	if (data == data_end)
+		data_end = end;
+
+	info = NULL;
+	errcode = pt_perf_read_records(perf, &info, data, data_end);
+	if (errcode < 0) {
+		pt_perf_fini(perf);
+		return errcode;
+	}
+
+	if (info)
+		pt_perf_read_info(perf, info);
+
+	if (data_end != end)
+		pt_perf_read_cpu(perf, data_end);
+
+	return 0;
+}
+
+void pt_perf_fini(struct pt_perf *perf)
+{
+	uint32_t idx;
+
+	if (!perf)
+		return;
+
+	for (idx = 0; idx < perf->nbuffers; ++idx)
+		free(perf->buffer[idx].part);
+
+	free(perf->buffer);
+	free(perf->mapping);
+
+	perf->buffer = NULL;
+	perf->nbuffers = 0;
+	perf->mapping = NULL;
+	perf->nmappings = 0;
+	perf->mapping_capacity = 0;
+}
+
+const struct pt_perf_buffer *
+pt_perf_find_buffer(const struct pt_perf *perf, uint32_t idx)
+{
+	uint32_t buffer;
+
+	if (!perf)
+		return NULL;
+
+	for (buffer = 0; buffer < perf->nbuffers; ++buffer) {
+		if (perf->buffer[buffer].idx == idx)
+			return &perf->buffer[buffer];
+	}
+
+	return NULL;
+}
+
+int pt_perf_config(struct pt_config *config, const struct pt_perf *perf,
+		   uint32_t idx)
+{
+	const struct pt_perf_buffer *buffer;
+
+	if (!config || !perf)
+		return -pte_invalid;
+
+	buffer = pt_perf_find_buffer(perf, idx);
+	if (!buffer || !buffer->nparts)
+		return -pte_invalid;
+
+	config->begin = buffer->part[0].begin;
+	config->end = buffer->part[0].end;
+	config->parts = &buffer->part[1];
+	config->nparts = buffer->nparts - 1;
+
+	if (config->cpu.vendor == pcv_unknown)
+		config->cpu = perf->cpu;
+
+	if (!config->cpuid_0x15_eax && !config->cpuid_0x15_ebx) {
+		config->cpuid_0x15_eax = perf->cpuid_0x15_eax;
+		config->cpuid_0x15_ebx = perf->cpuid_0x15_ebx;
+	}
+
+	if (!config->mtc_freq)
+		config->mtc_freq = perf->mtc_freq;
+
+	if (!config->nom_freq)
+		config->nom_freq = perf->nom_freq;
+
+	return 0;
+}
+
+int pt_perf_image(struct pt_image *image, const struct pt_perf *perf,
+		  uint32_t pid, const struct pt_asid *asid)
+{
+	const struct pt_perf_mapping *mapping, *end;
+	int skipped;
+
+	if (!image || !perf)
+		return -pte_invalid;
+
+	skipped = 0;
+	end = perf->mapping + perf->nmappings;
+	for (mapping = perf->mapping; mapping < end; ++mapping) {
+		int errcode;
+
+		if (mapping->pid != pid)
+			continue;
+
+		errcode = pt_image_add_file(image, mapping->filename,
+					    mapping->offset, mapping->size,
+					    asid, mapping->vaddr);
+		if (errcode < 0)
+			skipped += 1;
+	}
+
+	return skipped;
+}
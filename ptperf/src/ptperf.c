@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#if defined(FEATURE_MMAP)
+# define _POSIX_C_SOURCE 200112L
+# define _DEFAULT_SOURCE 1
+# define _DARWIN_C_SOURCE 1
+#endif /* defined(FEATURE_MMAP) */
+
+#include "pt_perf.h"
+
+#include "intel-pt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(FEATURE_MMAP)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif /* defined(FEATURE_MMAP) */
+
+
+/* A loaded perf.data file. */
+struct ptperf_file {
+	/* The file contents. */
+	uint8_t *base;
+
+	/* The size of @base in bytes. */
+	size_t size;
+
+	/* A flag saying whether @base is mapped or allocated. */
+	int mapped;
+};
+
+static int usage(const char *name)
+{
+	fprintf(stderr,
+		"%s: [<options>] <perf.data>.  Use --help or -h for help.\n",
+		name);
+	return -1;
+}
+
+static int help(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [<options>] <perf.data>\n\n"
+		"List the Intel PT trace in a perf.data file.\n\n"
+		"options:\n"
+		"  --help|-h                 this text.\n"
+		"  --version                 display version information and exit.\n"
+		"  --options                 print the ptdump and ptxed options for decoding\n"
+		"                            the trace.\n"
+		"  --mmaps                   list the executable file mappings.\n"
+		"  <perf.data>               the perf.data file.\n\n"
+		"Use ptdump or ptxed --perf <perf.data>:<idx> to decode the trace in AUX\n"
+		"area <idx>.  Use ptxed --perf-image <pid> to load the files mapped by\n"
+		"process <pid>.\n",
+		name);
+
+	return 0;
+}
+
+static int version(const char *name)
+{
+	struct pt_version v = pt_library_version();
+
+	printf("%s-%d.%d.%d%s / libipt-%" PRIu8 ".%" PRIu8 ".%" PRIu32 "%s\n",
+	       name, PT_VERSION_MAJOR, PT_VERSION_MINOR, PT_VERSION_BUILD,
+	       PT_VERSION_EXT, v.major, v.minor, v.build, v.ext);
+	return 0;
+}
+
+#if defined(FEATURE_MMAP)
+
+/* Map @file read-only.
+ *
+ * Returns zero on success.
+ * Returns a positive value if @file can not be mapped and should be read,
+ * instead.
+ */
+static int map_file(struct ptperf_file *loaded, FILE *file)
+{
+	struct stat stat;
+	uint8_t *base;
+	int fd, errcode;
+
+	fd = fileno(file);
+	if (fd < 0)
+		return 1;
+
+	errcode = fstat(fd, &stat);
+	if (errcode < 0)
+		return 1;
+
+	if (!S_ISREG(stat.st_mode) || stat.st_size <= 0)
+		return 1;
+
+	if ((uint64_t) (size_t) stat.st_size != (uint64_t) stat.st_size)
+		return 1;
+
+	base = mmap(NULL, (size_t) stat.st_size, PROT_READ, MAP_PRIVATE, fd,
+		    0);
+	if (base == MAP_FAILED)
+		return 1;
+
+	loaded->base = base;
+	loaded->size = (size_t) stat.st_size;
+	loaded->mapped = 1;
+
+	return 0;
+}
+
+#endif /* defined(FEATURE_MMAP) */
+
+static int load_file(struct ptperf_file *loaded, const char *arg,
+		     const char *prog)
+{
+	uint8_t *content;
+	size_t read;
+	FILE *file;
+	long fsize;
+	int errcode;
+
+	errno = 0;
+	file = fopen(arg, "rb");
+	if (!file) {
+		fprintf(stderr, "%s: failed to open %s: %d.\n",
+			prog, arg, errno);
+		return -1;
+	}
+
+#if defined(FEATURE_MMAP)
+	errcode = map_file(loaded, file);
+	if (!errcode) {
+		fclose(file);
+		return 0;
+	}
+#endif /* defined(FEATURE_MMAP) */
+
+	errcode = fseek(file, 0, SEEK_END);
+	if (errcode) {
+		fprintf(stderr, "%s: failed to determine size of %s: %d.\n",
+			prog, arg, errno);
+		goto err_file;
+	}
+
+	fsize = ftell(file);
+	if (fsize <= 0) {
+		fprintf(stderr, "%s: failed to determine size of %s: %d.\n",
+			prog, arg, errno);
+		goto err_file;
+	}
+
+	errcode = fseek(file, 0, SEEK_SET);
+	if (errcode) {
+		fprintf(stderr, "%s: failed to load %s: %d.\n",
+			prog, arg, errno);
+		goto err_file;
+	}
+
+	content = malloc((size_t) fsize);
+	if (!content) {
+		fprintf(stderr, "%s: failed to allocated memory %s.\n",
+			prog, arg);
+		goto err_file;
+	}
+
+	read = fread(content, (size_t) fsize, 1, file);
+	if (read != 1) {
+		fprintf(stderr, "%s: failed to load %s: %d.\n",
+			prog, arg, errno);
+		goto err_content;
+	}
+
+	fclose(file);
+
+	loaded->base = content;
+	loaded->size = (size_t) fsize;
+	loaded->mapped = 0;
+
+	return 0;
+
+err_content:
+	free(content);
+
+err_file:
+	fclose(file);
+	return -1;
+}
+
+static void unload_file(struct ptperf_file *loaded)
+{
+	if (!loaded || !loaded->base)
+		return;
+
+#if defined(FEATURE_MMAP)
+	if (loaded->mapped)
+		(void) munmap(loaded->base, loaded->size);
+	else
+#endif /* defined(FEATURE_MMAP) */
+		free(loaded->base);
+
+	loaded->base = NULL;
+	loaded->size = 0;
+}
+
+static void print_buffers(const struct pt_perf *perf)
+{
+	uint32_t buffer;
+
+	printf("idx  cpu  tid       chunks    size\n");
+	for (buffer = 0; buffer < perf->nbuffers; ++buffer) {
+		const struct pt_perf_buffer *aux;
+
+		aux = &perf->buffer[buffer];
+
+		printf("%-4" PRIu32 " ", aux->idx);
+
+		if (aux->cpu == UINT32_MAX)
+			printf("%-4s ", "-");
+		else
+			printf("%-4" PRIu32 " ", aux->cpu);
+
+		if (aux->tid == UINT32_MAX)
+			printf("%-9s ", "-");
+		else
+			printf("%-9" PRIu32 " ", aux->tid);
+
+		printf("%-9" PRIu32 " %" PRIu64 "\n", aux->nparts, aux->size);
+	}
+}
+
+static void print_mappings(const struct pt_perf *perf)
+{
+	uint32_t idx;
+
+	printf("pid       vaddr             size      offset    file\n");
+	for (idx = 0; idx < perf->nmappings; ++idx) {
+		const struct pt_perf_mapping *mapping;
+
+		mapping = &perf->mapping[idx];
+
+		if (mapping->pid == UINT32_MAX)
+			printf("%-9s ", "-");
+		else
+			printf("%-9" PRIu32 " ", mapping->pid);
+
+		printf("%016" PRIx64 "  %-9" PRIx64 " %-9" PRIx64 " %s\n",
+		       mapping->vaddr, mapping->size, mapping->offset,
+		       mapping->filename);
+	}
+}
+
+static void print_options(const struct pt_perf *perf)
+{
+	const char *sep;
+
+	sep = "";
+	if (perf->cpu.vendor == pcv_intel) {
+		printf("%s--cpu %" PRIu16 "/%" PRIu8 "/%" PRIu8, sep,
+		       perf->cpu.family, perf->cpu.model, perf->cpu.stepping);
+		sep = " ";
+	}
+
+	if (perf->mtc_freq) {
+		printf("%s--mtc-freq %" PRIu8, sep, perf->mtc_freq);
+		sep = " ";
+	}
+
+	if (perf->nom_freq) {
+		printf("%s--nom-freq %" PRIu8, sep, perf->nom_freq);
+		sep = " ";
+	}
+
+	if (perf->cpuid_0x15_eax || perf->cpuid_0x15_ebx) {
+		printf("%s--cpuid-0x15.eax %" PRIu32 " --cpuid-0x15.ebx %"
+		       PRIu32, sep, perf->cpuid_0x15_eax,
+		       perf->cpuid_0x15_ebx);
+		sep = " ";
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct ptperf_file file;
+	struct pt_perf perf;
+	const char *perffile;
+	int errcode, idx, options, mmaps;
+
+	perffile = NULL;
+	options = 0;
+	mmaps = 0;
+
+	for (idx = 1; idx < argc; ++idx) {
+		if (strncmp(argv[idx], "-", 1) != 0) {
+			perffile = argv[idx];
+			if (idx < (argc-1))
+				return usage(argv[0]);
+			break;
+		}
+
+		if (strcmp(argv[idx], "-h") == 0)
+			return help(argv[0]);
+		if (strcmp(argv[idx], "--help") == 0)
+			return help(argv[0]);
+		if (strcmp(argv[idx], "--version") == 0)
+			return version(argv[0]);
+		if (strcmp(argv[idx], "--options") == 0)
+			options = 1;
+		else if (strcmp(argv[idx], "--mmaps") == 0)
+			mmaps = 1;
+		else {
+			fprintf(stderr, "%s: unknown option: %s.\n", argv[0],
+				argv[idx]);
+			return -1;
+		}
+	}
+
+	if (!perffile)
+		return usage(argv[0]);
+
+	memset(&file, 0, sizeof(file));
+	errcode = load_file(&file, perffile, argv[0]);
+	if (errcode < 0)
+		return 1;
+
+	errcode = pt_perf_init(&perf, file.base, file.base + file.size);
+	if (errcode < 0) {
+		fprintf(stderr, "%s: failed to read %s: %s.\n", argv[0],
+			perffile, pt_errstr(pt_errcode(errcode)));
+		unload_file(&file);
+		return 1;
+	}
+
+	if (options)
+		print_options(&perf);
+	else if (mmaps)
+		print_mappings(&perf);
+	else
+		print_buffers(&perf);
+
+	pt_perf_fini(&perf);
+	unload_file(&file);
+
+	return 0;
+}
@@ -0,0 +1,713 @@
+/*
+ * Copyright (c) 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ptunit.h"
+#include "ptunit_mktempname.h"
+
+#include "pt_perf.h"
+
+#include "intel-pt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The layout of the test perf.data file. */
+enum {
+	pfix_attrs	= 104,
+	pfix_attr_size	= 136,
+	pfix_data	= pfix_attrs + pfix_attr_size,
+	pfix_pmu_type	= 8
+};
+
+/* A test fixture providing a perf.data file. */
+struct perf_fixture {
+	/* The file contents. */
+	uint8_t data[0x800];
+
+	/* The current write position in @data. */
+	uint8_t *pos;
+
+	/* The end of the data section. */
+	uint8_t *data_end;
+
+	/* The end of the file. */
+	uint8_t *end;
+
+	/* The offsets of the trace chunks in @data. */
+	uint8_t *chunk[3];
+
+	/* The perf.data file. */
+	struct pt_perf perf;
+
+	/* The test fixture initialization and finalization functions. */
+	struct ptunit_result (*init)(struct perf_fixture *);
+	struct ptunit_result (*fini)(struct perf_fixture *);
+};
+
+static void pfix_put16(struct perf_fixture *pfix, uint16_t value)
+{
+	memcpy(pfix->pos, &value, sizeof(value));
+	pfix->pos += sizeof(value);
+}
+
+static void pfix_put32(struct perf_fixture *pfix, uint32_t value)
+{
+	memcpy(pfix->pos, &value, sizeof(value));
+	pfix->pos += sizeof(value);
+}
+
+static void pfix_put64(struct perf_fixture *pfix, uint64_t value)
+{
+	memcpy(pfix->pos, &value, sizeof(value));
+	pfix->pos += sizeof(value);
+}
+
+static void pfix_put_header(struct perf_fixture *pfix, uint32_t type,
+			    uint16_t size)
+{
+	pfix_put32(pfix, type);
+	pfix_put16(pfix, 0);
+	pfix_put16(pfix, size);
+}
+
+/* Write a PERF_RECORD_MMAP or PERF_RECORD_MMAP2 record.
+ *
+ * The filename must fit into 16 bytes including the terminating zero.
+ */
+static void pfix_put_mmap(struct perf_fixture *pfix, uint32_t type,
+			  uint16_t misc, uint32_t pid, uint64_t vaddr,
+			  uint32_t prot, const char *filename)
+{
+	uint16_t size;
+
+	size = (type == 10) ? 72 + 16 : 40 + 16;
+
+	pfix_put32(pfix, type);
+	pfix_put16(pfix, misc);
+	pfix_put16(pfix, size);
+	pfix_put32(pfix, pid);
+	pfix_put32(pfix, pid + 1);
+	pfix_put64(pfix, vaddr);
+	pfix_put64(pfix, 0x2000ull);
+	pfix_put64(pfix, 0x1000ull);
+
+	if (type == 10) {
+		pfix_put64(pfix, 0ull);
+		pfix_put64(pfix, 0ull);
+		pfix_put64(pfix, 0ull);
+		pfix_put32(pfix, prot);
+		pfix_put32(pfix, 0);
+	}
+
+	memset(pfix->pos, 0, 16);
+	strncpy((char *) pfix->pos, filename, 15);
+	pfix->pos += 16;
+}
+
+/* Write a PERF_RECORD_AUXTRACE record for @size bytes of trace. */
+static uint8_t *pfix_put_auxtrace(struct perf_fixture *pfix, uint32_t idx,
+				  uint32_t cpu, uint8_t size)
+{
+	uint8_t *chunk;
+
+	pfix_put_header(pfix, 71, 48);
+	pfix_put64(pfix, size);
+	pfix_put64(pfix, 0ull);
+	pfix_put64(pfix, 0ull);
+	pfix_put32(pfix, idx);
+	pfix_put32(pfix, UINT32_MAX);
+	pfix_put32(pfix, cpu);
+	pfix_put32(pfix, 0);
+
+	chunk = pfix->pos;
+	memset(chunk, (int) (idx + size), size);
+	pfix->pos += size;
+
+	return chunk;
+}
+
+/* Write the file header with the data section ending at @data_end. */
+static void pfix_put_file_header(struct perf_fixture *pfix,
+				 const uint8_t *data_end, int features)
+{
+	pfix->pos = pfix->data;
+
+	pfix_put64(pfix, 0x32454c4946524550ull);
+	pfix_put64(pfix, 104);
+	pfix_put64(pfix, pfix_attr_size);
+	pfix_put64(pfix, pfix_attrs);
+	pfix_put64(pfix, pfix_attr_size);
+	pfix_put64(pfix, pfix_data);
+	pfix_put64(pfix, (uint64_t) (data_end - &pfix->data[pfix_data]));
+	pfix_put64(pfix, 0ull);
+	pfix_put64(pfix, 0ull);
+
+	/* The cpuid header feature. */
+	pfix_put64(pfix, features ? (1ull << 9) : 0ull);
+	pfix_put64(pfix, 0ull);
+	pfix_put64(pfix, 0ull);
+	pfix_put64(pfix, 0ull);
+}
+
+static struct ptunit_result pfix_init(struct perf_fixture *pfix)
+{
+	static const char cpuid[] = "GenuineIntel,6,142,10";
+	uint8_t *features;
+	int priv;
+
+	memset(pfix->data, 0, sizeof(pfix->data));
+
+	/* The Intel PT event with MTC enabled at frequency 3. */
+	pfix->pos = &pfix->data[pfix_attrs];
+	pfix_put32(pfix, pfix_pmu_type);
+	pfix_put32(pfix, pfix_attr_size - 16);
+	pfix_put64(pfix, (1ull << 9) | (3ull << 14));
+
+	pfix->pos = &pfix->data[pfix_data];
+
+	/* A PERF_RECORD_AUXTRACE_INFO record for Intel PT. */
+	pfix_put_header(pfix, 70, 16 + (17 * 8));
+	pfix_put32(pfix, 1);
+	pfix_put32(pfix, 0);
+	for (priv = 0; priv < 17; ++priv) {
+		switch (priv) {
+		case 0:
+			pfix_put64(pfix, pfix_pmu_type);
+			break;
+
+		case 10:
+			pfix_put64(pfix, 1ull << 9);
+			break;
+
+		case 11:
+			pfix_put64(pfix, 0xfull << 14);
+			break;
+
+		case 12:
+			pfix_put64(pfix, 0x70);
+			break;
+
+		case 13:
+			pfix_put64(pfix, 2);
+			break;
+
+		case 15:
+			pfix_put64(pfix, 20);
+			break;
+
+		default:
+			pfix_put64(pfix, 0ull);
+			break;
+		}
+	}
+
+	pfix->chunk[0] = pfix_put_auxtrace(pfix, 0, 0, 4);
+
+	/* A PERF_RECORD_SAMPLE record that we skip. */
+	pfix_put_header(pfix, 9, 16);
+	pfix_put64(pfix, 0ull);
+
+	/* Executable and data mappings; we only collect the former. */
+	pfix_put_mmap(pfix, 1, 0, 42, 0x400000ull, 0, "/bin/a");
+	pfix_put_mmap(pfix, 1, 1 << 13, 42, 0x600000ull, 0, "/bin/a");
+	pfix_put_mmap(pfix, 10, 0, 43, 0x7f0000ull, 5, "/lib/b.so");
+	pfix_put_mmap(pfix, 10, 0, 43, 0x7f2000ull, 3, "/lib/b.so");
+
+	pfix->chunk[1] = pfix_put_auxtrace(pfix, 1, 1, 3);
+	pfix->chunk[2] = pfix_put_auxtrace(pfix, 0, 0, 5);
+
+	pfix->data_end = pfix->pos;
+
+	/* The header feature sections. */
+	features = pfix->pos;
+	pfix_put64(pfix, (uint64_t) (features + 16 - pfix->data));
+	pfix_put64(pfix, 4 + 24);
+	pfix_put32(pfix, 24);
+	memcpy(pfix->pos, cpuid, sizeof(cpuid));
+	pfix->pos += 24;
+
+	pfix->end = pfix->pos;
+
+	pfix_put_file_header(pfix, pfix->data_end, 1);
+
+	memset(&pfix->perf, 0, sizeof(pfix->perf));
+
+	return ptu_passed();
+}
+
+static struct ptunit_result pfix_fini(struct perf_fixture *pfix)
+{
+	pt_perf_fini(&pfix->perf);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_null(void)
+{
+	struct pt_perf perf;
+	uint8_t data[4];
+	int errcode;
+
+	memset(data, 0, sizeof(data));
+
+	errcode = pt_perf_init(NULL, data, data + sizeof(data));
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_perf_init(&perf, NULL, data + sizeof(data));
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_perf_init(&perf, data, NULL);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_empty(void)
+{
+	struct pt_perf perf;
+	uint8_t data[4];
+	int errcode;
+
+	memset(data, 0, sizeof(data));
+
+	errcode = pt_perf_init(&perf, data, data);
+	ptu_int_eq(errcode, -pte_bad_config);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_bad_magic(struct perf_fixture *pfix)
+{
+	int errcode;
+
+	pfix->data[0] += 1;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, -pte_bad_config);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_swapped(struct perf_fixture *pfix)
+{
+	uint64_t magic;
+	int errcode;
+
+	magic = 0x50455246494c4532ull;
+	memcpy(pfix->data, &magic, sizeof(magic));
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, -pte_not_supported);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_bad_data(struct perf_fixture *pfix)
+{
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->data_end - 1);
+	ptu_int_eq(errcode, -pte_bad_config);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_bad_record(struct perf_fixture *pfix)
+{
+	uint16_t size;
+	int errcode;
+
+	/* Corrupt the size of the PERF_RECORD_AUXTRACE_INFO record. */
+	size = 4;
+	memcpy(&pfix->data[pfix_data + 6], &size, sizeof(size));
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, -pte_bad_packet);
+	ptu_uint_eq(pfix->perf.nbuffers, 0);
+	ptu_null(pfix->perf.buffer);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init(struct perf_fixture *pfix)
+{
+	const struct pt_perf_buffer *buffer;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(pfix->perf.nbuffers, 2);
+
+	buffer = &pfix->perf.buffer[0];
+	ptu_uint_eq(buffer->idx, 0);
+	ptu_uint_eq(buffer->cpu, 0);
+	ptu_uint_eq(buffer->tid, UINT32_MAX);
+	ptu_uint_eq(buffer->size, 9);
+	ptu_uint_eq(buffer->nparts, 2);
+	ptu_ptr_eq(buffer->part[0].begin, pfix->chunk[0]);
+	ptu_ptr_eq(buffer->part[0].end, pfix->chunk[0] + 4);
+	ptu_ptr_eq(buffer->part[1].begin, pfix->chunk[2]);
+	ptu_ptr_eq(buffer->part[1].end, pfix->chunk[2] + 5);
+
+	buffer = &pfix->perf.buffer[1];
+	ptu_uint_eq(buffer->idx, 1);
+	ptu_uint_eq(buffer->cpu, 1);
+	ptu_uint_eq(buffer->size, 3);
+	ptu_uint_eq(buffer->nparts, 1);
+	ptu_ptr_eq(buffer->part[0].begin, pfix->chunk[1]);
+	ptu_ptr_eq(buffer->part[0].end, pfix->chunk[1] + 3);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_cpu(struct perf_fixture *pfix)
+{
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+	ptu_int_eq(pfix->perf.cpu.vendor, pcv_intel);
+	ptu_uint_eq(pfix->perf.cpu.family, 6);
+	ptu_uint_eq(pfix->perf.cpu.model, 142);
+	ptu_uint_eq(pfix->perf.cpu.stepping, 10);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_no_cpu(struct perf_fixture *pfix)
+{
+	int errcode;
+
+	pfix_put_file_header(pfix, pfix->data_end, 0);
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+	ptu_int_eq(pfix->perf.cpu.vendor, pcv_unknown);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_info(struct perf_fixture *pfix)
+{
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(pfix->perf.cpuid_0x15_eax, 2);
+	ptu_uint_eq(pfix->perf.cpuid_0x15_ebx, 0x70);
+	ptu_uint_eq(pfix->perf.nom_freq, 20);
+	ptu_uint_eq(pfix->perf.mtc_freq, 3);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_interrupted(struct perf_fixture *pfix)
+{
+	const struct pt_perf_buffer *buffer;
+	int errcode;
+
+	/* An interrupted perf leaves the data size at zero and may truncate
+	 * the last chunk.
+	 */
+	pfix_put_file_header(pfix, &pfix->data[pfix_data], 0);
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->chunk[2] + 2);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(pfix->perf.nbuffers, 2);
+
+	buffer = pt_perf_find_buffer(&pfix->perf, 0);
+	ptu_ptr(buffer);
+	ptu_uint_eq(buffer->nparts, 2);
+	ptu_uint_eq(buffer->size, 6);
+	ptu_ptr_eq(buffer->part[1].end, pfix->chunk[2] + 2);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_mmap(struct perf_fixture *pfix)
+{
+	const struct pt_perf_mapping *mapping;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+	ptu_uint_eq(pfix->perf.nmappings, 2);
+
+	mapping = &pfix->perf.mapping[0];
+	ptu_str_eq(mapping->filename, "/bin/a");
+	ptu_uint_eq(mapping->pid, 42);
+	ptu_uint_eq(mapping->tid, 43);
+	ptu_uint_eq(mapping->vaddr, 0x400000ull);
+	ptu_uint_eq(mapping->size, 0x2000ull);
+	ptu_uint_eq(mapping->offset, 0x1000ull);
+
+	mapping = &pfix->perf.mapping[1];
+	ptu_str_eq(mapping->filename, "/lib/b.so");
+	ptu_uint_eq(mapping->pid, 43);
+	ptu_uint_eq(mapping->vaddr, 0x7f0000ull);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result init_bad_mmap(struct perf_fixture *pfix)
+{
+	uint8_t *pos;
+	int errcode;
+
+	/* Remove the terminating zero from the first mapping's filename. */
+	pos = pfix->chunk[0] + 4 + 16 + 40;
+	memset(pos, 'a', 16);
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, -pte_bad_packet);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result image_null(struct perf_fixture *pfix)
+{
+	struct pt_image *image;
+	int errcode;
+
+	errcode = pt_perf_image(NULL, &pfix->perf, 0, NULL);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	image = pt_image_alloc(NULL);
+	ptu_ptr(image);
+
+	errcode = pt_perf_image(image, NULL, 0, NULL);
+	pt_image_free(image);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result image(struct perf_fixture *pfix)
+{
+	struct pt_perf_mapping mapping[4];
+	struct pt_image *image;
+	uint8_t content[0x100];
+	char *name;
+	FILE *file;
+	size_t written;
+	int skipped, removed;
+
+	name = mktempname();
+	ptu_ptr(name);
+
+	memset(content, 0xcc, sizeof(content));
+
+	file = fopen(name, "wb");
+	ptu_ptr(file);
+
+	written = fwrite(content, sizeof(content), 1, file);
+	fclose(file);
+	ptu_uint_eq(written, 1);
+
+	memset(mapping, 0, sizeof(mapping));
+
+	mapping[0].filename = name;
+	mapping[0].pid = 1;
+	mapping[0].vaddr = 0x1000ull;
+	mapping[0].size = sizeof(content);
+
+	/* This one overlaps. */
+	mapping[1] = mapping[0];
+	mapping[1].vaddr = 0x1080ull;
+
+	/* This one does not exist. */
+	mapping[2] = mapping[0];
+	mapping[2].filename = "";
+	mapping[2].vaddr = 0x2000ull;
+
+	/* This one is in a different process. */
+	mapping[3] = mapping[0];
+	mapping[3].pid = 2;
+
+	pfix->perf.mapping = mapping;
+	pfix->perf.nmappings = 4;
+
+	image = pt_image_alloc(NULL);
+	ptu_ptr(image);
+
+	skipped = pt_perf_image(image, &pfix->perf, 1, NULL);
+	removed = pt_image_remove_by_filename(image, name, NULL);
+
+	pt_image_free(image);
+	remove(name);
+	free(name);
+
+	pfix->perf.mapping = NULL;
+	pfix->perf.nmappings = 0;
+
+	ptu_int_eq(skipped, 2);
+	ptu_int_eq(removed, 1);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result find_buffer(struct perf_fixture *pfix)
+{
+	const struct pt_perf_buffer *buffer;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+
+	buffer = pt_perf_find_buffer(&pfix->perf, 1);
+	ptu_ptr_eq(buffer, &pfix->perf.buffer[1]);
+
+	buffer = pt_perf_find_buffer(&pfix->perf, 2);
+	ptu_null(buffer);
+
+	buffer = pt_perf_find_buffer(NULL, 0);
+	ptu_null(buffer);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result config_null(struct perf_fixture *pfix)
+{
+	struct pt_config config;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+
+	errcode = pt_perf_config(NULL, &pfix->perf, 0);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	errcode = pt_perf_config(&config, NULL, 0);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result config_bad_idx(struct perf_fixture *pfix)
+{
+	struct pt_config config;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+
+	pt_config_init(&config);
+
+	errcode = pt_perf_config(&config, &pfix->perf, 2);
+	ptu_int_eq(errcode, -pte_invalid);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result config(struct perf_fixture *pfix)
+{
+	struct pt_config config;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+
+	pt_config_init(&config);
+
+	errcode = pt_perf_config(&config, &pfix->perf, 0);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(config.begin, pfix->chunk[0]);
+	ptu_ptr_eq(config.end, pfix->chunk[0] + 4);
+	ptu_uint_eq(config.nparts, 1);
+	ptu_ptr_eq(config.parts[0].begin, pfix->chunk[2]);
+	ptu_ptr_eq(config.parts[0].end, pfix->chunk[2] + 5);
+	ptu_int_eq(config.cpu.vendor, pcv_intel);
+	ptu_uint_eq(config.cpu.model, 142);
+	ptu_uint_eq(config.cpuid_0x15_eax, 2);
+	ptu_uint_eq(config.cpuid_0x15_ebx, 0x70);
+	ptu_uint_eq(config.nom_freq, 20);
+	ptu_uint_eq(config.mtc_freq, 3);
+
+	return ptu_passed();
+}
+
+static struct ptunit_result config_keep(struct perf_fixture *pfix)
+{
+	struct pt_config config;
+	int errcode;
+
+	errcode = pt_perf_init(&pfix->perf, pfix->data, pfix->end);
+	ptu_int_eq(errcode, 0);
+
+	pt_config_init(&config);
+	config.cpu.vendor = pcv_intel;
+	config.cpu.family = 6;
+	config.cpu.model = 61;
+	config.nom_freq = 10;
+
+	errcode = pt_perf_config(&config, &pfix->perf, 1);
+	ptu_int_eq(errcode, 0);
+	ptu_ptr_eq(config.begin, pfix->chunk[1]);
+	ptu_uint_eq(config.nparts, 0);
+	ptu_uint_eq(config.cpu.model, 61);
+	ptu_uint_eq(config.nom_freq, 10);
+	ptu_uint_eq(config.mtc_freq, 3);
+
+	return ptu_passed();
+}
+
+int main(int argc, char **argv)
+{
+	struct perf_fixture pfix;
+	struct ptunit_suite suite;
+
+	pfix.init = pfix_init;
+	pfix.fini = pfix_fini;
+
+	suite = ptunit_mk_suite(argc, argv);
+
+	ptu_run(suite, init_null);
+	ptu_run(suite, init_empty);
+	ptu_run_f(suite, init_bad_magic, pfix);
+	ptu_run_f(suite, init_swapped, pfix);
+	ptu_run_f(suite, init_bad_data, pfix);
+	ptu_run_f(suite, init_bad_record, pfix);
+	ptu_run_f(suite, init, pfix);
+	ptu_run_f(suite, init_cpu, pfix);
+	ptu_run_f(suite, init_no_cpu, pfix);
+	ptu_run_f(suite, init_info, pfix);
+	ptu_run_f(suite, init_interrupted, pfix);
+	ptu_run_f(suite, init_mmap, pfix);
+	ptu_run_f(suite, init_bad_mmap, pfix);
+	ptu_run_f(suite, find_buffer, pfix);
+	ptu_run_f(suite, config_null, pfix);
+	ptu_run_f(suite, config_bad_idx, pfix);
+	ptu_run_f(suite, config, pfix);
+	ptu_run_f(suite, config_keep, pfix);
+	ptu_run_f(suite, image_null, pfix);
+	ptu_run_f(suite, image, pfix);
+
+	ptunit_report(&suite);
+	return suite.nr_fails;
+}
@@ -57,4 +57,28 @@ struct pt_image;
 extern int load_elf(struct pt_image *image, const char *file,
 		    uint64_t base, const char *prog, int verbose);
 
+/* Load the kernel from an ELF core file.
+ *
+ * Adds sections for the executable ELF LOAD segments in the kernel text
+ * mapping of an x86_64 kernel core file like /proc/kcore.  This includes the
+ * kernel and its modules but neither the direct mapping of physical memory
+ * nor the vmalloc area.
+ *
+ * The segments are split into pieces of 2MB that are added as separate
+ * sections at their virtual addresses.  The file is not read until the
+ * decoder needs a piece.
+ *
+ * The name of the program in @prog is used for error reporting.
+ * If @verbose is non-zero, prints information about loaded segments.
+ *
+ * Successfully loaded segments are not unloaded in case of errors.
+ *
+ * Returns 0 on success, a negative error code otherwise.
+ * Returns -pte_invalid if @image or @file are NULL.
+ * Returns -pte_bad_config if @file can't be processed.
+ * Returns -pte_nomem if not enough memory can be allocated.
+ */
+extern int load_kcore(struct pt_image *image, const char *file,
+		      const char *prog, int verbose);
+
 #endif /* LOAD_ELF_H */
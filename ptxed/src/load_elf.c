@@ -25,111 +25,208 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined(FEATURE_MMAP)
+# define _POSIX_C_SOURCE 200112L
+# define _DEFAULT_SOURCE 1
+# define _DARWIN_C_SOURCE 1
+#endif /* defined(FEATURE_MMAP) */
 
 #include "load_elf.h"
 
 #include "intel-pt.h"
 
+#include <stdlib.h>
 #include <stdio.h>
 #include <elf.h>
 #include <inttypes.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 
+#if defined(FEATURE_MMAP)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif /* defined(FEATURE_MMAP) */
 
-static int load_elf32(struct pt_image *image, FILE *file, uint64_t base,
-		      const char *name, const char *prog, int verbose)
+
+/* An ELF file opened for reading its headers. */
+struct elf_file {
+	/* The file. */
+	FILE *file;
+
+#if defined(FEATURE_MMAP)
+	/* The mapped file contents - NULL if the file could not be mapped. */
+	const uint8_t *begin;
+
+	/* The size of the mapped file in bytes. */
+	size_t size;
+#endif /* defined(FEATURE_MMAP) */
+
+	/* The file name and the program name for error reporting. */
+	const char *name;
+	const char *prog;
+};
+
+/* Read @size bytes at @offset in @elf into @buffer.
+ *
+ * Returns zero on success, -pte_bad_config otherwise.
+ */
+static int elf_read(const struct elf_file *elf, void *buffer, uint64_t offset,
+		    size_t size, const char *what)
 {
-	Elf32_Ehdr ehdr;
-	Elf32_Half pidx;
-	int64_t offset;
-	int count, errcode, sections;
+	int errcode, count;
+
+#if defined(FEATURE_MMAP)
+	if (elf->begin) {
+		if ((elf->size < offset) || ((elf->size - offset) < size)) {
+			fprintf(stderr, "%s: warning: %s error reading %s: "
+				"truncated file.\n", elf->prog, elf->name,
+				what);
+			return -pte_bad_config;
+		}
 
-	errcode = fseek(file, 0, SEEK_SET);
-	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking ELF header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
+		memcpy(buffer, elf->begin + offset, size);
+		return 0;
 	}
+#endif /* defined(FEATURE_MMAP) */
 
-	count = fread(&ehdr, sizeof(ehdr), 1, file);
-	if (count != 1) {
-		fprintf(stderr,
-			"%s: warning: %s error reading ELF header: %s.\n",
-			prog, name, strerror(errno));
+	if (LONG_MAX < offset) {
+		fprintf(stderr, "%s: warning: %s error seeking %s: "
+			"offset too big.\n", elf->prog, elf->name, what);
 		return -pte_bad_config;
 	}
 
-	errcode = fseek(file, ehdr.e_phoff, SEEK_SET);
+	errcode = fseek(elf->file, (long) offset, SEEK_SET);
 	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking program header: %s.\n",
-			prog, name, strerror(errno));
+		fprintf(stderr, "%s: warning: %s error seeking %s: %s.\n",
+			elf->prog, elf->name, what, strerror(errno));
 		return -pte_bad_config;
 	}
 
-	/* Determine the load offset. */
-	if (!base)
-		offset = 0;
-	else {
-		uint64_t minaddr;
+	count = fread(buffer, size, 1, elf->file);
+	if (count != 1) {
+		fprintf(stderr, "%s: warning: %s error reading %s: %s.\n",
+			elf->prog, elf->name, what, strerror(errno));
+		return -pte_bad_config;
+	}
 
-		minaddr = UINT64_MAX;
+	return 0;
+}
 
-		for (pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
-			Elf32_Phdr phdr;
+/* The load segments of an ELF file. */
+struct elf_segments {
+	/* The segments in program header order. */
+	struct pt_file_segment *segment;
 
-			count = fread(&phdr, sizeof(phdr), 1, file);
-			if (count != 1) {
-				fprintf(stderr,
-					"%s: warning: %s error reading "
-					"phdr %u: %s.\n",
-					prog, name, pidx, strerror(errno));
-				return -pte_bad_config;
-			}
+	/* The index of the program header of each segment in @segment.
+	 *
+	 * A program header may be split into several segments.
+	 */
+	uint32_t *phdr;
 
-			if (phdr.p_type != PT_LOAD)
-				continue;
+	/* The number of segments and the number of allocated entries. */
+	int nsegments;
+	int capacity;
+};
 
-			if (phdr.p_vaddr < minaddr)
-				minaddr = phdr.p_vaddr;
-		}
+static void elf_segments_fini(struct elf_segments *segs)
+{
+	free(segs->segment);
+	free(segs->phdr);
+}
 
-		offset = base - minaddr;
-	}
+/* Append a segment for program header @phdr to @segs.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int elf_segments_append(struct elf_segments *segs, uint32_t phdr,
+			       uint64_t offset, uint64_t size, uint64_t vaddr)
+{
+	struct pt_file_segment *segment;
 
-	errcode = fseek(file, ehdr.e_phoff, SEEK_SET);
-	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking program header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
+	if (segs->capacity <= segs->nsegments) {
+		uint32_t *phdrs;
+		int capacity;
+
+		capacity = segs->capacity ? segs->capacity << 1 : 16;
+		if (capacity <= segs->capacity)
+			return -pte_nomem;
+
+		segment = realloc(segs->segment, capacity * sizeof(*segment));
+		if (!segment)
+			return -pte_nomem;
+
+		segs->segment = segment;
+
+		phdrs = realloc(segs->phdr, capacity * sizeof(*phdrs));
+		if (!phdrs)
+			return -pte_nomem;
+
+		segs->phdr = phdrs;
+		segs->capacity = capacity;
 	}
 
-	for (sections = 0, pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
-		Elf32_Phdr phdr;
+	segment = &segs->segment[segs->nsegments];
+	segment->offset = offset;
+	segment->size = size;
+	segment->vaddr = vaddr;
+	segment->status = 0;
 
-		count = fread(&phdr, sizeof(phdr), 1, file);
-		if (count != 1) {
-			fprintf(stderr,
-				"%s: warning: %s error reading phdr %u: %s.\n",
-				prog, name, pidx, strerror(errno));
-			return -pte_bad_config;
-		}
+	segs->phdr[segs->nsegments] = phdr;
+	segs->nsegments += 1;
 
-		if (phdr.p_type != PT_LOAD)
-			continue;
+	return 0;
+}
 
-		if (!phdr.p_filesz)
-			continue;
+/* Add the ELF LOAD segments in @segs to @image.
+ *
+ * Relocates the segments so that the lowest addressed segment is loaded at
+ * @base, unless @base is zero.
+ *
+ * Segments that can not be added are reported and skipped.
+ */
+static int add_segments(struct pt_image *image, const struct elf_file *elf,
+			struct elf_segments *segs, uint64_t minaddr,
+			uint64_t base, int verbose)
+{
+	int64_t offset;
+	int idx, sections;
+
+	offset = base ? (int64_t) (base - minaddr) : 0ll;
+
+	for (idx = 0; idx < segs->nsegments; ++idx)
+		segs->segment[idx].vaddr += offset;
+
+	/* The status of each segment tells us whether it was added, even if
+	 * the call as a whole fails.
+	 */
+	(void) pt_image_add_file_segments(image, elf->name, segs->segment,
+					  (uint32_t) segs->nsegments, NULL);
+
+	for (sections = 0, idx = 0; idx < segs->nsegments;) {
+		const struct pt_file_segment *first;
+		uint64_t size;
+		uint32_t phdr;
+		int errcode;
+
+		first = &segs->segment[idx];
+		phdr = segs->phdr[idx];
+
+		errcode = 0;
+		size = 0ull;
+		for (; idx < segs->nsegments && segs->phdr[idx] == phdr; ++idx) {
+			if (!errcode)
+				errcode = segs->segment[idx].status;
+
+			size += segs->segment[idx].size;
+		}
 
-		errcode = pt_image_add_file(image, name, phdr.p_offset,
-					    phdr.p_filesz, NULL,
-					    phdr.p_vaddr + offset);
 		if (errcode < 0) {
 			fprintf(stderr, "%s: warning: %s: failed to create "
-				"section for phdr %u: %s.\n", prog, name, pidx,
+				"section for phdr %u: %s.\n", elf->prog,
+				elf->name, phdr,
 				pt_errstr(pt_errcode(errcode)));
 			continue;
 		}
@@ -137,10 +234,10 @@ static int load_elf32(struct pt_image *image, FILE *file, uint64_t base,
 		sections += 1;
 
 		if (verbose) {
-			printf("%s: phdr %u [%s]", prog, pidx, name);
-			printf(" offset=0x%" PRIx32, phdr.p_offset);
-			printf(" size=0x%" PRIx32, phdr.p_filesz);
-			printf(" vaddr=0x%" PRIx32, phdr.p_vaddr);
+			printf("%s: phdr %u [%s]", elf->prog, phdr, elf->name);
+			printf(" offset=0x%" PRIx64, first->offset);
+			printf(" size=0x%" PRIx64, size);
+			printf(" vaddr=0x%" PRIx64, first->vaddr - offset);
 			printf(".\n");
 		}
 	}
@@ -148,153 +245,182 @@ static int load_elf32(struct pt_image *image, FILE *file, uint64_t base,
 	if (!sections)
 		fprintf(stderr,
 			"%s: warning: %s: did not find any load sections.\n",
-			prog,  name);
+			elf->prog, elf->name);
 
 	return 0;
 }
 
-static int load_elf64(struct pt_image *image, FILE *file, uint64_t base,
-		      const char *name, const char *prog, int verbose)
+static int load_elf32(struct pt_image *image, const struct elf_file *elf,
+		      uint64_t base, int verbose)
 {
-	Elf64_Ehdr ehdr;
-	Elf64_Half pidx;
-	int64_t offset;
-	int count, errcode, sections;
+	struct elf_segments segs;
+	Elf32_Ehdr ehdr;
+	Elf32_Half pidx;
+	uint64_t minaddr;
+	int errcode;
 
-	errcode = fseek(file, 0, SEEK_SET);
-	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking ELF header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
-	}
+	errcode = elf_read(elf, &ehdr, 0ull, sizeof(ehdr), "ELF header");
+	if (errcode < 0)
+		return errcode;
 
-	count = fread(&ehdr, sizeof(ehdr), 1, file);
-	if (count != 1) {
-		fprintf(stderr,
-			"%s: warning: %s error reading ELF header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
-	}
+	memset(&segs, 0, sizeof(segs));
 
-	errcode = fseek(file, ehdr.e_phoff, SEEK_SET);
-	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking program header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
-	}
+	minaddr = UINT64_MAX;
+	for (pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
+		Elf32_Phdr phdr;
 
-	/* Determine the load offset. */
-	if (!base)
-		offset = 0;
-	else {
-		uint64_t minaddr;
+		errcode = elf_read(elf, &phdr, ehdr.e_phoff +
+				   ((uint64_t) pidx * ehdr.e_phentsize),
+				   sizeof(phdr), "program header");
+		if (errcode < 0)
+			goto out;
+
+		if (phdr.p_type != PT_LOAD)
+			continue;
 
-		minaddr = UINT64_MAX;
+		if (phdr.p_vaddr < minaddr)
+			minaddr = phdr.p_vaddr;
+
+		if (!phdr.p_filesz)
+			continue;
 
-		for (pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
-			Elf64_Phdr phdr;
+		errcode = elf_segments_append(&segs, pidx, phdr.p_offset,
+					      phdr.p_filesz, phdr.p_vaddr);
+		if (errcode < 0)
+			goto out;
+	}
 
-			count = fread(&phdr, sizeof(phdr), 1, file);
-			if (count != 1) {
-				fprintf(stderr,
-					"%s: warning: %s error reading "
-					"phdr %u: %s.\n",
-					prog, name, pidx, strerror(errno));
-				return -pte_bad_config;
-			}
+	errcode = add_segments(image, elf, &segs, minaddr, base, verbose);
 
-			if (phdr.p_type != PT_LOAD)
-				continue;
+out:
+	elf_segments_fini(&segs);
+	return errcode;
+}
 
-			if (phdr.p_vaddr < minaddr)
-				minaddr = phdr.p_vaddr;
-		}
+static int load_elf64(struct pt_image *image, const struct elf_file *elf,
+		      uint64_t base, int verbose)
+{
+	struct elf_segments segs;
+	Elf64_Ehdr ehdr;
+	Elf64_Half pidx;
+	uint64_t minaddr;
+	int errcode;
 
-		offset = base - minaddr;
-	}
+	errcode = elf_read(elf, &ehdr, 0ull, sizeof(ehdr), "ELF header");
+	if (errcode < 0)
+		return errcode;
 
-	errcode = fseek(file, ehdr.e_phoff, SEEK_SET);
-	if (errcode) {
-		fprintf(stderr,
-			"%s: warning: %s error seeking program header: %s.\n",
-			prog, name, strerror(errno));
-		return -pte_bad_config;
-	}
+	memset(&segs, 0, sizeof(segs));
 
-	for (sections = 0, pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
+	minaddr = UINT64_MAX;
+	for (pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
 		Elf64_Phdr phdr;
 
-		count = fread(&phdr, sizeof(phdr), 1, file);
-		if (count != 1) {
-			fprintf(stderr,
-				"%s: warning: %s error reading phdr %u: %s.\n",
-				prog, name, pidx, strerror(errno));
-			return -pte_bad_config;
-		}
+		errcode = elf_read(elf, &phdr, ehdr.e_phoff +
+				   ((uint64_t) pidx * ehdr.e_phentsize),
+				   sizeof(phdr), "program header");
+		if (errcode < 0)
+			goto out;
 
 		if (phdr.p_type != PT_LOAD)
 			continue;
 
+		if (phdr.p_vaddr < minaddr)
+			minaddr = phdr.p_vaddr;
+
 		if (!phdr.p_filesz)
 			continue;
 
-		errcode = pt_image_add_file(image, name, phdr.p_offset,
-					    phdr.p_filesz, NULL,
-					    phdr.p_vaddr + offset);
-		if (errcode < 0) {
-			fprintf(stderr, "%s: warning: %s: failed to create "
-				"section for phdr %u: %s.\n", prog, name, pidx,
-				pt_errstr(pt_errcode(errcode)));
-			continue;
-		}
+		errcode = elf_segments_append(&segs, pidx, phdr.p_offset,
+					      phdr.p_filesz, phdr.p_vaddr);
+		if (errcode < 0)
+			goto out;
+	}
 
-		sections += 1;
+	errcode = add_segments(image, elf, &segs, minaddr, base, verbose);
 
-		if (verbose) {
-			printf("%s: phdr %u [%s]", prog, pidx, name);
-			printf(" offset=0x%" PRIx64, phdr.p_offset);
-			printf(" size=0x%" PRIx64, phdr.p_filesz);
-			printf(" vaddr=0x%" PRIx64, phdr.p_vaddr);
-			printf(".\n");
-		}
-	}
+out:
+	elf_segments_fini(&segs);
+	return errcode;
+}
 
-	if (!sections)
-		fprintf(stderr,
-			"%s: warning: %s: did not find any load sections.\n",
-			prog,  name);
+#if defined(FEATURE_MMAP)
 
-	return 0;
+/* Map @elf's file read-only.
+ *
+ * Leaves @elf->begin NULL if the file can not be mapped.  The headers will
+ * be read from the file, instead.
+ */
+static void map_elf(struct elf_file *elf)
+{
+	struct stat stat;
+	void *base;
+	int fd, errcode;
+
+	fd = fileno(elf->file);
+	if (fd < 0)
+		return;
+
+	errcode = fstat(fd, &stat);
+	if (errcode)
+		return;
+
+	if ((stat.st_size <= 0) || (SIZE_MAX < (uint64_t) stat.st_size))
+		return;
+
+	base = mmap(NULL, (size_t) stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED)
+		return;
+
+	elf->begin = (const uint8_t *) base;
+	elf->size = (size_t) stat.st_size;
 }
 
-int load_elf(struct pt_image *image, const char *name, uint64_t base,
-	     const char *prog, int verbose)
+static void unmap_elf(struct elf_file *elf)
+{
+	if (elf->begin)
+		munmap((void *) elf->begin, elf->size);
+}
+
+#endif /* defined(FEATURE_MMAP) */
+
+/* Open the ELF file @name for reading its headers.
+ *
+ * If @map is non-zero, tries to map the file so the headers can be read
+ * without system calls.
+ *
+ * Provides the ELF class in @eclass.
+ *
+ * Returns zero on success, -pte_bad_config otherwise.
+ */
+static int open_elf(struct elf_file *elf, uint8_t *eclass, const char *name,
+		    const char *prog, int map)
 {
 	uint8_t e_ident[EI_NIDENT];
-	FILE *file;
-	int errcode, count, idx;
+	int errcode, idx;
 
-	if (!image || !name)
-		return -pte_invalid;
+	memset(elf, 0, sizeof(*elf));
+	elf->name = name;
+	elf->prog = prog;
 
-	file = fopen(name, "rb");
-	if (!file) {
+	elf->file = fopen(name, "rb");
+	if (!elf->file) {
 		fprintf(stderr, "%s: warning: failed to open %s: %s.\n", prog,
 			name, strerror(errno));
 		return -pte_bad_config;
 	}
 
-	count = fread(e_ident, sizeof(e_ident), 1, file);
-	if (count != 1) {
-		fprintf(stderr,
-			"%s: warning: %s failed to read file header: %s.\n",
-			prog, name, strerror(errno));
+#if defined(FEATURE_MMAP)
+	if (map)
+		map_elf(elf);
+#else
+	(void) map;
+#endif /* defined(FEATURE_MMAP) */
 
-		errcode = -pte_bad_config;
-		goto out;
-	}
+	errcode = elf_read(elf, e_ident, 0ull, sizeof(e_ident),
+			   "file header");
+	if (errcode < 0)
+		return errcode;
 
 	for (idx = 0; idx < SELFMAG; ++idx) {
 		if (e_ident[idx] != ELFMAG[idx]) {
@@ -302,28 +428,195 @@ int load_elf(struct pt_image *image, const char *name, uint64_t base,
 				"%s: warning: ignoring %s: not an ELF file.\n",
 				prog, name);
 
-			errcode = -pte_bad_config;
-			goto out;
+			return -pte_bad_config;
 		}
 	}
 
-	switch (e_ident[EI_CLASS]) {
+	*eclass = e_ident[EI_CLASS];
+	return 0;
+}
+
+static void close_elf(struct elf_file *elf)
+{
+	if (!elf->file)
+		return;
+
+#if defined(FEATURE_MMAP)
+	unmap_elf(elf);
+#endif /* defined(FEATURE_MMAP) */
+
+	fclose(elf->file);
+}
+
+int load_elf(struct pt_image *image, const char *name, uint64_t base,
+	     const char *prog, int verbose)
+{
+	struct elf_file elf;
+	uint8_t eclass;
+	int errcode;
+
+	if (!image || !name)
+		return -pte_invalid;
+
+	errcode = open_elf(&elf, &eclass, name, prog, 1);
+	if (errcode < 0)
+		goto out;
+
+	switch (eclass) {
 	default:
 		fprintf(stderr, "%s: unsupported ELF class: %d\n",
-			prog, e_ident[EI_CLASS]);
+			prog, eclass);
 		errcode =  -pte_bad_config;
 		break;
 
 	case ELFCLASS32:
-		errcode = load_elf32(image, file, base, name, prog, verbose);
+		errcode = load_elf32(image, &elf, base, verbose);
 		break;
 
 	case ELFCLASS64:
-		errcode = load_elf64(image, file, base, name, prog, verbose);
+		errcode = load_elf64(image, &elf, base, verbose);
 		break;
 	}
 
 out:
-	fclose(file);
+	close_elf(&elf);
+	return errcode;
+}
+
+/* The start of the kernel text mapping on x86_64.
+ *
+ * The kernel text and the modules are mapped above this address.  The direct
+ * mapping of physical memory and the vmalloc area lie below.
+ */
+static const uint64_t kcore_text_base = 0xffffffff80000000ull;
+
+/* The size of the pieces into which kernel segments are split.
+ *
+ * Each piece is added as a separate section.  It is mapped when it is first
+ * read so memory grows with the amount of kernel code that is executed and
+ * not with the size of the kernel address space.
+ */
+static const uint64_t kcore_chunk_size = 0x200000ull;
+
+/* Split the kernel segment @phdr into pieces and append them to @segs.
+ *
+ * Returns zero on success, a negative error code otherwise.
+ */
+static int kcore_add_chunks(struct elf_segments *segs, uint32_t pidx,
+			    const Elf64_Phdr *phdr)
+{
+	uint64_t offset, size, vaddr;
+
+	offset = phdr->p_offset;
+	vaddr = phdr->p_vaddr;
+	for (size = phdr->p_filesz; size;) {
+		uint64_t chunk;
+		int errcode;
+
+		/* Align the pieces to the chunk size in the virtual address
+		 * space so they do not depend on where the segment starts.
+		 */
+		chunk = kcore_chunk_size - (vaddr & (kcore_chunk_size - 1));
+		if (size < chunk)
+			chunk = size;
+
+		errcode = elf_segments_append(segs, pidx, offset, chunk, vaddr);
+		if (errcode < 0)
+			return errcode;
+
+		offset += chunk;
+		vaddr += chunk;
+		size -= chunk;
+	}
+
+	return 0;
+}
+
+static int load_kcore64(struct pt_image *image, const struct elf_file *elf,
+			int verbose)
+{
+	struct elf_segments segs;
+	Elf64_Ehdr ehdr;
+	Elf64_Half pidx;
+	int errcode;
+
+	errcode = elf_read(elf, &ehdr, 0ull, sizeof(ehdr), "ELF header");
+	if (errcode < 0)
+		return errcode;
+
+	if (ehdr.e_type != ET_CORE) {
+		fprintf(stderr, "%s: warning: ignoring %s: not a core file.\n",
+			elf->prog, elf->name);
+		return -pte_bad_config;
+	}
+
+	/* We only know the kernel text layout on x86_64. */
+	if (ehdr.e_machine != EM_X86_64) {
+		fprintf(stderr, "%s: warning: ignoring %s: unsupported "
+			"machine: %u.\n", elf->prog, elf->name,
+			ehdr.e_machine);
+		return -pte_bad_config;
+	}
+
+	memset(&segs, 0, sizeof(segs));
+
+	for (pidx = 0; pidx < ehdr.e_phnum; ++pidx) {
+		Elf64_Phdr phdr;
+
+		errcode = elf_read(elf, &phdr, ehdr.e_phoff +
+				   ((uint64_t) pidx * ehdr.e_phentsize),
+				   sizeof(phdr), "program header");
+		if (errcode < 0)
+			goto out;
+
+		if (phdr.p_type != PT_LOAD)
+			continue;
+
+		if (!(phdr.p_flags & PF_X) || !phdr.p_filesz)
+			continue;
+
+		if (phdr.p_vaddr < kcore_text_base)
+			continue;
+
+		errcode = kcore_add_chunks(&segs, pidx, &phdr);
+		if (errcode < 0)
+			goto out;
+	}
+
+	errcode = add_segments(image, elf, &segs, 0ull, 0ull, verbose);
+
+out:
+	elf_segments_fini(&segs);
+	return errcode;
+}
+
+int load_kcore(struct pt_image *image, const char *name, const char *prog,
+	       int verbose)
+{
+	struct elf_file elf;
+	uint8_t eclass;
+	int errcode;
+
+	if (!image || !name)
+		return -pte_invalid;
+
+	/* The kernel's core file is as big as its address space and
+	 * can't be mapped.
+	 */
+	errcode = open_elf(&elf, &eclass, name, prog, 0);
+	if (errcode < 0)
+		goto out;
+
+	if (eclass != ELFCLASS64) {
+		fprintf(stderr, "%s: unsupported ELF class: %d\n",
+			prog, eclass);
+		errcode = -pte_bad_config;
+		goto out;
+	}
+
+	errcode = load_kcore64(image, &elf, verbose);
+
+out:
+	close_elf(&elf);
 	return errcode;
 }
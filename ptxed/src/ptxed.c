@@ -26,20 +26,39 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(FEATURE_MMAP)
+# define _POSIX_C_SOURCE 200112L
+# define _DEFAULT_SOURCE 1
+# define _DARWIN_C_SOURCE 1
+#endif /* defined(FEATURE_MMAP) */
+
 #if defined(FEATURE_ELF)
 # include "load_elf.h"
 #endif /* defined(FEATURE_ELF) */
 
 #include "pt_cpu.h"
+#include "pt_perf.h"
 
 #include "intel-pt.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
 
+#if defined(FEATURE_MMAP)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif /* defined(FEATURE_MMAP) */
+
+#if defined(FEATURE_RUSAGE)
+# include <sys/resource.h>
+#endif /* defined(FEATURE_RUSAGE) */
+
 #include <xed-state.h>
 #include <xed-init.h>
 #include <xed-error-enum.h>
@@ -59,25 +78,117 @@ struct ptxed_options {
 	/* Print statistics (overrides quiet). */
 	uint32_t print_stats:1;
 
+	/* Print disassembly cache statistics. */
+	uint32_t print_dcache_stats:1;
+
 	/* Print information about section loads and unloads. */
 	uint32_t track_image:1;
 
 	/* Print in AT&T format. */
 	uint32_t att_format:1;
 
+	/* Print in binary instruction trace format. */
+	uint32_t bin_format:1;
+
 	/* Print the offset into the trace file. */
 	uint32_t print_offset:1;
 
 	/* Print the raw bytes for an insn. */
 	uint32_t print_raw_insn:1;
+
+	/* Prefault the trace file when mapping it. */
+	uint32_t pt_populate:1;
+};
+
+/* A trace file loaded into memory. */
+struct ptxed_file {
+	/* The mapped or allocated memory. */
+	void *base;
+
+	/* The size of @base in bytes. */
+	size_t size;
+
+	/* A flag telling whether @base has been mapped. */
+	uint32_t mapped:1;
 };
 
 /* A collection of statistics. */
 struct ptxed_stats {
 	/* The number of instructions. */
 	uint64_t insn;
+
+	/* The number of disassembly cache hits and misses. */
+	uint64_t dcache_hit;
+	uint64_t dcache_miss;
+
+#if defined(FEATURE_RUSAGE)
+	/* The number of minor and major page faults while decoding. */
+	uint64_t minflt;
+	uint64_t majflt;
+#endif /* defined(FEATURE_RUSAGE) */
+};
+
+/* The number of entries in the disassembly cache.
+ *
+ * This must be a power of two.
+ */
+enum {
+	ptxed_dcache_size	= 4096
+};
+
+/* A disassembly cache entry. */
+struct ptxed_dcache_entry {
+	/* The instruction's address. */
+	uint64_t ip;
+
+	/* The instruction's raw bytes. */
+	uint8_t raw[pt_max_insn_size];
+
+	/* The size of the instruction in bytes - zero for unused entries. */
+	uint8_t size;
+
+	/* The execution mode. */
+	uint8_t mode;
+
+	/* The formatted disassembly. */
+	char text[128];
+};
+
+/* A direct-mapped cache of formatted disassembly indexed by IP.
+ *
+ * Hot loops execute the same instructions over and over again.  We remember
+ * how we formatted them to avoid decoding and formatting them again.
+ */
+struct ptxed_dcache {
+	/* The cache entries. */
+	struct ptxed_dcache_entry entry[ptxed_dcache_size];
+};
+
+/* The size of the output buffer in bytes. */
+enum {
+	ptxed_output_size	= 1 << 16
 };
 
+/* A buffer for formatted output.
+ *
+ * We format everything we print to stdout while decoding into this buffer
+ * and write it out in large chunks to avoid the overhead of stdio formatting
+ * and locking.
+ */
+struct ptxed_output {
+	/* The formatted output. */
+	char data[ptxed_output_size];
+
+	/* The number of bytes used in @data. */
+	size_t size;
+
+	/* The binary instruction trace writer state. */
+	struct pt_bin_state bin;
+};
+
+/* The output buffer. */
+static struct ptxed_output output;
+
 
 static void version(const char *name)
 {
@@ -95,19 +206,37 @@ static void help(const char *name)
 	       "  --help|-h                     this text.\n"
 	       "  --version                     display version information and exit.\n"
 	       "  --att                         print instructions in att format.\n"
+	       "  --format=text|bin             print instructions as text (default) or in the\n"
+	       "                                binary instruction trace format.\n"
 	       "  --no-inst                     do not print instructions (only addresses).\n"
 	       "  --quiet|-q                    do not print anything (except errors).\n"
 	       "  --offset                      print the offset into the trace file.\n"
 	       "  --raw-insn                    print the raw bytes of each instruction.\n"
 	       "  --stat                        print statistics (even when quiet).\n"
+	       "  --stat-dcache                 print disassembly cache statistics (implies --stat).\n"
 	       "  --verbose|-v                  print various information (even when quiet).\n"
 	       "  --pt <file>[:<from>[-<to>]]   load the processor trace data from <file>.\n"
 	       "                                an optional offset or range can be given.\n"
+	       "  --perf <file>[:<idx>]         load the processor trace data for AUX area <idx>\n"
+	       "                                (default: 0) from the perf.data file <file>.\n"
+	       "                                the cpu and timing configuration is taken from\n"
+	       "                                <file> unless specified before --perf.\n"
+	       "  --perf-image <pid>            load the files mapped by process <pid> according\n"
+	       "                                to the perf.data file given with --perf.\n"
+	       "  --pt-populate                 prefault the trace file when mapping it.\n"
+	       "                                this must be specified before --pt or --perf.\n"
+	       "  --prefault                    prefault sections when mapping them.  big\n"
+	       "                                sections are read page by page, instead.\n"
 #if defined(FEATURE_ELF)
 	       "  --elf <<file>[:<base>]        load an ELF from <file> at address <base>.\n"
 	       "                                use the default load address if <base> is omitted.\n"
+	       "  --kcore <file>                load the kernel text and modules from the kernel\n"
+	       "                                core file <file>, e.g. /proc/kcore.\n"
 #endif /* defined(FEATURE_ELF) */
 	       "  --raw <file>:<base>           load a raw binary from <file> at address <base>.\n"
+	       "  --image <file>                load the image manifest <file>.\n"
+	       "  --save-image <file>           save the image manifest to <file> once all\n"
+	       "                                options have been processed.\n"
 	       "  --cpu none|auto|f/m[/s]       set cpu to the given value and decode according to:\n"
 	       "                                  none     spec (default)\n"
 	       "                                  auto     current cpu\n"
@@ -118,11 +247,11 @@ static void help(const char *name)
 	       "  --cpuid-0x15.ebx              set the value of cpuid[0x15].ebx.\n"
 	       "\n"
 #if defined(FEATURE_ELF)
-	       "You must specify at least one binary or ELF file (--raw|--elf).\n"
+	       "You must specify at least one binary or ELF file (--raw|--elf|--kcore|--perf-image|--image).\n"
 #else /* defined(FEATURE_ELF) */
-	       "You must specify at least one binary file (--raw).\n"
+	       "You must specify at least one binary file (--raw|--perf-image|--image).\n"
 #endif /* defined(FEATURE_ELF) */
-	       "You must specify exactly one processor trace file (--pt).\n",
+	       "You must specify exactly one processor trace file (--pt|--perf).\n",
 	       name);
 }
 
@@ -175,8 +304,201 @@ static int parse_range(const char *arg, uint64_t *begin, uint64_t *end)
 	return 2;
 }
 
-static int load_file(uint8_t **buffer, size_t *size, char *arg,
-		     const char *prog)
+static int check_range(uint64_t *pbegin, uint64_t *pend, uint64_t fsize,
+		       int range_parts, const char *arg, const char *prog)
+{
+	uint64_t begin, end;
+
+	begin = *pbegin;
+	end = *pend;
+
+	/* Truncate the range to fit into the file unless an explicit range end
+	 * was provided.
+	 */
+	if (range_parts < 2)
+		end = fsize;
+
+	if (fsize <= begin) {
+		fprintf(stderr, "%s: offset 0x%" PRIx64 " outside of %s.\n",
+			prog, begin, arg);
+		return -1;
+	}
+
+	if (fsize < end) {
+		fprintf(stderr, "%s: range 0x%" PRIx64 " outside of %s.\n",
+			prog, end, arg);
+		return -1;
+	}
+
+	if (end <= begin) {
+		fprintf(stderr, "%s: bad range.\n", prog);
+		return -1;
+	}
+
+	*pend = end;
+
+	return 0;
+}
+
+#if defined(FEATURE_MMAP)
+
+/* Map the trace file @file read-only.
+ *
+ * Returns zero on success.
+ * Returns a negative value if the requested range is not valid.
+ * Returns a positive value if @file can not be mapped and should be read,
+ * instead.
+ */
+static int map_file(struct ptxed_file *loaded, uint8_t **buffer, size_t *size,
+		    FILE *file, uint64_t begin, uint64_t end, int range_parts,
+		    int populate, const char *arg, const char *prog)
+{
+	struct stat stat;
+	uint64_t offset, length;
+	uint8_t *base;
+	long page_size;
+	int fd, errcode, flags;
+
+	fd = fileno(file);
+	if (fd < 0)
+		return 1;
+
+	errcode = fstat(fd, &stat);
+	if (errcode < 0)
+		return 1;
+
+	/* Pipes and other special files are read. */
+	if (!S_ISREG(stat.st_mode) || stat.st_size <= 0)
+		return 1;
+
+	errcode = check_range(&begin, &end, (uint64_t) stat.st_size,
+			      range_parts, arg, prog);
+	if (errcode < 0)
+		return errcode;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0)
+		return 1;
+
+	/* The mapping must start at a page boundary. */
+	offset = begin - (begin % (uint64_t) page_size);
+	length = end - offset;
+
+	if ((uint64_t) (size_t) length != length ||
+	    (uint64_t) (off_t) offset != offset)
+		return 1;
+
+	flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+	if (populate)
+		flags |= MAP_POPULATE;
+#endif /* defined(MAP_POPULATE) */
+
+	base = mmap(NULL, (size_t) length, PROT_READ, flags, fd,
+		    (off_t) offset);
+	if (base == MAP_FAILED)
+		return 1;
+
+	/* The hints are only an optimization - we ignore errors. */
+	(void) posix_madvise(base, (size_t) length, POSIX_MADV_SEQUENTIAL);
+#if !defined(MAP_POPULATE)
+	if (populate)
+		(void) posix_madvise(base, (size_t) length,
+				     POSIX_MADV_WILLNEED);
+#endif /* !defined(MAP_POPULATE) */
+
+	loaded->base = base;
+	loaded->size = (size_t) length;
+	loaded->mapped = 1;
+
+	*buffer = base + (begin - offset);
+	*size = (size_t) (end - begin);
+
+	return 0;
+}
+
+#endif /* defined(FEATURE_MMAP) */
+
+/* Read the trace file @file that does not support seeking, e.g. a pipe.
+ *
+ * Returns zero on success, a negative value otherwise.
+ */
+static int read_stream(struct ptxed_file *loaded, uint8_t **buffer,
+		       size_t *size, FILE *file, uint64_t begin, uint64_t end,
+		       int range_parts, const char *arg, const char *prog)
+{
+	uint8_t *content;
+	size_t fsize, capacity;
+	int errcode;
+
+	content = NULL;
+	fsize = 0;
+	capacity = 0;
+
+	for (;;) {
+		size_t read, request;
+
+		/* We do not need to read beyond an explicit range end. */
+		if (range_parts == 2 && end <= fsize)
+			break;
+
+		if (fsize == capacity) {
+			uint8_t *grown;
+
+			capacity = capacity ? capacity * 2 : 0x10000;
+			if (capacity <= fsize) {
+				fprintf(stderr, "%s: %s is too big.\n",
+					prog, arg);
+				goto err_content;
+			}
+
+			grown = realloc(content, capacity);
+			if (!grown) {
+				fprintf(stderr,
+					"%s: failed to allocated memory %s.\n",
+					prog, arg);
+				goto err_content;
+			}
+
+			content = grown;
+		}
+
+		request = capacity - fsize;
+		read = fread(content + fsize, 1, request, file);
+		fsize += read;
+
+		if (read < request) {
+			if (ferror(file)) {
+				fprintf(stderr, "%s: failed to load %s: %d.\n",
+					prog, arg, errno);
+				goto err_content;
+			}
+
+			break;
+		}
+	}
+
+	errcode = check_range(&begin, &end, (uint64_t) fsize, range_parts,
+			      arg, prog);
+	if (errcode < 0)
+		goto err_content;
+
+	loaded->base = content;
+	loaded->size = capacity;
+	loaded->mapped = 0;
+
+	*buffer = content + begin;
+	*size = (size_t) (end - begin);
+
+	return 0;
+
+err_content:
+	free(content);
+	return -1;
+}
+
+static int load_file(struct ptxed_file *loaded, uint8_t **buffer, size_t *size,
+		     char *arg, int populate, const char *prog)
 {
 	uint64_t begin_arg, end_arg;
 	uint8_t *content;
@@ -186,7 +508,7 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 	int errcode, range_parts;
 	char *range;
 
-	if (!buffer || !size || !arg || !prog) {
+	if (!loaded || !buffer || !size || !arg || !prog) {
 		fprintf(stderr, "%s: internal error.\n", prog ? prog : "");
 		return -1;
 	}
@@ -221,11 +543,20 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		return -1;
 	}
 
+#if defined(FEATURE_MMAP)
+	errcode = map_file(loaded, buffer, size, file, begin_arg, end_arg,
+			   range_parts, populate, arg, prog);
+	if (errcode <= 0)
+		goto out_file;
+#else
+	(void) populate;
+#endif /* defined(FEATURE_MMAP) */
+
 	errcode = fseek(file, 0, SEEK_END);
 	if (errcode) {
-		fprintf(stderr, "%s: failed to determine size of %s: %d.\n",
-			prog, arg, errno);
-		goto err_file;
+		errcode = read_stream(loaded, buffer, size, file, begin_arg,
+				      end_arg, range_parts, arg, prog);
+		goto out_file;
 	}
 
 	fsize = ftell(file);
@@ -235,11 +566,10 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		goto err_file;
 	}
 
-	/* Truncate the range to fit into the file unless an explicit range end
-	 * was provided.
-	 */
-	if (range_parts < 2)
-		end_arg = (uint64_t) fsize;
+	errcode = check_range(&begin_arg, &end_arg, (uint64_t) fsize,
+			      range_parts, arg, prog);
+	if (errcode < 0)
+		goto err_file;
 
 	begin = (long) begin_arg;
 	end = (long) end_arg;
@@ -248,23 +578,6 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 		goto err_file;
 	}
 
-	if (fsize <= begin) {
-		fprintf(stderr, "%s: offset 0x%lx outside of %s.\n",
-			prog, begin, arg);
-		goto err_file;
-	}
-
-	if (fsize < end) {
-		fprintf(stderr, "%s: range 0x%lx outside of %s.\n",
-			prog, end, arg);
-		goto err_file;
-	}
-
-	if (end <= begin) {
-		fprintf(stderr, "%s: bad range.\n", prog);
-		goto err_file;
-	}
-
 	fsize = end - begin;
 
 	content = malloc(fsize);
@@ -290,11 +603,19 @@ static int load_file(uint8_t **buffer, size_t *size, char *arg,
 
 	fclose(file);
 
+	loaded->base = content;
+	loaded->size = (size_t) fsize;
+	loaded->mapped = 0;
+
 	*buffer = content;
 	*size = fsize;
 
 	return 0;
 
+out_file:
+	fclose(file);
+	return errcode;
+
 err_content:
 	free(content);
 
@@ -303,13 +624,30 @@ err_file:
 	return -1;
 }
 
-static int load_pt(struct pt_config *config, char *arg, const char *prog)
+static void unload_file(struct ptxed_file *loaded)
+{
+	if (!loaded || !loaded->base)
+		return;
+
+#if defined(FEATURE_MMAP)
+	if (loaded->mapped)
+		(void) munmap(loaded->base, loaded->size);
+	else
+#endif /* defined(FEATURE_MMAP) */
+		free(loaded->base);
+
+	loaded->base = NULL;
+	loaded->size = 0;
+}
+
+static int load_pt(struct pt_config *config, struct ptxed_file *loaded,
+		   char *arg, int populate, const char *prog)
 {
 	uint8_t *buffer;
 	size_t size;
 	int errcode;
 
-	errcode = load_file(&buffer, &size, arg, prog);
+	errcode = load_file(loaded, &buffer, &size, arg, populate, prog);
 	if (errcode < 0)
 		return errcode;
 
@@ -319,6 +657,62 @@ static int load_pt(struct pt_config *config, char *arg, const char *prog)
 	return 0;
 }
 
+/* Load the trace for one AUX area from a perf.data file.
+ *
+ * The AUX area index may be given as :<idx> suffix to @arg.  It defaults to
+ * zero.
+ *
+ * The trace is not copied.  @config points into @loaded via @perf, both of
+ * which must remain valid while @config is used.
+ */
+static int load_perf(struct pt_config *config, struct pt_perf *perf,
+		     struct ptxed_file *loaded, char *arg, int populate,
+		     const char *prog)
+{
+	uint64_t idx;
+	uint8_t *buffer;
+	size_t size;
+	char *sep;
+	int errcode;
+
+	idx = 0ull;
+
+	sep = strrchr(arg, ':');
+	if (sep) {
+		char *rest;
+
+		/* If we can't parse the index, assume that the ':' is part
+		 * of the filename, e.g. a drive letter on Windows.
+		 */
+		errno = 0;
+		idx = strtoull(sep + 1, &rest, 0);
+		if (errno || !sep[1] || *rest || (UINT32_MAX < idx))
+			idx = 0ull;
+		else
+			*sep = 0;
+	}
+
+	errcode = load_file(loaded, &buffer, &size, arg, populate, prog);
+	if (errcode < 0)
+		return errcode;
+
+	errcode = pt_perf_init(perf, buffer, buffer + size);
+	if (errcode < 0) {
+		fprintf(stderr, "%s: failed to read %s: %s.\n", prog, arg,
+			pt_errstr(pt_errcode(errcode)));
+		return errcode;
+	}
+
+	errcode = pt_perf_config(config, perf, (uint32_t) idx);
+	if (errcode < 0) {
+		fprintf(stderr, "%s: no trace for AUX area %" PRIu64 " in %s.\n",
+			prog, idx, arg);
+		return errcode;
+	}
+
+	return 0;
+}
+
 static int load_raw(struct pt_image *image, char *arg, const char *prog)
 {
 	uint64_t base;
@@ -357,124 +751,358 @@ static xed_machine_mode_enum_t translate_mode(enum pt_exec_mode mode)
 	return XED_MACHINE_MODE_INVALID;
 }
 
-static void print_insn(const struct pt_insn *insn, xed_state_t *xed,
-		       const struct ptxed_options *options, uint64_t offset)
+static void output_flush(void)
 {
-	if (!insn || !options) {
-		printf("[internal error]\n");
+	if (!output.size)
 		return;
+
+	fwrite(output.data, output.size, 1, stdout);
+	fflush(stdout);
+
+	output.size = 0;
+}
+
+/* Reserve @size bytes in the output buffer.
+ *
+ * Returns a pointer to the reserved bytes.  The caller must not reserve more
+ * than ptxed_output_size bytes.
+ */
+static char *output_reserve(size_t size)
+{
+	char *pos;
+
+	if ((sizeof(output.data) - output.size) < size)
+		output_flush();
+
+	pos = &output.data[output.size];
+	output.size += size;
+
+	return pos;
+}
+
+static void output_str(const char *str)
+{
+	size_t size;
+
+	size = strlen(str);
+	memcpy(output_reserve(size), str, size);
+}
+
+static void output_printf(const char *format, ...)
+{
+	size_t avail;
+	va_list ap;
+	int size;
+
+	avail = sizeof(output.data) - output.size;
+
+	va_start(ap, format);
+	size = vsnprintf(&output.data[output.size], avail, format, ap);
+	va_end(ap);
+
+	if (size < 0)
+		return;
+
+	/* If it didn't fit, flush and try again.  We truncate anything that
+	 * doesn't fit into an empty buffer.
+	 */
+	if (avail <= (size_t) size) {
+		output_flush();
+
+		avail = sizeof(output.data);
+
+		va_start(ap, format);
+		size = vsnprintf(output.data, avail, format, ap);
+		va_end(ap);
+
+		if (size < 0)
+			return;
+
+		if (avail <= (size_t) size)
+			size = (int) avail - 1;
 	}
 
-	if (insn->resynced)
-		printf("[overflow]\n");
+	output.size += (size_t) size;
+}
 
-	if (insn->enabled)
-		printf("[enabled]\n");
+static const char hex_digits[] = "0123456789abcdef";
 
-	if (insn->resumed)
-		printf("[resumed]\n");
+/* Print @value as 16 hexadecimal digits.
+ *
+ * This is equivalent to printf("%016" PRIx64, value).
+ */
+static void output_hex64(uint64_t value)
+{
+	char *pos;
+	int shift;
 
-	if (insn->speculative)
-		printf("? ");
+	pos = output_reserve(16);
+	for (shift = 60; shift >= 0; shift -= 4)
+		*pos++ = hex_digits[(value >> shift) & 0xf];
+}
 
-	if (options->print_offset)
-		printf("%016" PRIx64 "  ", offset);
+static void output_bin_insn(const struct pt_insn *insn,
+			    const struct ptxed_options *options)
+{
+	uint8_t *begin, *end;
+	int size;
 
-	printf("%016" PRIx64, insn->ip);
+	begin = (uint8_t *) &output.data[output.size];
+	end = (uint8_t *) &output.data[sizeof(output.data)];
 
-	if (options->print_raw_insn) {
-		uint8_t i;
+	size = pt_bin_write_insn(&output.bin, begin, end, insn,
+				 options->print_raw_insn);
+	if (size == -pte_eos) {
+		output_flush();
 
-		printf(" ");
-		for (i = 0; i < insn->size; ++i)
-			printf(" %02x", insn->raw[i]);
+		begin = (uint8_t *) output.data;
+		size = pt_bin_write_insn(&output.bin, begin, end, insn,
+					 options->print_raw_insn);
+	}
 
-		for (; i < sizeof(insn->raw); ++i)
-			printf("   ");
+	if (size < 0) {
+		fprintf(stderr, "[%" PRIx64 ": error writing insn: %s]\n",
+			insn->ip, pt_errstr(pt_errcode(size)));
+		return;
 	}
 
-	if (!options->dont_print_insn) {
-		xed_machine_mode_enum_t mode;
-		xed_decoded_inst_t inst;
-		xed_error_enum_t errcode;
+	output.size += (size_t) size;
+}
 
-		mode = translate_mode(insn->mode);
+static void output_bin_error(int errcode, uint64_t offset, uint64_t ip)
+{
+	uint8_t *begin, *end;
+	int size;
 
-		xed_state_set_machine_mode(xed, mode);
-		xed_decoded_inst_zero_set_mode(&inst, xed);
+	begin = (uint8_t *) &output.data[output.size];
+	end = (uint8_t *) &output.data[sizeof(output.data)];
 
-		errcode = xed_decode(&inst, insn->raw, insn->size);
-		switch (errcode) {
-		case XED_ERROR_NONE: {
-			xed_print_info_t pi;
-			char buffer[256];
-			xed_bool_t ok;
+	size = pt_bin_write_error(&output.bin, begin, end, errcode, offset, ip);
+	if (size == -pte_eos) {
+		output_flush();
 
-			xed_init_print_info(&pi);
-			pi.p = &inst;
-			pi.buf = buffer;
-			pi.blen = sizeof(buffer);
-			pi.runtime_address = insn->ip;
+		begin = (uint8_t *) output.data;
+		size = pt_bin_write_error(&output.bin, begin, end, errcode,
+					  offset, ip);
+	}
 
-			if (options->att_format)
-				pi.syntax = XED_SYNTAX_ATT;
+	if (size < 0) {
+		fprintf(stderr, "[%" PRIx64 ": error writing error: %s]\n",
+			ip, pt_errstr(pt_errcode(size)));
+		return;
+	}
 
-			ok = xed_format_generic(&pi);
-			if (!ok) {
-				printf(" [xed print error]");
-				break;
-			}
+	output.size += (size_t) size;
+}
+
+/* Find the disassembly cache entry for @insn.
+ *
+ * Returns the entry @insn maps to or NULL if @dcache is NULL.
+ */
+static struct ptxed_dcache_entry *dcache_entry(struct ptxed_dcache *dcache,
+					       const struct pt_insn *insn)
+{
+	uint64_t ip;
+
+	if (!dcache || !insn)
+		return NULL;
+
+	ip = (insn->ip * 0x9e3779b97f4a7c15ull) >> 32;
+
+	return &dcache->entry[ip & (ptxed_dcache_size - 1)];
+}
+
+/* Check whether @entry holds the disassembly for @insn. */
+static int dcache_match(const struct ptxed_dcache_entry *entry,
+			const struct pt_insn *insn)
+{
+	if (entry->ip != insn->ip)
+		return 0;
+
+	if (entry->size != insn->size)
+		return 0;
+
+	if (entry->mode != (uint8_t) insn->mode)
+		return 0;
 
-			printf("  %s", buffer);
+	return memcmp(entry->raw, insn->raw, insn->size) == 0;
+}
+
+static void print_disasm(const struct pt_insn *insn, xed_state_t *xed,
+			 struct ptxed_dcache *dcache,
+			 const struct ptxed_options *options,
+			 struct ptxed_stats *stats)
+{
+	struct ptxed_dcache_entry *entry;
+	xed_machine_mode_enum_t mode;
+	xed_decoded_inst_t inst;
+	xed_error_enum_t errcode;
+
+	entry = dcache_entry(dcache, insn);
+	if (entry) {
+		if (dcache_match(entry, insn)) {
+			if (stats)
+				stats->dcache_hit += 1;
+
+			output_str("  ");
+			output_str(entry->text);
+			return;
 		}
-			break;
 
-		default:
-			printf(" [xed decode error: (%u) %s]", errcode,
-			       xed_error_enum_t2str(errcode));
+		if (stats)
+			stats->dcache_miss += 1;
+	}
+
+	mode = translate_mode(insn->mode);
+
+	xed_state_set_machine_mode(xed, mode);
+	xed_decoded_inst_zero_set_mode(&inst, xed);
+
+	errcode = xed_decode(&inst, insn->raw, insn->size);
+	switch (errcode) {
+	case XED_ERROR_NONE: {
+		xed_print_info_t pi;
+		char buffer[256];
+		xed_bool_t ok;
+		size_t len;
+
+		xed_init_print_info(&pi);
+		pi.p = &inst;
+		pi.buf = buffer;
+		pi.blen = sizeof(buffer);
+		pi.runtime_address = insn->ip;
+
+		if (options->att_format)
+			pi.syntax = XED_SYNTAX_ATT;
+
+		ok = xed_format_generic(&pi);
+		if (!ok) {
+			output_str(" [xed print error]");
 			break;
 		}
+
+		output_str("  ");
+		output_str(buffer);
+
+		/* We only cache what fits into the entry.  Longer strings are
+		 * rare enough.
+		 */
+		len = strlen(buffer);
+		if (entry && (len < sizeof(entry->text))) {
+			entry->ip = insn->ip;
+			entry->size = insn->size;
+			entry->mode = (uint8_t) insn->mode;
+			memcpy(entry->raw, insn->raw, insn->size);
+			memcpy(entry->text, buffer, len + 1);
+		}
 	}
+		break;
 
-	printf("\n");
+	default:
+		output_printf(" [xed decode error: (%u) %s]", errcode,
+			      xed_error_enum_t2str(errcode));
+		break;
+	}
+}
+
+static void print_insn(const struct pt_insn *insn, xed_state_t *xed,
+		       struct ptxed_dcache *dcache,
+		       const struct ptxed_options *options,
+		       struct ptxed_stats *stats, uint64_t offset)
+{
+	if (!insn || !options) {
+		output_str("[internal error]\n");
+		return;
+	}
+
+	if (options->bin_format) {
+		output_bin_insn(insn, options);
+		return;
+	}
+
+	if (insn->resynced)
+		output_str("[overflow]\n");
+
+	if (insn->enabled)
+		output_str("[enabled]\n");
+
+	if (insn->resumed)
+		output_str("[resumed]\n");
+
+	if (insn->speculative)
+		output_str("? ");
+
+	if (options->print_offset) {
+		output_hex64(offset);
+		output_str("  ");
+	}
+
+	output_hex64(insn->ip);
+
+	if (options->print_raw_insn) {
+		char *pos;
+		uint8_t i;
+
+		/* One blank plus three characters per byte. */
+		pos = output_reserve(1 + (3 * sizeof(insn->raw)));
+		memset(pos, ' ', 1 + (3 * sizeof(insn->raw)));
+
+		for (i = 0; i < insn->size; ++i) {
+			pos[2 + (3 * i)] = hex_digits[insn->raw[i] >> 4];
+			pos[3 + (3 * i)] = hex_digits[insn->raw[i] & 0xf];
+		}
+	}
+
+	if (!options->dont_print_insn)
+		print_disasm(insn, xed, dcache, options, stats);
+
+	output_str("\n");
 
 	if (insn->interrupted)
-		printf("[interrupt]\n");
+		output_str("[interrupt]\n");
 
 	if (insn->aborted)
-		printf("[aborted]\n");
+		output_str("[aborted]\n");
 
 	if (insn->committed)
-		printf("[committed]\n");
+		output_str("[committed]\n");
 
 	if (insn->disabled)
-		printf("[disabled]\n");
+		output_str("[disabled]\n");
 
 	if (insn->stopped)
-		printf("[stopped]\n");
+		output_str("[stopped]\n");
 }
 
 static void diagnose(const char *errtype, struct pt_insn_decoder *decoder,
-		     const struct pt_insn *insn, int errcode)
+		     const struct pt_insn *insn, int errcode,
+		     const struct ptxed_options *options)
 {
 	int err;
 	uint64_t pos;
 
 	err = pt_insn_get_offset(decoder, &pos);
-	if (err < 0) {
-		printf("could not determine offset: %s\n",
-		       pt_errstr(pt_errcode(err)));
-		printf("[?, %" PRIx64 ": %s: %s]\n", insn->ip, errtype,
-		       pt_errstr(pt_errcode(errcode)));
+	if (options->bin_format) {
+		if (err < 0)
+			pos = 0ull;
+
+		output_bin_error(errcode, pos, insn->ip);
+	} else if (err < 0) {
+		output_printf("could not determine offset: %s\n",
+			      pt_errstr(pt_errcode(err)));
+		output_printf("[?, %" PRIx64 ": %s: %s]\n", insn->ip, errtype,
+			      pt_errstr(pt_errcode(errcode)));
 	} else
-		printf("[%" PRIx64 ", %" PRIx64 ": %s: %s]\n", pos,
-		       insn->ip, errtype, pt_errstr(pt_errcode(errcode)));
+		output_printf("[%" PRIx64 ", %" PRIx64 ": %s: %s]\n", pos,
+			      insn->ip, errtype,
+			      pt_errstr(pt_errcode(errcode)));
 }
 
 static void decode(struct pt_insn_decoder *decoder,
 		   const struct ptxed_options *options,
 		   struct ptxed_stats *stats)
 {
+	struct ptxed_dcache *dcache;
 	xed_state_t xed;
 	uint64_t offset, sync;
 
@@ -484,6 +1112,13 @@ static void decode(struct pt_insn_decoder *decoder,
 	}
 
 	xed_state_zero(&xed);
+	pt_bin_init(&output.bin);
+
+	/* The cache is an optimization.  We can do without it. */
+	dcache = NULL;
+	if (!options->quiet && !options->dont_print_insn &&
+	    !options->bin_format)
+		dcache = calloc(1, sizeof(*dcache));
 
 	offset = 0ull;
 	sync = 0ull;
@@ -501,7 +1136,8 @@ static void decode(struct pt_insn_decoder *decoder,
 			if (errcode == -pte_eos)
 				break;
 
-			diagnose("sync error", decoder, &insn, errcode);
+			diagnose("sync error", decoder, &insn, errcode,
+				 options);
 
 			/* Let's see if we made any progress.  If we haven't,
 			 * we likely never will.  Bail out.
@@ -531,7 +1167,8 @@ static void decode(struct pt_insn_decoder *decoder,
 				 */
 				if (insn.iclass != ptic_error) {
 					if (!options->quiet)
-						print_insn(&insn, &xed, options,
+						print_insn(&insn, &xed, dcache,
+							   options, stats,
 							   offset);
 					if (stats)
 						stats->insn += 1;
@@ -540,14 +1177,16 @@ static void decode(struct pt_insn_decoder *decoder,
 			}
 
 			if (!options->quiet)
-				print_insn(&insn, &xed, options, offset);
+				print_insn(&insn, &xed, dcache, options,
+					   stats, offset);
 
 			if (stats)
 				stats->insn += 1;
 
 			if (errcode & pts_eos) {
-				if (!insn.disabled && !options->quiet)
-					printf("[end of trace]\n");
+				if (!insn.disabled && !options->quiet &&
+				    !options->bin_format)
+					output_str("[end of trace]\n");
 
 				errcode = -pte_eos;
 				break;
@@ -562,20 +1201,63 @@ static void decode(struct pt_insn_decoder *decoder,
 		if (errcode == -pte_eos)
 			break;
 
-		diagnose("error", decoder, &insn, errcode);
+		diagnose("error", decoder, &insn, errcode, options);
 	}
+
+	output_flush();
+	free(dcache);
 }
 
-static void print_stats(struct ptxed_stats *stats)
+static void print_stats(struct ptxed_stats *stats,
+			const struct ptxed_options *options)
 {
-	if (!stats) {
+	FILE *file;
+
+	if (!stats || !options) {
 		printf("[internal error]\n");
 		return;
 	}
 
-	printf("insn: %" PRIu64 ".\n", stats->insn);
+	/* Don't mix text into the binary output. */
+	file = options->bin_format ? stderr : stdout;
+
+	fprintf(file, "insn: %" PRIu64 ".\n", stats->insn);
+
+	if (options->print_dcache_stats) {
+		fprintf(file, "dcache hit: %" PRIu64 ".\n", stats->dcache_hit);
+		fprintf(file, "dcache miss: %" PRIu64 ".\n",
+			stats->dcache_miss);
+	}
+
+#if defined(FEATURE_RUSAGE)
+	fprintf(file, "minor faults: %" PRIu64 ".\n", stats->minflt);
+	fprintf(file, "major faults: %" PRIu64 ".\n", stats->majflt);
+#endif /* defined(FEATURE_RUSAGE) */
+}
+
+#if defined(FEATURE_RUSAGE)
+
+/* Count the page faults of this process.
+ *
+ * Returns zero on success, -1 otherwise.
+ */
+static int get_faults(uint64_t *minflt, uint64_t *majflt)
+{
+	struct rusage usage;
+	int errcode;
+
+	errcode = getrusage(RUSAGE_SELF, &usage);
+	if (errcode)
+		return -1;
+
+	*minflt = (uint64_t) usage.ru_minflt;
+	*majflt = (uint64_t) usage.ru_majflt;
+
+	return 0;
 }
 
+#endif /* defined(FEATURE_RUSAGE) */
+
 static int get_arg_uint64(uint64_t *value, const char *option, const char *arg,
 			  const char *prog)
 {
@@ -645,9 +1327,11 @@ extern int main(int argc, char *argv[])
 	struct pt_insn_decoder *decoder;
 	struct ptxed_options options;
 	struct ptxed_stats stats;
+	struct ptxed_file file;
 	struct pt_config config;
 	struct pt_image *image;
-	const char *prog;
+	struct pt_perf perf;
+	const char *prog, *save_image;
 	int errcode, i;
 
 	if (!argc) {
@@ -657,9 +1341,12 @@ extern int main(int argc, char *argv[])
 
 	prog = argv[0];
 	decoder = NULL;
+	save_image = NULL;
 
 	memset(&options, 0, sizeof(options));
 	memset(&stats, 0, sizeof(stats));
+	memset(&file, 0, sizeof(file));
+	memset(&perf, 0, sizeof(perf));
 
 	pt_config_init(&config);
 
@@ -701,7 +1388,52 @@ extern int main(int argc, char *argv[])
 			if (errcode < 0)
 				goto err;
 
-			errcode = load_pt(&config, arg, prog);
+			errcode = load_pt(&config, &file, arg,
+					  options.pt_populate, prog);
+			if (errcode < 0)
+				goto err;
+
+			decoder = pt_insn_alloc_decoder(&config);
+			if (!decoder) {
+				fprintf(stderr,
+					"%s: failed to create decoder.\n",
+					prog);
+				goto err;
+			}
+
+			errcode = pt_insn_set_image(decoder, image);
+			if (errcode < 0) {
+				fprintf(stderr,
+					"%s: failed to set image.\n",
+					prog);
+				goto err;
+			}
+
+			continue;
+		}
+		if (strcmp(arg, "--perf") == 0) {
+			if (argc <= i) {
+				fprintf(stderr,
+					"%s: --perf: missing argument.\n",
+					prog);
+				goto out;
+			}
+			arg = argv[i++];
+
+			if (decoder) {
+				fprintf(stderr,
+					"%s: duplicate pt sources: %s.\n",
+					prog, arg);
+				goto err;
+			}
+
+			errcode = load_perf(&config, &perf, &file, arg,
+					    options.pt_populate, prog);
+			if (errcode < 0)
+				goto err;
+
+			/* The perf.data file may have provided the cpu. */
+			errcode = pt_cpu_errata(&config.errata, &config.cpu);
 			if (errcode < 0)
 				goto err;
 
@@ -723,6 +1455,43 @@ extern int main(int argc, char *argv[])
 
 			continue;
 		}
+		if (strcmp(arg, "--perf-image") == 0) {
+			uint32_t pid;
+
+			if (argc <= i) {
+				fprintf(stderr,
+					"%s: --perf-image: missing argument.\n",
+					prog);
+				goto out;
+			}
+			arg = argv[i++];
+
+			if (!perf.begin) {
+				fprintf(stderr,
+					"%s: --perf-image: specify --perf "
+					"first.\n", prog);
+				goto err;
+			}
+
+			if (!get_arg_uint32(&pid, "--perf-image", arg, prog))
+				goto err;
+
+			errcode = pt_perf_image(image, &perf, pid, NULL);
+			if (errcode < 0) {
+				fprintf(stderr,
+					"%s: failed to load image for %s: %s.\n",
+					prog, arg,
+					pt_errstr(pt_errcode(errcode)));
+				goto err;
+			}
+
+			if (errcode)
+				fprintf(stderr,
+					"%s: warning: pid %s: skipped %d "
+					"mappings.\n", prog, arg, errcode);
+
+			continue;
+		}
 		if (strcmp(arg, "--raw") == 0) {
 			if (argc <= i) {
 				fprintf(stderr,
@@ -735,6 +1504,41 @@ extern int main(int argc, char *argv[])
 			if (errcode < 0)
 				goto err;
 
+			continue;
+		}
+		if (strcmp(arg, "--image") == 0) {
+			if (argc <= i) {
+				fprintf(stderr,
+					"%s: --image: missing argument.\n",
+					prog);
+				goto out;
+			}
+			arg = argv[i++];
+
+			errcode = pt_image_load(image, arg);
+			if (errcode < 0) {
+				fprintf(stderr,
+					"%s: failed to load image %s: %s.\n",
+					prog, arg,
+					pt_errstr(pt_errcode(errcode)));
+				goto err;
+			}
+
+			if (options.track_image)
+				printf("%s: image %s: ignored %d sections.\n",
+				       prog, arg, errcode);
+
+			continue;
+		}
+		if (strcmp(arg, "--save-image") == 0) {
+			if (argc <= i) {
+				fprintf(stderr,
+					"%s: --save-image: missing argument.\n",
+					prog);
+				goto out;
+			}
+			save_image = argv[i++];
+
 			continue;
 		}
 #if defined(FEATURE_ELF)
@@ -759,11 +1563,35 @@ extern int main(int argc, char *argv[])
 
 			continue;
 		}
+		if (strcmp(arg, "--kcore") == 0) {
+			if (argc <= i) {
+				fprintf(stderr,
+					"%s: --kcore: missing argument.\n",
+					prog);
+				goto out;
+			}
+			arg = argv[i++];
+
+			errcode = load_kcore(image, arg, prog,
+					     options.track_image);
+			if (errcode < 0)
+				goto err;
+
+			continue;
+		}
 #endif /* defined(FEATURE_ELF) */
 		if (strcmp(arg, "--att") == 0) {
 			options.att_format = 1;
 			continue;
 		}
+		if (strcmp(arg, "--format=text") == 0) {
+			options.bin_format = 0;
+			continue;
+		}
+		if (strcmp(arg, "--format=bin") == 0) {
+			options.bin_format = 1;
+			continue;
+		}
 		if (strcmp(arg, "--no-inst") == 0) {
 			options.dont_print_insn = 1;
 			continue;
@@ -784,6 +1612,23 @@ extern int main(int argc, char *argv[])
 			options.print_stats = 1;
 			continue;
 		}
+		if (strcmp(arg, "--stat-dcache") == 0) {
+			options.print_stats = 1;
+			options.print_dcache_stats = 1;
+			continue;
+		}
+		if (strcmp(arg, "--prefault") == 0) {
+			errcode = pt_image_set_advice(image, ptma_prefault |
+						      ptma_random);
+			if (errcode < 0) {
+				fprintf(stderr,
+					"%s: failed to set map advice: %s.\n",
+					prog, pt_errstr(pt_errcode(errcode)));
+				goto err;
+			}
+
+			continue;
+		}
 		if (strcmp(arg, "--cpu") == 0) {
 			/* override cpu information before the decoder
 			 * is initialized.
@@ -857,6 +1702,10 @@ extern int main(int argc, char *argv[])
 
 			continue;
 		}
+		if (strcmp(arg, "--pt-populate") == 0) {
+			options.pt_populate = 1;
+			continue;
+		}
 		if (strcmp(arg, "--verbose") == 0 || strcmp(arg, "-v") == 0) {
 			options.track_image = 1;
 			continue;
@@ -871,19 +1720,55 @@ extern int main(int argc, char *argv[])
 		goto err;
 	}
 
+	if (save_image) {
+		errcode = pt_image_save(image, save_image);
+		if (errcode < 0) {
+			fprintf(stderr, "%s: failed to save image to %s: %s.\n",
+				prog, save_image,
+				pt_errstr(pt_errcode(errcode)));
+			goto err;
+		}
+	}
+
 	xed_tables_init();
+
+#if defined(FEATURE_RUSAGE)
+	{
+		uint64_t minflt, majflt;
+
+		errcode = get_faults(&minflt, &majflt);
+
+		decode(decoder, &options, &stats);
+
+		if (!errcode)
+			errcode = get_faults(&stats.minflt, &stats.majflt);
+
+		if (!errcode) {
+			stats.minflt -= minflt;
+			stats.majflt -= majflt;
+		} else {
+			stats.minflt = 0ull;
+			stats.majflt = 0ull;
+		}
+	}
+#else /* defined(FEATURE_RUSAGE) */
 	decode(decoder, &options, &stats);
+#endif /* defined(FEATURE_RUSAGE) */
 
 	if (options.print_stats)
-		print_stats(&stats);
+		print_stats(&stats, &options);
 
 out:
 	pt_insn_free_decoder(decoder);
 	pt_image_free(image);
+	pt_perf_fini(&perf);
+	unload_file(&file);
 	return 0;
 
 err:
 	pt_insn_free_decoder(decoder);
 	pt_image_free(image);
+	pt_perf_fini(&perf);
+	unload_file(&file);
 	return 1;
 }
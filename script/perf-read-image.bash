@@ -61,7 +61,7 @@ perf script --no-itrace -i "$file" -D | gawk -F' ' -- '
     else if (match(file, /\.ko$/) != 0) {
       # ignore kernel objects
       #
-      # use /proc/kcore
+      # use ptxed --kcore /proc/kcore
     }
     else {
       printf(" --elf %s:0x%x", file, vaddr)